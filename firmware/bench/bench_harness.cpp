@@ -0,0 +1,197 @@
+/*
+ * bench_harness.cpp - Host microbenchmark harness for TMF firmware kernels
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ */
+
+#include "bench_harness.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MAX_CASES    128
+#define BENCH_MAX_SAMPLES  255
+#define MAD_TO_SIGMA       1.4826
+
+typedef struct {
+    const char *name;
+    Bench_Fn_t fn;
+} Bench_Case_t;
+
+static Bench_Case_t cases[BENCH_MAX_CASES];
+static uint32_t case_count = 0;
+static uint32_t rng_state = 0x12345678u;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static double time_batch(Bench_Fn_t fn, uint64_t iterations) {
+    double start = now_ns();
+    fn(iterations);
+    return now_ns() - start;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median_sorted(const double *values, uint32_t count) {
+    if (count == 0) return 0.0;
+    if (count & 1U) return values[count / 2];
+    return 0.5 * (values[count / 2 - 1] + values[count / 2]);
+}
+
+void Bench_Add(const char *name, Bench_Fn_t fn) {
+    if (case_count >= BENCH_MAX_CASES) {
+        fprintf(stderr, "bench: too many cases, dropping %s\n", name);
+        return;
+    }
+    cases[case_count].name = name;
+    cases[case_count].fn = fn;
+    case_count++;
+}
+
+float Bench_RandomFloat(float lo, float hi) {
+    // xorshift32: identical input streams on every run
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return lo + (hi - lo) * (float)(rng_state >> 8) * (1.0f / 16777216.0f);
+}
+
+static void run_case(const Bench_Case_t *bench, const Bench_Config_t *config, Bench_Result_t *result) {
+    double samples[BENCH_MAX_SAMPLES];
+    double deviations[BENCH_MAX_SAMPLES];
+    uint32_t sample_count = config->samples;
+    if (sample_count > BENCH_MAX_SAMPLES) sample_count = BENCH_MAX_SAMPLES;
+    if (sample_count == 0) sample_count = 1;
+
+    // Calibrate batch size so one sample spans at least min_sample_ms
+    double min_sample_ns = config->min_sample_ms * 1e6;
+    uint64_t batch = 1;
+    double elapsed = time_batch(bench->fn, batch);
+    while (elapsed < min_sample_ns && batch < (1ULL << 40)) {
+        double scale = (elapsed > 0.0) ? (min_sample_ns / elapsed) * 1.2 : 10.0;
+        if (scale < 2.0) scale = 2.0;
+        if (scale > 100.0) scale = 100.0;
+        batch = (uint64_t)((double)batch * scale);
+        elapsed = time_batch(bench->fn, batch);
+    }
+
+    // Warm caches, branch predictors and CPU frequency
+    double warmup_end = now_ns() + config->warmup_ms * 1e6;
+    while (now_ns() < warmup_end) {
+        time_batch(bench->fn, batch);
+    }
+
+    for (uint32_t i = 0; i < sample_count; i++) {
+        samples[i] = time_batch(bench->fn, batch) / (double)batch;
+    }
+
+    qsort(samples, sample_count, sizeof(double), compare_double);
+    double median = median_sorted(samples, sample_count);
+
+    for (uint32_t i = 0; i < sample_count; i++) {
+        deviations[i] = fabs(samples[i] - median);
+    }
+    qsort(deviations, sample_count, sizeof(double), compare_double);
+    double limit = config->mad_threshold * MAD_TO_SIGMA * median_sorted(deviations, sample_count);
+
+    // Samples stay sorted, so the kept set is contiguous
+    uint32_t first = 0;
+    uint32_t last = sample_count;
+    while (first < last && median - samples[first] > limit) first++;
+    while (last > first && samples[last - 1] - median > limit) last--;
+
+    uint32_t kept = last - first;
+    double sum = 0.0;
+    for (uint32_t i = first; i < last; i++) sum += samples[i];
+    double mean = sum / (double)kept;
+
+    double variance = 0.0;
+    for (uint32_t i = first; i < last; i++) {
+        variance += (samples[i] - mean) * (samples[i] - mean);
+    }
+    variance = (kept > 1) ? variance / (double)(kept - 1) : 0.0;
+
+    result->name = bench->name;
+    result->ns_per_op = median_sorted(samples + first, kept);
+    result->mean_ns = mean;
+    result->min_ns = samples[first];
+    result->stddev_ns = sqrt(variance);
+    result->ops_per_sec = (result->ns_per_op > 0.0) ? 1e9 / result->ns_per_op : 0.0;
+    result->batch = batch;
+    result->samples = sample_count;
+    result->kept = kept;
+}
+
+// Quoted JSON string: escapes quotes, backslashes and control characters
+static void write_json_string(FILE *out, const char *text) {
+    fputc('"', out);
+    for (const char *c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') fprintf(out, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20) fprintf(out, "\\u%04x", (unsigned)(unsigned char)*c);
+        else fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+static void write_json(FILE *out, const Bench_Result_t *results, uint32_t count,
+                       const Bench_Config_t *config, const char *label) {
+    fprintf(out, "{\n  \"suite\": \"tmf-bench\",\n  \"format\": 1,\n");
+    fprintf(out, "  \"label\": ");
+    write_json_string(out, label ? label : "");
+    fprintf(out, ",\n");
+    fprintf(out, "  \"config\": {\"samples\": %u, \"min_sample_ms\": %.3f, "
+                 "\"warmup_ms\": %.3f, \"mad_threshold\": %.2f},\n",
+            config->samples, config->min_sample_ms, config->warmup_ms, config->mad_threshold);
+    fprintf(out, "  \"results\": [\n");
+    for (uint32_t i = 0; i < count; i++) {
+        const Bench_Result_t *r = &results[i];
+        fprintf(out, "    {\"name\": ");
+        write_json_string(out, r->name);
+        fprintf(out, ", \"ns_per_op\": %.4f, \"mean_ns\": %.4f, "
+                     "\"min_ns\": %.4f, \"stddev_ns\": %.4f, \"ops_per_sec\": %.1f, "
+                     "\"batch\": %llu, \"samples\": %u, \"kept\": %u}%s\n",
+                r->ns_per_op, r->mean_ns, r->min_ns, r->stddev_ns, r->ops_per_sec,
+                (unsigned long long)r->batch, r->samples, r->kept,
+                (i + 1 < count) ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+int Bench_RunAll(const Bench_Config_t *config, const char *filter,
+                 const char *json_path, const char *label) {
+    static Bench_Result_t results[BENCH_MAX_CASES];
+    uint32_t result_count = 0;
+
+    printf("%-36s %12s %14s %10s %8s\n", "case", "ns/op", "ops/s", "stddev", "kept");
+    for (uint32_t i = 0; i < case_count; i++) {
+        if (filter != NULL && strstr(cases[i].name, filter) == NULL) continue;
+
+        Bench_Result_t *r = &results[result_count++];
+        run_case(&cases[i], config, r);
+        printf("%-36s %12.3f %14.0f %10.3f %5u/%u\n",
+               r->name, r->ns_per_op, r->ops_per_sec, r->stddev_ns, r->kept, r->samples);
+        fflush(stdout);
+    }
+
+    if (json_path != NULL) {
+        FILE *out = fopen(json_path, "w");
+        if (out == NULL) {
+            fprintf(stderr, "bench: cannot write %s\n", json_path);
+            return 1;
+        }
+        write_json(out, results, result_count, config, label);
+        fclose(out);
+    }
+    return 0;
+}
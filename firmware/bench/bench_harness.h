@@ -0,0 +1,71 @@
+/*
+ * bench_harness.h - Host microbenchmark harness for TMF firmware kernels
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Each case runs a kernel for a requested number of iterations. The harness
+ * warms up, calibrates the batch size to a minimum sample time, collects
+ * a fixed number of samples and rejects outliers with a median absolute
+ * deviation filter before reporting ns/op and ops/s.
+ *
+ * Cases come in two flavours by convention:
+ *   <kernel>/throughput  independent inputs, measures issue rate
+ *   <kernel>/latency     each call consumes the previous result
+ */
+
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef void (*Bench_Fn_t)(uint64_t iterations);
+
+typedef struct {
+    const char *name;
+    double ns_per_op;      // Median of the kept samples
+    double mean_ns;        // Mean of the kept samples
+    double min_ns;
+    double stddev_ns;
+    double ops_per_sec;    // 1e9 / ns_per_op
+    uint64_t batch;        // Iterations per sample
+    uint32_t samples;      // Samples taken
+    uint32_t kept;         // Samples surviving outlier rejection
+} Bench_Result_t;
+
+typedef struct {
+    uint32_t samples;       // Samples per case (default 31)
+    double min_sample_ms;   // Minimum wall time per sample (default 2 ms)
+    double warmup_ms;       // Warmup time per case (default 50 ms)
+    double mad_threshold;   // Outlier cutoff in scaled MADs (default 3.0)
+} Bench_Config_t;
+
+// Register a case; name must have static storage duration
+void Bench_Add(const char *name, Bench_Fn_t fn);
+
+// Run all cases whose name contains filter (NULL = all). Results are
+// printed as a table and, if json_path is set, written as JSON.
+int Bench_RunAll(const Bench_Config_t *config, const char *filter,
+                 const char *json_path, const char *label);
+
+// Keep a value alive without emitting a store
+template <typename T>
+static inline void Bench_DoNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Deterministic pseudo-random float in [lo, hi)
+float Bench_RandomFloat(float lo, float hi);
+
+/* --- Suite registration --- */
+
+void Bench_RegisterFlightMath(void);
+void Bench_RegisterEstimators(void);
+void Bench_RegisterSensorIO(void);
+void Bench_RegisterFilters(void);
+void Bench_RegisterLogging(void);
+void Bench_RegisterPropulsion(void);
+void Bench_RegisterPlant(void);
+
+#endif // BENCH_HARNESS_H
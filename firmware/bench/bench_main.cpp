@@ -0,0 +1,72 @@
+/*
+ * bench_main.cpp - Entry point for the TMF host benchmark suite
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Usage: tmf_bench [--filter <substr>] [--json <path>] [--label <rev>]
+ *                  [--samples <n>] [--min-sample-ms <ms>] [--warmup-ms <ms>]
+ *                  [--cpu <index>]
+ */
+
+#include "bench_harness.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--filter substr] [--json path] [--label rev] [--samples n]\n"
+            "          [--min-sample-ms ms] [--warmup-ms ms] [--cpu index]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    Bench_Config_t config = { 31, 2.0, 50.0, 3.0 };
+    const char *filter = NULL;
+    const char *json_path = NULL;
+    const char *label = NULL;
+    int cpu = -1;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (value == NULL) {
+            usage(argv[0]);
+            return 2;
+        }
+        if (strcmp(arg, "--filter") == 0) filter = value;
+        else if (strcmp(arg, "--json") == 0) json_path = value;
+        else if (strcmp(arg, "--label") == 0) label = value;
+        else if (strcmp(arg, "--samples") == 0) config.samples = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--min-sample-ms") == 0) config.min_sample_ms = atof(value);
+        else if (strcmp(arg, "--warmup-ms") == 0) config.warmup_ms = atof(value);
+        else if (strcmp(arg, "--cpu") == 0) cpu = atoi(value);
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+        i++;
+    }
+
+    // Pinning removes migration noise between samples
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            fprintf(stderr, "bench: could not pin to cpu %d\n", cpu);
+        }
+    }
+
+    Bench_RegisterFlightMath();
+    Bench_RegisterEstimators();
+    Bench_RegisterSensorIO();
+    Bench_RegisterFilters();
+    Bench_RegisterLogging();
+    Bench_RegisterPropulsion();
+    Bench_RegisterPlant();
+
+    return Bench_RunAll(&config, filter, json_path, label);
+}
@@ -0,0 +1,74 @@
+/*
+ * estimator_bench.cpp - Benchmarks for the navigation estimator
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Measures the EKF prediction (the 500 Hz cost) and the GPS and baro
+ * updates on a filter that has already been running, so covariance
+ * values are representative rather than initial.
+ */
+
+#include "bench_harness.h"
+#include "nav_ekf.h"
+
+#define TABLE_SIZE 1024
+#define TABLE_MASK (TABLE_SIZE - 1)
+
+static NavEkf_t ekf;
+static IMU_Data_t imu_samples[TABLE_SIZE];
+static uint64_t ekf_time_us = 0;
+
+static void prime_filter(void) {
+    Quaternion_t level = { 1.0f, 0.0f, 0.0f, 0.0f };
+    NavEkf_Config_t config = NavEkf_DefaultConfig();
+    NavEkf_Init(&ekf, &config, level);
+
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        imu_samples[i].accel_x = Bench_RandomFloat(-0.5f, 0.5f);
+        imu_samples[i].accel_y = Bench_RandomFloat(-0.5f, 0.5f);
+        imu_samples[i].accel_z = 9.80665f + Bench_RandomFloat(-0.5f, 0.5f);
+        imu_samples[i].gyro_x = Bench_RandomFloat(-2.0f, 2.0f);
+        imu_samples[i].gyro_y = Bench_RandomFloat(-2.0f, 2.0f);
+        imu_samples[i].gyro_z = Bench_RandomFloat(-2.0f, 2.0f);
+    }
+
+    NavEkf_FuseGps(&ekf, 37.7749, -122.4194, 15.0f, 0);
+    for (int i = 0; i < 2000; i++) {
+        ekf_time_us += 2000;
+        NavEkf_Predict(&ekf, &imu_samples[i & TABLE_MASK], 0.002f, ekf_time_us);
+        if (i % 50 == 0) NavEkf_FuseGps(&ekf, 37.7749, -122.4194, 15.0f, ekf_time_us - 100000);
+        if (i % 10 == 0) NavEkf_FuseBaro(&ekf, 15.0f);
+    }
+}
+
+static void predict_latency(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        ekf_time_us += 2000;
+        NavEkf_Predict(&ekf, &imu_samples[i & TABLE_MASK], 0.002f, ekf_time_us);
+    }
+    Bench_DoNotOptimize(ekf.P);
+}
+
+static void gps_latency(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        double jitter = (double)(i & 7) * 1e-6;
+        NavEkf_FuseGps(&ekf, 37.7749 + jitter, -122.4194, 15.0f, ekf_time_us - 100000);
+    }
+    Bench_DoNotOptimize(ekf.pos);
+}
+
+static void baro_latency(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        NavEkf_FuseBaro(&ekf, 15.0f + (float)(i & 7) * 0.1f);
+    }
+    Bench_DoNotOptimize(ekf.pos);
+}
+
+void Bench_RegisterEstimators(void) {
+    prime_filter();
+
+    Bench_Add("nav_ekf_predict/latency", predict_latency);
+    Bench_Add("nav_ekf_fuse_gps/latency", gps_latency);
+    Bench_Add("nav_ekf_fuse_baro/latency", baro_latency);
+}
@@ -0,0 +1,120 @@
+/*
+ * filter_bench.cpp - Benchmarks for the IMU filter chain
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Covers a single biquad section, a three-section cascade, the per-sample
+ * gyro chain (dynamic notch plus the default one-section cascade on three
+ * axes) and the notch tracker's FFT, both per slice (the cost added to one
+ * control frame) and per full analysis.
+ */
+
+#include "bench_harness.h"
+#include "biquad.h"
+#include "dyn_notch.h"
+#include <math.h>
+
+#define TABLE_SIZE 1024
+#define TABLE_MASK (TABLE_SIZE - 1)
+#define SAMPLE_HZ  2000.0f
+#define CASCADE_STAGES 3
+
+static float gyro_samples[TABLE_SIZE][3];
+static Biquad_t lowpass;
+static Biquad_t cascade[CASCADE_STAGES];
+static Biquad_t gyro_lpf[3];
+static DynNotch_t notch;
+
+static void setup(void) {
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        // 310 Hz vibration on every axis plus broadband noise
+        float vibration = 20.0f * sinf(6.2831853f * 310.0f * (float)i / SAMPLE_HZ);
+        for (int axis = 0; axis < 3; axis++) {
+            gyro_samples[i][axis] = vibration + Bench_RandomFloat(-2.0f, 2.0f);
+        }
+    }
+
+    Biquad_SetLowpass(&lowpass, 150.0f, SAMPLE_HZ, BIQUAD_Q_BUTTERWORTH);
+    Biquad_Reset(&lowpass);
+    // Low-pass, a fixed notch on a frame resonance, second low-pass
+    Biquad_SetLowpass(&cascade[0], 150.0f, SAMPLE_HZ, BIQUAD_Q_BUTTERWORTH);
+    Biquad_SetNotch(&cascade[1], 220.0f, SAMPLE_HZ, 5.0f);
+    Biquad_SetLowpass(&cascade[2], 300.0f, SAMPLE_HZ, BIQUAD_Q_BUTTERWORTH);
+    for (int i = 0; i < CASCADE_STAGES; i++) Biquad_Reset(&cascade[i]);
+    for (int axis = 0; axis < 3; axis++) {
+        Biquad_SetLowpass(&gyro_lpf[axis], 150.0f, SAMPLE_HZ, BIQUAD_Q_BUTTERWORTH);
+        Biquad_Reset(&gyro_lpf[axis]);
+    }
+
+    // Lock the notches so the chain benchmark includes them
+    DynNotch_Init(&notch, SAMPLE_HZ, 80.0f, 900.0f, 3.5f);
+    for (int i = 0; i < 3 * DYN_NOTCH_FFT_SIZE; i++) {
+        DynNotch_AddSample(&notch, gyro_samples[i & TABLE_MASK]);
+        DynNotch_Step(&notch);
+    }
+}
+
+/* --- Single section --- */
+
+static void biquad_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        float y = Biquad_Apply(&lowpass, gyro_samples[i & TABLE_MASK][0]);
+        Bench_DoNotOptimize(y);
+    }
+}
+
+static void biquad_latency(uint64_t iterations) {
+    float y = 0.0f;
+    for (uint64_t i = 0; i < iterations; i++) {
+        y = Biquad_Apply(&lowpass, gyro_samples[i & TABLE_MASK][0] + y * 1e-3f);
+    }
+    Bench_DoNotOptimize(y);
+}
+
+static void cascade_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        float y = Biquad_ApplyCascade(cascade, CASCADE_STAGES, gyro_samples[i & TABLE_MASK][0]);
+        Bench_DoNotOptimize(y);
+    }
+}
+
+/* --- Per-sample gyro chain: record, notch, cascade --- */
+
+static void gyro_chain_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        float g[3] = { gyro_samples[i & TABLE_MASK][0], gyro_samples[i & TABLE_MASK][1],
+                       gyro_samples[i & TABLE_MASK][2] };
+        DynNotch_AddSample(&notch, g);
+        DynNotch_Apply(&notch, g);
+        for (int axis = 0; axis < 3; axis++) g[axis] = Biquad_ApplyCascade(&gyro_lpf[axis], 1, g[axis]);
+        Bench_DoNotOptimize(g);
+    }
+}
+
+/* --- FFT tracker --- */
+
+static void notch_step_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        DynNotch_Step(&notch);
+    }
+    Bench_DoNotOptimize(notch.center_hz);
+}
+
+static void notch_analysis_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        for (int step = 0; step < DYN_NOTCH_FFT_LOG2 + 2; step++) DynNotch_Step(&notch);
+    }
+    Bench_DoNotOptimize(notch.center_hz);
+}
+
+void Bench_RegisterFilters(void) {
+    setup();
+
+    Bench_Add("biquad/throughput", biquad_throughput);
+    Bench_Add("biquad/latency", biquad_latency);
+    Bench_Add("biquad_cascade_x3/throughput", cascade_throughput);
+    Bench_Add("gyro_chain/throughput", gyro_chain_throughput);
+    Bench_Add("dyn_notch_step/throughput", notch_step_throughput);
+    Bench_Add("dyn_notch_fft/throughput", notch_analysis_throughput);
+}
@@ -0,0 +1,589 @@
+/*
+ * flight_math_bench.cpp - Benchmarks for the flight-math kernels
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Covers PID_Update and the SoA PID bank, the quad-X and octo-X mixers, the AHRS update and Euler
+ * extraction, the barometric altitude kernel (against powf), the navigation
+ * great-circle helpers, the minimum-snap planner (one plan, and the
+ * per-tick evaluation of a segment), the geofence queries, against a
+ * brute-force scan of the same fences, terrain lookups in a full DEM
+ * tile cache, and the parameter store (name-hash lookups, and the
+ * per-frame update check plus a gain read the control loop pays).
+ * Inputs come from fixed tables (power-of-two sized, masked index) so the
+ * measurement is dominated by the kernel rather than input generation.
+ */
+
+#include "bench_harness.h"
+#include "ahrs.h"
+#include "flight_control.h"
+#include "geofence.h"
+#include "local_frame.h"
+#include "mixer.h"
+#include "pid_bank.h"
+#include "navigation.h"
+#include "params.h"
+#include "sensors.h"
+#include "terrain.h"
+#include "trajectory.h"
+#include <math.h>
+
+#define TABLE_SIZE 1024
+#define TABLE_MASK (TABLE_SIZE - 1)
+#define PID_LANES  8
+#define AHRS_LANES 8
+#define BATCH_AXES 64
+#define MISSION_WAYPOINTS 1024
+#define FENCE_OUTLINE     512     // Keep-in vertices
+#define FENCE_ISLANDS     4       // Keep-out polygons of 64 vertices
+#define FENCE_POSTS       8       // Keep-out cylinders
+#define DEM_TILES_NORTH   3       // Fills the tile cache
+#define DEM_TILES_EAST    4
+
+#define BANK_OPTIONS FLIGHT_CONTROL_PID_OPTIONS   // The attitude controller's variant
+
+static float setpoints[TABLE_SIZE];
+static float measurements[TABLE_SIZE];
+static float pressures[TABLE_SIZE];
+static IMU_Data_t imu_samples[TABLE_SIZE];
+static Position_t positions[TABLE_SIZE];
+static PID_Controller_t pid_lanes[PID_LANES];
+static AHRS_State_t ahrs_lanes[AHRS_LANES];
+static PID_Controller_t pid_batch[BATCH_AXES];
+static PidBank<3, BANK_OPTIONS> bank3;
+static PidBank<BATCH_AXES, BANK_OPTIONS> bank_batch;
+static Waypoint_t mission_waypoints[MISSION_WAYPOINTS];
+static Mission_Source_t mission_source;
+static TrajectoryPlanner_t planner;
+static Geofence_t geofence;
+static Position_t fence_positions[TABLE_SIZE];
+static Velocity_t fence_velocities[TABLE_SIZE];
+static Terrain_t terrain;
+static Position_t terrain_positions[TABLE_SIZE];
+static uint32_t param_hashes[TABLE_SIZE];
+static Params_t params;
+
+static void fill_tables(void) {
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        setpoints[i] = Bench_RandomFloat(-30.0f, 30.0f);
+        measurements[i] = Bench_RandomFloat(-30.0f, 30.0f);
+        pressures[i] = Bench_RandomFloat(850.0f, 1030.0f);
+
+        imu_samples[i].accel_x = Bench_RandomFloat(-4.0f, 4.0f);
+        imu_samples[i].accel_y = Bench_RandomFloat(-4.0f, 4.0f);
+        imu_samples[i].accel_z = Bench_RandomFloat(7.0f, 11.0f);
+        imu_samples[i].gyro_x = Bench_RandomFloat(-1.0f, 1.0f);
+        imu_samples[i].gyro_y = Bench_RandomFloat(-1.0f, 1.0f);
+        imu_samples[i].gyro_z = Bench_RandomFloat(-1.0f, 1.0f);
+        imu_samples[i].mag_x = Bench_RandomFloat(0.2f, 0.4f);
+        imu_samples[i].mag_y = Bench_RandomFloat(-0.1f, 0.1f);
+        imu_samples[i].mag_z = Bench_RandomFloat(0.4f, 0.6f);
+
+        positions[i].latitude = 37.7749 + Bench_RandomFloat(-0.1f, 0.1f);
+        positions[i].longitude = -122.4194 + Bench_RandomFloat(-0.1f, 0.1f);
+        positions[i].altitude = Bench_RandomFloat(0.0f, 120.0f);
+    }
+    for (int i = 0; i < PID_LANES; i++) {
+        PID_Init(&pid_lanes[i], 6.0f, 0.3f, 0.05f, -1.0f, 1.0f);
+    }
+    for (int i = 0; i < BATCH_AXES; i++) {
+        PID_Init(&pid_batch[i], 6.0f, 0.3f, 0.05f, -1.0f, 1.0f);
+        bank_batch.Configure(i, 6.0f, 0.3f, 0.05f, -1.0f, 1.0f);
+    }
+    for (int i = 0; i < 3; i++) {
+        bank3.Configure(i, 6.0f, 0.3f, 0.05f, -1.0f, 1.0f);
+    }
+    bank3.SetWrap(2, 360.0f);
+    bank3.SetTiming(0.002f);
+    bank3.SetDerivativeCutoff(40.0f);
+    bank3.Reset();
+    bank_batch.SetTiming(0.002f);
+    bank_batch.SetDerivativeCutoff(40.0f);
+    bank_batch.Reset();
+    for (int i = 0; i < AHRS_LANES; i++) {
+        AHRS_Init(&ahrs_lanes[i], AHRS_DEFAULT_KP, AHRS_DEFAULT_KI);
+    }
+
+    // Every eighth lookup is a name the table does not hold
+    Params_Init(&params);
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        int id = (int)Bench_RandomFloat(0.0f, (float)PARAM_COUNT - 0.01f);
+        param_hashes[i] = (i & 7) ? Params_GetInfo((Param_Id_t)id)->hash : (uint32_t)i * 2654435761U;
+    }
+
+    // Random walk of 20-80 m legs, turning up to 90 degrees at each waypoint
+    LocalFrame_t frame;
+    LocalFrame_Init(&frame, positions[0].latitude, positions[0].longitude, 100.0f);
+    float ned[3] = { 0.0f, 0.0f, -100.0f }, heading = 0.0f;
+    for (int i = 0; i < MISSION_WAYPOINTS; i++) {
+        heading += Bench_RandomFloat(-1.57f, 1.57f);
+        float leg = Bench_RandomFloat(20.0f, 80.0f);
+        ned[0] += leg * cosf(heading);
+        ned[1] += leg * sinf(heading);
+        ned[2] = -100.0f + Bench_RandomFloat(-5.0f, 5.0f);
+        Waypoint_t *w = &mission_waypoints[i];
+        LocalFrame_FromNED(&frame, ned, &w->position.latitude, &w->position.longitude, &w->position.altitude);
+        w->hold_time = 0.0f;
+    }
+    Mission_ArraySource(&mission_source, mission_waypoints, MISSION_WAYPOINTS);
+
+    // A ~1.5 km keep-in outline with wavy edges, keep-out islands and
+    // posts inside it; queries cover the outline and a margin around it
+    Geofence_Init(&geofence, positions[0].latitude, positions[0].longitude);
+    Geofence_Vertex_t outline[FENCE_OUTLINE];
+    for (int i = 0; i < FENCE_OUTLINE; i++) {
+        float a = 6.2831853f * (float)i / FENCE_OUTLINE;
+        float r = 1500.0f + 120.0f * sinf(7.0f * a) + 40.0f * sinf(31.0f * a);
+        float ned[3] = { r * cosf(a), r * sinf(a), 0.0f }, alt;
+        LocalFrame_FromNED(&frame, ned, &outline[i].latitude, &outline[i].longitude, &alt);
+    }
+    Geofence_AddPolygon(&geofence, GEOFENCE_KEEP_IN, outline, FENCE_OUTLINE, 0.0f, 120.0f);
+    for (int k = 0; k < FENCE_ISLANDS; k++) {
+        Geofence_Vertex_t island[64];
+        float cn = Bench_RandomFloat(-800.0f, 800.0f), ce = Bench_RandomFloat(-800.0f, 800.0f);
+        for (int i = 0; i < 64; i++) {
+            float a = 6.2831853f * (float)i / 64.0f;
+            float r = 120.0f + 30.0f * sinf(5.0f * a);
+            float ned[3] = { cn + r * cosf(a), ce + r * sinf(a), 0.0f }, alt;
+            LocalFrame_FromNED(&frame, ned, &island[i].latitude, &island[i].longitude, &alt);
+        }
+        Geofence_AddPolygon(&geofence, GEOFENCE_KEEP_OUT, island, 64, 0.0f, 1000.0f);
+    }
+    for (int k = 0; k < FENCE_POSTS; k++) {
+        float ned[3] = { Bench_RandomFloat(-1200.0f, 1200.0f), Bench_RandomFloat(-1200.0f, 1200.0f), 0.0f }, alt;
+        Geofence_Vertex_t center;
+        LocalFrame_FromNED(&frame, ned, &center.latitude, &center.longitude, &alt);
+        Geofence_AddCylinder(&geofence, GEOFENCE_KEEP_OUT, &center, Bench_RandomFloat(20.0f, 80.0f), 0.0f, 60.0f);
+    }
+    Geofence_Build(&geofence);
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        float ned[3] = { Bench_RandomFloat(-1700.0f, 1700.0f), Bench_RandomFloat(-1700.0f, 1700.0f),
+                         -Bench_RandomFloat(10.0f, 110.0f) };
+        Position_t *p = &fence_positions[i];
+        LocalFrame_FromNED(&geofence.frame, ned, &p->latitude, &p->longitude, &p->altitude);
+        float heading = Bench_RandomFloat(0.0f, 6.2831853f);
+        fence_velocities[i].north = 15.0f * cosf(heading);
+        fence_velocities[i].east = 15.0f * sinf(heading);
+        fence_velocities[i].down = 0.0f;
+    }
+
+    // One arc-second DEM of rolling hills, decoded straight into the cache
+    Terrain_Grid_t grid = { 47.35, 8.50, 1.0 / 3600.0, 1.0 / 3600.0, DEM_TILES_NORTH, DEM_TILES_EAST };
+    Terrain_Init(&terrain, &grid);
+    static float heights[TERRAIN_TILE_POSTS * TERRAIN_TILE_POSTS];
+    static uint8_t tile[TERRAIN_MAX_TILE_BYTES];
+    for (uint32_t key = 0; key < DEM_TILES_NORTH * DEM_TILES_EAST; key++) {
+        for (int i = 0; i < TERRAIN_TILE_POSTS * TERRAIN_TILE_POSTS; i++) {
+            float n = (float)((key / DEM_TILES_EAST) * TERRAIN_TILE_CELLS + i / TERRAIN_TILE_POSTS);
+            float e = (float)((key % DEM_TILES_EAST) * TERRAIN_TILE_CELLS + i % TERRAIN_TILE_POSTS);
+            heights[i] = 450.0f + 60.0f * sinf(n * 0.035f) * cosf(e * 0.02f) + Bench_RandomFloat(-1.0f, 1.0f);
+        }
+        Terrain_LoadTile(&terrain, key, tile, Terrain_EncodeTile(heights, tile));
+    }
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        terrain_positions[i].latitude = grid.origin_latitude +
+            Bench_RandomFloat(0.0f, 0.999f) * DEM_TILES_NORTH * TERRAIN_TILE_CELLS * grid.spacing_latitude;
+        terrain_positions[i].longitude = grid.origin_longitude +
+            Bench_RandomFloat(0.0f, 0.999f) * DEM_TILES_EAST * TERRAIN_TILE_CELLS * grid.spacing_longitude;
+    }
+}
+
+/* --- PID_Update --- */
+
+static void pid_throughput(uint64_t iterations) {
+    // Round-robin over lanes so consecutive calls do not share state
+    for (uint64_t i = 0; i < iterations; i++) {
+        float out = PID_Update(&pid_lanes[i & (PID_LANES - 1)],
+                               setpoints[i & TABLE_MASK], measurements[i & TABLE_MASK], 0.01f);
+        Bench_DoNotOptimize(out);
+    }
+}
+
+static void pid_latency(uint64_t iterations) {
+    float measured = 0.0f;
+    for (uint64_t i = 0; i < iterations; i++) {
+        measured = PID_Update(&pid_lanes[0], setpoints[i & TABLE_MASK], measured, 0.01f);
+    }
+    Bench_DoNotOptimize(measured);
+}
+
+/* --- PID bank: three attitude axes, and a 64-axis batch vs scalar --- */
+
+static void pid_scalar3_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        const float *sp = &setpoints[(i & 255) * 3];
+        const float *me = &measurements[(i & 255) * 3];
+        for (int axis = 0; axis < 3; axis++) {
+            float out = PID_Update(&pid_lanes[axis], sp[axis], me[axis], 0.002f);
+            Bench_DoNotOptimize(out);
+        }
+    }
+}
+
+static void pid_bank3_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        bank3.SetTiming(0.002f);
+        bank3.Update(&setpoints[(i & 255) * 3], &measurements[(i & 255) * 3]);
+        Bench_DoNotOptimize(bank3.output);
+    }
+}
+
+static void pid_scalar_batch_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        const float *sp = &setpoints[(i * BATCH_AXES) & TABLE_MASK];
+        const float *me = &measurements[(i * BATCH_AXES) & TABLE_MASK];
+        for (int axis = 0; axis < BATCH_AXES; axis++) {
+            pid_batch[axis].output = PID_Update(&pid_batch[axis], sp[axis], me[axis], 0.002f);
+        }
+        Bench_DoNotOptimize(pid_batch);
+    }
+}
+
+static void pid_bank_batch_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        bank_batch.SetTiming(0.002f);
+        bank_batch.Update(&setpoints[(i * BATCH_AXES) & TABLE_MASK],
+                          &measurements[(i * BATCH_AXES) & TABLE_MASK]);
+        Bench_DoNotOptimize(bank_batch.output);
+    }
+}
+
+/* --- Quad-X mixer --- */
+
+static void mix_throughput(uint64_t iterations) {
+    Motor_Output_t motors;
+    for (uint64_t i = 0; i < iterations; i++) {
+        float r = setpoints[i & TABLE_MASK] * 0.01f;
+        float p = measurements[i & TABLE_MASK] * 0.01f;
+        FlightControl_MixQuadX(0.5f, r, p, r - p, &motors);
+        Bench_DoNotOptimize(motors);
+    }
+}
+
+static void mix_latency(uint64_t iterations) {
+    Motor_Output_t motors = { 0.5f, 0.5f, 0.5f, 0.5f };
+    for (uint64_t i = 0; i < iterations; i++) {
+        float r = (motors.motor1 - 0.5f) + setpoints[i & TABLE_MASK] * 0.01f;
+        FlightControl_MixQuadX(0.5f, r, 0.1f, -0.05f, &motors);
+    }
+    Bench_DoNotOptimize(motors);
+}
+
+static void mix_octo_throughput(uint64_t iterations) {
+    float out[8];
+    for (uint64_t i = 0; i < iterations; i++) {
+        float r = setpoints[i & TABLE_MASK] * 0.01f;
+        float p = measurements[i & TABLE_MASK] * 0.01f;
+        Mixer_Apply<MIXER_OCTO_X>(0.5f, r, p, r - p, 0.0f, 1.0f, out);
+        Bench_DoNotOptimize(out);
+    }
+}
+
+/* --- AHRS --- */
+
+static void ahrs_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        const IMU_Data_t *s = &imu_samples[i & TABLE_MASK];
+        AHRS_State_t *ahrs = &ahrs_lanes[i & (AHRS_LANES - 1)];
+        AHRS_Update(ahrs, s->gyro_x, s->gyro_y, s->gyro_z, s->accel_x, s->accel_y, s->accel_z,
+                    s->mag_x, s->mag_y, s->mag_z, 0.001f);
+        Bench_DoNotOptimize(ahrs->q);
+    }
+}
+
+static void ahrs_latency(uint64_t iterations) {
+    AHRS_State_t *ahrs = &ahrs_lanes[0];
+    for (uint64_t i = 0; i < iterations; i++) {
+        const IMU_Data_t *s = &imu_samples[i & TABLE_MASK];
+        AHRS_Update(ahrs, s->gyro_x, s->gyro_y, s->gyro_z, s->accel_x, s->accel_y, s->accel_z,
+                    s->mag_x, s->mag_y, s->mag_z, 0.001f);
+    }
+    Bench_DoNotOptimize(ahrs->q);
+}
+
+static void ahrs_tilt_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        const IMU_Data_t *s = &imu_samples[i & TABLE_MASK];
+        AHRS_State_t *ahrs = &ahrs_lanes[i & (AHRS_LANES - 1)];
+        AHRS_Update(ahrs, s->gyro_x, s->gyro_y, s->gyro_z, s->accel_x, s->accel_y, s->accel_z,
+                    0.0f, 0.0f, 0.0f, 0.001f);
+        Bench_DoNotOptimize(ahrs->q);
+    }
+}
+
+static void euler_throughput(uint64_t iterations) {
+    float roll, pitch, yaw;
+    for (uint64_t i = 0; i < iterations; i++) {
+        AHRS_GetEuler(&ahrs_lanes[i & (AHRS_LANES - 1)], &roll, &pitch, &yaw);
+        Bench_DoNotOptimize(roll);
+        Bench_DoNotOptimize(pitch);
+        Bench_DoNotOptimize(yaw);
+    }
+}
+
+/* --- Barometric altitude --- */
+
+static void baro_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        float alt = Sensors_PressureToAltitude(pressures[i & TABLE_MASK]);
+        Bench_DoNotOptimize(alt);
+    }
+}
+
+// The exact expression, as Sensors_PressureToAltitude computed it before
+static void baro_powf_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        float alt = 44330.77f * (1.0f - powf(pressures[i & TABLE_MASK] / 1013.25f, 0.190263f));
+        Bench_DoNotOptimize(alt);
+    }
+}
+
+static void baro_latency(uint64_t iterations) {
+    float alt = 0.0f;
+    for (uint64_t i = 0; i < iterations; i++) {
+        alt = Sensors_PressureToAltitude(pressures[i & TABLE_MASK] + alt * 1e-6f);
+    }
+    Bench_DoNotOptimize(alt);
+}
+
+/* --- Navigation great-circle helpers --- */
+
+static void distance_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        float d = Navigation_DistanceBetween(&positions[i & TABLE_MASK],
+                                             &positions[(i + 1) & TABLE_MASK]);
+        Bench_DoNotOptimize(d);
+    }
+}
+
+static void distance_latency(uint64_t iterations) {
+    Position_t a = positions[0];
+    for (uint64_t i = 0; i < iterations; i++) {
+        float d = Navigation_DistanceBetween(&a, &positions[i & TABLE_MASK]);
+        a.latitude = positions[0].latitude + (double)d * 1e-12;
+    }
+    Bench_DoNotOptimize(a);
+}
+
+static void bearing_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        float b = Navigation_BearingBetween(&positions[i & TABLE_MASK],
+                                            &positions[(i + 1) & TABLE_MASK]);
+        Bench_DoNotOptimize(b);
+    }
+}
+
+static void bearing_latency(uint64_t iterations) {
+    Position_t a = positions[0];
+    for (uint64_t i = 0; i < iterations; i++) {
+        float b = Navigation_BearingBetween(&a, &positions[i & TABLE_MASK]);
+        a.longitude = positions[0].longitude + (double)b * 1e-12;
+    }
+    Bench_DoNotOptimize(a);
+}
+
+/* --- Per-tick waypoint geometry: great-circle vs leg tangent plane --- */
+
+static void leg_great_circle_throughput(uint64_t iterations) {
+    const Position_t *target = &positions[0];
+    for (uint64_t i = 0; i < iterations; i++) {
+        const Position_t *here = &positions[i & TABLE_MASK];
+        float d = Navigation_DistanceBetween(here, target);
+        float b = Navigation_BearingBetween(here, target) * 0.0174532925f;
+        float n = d * cosf(b);
+        float e = d * sinf(b);
+        Bench_DoNotOptimize(n);
+        Bench_DoNotOptimize(e);
+    }
+}
+
+static void leg_local_throughput(uint64_t iterations) {
+    LocalFrame_t frame;
+    LocalFrame_Init(&frame, positions[0].latitude, positions[0].longitude, positions[0].altitude);
+    for (uint64_t i = 0; i < iterations; i++) {
+        const Position_t *here = &positions[i & TABLE_MASK];
+        float ned[3];
+        LocalFrame_ToNED(&frame, here->latitude, here->longitude, here->altitude, ned);
+        float d = sqrtf(ned[0] * ned[0] + ned[1] * ned[1]);
+        float b = atan2f(-ned[1], -ned[0]);
+        Bench_DoNotOptimize(d);
+        Bench_DoNotOptimize(b);
+    }
+}
+
+/* --- Minimum-snap trajectory --- */
+
+static void start_mission(void) {
+    Position_t start = { positions[0].latitude, positions[0].longitude, 100.0f };
+    const float at_rest[3] = { 0.0f, 0.0f, 0.0f };
+    TrajectoryPlanner_Start(&planner, &mission_source, &start, at_rest, 0);
+}
+
+static void traj_plan_latency(uint64_t iterations) {
+    // Each call plans one segment; flown segments are dropped unflown
+    for (uint64_t i = 0; i < iterations; i++) {
+        if (planner.plan_next + 1 >= planner.mission_count) start_mission();
+        planner.queue_count = 0;
+        bool planned = TrajectoryPlanner_Service(&planner);
+        Bench_DoNotOptimize(planned);
+    }
+}
+
+static void traj_evaluate_throughput(uint64_t iterations) {
+    start_mission();
+    TrajectoryPlanner_Service(&planner);
+    const Trajectory_Segment_t *segment = &planner.queue[planner.queue_head];
+    for (uint64_t i = 0; i < iterations; i++) {
+        float pos[3], vel[3], acc[3];
+        float t = segment->duration_s * (float)(i & TABLE_MASK) * (1.0f / TABLE_SIZE);
+        Trajectory_Evaluate(segment, t, pos, vel, acc);
+        Bench_DoNotOptimize(pos);
+        Bench_DoNotOptimize(vel);
+        Bench_DoNotOptimize(acc);
+    }
+}
+
+/* --- Geofence: grid index vs scanning every edge --- */
+
+static void fence_check_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        Geofence_Status_t status;
+        Geofence_Check(&geofence, &fence_positions[i & TABLE_MASK], &status);
+        Bench_DoNotOptimize(status);
+    }
+}
+
+static void fence_check_latency(uint64_t iterations) {
+    Position_t p = fence_positions[0];
+    for (uint64_t i = 0; i < iterations; i++) {
+        Geofence_Status_t status;
+        Geofence_Check(&geofence, &p, &status);
+        p = fence_positions[(i + (status.breached ? 1 : 2)) & TABLE_MASK];
+    }
+    Bench_DoNotOptimize(p);
+}
+
+static void fence_brute_throughput(uint64_t iterations) {
+    // Even-odd containment and nearest edge over every vertex, plus the
+    // cylinders: what each check would cost without the index
+    for (uint64_t i = 0; i < iterations; i++) {
+        float ned[3];
+        const Position_t *p = &fence_positions[i & TABLE_MASK];
+        LocalFrame_ToNED(&geofence.frame, p->latitude, p->longitude, p->altitude, ned);
+        uint32_t inside = 0;
+        float nearest = INFINITY;
+        for (uint32_t f = 0; f < geofence.fence_count; f++) {
+            const Geofence_Fence_t *fence = &geofence.fences[f];
+            if (fence->cylinder) {
+                float dn = ned[0] - fence->center[0], de = ned[1] - fence->center[1];
+                float d = sqrtf(dn * dn + de * de) - fence->radius;
+                if (d < 0.0f) inside |= 1u << f;
+                if (d * d < nearest) nearest = d * d;
+                continue;
+            }
+            uint32_t first = fence->first_vertex, last = first + fence->vertex_count - 1;
+            for (uint32_t v = first, prev = last; v <= last; prev = v++) {
+                const float *a = geofence.vertices[prev], *b = geofence.vertices[v];
+                if ((a[0] > ned[0]) != (b[0] > ned[0]) &&
+                    ned[1] < a[1] + (ned[0] - a[0]) * (b[1] - a[1]) / (b[0] - a[0])) {
+                    inside ^= 1u << f;
+                }
+                float ex = b[0] - a[0], ey = b[1] - a[1], px = ned[0] - a[0], py = ned[1] - a[1];
+                float t = (px * ex + py * ey) / (ex * ex + ey * ey);
+                if (t < 0.0f) t = 0.0f;
+                if (t > 1.0f) t = 1.0f;
+                float dx = px - t * ex, dy = py - t * ey;
+                if (dx * dx + dy * dy < nearest) nearest = dx * dx + dy * dy;
+            }
+        }
+        Bench_DoNotOptimize(inside);
+        Bench_DoNotOptimize(nearest);
+    }
+}
+
+static void fence_predict_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        Geofence_Status_t status;
+        Geofence_Predict(&geofence, &fence_positions[i & TABLE_MASK], &fence_velocities[i & TABLE_MASK],
+                         3.0f, &status);
+        Bench_DoNotOptimize(status);
+    }
+}
+
+/* --- Terrain: bilinear lookup in the tile cache --- */
+
+static void terrain_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        const Position_t *p = &terrain_positions[i & TABLE_MASK];
+        float height;
+        Terrain_Height(&terrain, p->latitude, p->longitude, &height);
+        Bench_DoNotOptimize(height);
+    }
+}
+
+static void terrain_latency(uint64_t iterations) {
+    uint32_t index = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        const Position_t *p = &terrain_positions[index];
+        float height = 0.0f;
+        Terrain_Height(&terrain, p->latitude, p->longitude, &height);
+        index = (index + 1 + ((uint32_t)height & 1u)) & TABLE_MASK;
+    }
+    Bench_DoNotOptimize(index);
+}
+
+/* --- Parameters: name lookup and the per-frame read --- */
+
+static void param_find_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        Param_Id_t id = Params_Find(param_hashes[i & TABLE_MASK]);
+        Bench_DoNotOptimize(id);
+    }
+}
+
+static void param_frame_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        bool changed = Params_BeginFrame(&params);
+        float kp = Params_Float(Params_Active(&params), PARAM_ATT_ROLL_KP);
+        Bench_DoNotOptimize(changed);
+        Bench_DoNotOptimize(kp);
+    }
+}
+
+void Bench_RegisterFlightMath(void) {
+    fill_tables();
+
+    Bench_Add("pid_update/throughput", pid_throughput);
+    Bench_Add("pid_update/latency", pid_latency);
+    Bench_Add("pid_scalar_x3/throughput", pid_scalar3_throughput);
+    Bench_Add("pid_bank_x3/throughput", pid_bank3_throughput);
+    Bench_Add("pid_scalar_x64/throughput", pid_scalar_batch_throughput);
+    Bench_Add("pid_bank_x64/throughput", pid_bank_batch_throughput);
+    Bench_Add("quad_mix/throughput", mix_throughput);
+    Bench_Add("quad_mix/latency", mix_latency);
+    Bench_Add("octo_mix/throughput", mix_octo_throughput);
+    Bench_Add("ahrs_update/throughput", ahrs_throughput);
+    Bench_Add("ahrs_update/latency", ahrs_latency);
+    Bench_Add("ahrs_update_tilt/throughput", ahrs_tilt_throughput);
+    Bench_Add("ahrs_euler/throughput", euler_throughput);
+    Bench_Add("baro_altitude/throughput", baro_throughput);
+    Bench_Add("baro_altitude/latency", baro_latency);
+    Bench_Add("baro_altitude_powf/throughput", baro_powf_throughput);
+    Bench_Add("nav_distance/throughput", distance_throughput);
+    Bench_Add("nav_distance/latency", distance_latency);
+    Bench_Add("nav_bearing/throughput", bearing_throughput);
+    Bench_Add("nav_bearing/latency", bearing_latency);
+    Bench_Add("nav_leg_great_circle/throughput", leg_great_circle_throughput);
+    Bench_Add("nav_leg_local/throughput", leg_local_throughput);
+    Bench_Add("traj_plan/latency", traj_plan_latency);
+    Bench_Add("traj_evaluate/throughput", traj_evaluate_throughput);
+    Bench_Add("geofence_check/throughput", fence_check_throughput);
+    Bench_Add("geofence_check/latency", fence_check_latency);
+    Bench_Add("geofence_brute/throughput", fence_brute_throughput);
+    Bench_Add("geofence_predict/throughput", fence_predict_throughput);
+    Bench_Add("terrain_height/throughput", terrain_throughput);
+    Bench_Add("terrain_height/latency", terrain_latency);
+    Bench_Add("param_find/throughput", param_find_throughput);
+    Bench_Add("param_frame/throughput", param_frame_throughput);
+}
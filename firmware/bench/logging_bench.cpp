@@ -0,0 +1,137 @@
+/*
+ * logging_bench.cpp - Benchmarks for the blackbox codec and telemetry framing
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Blackbox: one op is one frame. Encoding is the cost the control loop
+ * pays per logged cycle; decoding is the ground-side rate of
+ * tmf_blackbox_decode. Frames come from a table of slowly varying hover
+ * data with sensor noise, so the intra/delta mix and varint lengths match
+ * a real log.
+ *
+ * Telemetry: the CRC over one IMU_Data_t payload, and the ground-side
+ * parser (one op = one received byte).
+ */
+
+#include "bench_harness.h"
+#include "blackbox.h"
+#include "sensors.h"
+#include "telemetry.h"
+#include <math.h>
+#include <string.h>
+
+#define TABLE_SIZE 1024
+#define TABLE_MASK (TABLE_SIZE - 1)
+
+static Blackbox_Frame_t frames[TABLE_SIZE];
+static uint8_t encoded[TABLE_SIZE * BLACKBOX_MAX_FRAME_BYTES];
+static size_t encoded_length = 0;
+
+static void setup(void) {
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        Blackbox_Frame_t *f = &frames[i];
+        float t = (float)i * 0.002f;
+        f->time_us = (uint64_t)i * 2000U;
+        for (int axis = 0; axis < 3; axis++) {
+            f->gyro[axis] = 5.0f * sinf(3.0f * t + (float)axis) + Bench_RandomFloat(-1.0f, 1.0f);
+            f->accel[axis] = Bench_RandomFloat(-0.2f, 0.2f);
+            f->attitude[axis] = 2.0f * sinf(t + (float)axis);
+            f->command[axis] = 0.0f;
+            f->pid_p[axis] = -0.1f * f->attitude[axis];
+            f->pid_i[axis] = 0.01f * sinf(0.1f * t);
+            f->pid_d[axis] = Bench_RandomFloat(-0.02f, 0.02f);
+        }
+        f->accel[2] += 9.81f;
+        f->command[3] = 0.6f;
+        for (int m = 0; m < 4; m++) f->motors[m] = 0.6f + Bench_RandomFloat(-0.05f, 0.05f);
+    }
+
+    Blackbox_Codec_t codec;
+    Blackbox_CodecInit(&codec);
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        encoded_length += Blackbox_EncodeFrame(&codec, &frames[i], false, encoded + encoded_length);
+    }
+}
+
+static void encode_throughput(uint64_t iterations) {
+    static Blackbox_Codec_t codec;
+    uint8_t out[BLACKBOX_MAX_FRAME_BYTES];
+    size_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        total += Blackbox_EncodeFrame(&codec, &frames[i & TABLE_MASK], false, out);
+        Bench_DoNotOptimize(out[0]);
+    }
+    Bench_DoNotOptimize(total);
+}
+
+static void decode_throughput(uint64_t iterations) {
+    Blackbox_Codec_t codec;
+    Blackbox_CodecInit(&codec);
+    Blackbox_Frame_t frame;
+    size_t pos = 0;
+    char type;
+    for (uint64_t i = 0; i < iterations; i++) {
+        if (pos >= encoded_length) {
+            pos = 0;
+            Blackbox_CodecInit(&codec);
+        }
+        pos += Blackbox_DecodeFrame(&codec, encoded + pos, encoded_length - pos, &type, &frame);
+        Bench_DoNotOptimize(frame);
+    }
+}
+
+/* --- Telemetry --- */
+
+#define LINK_STREAM_SIZE 4096
+#define LINK_STREAM_MASK (LINK_STREAM_SIZE - 1)
+
+static uint8_t link_stream[LINK_STREAM_SIZE];
+
+// Back-to-back attitude frames, as tmf_telemetry_dump would receive them
+static void build_link_stream(void) {
+    IMU_Data_t imu;
+    memset(&imu, 0, sizeof(imu));
+    imu.accel_z = 9.81f;
+
+    uint8_t frame[sizeof(IMU_Data_t) + TELEMETRY_OVERHEAD];
+    for (size_t pos = 0, seq = 0; pos < LINK_STREAM_SIZE; seq++) {
+        imu.roll = Bench_RandomFloat(-5.0f, 5.0f);
+        frame[0] = TELEMETRY_SYNC;
+        frame[1] = sizeof(IMU_Data_t);
+        frame[2] = TELEMETRY_MSG_ATTITUDE;
+        frame[3] = (uint8_t)seq;
+        memcpy(&frame[4], &imu, sizeof(imu));
+        uint16_t crc = Telemetry_Crc16(0xFFFF, &frame[1], 3 + sizeof(imu));
+        frame[4 + sizeof(imu)] = (uint8_t)(crc & 0xFF);
+        frame[5 + sizeof(imu)] = (uint8_t)(crc >> 8);
+        for (size_t i = 0; i < sizeof(frame) && pos < LINK_STREAM_SIZE; i++) link_stream[pos++] = frame[i];
+    }
+}
+
+static void crc_throughput(uint64_t iterations) {
+    uint16_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        total ^= Telemetry_Crc16(0xFFFF, &link_stream[(i * 7) & 1023], sizeof(IMU_Data_t));
+    }
+    Bench_DoNotOptimize(total);
+}
+
+static void parse_throughput(uint64_t iterations) {
+    static Telemetry_Parser_t parser;
+    uint32_t frames = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        frames += Telemetry_ParseByte(&parser, link_stream[i & LINK_STREAM_MASK]);
+    }
+    Bench_DoNotOptimize(frames);
+}
+
+void Bench_RegisterLogging(void) {
+    setup();
+    build_link_stream();
+
+    Bench_Add("blackbox_encode/throughput", encode_throughput);
+    Bench_Add("blackbox_decode/throughput", decode_throughput);
+    Bench_Add("telemetry_crc16/throughput", crc_throughput);
+    Bench_Add("telemetry_parse/throughput", parse_throughput);
+}
@@ -0,0 +1,85 @@
+/*
+ * plant_bench.cpp - Benchmarks for the batched vehicle plant
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * One op is one vehicle advanced by one RK4 step, so batch sizes compare
+ * directly: the 1-vehicle case is the SIL cost, the larger batches show
+ * what the struct-of-arrays step gains once it vectorizes. Vehicles hover
+ * in gusty wind with slightly different motor commands, so every lane
+ * does real work. At 8 kHz a core steps 1e9 / (8000 * ns/op) vehicles.
+ *
+ * plant_imu samples the IMU of the whole batch; one op is one vehicle.
+ */
+
+#include "bench_harness.h"
+#include "vehicle_plant.h"
+
+#define PLANT_DT (1.0f / 8000.0f)
+#define SMALL_BATCH 64
+#define LARGE_BATCH 1024
+
+static VehiclePlant_t single;
+static VehiclePlant_t small_batch;
+static VehiclePlant_t large_batch;
+static IMU_Sample_t imu_samples[LARGE_BATCH];
+
+static void setup_batch(VehiclePlant_t *plant, uint32_t count) {
+    VehiclePlant_Init(plant, count, 37.7749, -122.4194, 15.0f, 1);
+    for (uint32_t i = 0; i < count; i++) {
+        float ned[3] = { 0.0f, 0.0f, -20.0f };
+        VehiclePlant_Wind_t wind = { { Bench_RandomFloat(-5.0f, 5.0f), Bench_RandomFloat(-5.0f, 5.0f), 0.0f },
+                                     Bench_RandomFloat(0.0f, 2.0f), 2.0f };
+        VehiclePlant_SetWind(plant, i, &wind);
+        VehiclePlant_Place(plant, i, ned, Bench_RandomFloat(-180.0f, 180.0f));
+
+        float hover = plant->command[0][i];
+        Motor_Output_t motors = { hover + Bench_RandomFloat(-0.01f, 0.01f), hover + Bench_RandomFloat(-0.01f, 0.01f),
+                                  hover + Bench_RandomFloat(-0.01f, 0.01f), hover + Bench_RandomFloat(-0.01f, 0.01f) };
+        VehiclePlant_SetMotors(plant, i, &motors);
+    }
+}
+
+static void setup(void) {
+    setup_batch(&single, 1);
+    setup_batch(&small_batch, SMALL_BATCH);
+    setup_batch(&large_batch, LARGE_BATCH);
+}
+
+/* --- Step --- */
+
+// Each step consumes the last, so a single vehicle is a latency chain
+static void step_single_latency(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) VehiclePlant_Step(&single, PLANT_DT);
+    Bench_DoNotOptimize(single.vel[0][0]);
+}
+
+static void step_small_throughput(uint64_t iterations) {
+    for (uint64_t done = 0; done < iterations; done += SMALL_BATCH) VehiclePlant_Step(&small_batch, PLANT_DT);
+    Bench_DoNotOptimize(small_batch.vel[0][0]);
+}
+
+static void step_large_throughput(uint64_t iterations) {
+    for (uint64_t done = 0; done < iterations; done += LARGE_BATCH) VehiclePlant_Step(&large_batch, PLANT_DT);
+    Bench_DoNotOptimize(large_batch.vel[0][0]);
+}
+
+/* --- Sensors --- */
+
+static void imu_throughput(uint64_t iterations) {
+    uint64_t time_us = 0;
+    for (uint64_t done = 0; done < iterations; done += LARGE_BATCH) {
+        VehiclePlant_SampleImu(&large_batch, time_us++, imu_samples);
+        Bench_DoNotOptimize(imu_samples[0]);
+    }
+}
+
+void Bench_RegisterPlant(void) {
+    setup();
+
+    Bench_Add("plant_step_1/latency", step_single_latency);
+    Bench_Add("plant_step_64/throughput", step_small_throughput);
+    Bench_Add("plant_step_1024/throughput", step_large_throughput);
+    Bench_Add("plant_imu/throughput", imu_throughput);
+}
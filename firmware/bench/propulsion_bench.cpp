@@ -0,0 +1,175 @@
+/*
+ * propulsion_bench.cpp - Benchmarks for the coil drive path
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Covers the frequency-to-period lookup (what every retune pays), a full
+ * retune through the timer shadow registers, and setting up an amplitude
+ * ramp (filling one COIL_RAMP_SAMPLES waveform buffer and re-arming the
+ * DAC DMA). The ramp itself costs no CPU once started.
+ *
+ * Resonance tracking: one op is one RESONANCE_BLOCK_CYCLES block, the
+ * work the coil ADC callback does per update. Blocks are recorded from
+ * the simulated tank at a spread of detunings. Lock time and jitter are
+ * simulated-time figures and come from tmf_resonance_sim instead.
+ *
+ * DShot: one op encodes one ESC frame, or decodes one captured eRPM reply
+ * (edge times at DShot600 over a spread of motor speeds).
+ */
+
+#include "bench_harness.h"
+#include "coil_control.h"
+#include "coil_plant.h"
+#include "propulsion_driver.h"
+#include "resonance_tracker.h"
+
+#define TABLE_SIZE 1024
+#define TABLE_MASK (TABLE_SIZE - 1)
+
+static uint32_t frequencies[TABLE_SIZE];
+static float amplitudes[TABLE_SIZE];
+
+#define BLOCK_COUNT 16
+#define BLOCK_MASK (BLOCK_COUNT - 1)
+
+static uint16_t block_in_phase[BLOCK_COUNT][RESONANCE_BLOCK_CYCLES];
+static uint16_t block_quadrature[BLOCK_COUNT][RESONANCE_BLOCK_CYCLES];
+
+#define REPLY_COUNT 64
+#define REPLY_MASK (REPLY_COUNT - 1)
+#define REPLY_BIT_COUNTS 144    // DShot600 reply bit at 108 MHz
+
+static uint16_t throttle_values[TABLE_SIZE];
+static uint16_t reply_edges[REPLY_COUNT][DSHOT_CAPTURE_EDGES];
+static uint32_t reply_lengths[REPLY_COUNT];
+
+static void setup(void) {
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        frequencies[i] = (uint32_t)Bench_RandomFloat((float)COIL_FREQ_MIN_HZ, (float)COIL_FREQ_MAX_HZ);
+        amplitudes[i] = Bench_RandomFloat(0.0f, 1.0f);
+        throttle_values[i] = (uint16_t)Bench_RandomFloat(DSHOT_THROTTLE_MIN, DSHOT_THROTTLE_MAX);
+    }
+    CoilControl_Init();
+}
+
+// Settle the tank at each detuning, then record one block
+static void record_blocks(void) {
+    ResonanceTracker_Config_t config;
+    ResonanceTracker_DefaultConfig(&config);
+    ResonanceTracker_Init(&config, 1100000);
+
+    CoilPlant_t plant;
+    CoilPlant_Init(&plant, 1100000.0, 50.0, 4.0f);
+    CoilControl_Cycle_t cycle;
+    for (int b = 0; b < BLOCK_COUNT; b++) {
+        CoilPlant_SetResonance(&plant, 1100000.0 + (b - BLOCK_COUNT / 2) * 2000.0);
+        for (int n = 0; n < 4 * RESONANCE_BLOCK_CYCLES; n++) {
+            int k = n % RESONANCE_BLOCK_CYCLES;
+            CoilPlant_NextCycle(&plant, &cycle);
+            CoilPlant_RunCycle(&plant, &cycle, &block_in_phase[b][k], &block_quadrature[b][k]);
+        }
+    }
+}
+
+// Replies as the ESC sends them: GCR-coded period, NRZI on the line
+static void record_replies(void) {
+    static const uint8_t gcr[16] = { 0x19, 0x1B, 0x12, 0x13, 0x1D, 0x15, 0x16, 0x17,
+                                     0x1A, 0x09, 0x0A, 0x0B, 0x1E, 0x0D, 0x0E, 0x0F };
+    for (int r = 0; r < REPLY_COUNT; r++) {
+        uint32_t period = (uint32_t)Bench_RandomFloat(60.0f, 2000.0f), exponent = 0;
+        while (period > 0x1FFU) {
+            period >>= 1;
+            exponent++;
+        }
+        uint32_t value = (exponent << 9) | period;
+        uint32_t word = (value << 4) | (~(value ^ (value >> 4) ^ (value >> 8)) & 0xFU);
+        uint32_t code = 0;
+        for (int n = 3; n >= 0; n--) code = (code << 5) | gcr[(word >> (n * 4)) & 0xFU];
+
+        uint32_t count = 0, level = 0;
+        reply_edges[r][count++] = 1000;
+        for (int k = 1; k < DSHOT_REPLY_BITS; k++) {
+            if (!((code >> (DSHOT_REPLY_BITS - 1 - k)) & 1U)) continue;
+            level ^= 1U;
+            reply_edges[r][count++] = (uint16_t)(1000 + k * REPLY_BIT_COUNTS);
+        }
+        if (level == 0) reply_edges[r][count++] = (uint16_t)(1000 + DSHOT_REPLY_BITS * REPLY_BIT_COUNTS);
+        reply_lengths[r] = count;
+    }
+}
+
+static void period_lookup_throughput(uint64_t iterations) {
+    uint32_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        total += CoilControl_PeriodForFrequency(frequencies[i & TABLE_MASK]);
+    }
+    Bench_DoNotOptimize(total);
+}
+
+static void set_frequency_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        bool ok = CoilControl_SetFrequency(frequencies[i & TABLE_MASK]);
+        Bench_DoNotOptimize(ok);
+    }
+}
+
+static void ramp_start_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        bool ok = CoilControl_RampAmplitude(amplitudes[i & TABLE_MASK], 2000, COIL_RAMP_SCURVE);
+        Bench_DoNotOptimize(ok);
+    }
+}
+
+static void resonance_detect_throughput(uint64_t iterations) {
+    float total = 0.0f;
+    for (uint64_t i = 0; i < iterations; i++) {
+        float amplitude;
+        total += ResonanceTracker_Detect(block_in_phase[i & BLOCK_MASK], block_quadrature[i & BLOCK_MASK],
+                                         RESONANCE_BLOCK_CYCLES, &amplitude);
+    }
+    Bench_DoNotOptimize(total);
+}
+
+static void resonance_update_throughput(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        ResonanceTracker_ProcessBlock(block_in_phase[i & BLOCK_MASK], block_quadrature[i & BLOCK_MASK],
+                                      RESONANCE_BLOCK_CYCLES);
+    }
+    ResonanceTracker_Status_t status;
+    ResonanceTracker_GetStatus(&status);
+    Bench_DoNotOptimize(status);
+}
+
+static void dshot_encode_throughput(uint64_t iterations) {
+    uint32_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        total += PropulsionDriver_EncodeFrame(throttle_values[i & TABLE_MASK], false, true);
+    }
+    Bench_DoNotOptimize(total);
+}
+
+static void dshot_decode_reply_throughput(uint64_t iterations) {
+    uint32_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        uint32_t erpm = 0;
+        bool ok = PropulsionDriver_DecodeReply(reply_edges[i & REPLY_MASK], reply_lengths[i & REPLY_MASK],
+                                               REPLY_BIT_COUNTS, &erpm);
+        total += ok ? erpm : 0;
+    }
+    Bench_DoNotOptimize(total);
+}
+
+void Bench_RegisterPropulsion(void) {
+    setup();
+    record_blocks();
+    record_replies();
+
+    Bench_Add("coil_period_lookup/throughput", period_lookup_throughput);
+    Bench_Add("coil_set_frequency/throughput", set_frequency_throughput);
+    Bench_Add("coil_ramp_start/throughput", ramp_start_throughput);
+    Bench_Add("resonance_detect/throughput", resonance_detect_throughput);
+    Bench_Add("resonance_update/throughput", resonance_update_throughput);
+    Bench_Add("dshot_encode/throughput", dshot_encode_throughput);
+    Bench_Add("dshot_decode_reply/throughput", dshot_decode_reply_throughput);
+}
@@ -0,0 +1,120 @@
+/*
+ * sensor_io_bench.cpp - Benchmarks for the sensor acquisition path
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Covers the GPS stream parser (one op = one received byte, so ns/op is
+ * directly the per-byte cost on the UART path), the IMU sample ring and
+ * the power monitor's ADC callback and snapshot read.
+ */
+
+#include "bench_harness.h"
+#include "gps_parser.h"
+#include "hardware_drivers.h"
+#include "imu_stream.h"
+#include "power_monitor.h"
+#include <stdio.h>
+#include <string.h>
+
+#define STREAM_SIZE 4096
+#define STREAM_MASK (STREAM_SIZE - 1)
+
+static uint8_t nmea_stream[STREAM_SIZE];
+static uint8_t ubx_stream[STREAM_SIZE];
+static GpsParser_t parser;
+
+// Repeat one message until the buffer is full; the tail is a partial copy
+static void fill_stream(uint8_t *stream, const uint8_t *message, size_t length) {
+    for (size_t i = 0; i < STREAM_SIZE; i++) stream[i] = message[i % length];
+}
+
+static void build_streams(void) {
+    static const char body[] = "GNGGA,123519.00,4807.03812,N,01131.00024,E,1,12,0.9,545.4,M,46.9,M,,";
+    char sentence[128];
+    uint8_t checksum = 0;
+    for (const char *c = body; *c; c++) checksum ^= (uint8_t)*c;
+    int length = snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+    fill_stream(nmea_stream, (const uint8_t *)sentence, (size_t)length);
+
+    uint8_t frame[6 + 92 + 2] = { 0xB5, 0x62, 0x01, 0x07, 92, 0 };
+    frame[6 + 20] = 3;
+    frame[6 + 21] = 0x01;
+    frame[6 + 23] = 12;
+    frame[6 + 28] = 0x40;
+    uint8_t ck_a = 0, ck_b = 0;
+    for (size_t i = 2; i < 6 + 92; i++) {
+        ck_a = (uint8_t)(ck_a + frame[i]);
+        ck_b = (uint8_t)(ck_b + ck_a);
+    }
+    frame[98] = ck_a;
+    frame[99] = ck_b;
+    fill_stream(ubx_stream, frame, sizeof(frame));
+
+    GpsParser_Init(&parser);
+}
+
+/* --- GPS parser --- */
+
+static void nmea_throughput(uint64_t iterations) {
+    uint32_t fixes = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        fixes += GpsParser_Feed(&parser, nmea_stream[i & STREAM_MASK], i);
+    }
+    Bench_DoNotOptimize(fixes);
+}
+
+static void ubx_throughput(uint64_t iterations) {
+    uint32_t fixes = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        fixes += GpsParser_Feed(&parser, ubx_stream[i & STREAM_MASK], i);
+    }
+    Bench_DoNotOptimize(fixes);
+}
+
+/* --- IMU ring: one publish plus one single-sample drain --- */
+
+static void imu_ring_throughput(uint64_t iterations) {
+    IMU_Sample_t sample;
+    memset(&sample, 0, sizeof(sample));
+    IMU_Sample_t out;
+    for (uint64_t i = 0; i < iterations; i++) {
+        sample.timestamp_us = i;
+        ImuStream_Publish(&sample);
+        ImuStream_Drain(&out, 1);
+        Bench_DoNotOptimize(out);
+    }
+}
+
+/* --- Power monitor: one op = one ADC scan folded in, or one snapshot --- */
+
+static uint16_t adc_block[POWER_ADC_BLOCK_SCANS * POWER_CHANNEL_COUNT];
+
+static void power_adc_block_throughput(uint64_t iterations) {
+    uint64_t blocks = (iterations + POWER_ADC_BLOCK_SCANS - 1) / POWER_ADC_BLOCK_SCANS;
+    for (uint64_t b = 0; b < blocks; b++) {
+        PowerMonitor_OnAdcBlock(adc_block, POWER_ADC_BLOCK_SCANS, b * 10000U);
+    }
+}
+
+static void power_snapshot_throughput(uint64_t iterations) {
+    PowerMonitor_Snapshot_t snapshot;
+    for (uint64_t i = 0; i < iterations; i++) {
+        PowerMonitor_GetSnapshot(&snapshot);
+        Bench_DoNotOptimize(snapshot);
+    }
+}
+
+void Bench_RegisterSensorIO(void) {
+    build_streams();
+    ImuStream_Reset();
+    for (size_t i = 0; i < sizeof(adc_block) / sizeof(adc_block[0]); i++) {
+        adc_block[i] = (uint16_t)Bench_RandomFloat(1000.0f, 3000.0f);
+    }
+
+    Bench_Add("gps_parse_nmea/throughput", nmea_throughput);
+    Bench_Add("gps_parse_ubx/throughput", ubx_throughput);
+    Bench_Add("imu_ring/throughput", imu_ring_throughput);
+    Bench_Add("power_adc_block/throughput", power_adc_block_throughput);
+    Bench_Add("power_snapshot/throughput", power_snapshot_throughput);
+}
@@ -0,0 +1,140 @@
+/*
+ * coil_plant.cpp - Simulated resonant coil tank for SIL and benchmarks
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * State x = [i, vC], L di/dt = v - R i - vC, C dvC/dt = i. With R = 1,
+ * L = Q / w0 and C = 1 / (w0^2 L). The tick is under 0.1 rad at the top
+ * of the band, so an eighth-order Taylor series of the matrix exponential
+ * is exact to double precision.
+ */
+
+#include "coil_plant.h"
+#include "resonance_tracker.h"
+#include "stm32f7xx_hal.h"
+#include <math.h>
+#include <string.h>
+
+#define PLANT_ADC_MAX      4095
+#define PLANT_PEAK_COUNTS  1600.0
+#define PLANT_TAYLOR_ORDER 8
+
+extern TIM_HandleTypeDef htim2;
+
+static float gaussian(uint32_t *state);
+
+void CoilPlant_Init(CoilPlant_t *plant, double resonance_hz, double quality, float noise_counts) {
+    memset(plant, 0, sizeof(*plant));
+    plant->quality = quality;
+    plant->tick_s = 1.0 / (2.0 * (double)HAL_RCC_GetPCLK1Freq());
+    plant->counts_per_amp = PLANT_PEAK_COUNTS * M_PI / 4.0;
+    plant->noise_counts = noise_counts;
+    plant->rng = 0x2545F491U;
+    CoilPlant_SetResonance(plant, resonance_hz);
+}
+
+void CoilPlant_SetResonance(CoilPlant_t *plant, double resonance_hz) {
+    double w0 = 2.0 * M_PI * resonance_hz;
+    double inductance = plant->quality / w0;
+    double capacitance = 1.0 / (w0 * w0 * inductance);
+    double h = plant->tick_s;
+    double a[2][2] = { { -h / inductance, -h / inductance }, { h / capacitance, 0.0 } };
+
+    // phi = sum (Ah)^k / k!, psi = sum (Ah)^k / (k+1)!
+    double term[2][2] = { { 1.0, 0.0 }, { 0.0, 1.0 } };
+    double phi[2][2] = { { 1.0, 0.0 }, { 0.0, 1.0 } };
+    double psi[2][2] = { { 1.0, 0.0 }, { 0.0, 1.0 } };
+    for (int k = 1; k <= PLANT_TAYLOR_ORDER; k++) {
+        double next[2][2];
+        for (int r = 0; r < 2; r++) {
+            for (int c = 0; c < 2; c++) {
+                next[r][c] = (term[r][0] * a[0][c] + term[r][1] * a[1][c]) / k;
+            }
+        }
+        memcpy(term, next, sizeof(term));
+        for (int r = 0; r < 2; r++) {
+            for (int c = 0; c < 2; c++) {
+                phi[r][c] += term[r][c];
+                psi[r][c] += term[r][c] / (k + 1);
+            }
+        }
+    }
+
+    memcpy(plant->phi, phi, sizeof(phi));
+    plant->gamma[0] = psi[0][0] * h / inductance;
+    plant->gamma[1] = psi[1][0] * h / inductance;
+    plant->resonance_hz = resonance_hz;
+}
+
+void CoilPlant_NextCycle(const CoilPlant_t *plant, CoilControl_Cycle_t *cycle) {
+    const DMA_Stream_TypeDef *burst = htim2.hdma[TIM_DMA_ID_UPDATE]->Instance;
+    uint32_t entries = burst->NDTR / (sizeof(CoilControl_Cycle_t) / sizeof(uint32_t));
+    if ((burst->CR & DMA_SxCR_EN) && entries > 0) {
+        const CoilControl_Cycle_t *pattern = (const CoilControl_Cycle_t *)burst->M0AR;
+        *cycle = pattern[plant->cycle % entries];
+        return;
+    }
+
+    const TIM_TypeDef *tim = htim2.Instance;
+    cycle->arr = tim->ARR;
+    cycle->rcr = 0;
+    cycle->ccr_drive = tim->CCR1;
+    cycle->ccr_in_phase = tim->CCR2;
+    cycle->ccr_quadrature = tim->CCR3;
+}
+
+void CoilPlant_RunCycle(CoilPlant_t *plant, const CoilControl_Cycle_t *cycle,
+                        uint16_t *in_phase, uint16_t *quadrature) {
+    double i = plant->current;
+    double v = plant->cap_voltage;
+    uint32_t count = cycle->arr + 1U;
+    double samples[2] = { 0.0, 0.0 };
+
+    for (uint32_t n = 0; n < count; n++) {
+        if (n == cycle->ccr_in_phase) samples[0] = i;
+        if (n == cycle->ccr_quadrature) samples[1] = i;
+        double drive = (n < cycle->ccr_drive) ? 1.0 : -1.0;
+        double i_next = plant->phi[0][0] * i + plant->phi[0][1] * v + plant->gamma[0] * drive;
+        v = plant->phi[1][0] * i + plant->phi[1][1] * v + plant->gamma[1] * drive;
+        i = i_next;
+    }
+    plant->current = i;
+    plant->cap_voltage = v;
+    plant->cycle++;
+    plant->time_s += (double)count * plant->tick_s;
+
+    uint16_t *outputs[2] = { in_phase, quadrature };
+    for (int k = 0; k < 2; k++) {
+        double code = RESONANCE_ADC_MIDSCALE + samples[k] * plant->counts_per_amp
+                      + plant->noise_counts * gaussian(&plant->rng);
+        long rounded = lround(code);
+        if (rounded < 0) rounded = 0;
+        if (rounded > PLANT_ADC_MAX) rounded = PLANT_ADC_MAX;
+        *outputs[k] = (uint16_t)rounded;
+    }
+}
+
+double CoilPlant_RelativePower(const CoilPlant_t *plant, double drive_hz) {
+    double x = plant->quality * (drive_hz / plant->resonance_hz - plant->resonance_hz / drive_hz);
+    return 1.0 / (1.0 + x * x);
+}
+
+double CoilPlant_Phase(const CoilPlant_t *plant, double drive_hz) {
+    double x = plant->quality * (drive_hz / plant->resonance_hz - plant->resonance_hz / drive_hz);
+    return -atan(x);
+}
+
+// Unit-variance noise: sum of four uniforms
+static float gaussian(uint32_t *state) {
+    float sum = 0.0f;
+    for (int k = 0; k < 4; k++) {
+        uint32_t x = *state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        *state = x;
+        sum += (float)x * (1.0f / 4294967296.0f) - 0.5f;
+    }
+    return sum * 1.7320508f;
+}
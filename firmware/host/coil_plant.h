@@ -0,0 +1,60 @@
+/*
+ * coil_plant.h - Simulated resonant coil tank for SIL and benchmarks
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * A series RLC tank driven by the coil H-bridge (+/-1 V square wave) and
+ * sensed by the 12-bit coil current ADC. The circuit is integrated
+ * exactly, one timer tick at a time, with the state transition matrix
+ * of the tick precomputed, so the drive edges and ADC sample points land
+ * on the same counts the real timer uses. Moving the resonance (plasma
+ * load changes) only recomputes that matrix; the tank's stored energy
+ * carries over, so transients are real.
+ *
+ * Drive cycles are taken from the coil timer's update DMA burst (the
+ * dither pattern coil_control.cpp programs), replayed in order.
+ */
+
+#ifndef COIL_PLANT_H
+#define COIL_PLANT_H
+
+#include "coil_control.h"
+#include <stdint.h>
+
+typedef struct {
+    double resonance_hz;
+    double quality;
+    double tick_s;              // One timer count
+    double phi[2][2];           // State transition over one tick
+    double gamma[2];            // Response to the drive voltage over one tick
+    double current;             // A (R = 1 ohm, so 1 V on resonance is 4/pi A)
+    double cap_voltage;         // V
+    double counts_per_amp;      // Sense gain: 1600 counts peak on resonance
+    float noise_counts;         // RMS ADC noise
+    uint32_t rng;
+    uint64_t cycle;             // Cycles run, indexes the dither pattern
+    double time_s;              // Simulated time
+} CoilPlant_t;
+
+// Tank at resonance_hz with the given Q, clocked like the coil timer
+void CoilPlant_Init(CoilPlant_t *plant, double resonance_hz, double quality, float noise_counts);
+
+// Move the resonance, keeping the tank's current and capacitor voltage
+void CoilPlant_SetResonance(CoilPlant_t *plant, double resonance_hz);
+
+// The cycle the coil timer runs next, from its update burst (or its
+// registers if the burst is stopped)
+void CoilPlant_NextCycle(const CoilPlant_t *plant, CoilControl_Cycle_t *cycle);
+
+// Run one drive cycle and return the two ADC conversions it triggers
+void CoilPlant_RunCycle(CoilPlant_t *plant, const CoilControl_Cycle_t *cycle,
+                        uint16_t *in_phase, uint16_t *quadrature);
+
+// Steady-state power at drive_hz relative to driving on resonance
+double CoilPlant_RelativePower(const CoilPlant_t *plant, double drive_hz);
+
+// Current phase at drive_hz, radians (positive leads, below resonance)
+double CoilPlant_Phase(const CoilPlant_t *plant, double drive_hz);
+
+#endif // COIL_PLANT_H
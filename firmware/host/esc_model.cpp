@@ -0,0 +1,187 @@
+/*
+ * esc_model.cpp - Simulated DShot ESCs and motors for SIL builds
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Written from the protocol, not from propulsion_driver.cpp, so the SIL
+ * run cross-checks the driver's encoder and decoder.
+ */
+
+#include "esc_model.h"
+#include "system_clock.h"
+#include <atomic>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ESC_COUNT          4
+#define ESC_FRAME_BITS     16
+#define ESC_REPLY_BITS     21
+#define ESC_MAX_RPM        24000.0f   // At full throttle
+#define ESC_SPINUP_TAU_S   0.040f
+#define ESC_STOPPED_RPM    200.0f     // Below this the reply reads "stopped"
+#define ESC_POLE_PAIRS     7
+#define ESC_TURNAROUND_US  30
+#define ESC_THROTTLE_MIN   48
+#define ESC_THROTTLE_MAX   2047
+
+// 4-bit nibble to 5-bit GCR code
+static const uint8_t gcr_encode[16] = {
+    0x19, 0x1B, 0x12, 0x13, 0x1D, 0x15, 0x16, 0x17, 0x1A, 0x09, 0x0A, 0x0B, 0x1E, 0x0D, 0x0E, 0x0F,
+};
+
+static EscModel_Stats_t stats;
+static std::atomic<uint16_t> throttle_value[ESC_COUNT];   // stats.value, for other threads
+static uint64_t last_frame_us[ESC_COUNT];
+static uint32_t jitter_state = 0x6C8E9CF5U;
+static uint32_t frame_period = 0;         // Timer counts per frame bit, from the last frame
+static bool exit_hook_registered = false;
+
+static uint16_t edge_time(double start, double bit, int k);
+static void print_at_exit(void);
+static void spin(int esc, uint16_t value);
+
+void EscModel_OnFrame(const TIM_HandleTypeDef *htim, const uint32_t *burst, uint32_t words) {
+    if (!exit_hook_registered) {
+        atexit(print_at_exit);
+        exit_hook_registered = true;
+    }
+
+    uint32_t period = htim->Instance->ARR + 1U;
+    frame_period = period;
+    uint32_t rows = words / ESC_COUNT;
+    for (int esc = 0; esc < ESC_COUNT; esc++) {
+        stats.frames++;
+        if (rows < ESC_FRAME_BITS) {
+            stats.timing_errors++;
+            continue;
+        }
+
+        // Nominal widths 3/4 and 3/8 of the bit, +/-5% of the bit accepted
+        uint16_t frame = 0;
+        bool clean = true;
+        for (uint32_t row = 0; row < rows; row++) {
+            uint32_t high = burst[row * ESC_COUNT + esc];
+            if (row >= ESC_FRAME_BITS) {
+                if (high != 0) clean = false;
+                continue;
+            }
+            uint32_t tolerance = period / 20U;
+            bool one = high * 4U + tolerance * 4U >= period * 3U && high * 4U <= period * 3U + tolerance * 4U;
+            bool zero = high * 8U + tolerance * 8U >= period * 3U && high * 8U <= period * 3U + tolerance * 8U;
+            if (one == zero) clean = false;
+            frame = (uint16_t)((frame << 1) | (one ? 1U : 0U));
+        }
+        if (!clean) {
+            stats.timing_errors++;
+            continue;
+        }
+
+        uint16_t packet = frame >> 4;
+        uint16_t crc = (packet ^ (packet >> 4) ^ (packet >> 8)) & 0xFU;
+        bool inverted = (htim->Instance->CCER & (TIM_CCER_CC1P << (4 * esc))) != 0;
+        if (inverted) crc = ~crc & 0xFU;
+        if ((frame & 0xFU) != crc) {
+            stats.crc_errors++;
+            continue;
+        }
+
+        uint16_t value = packet >> 1;
+        if (value >= 1 && value <= 47) {
+            stats.commands++;
+            continue;
+        }
+        spin(esc, value);
+    }
+}
+
+uint32_t EscModel_Reply(const TIM_HandleTypeDef *htim, uint32_t channel, uint16_t *edges, uint32_t max_edges) {
+    (void)htim;   // The pins are in capture mode now; timing comes from the last frame
+    int esc = (int)(channel >> 2U);
+    if (esc >= ESC_COUNT || max_edges == 0 || frame_period == 0) return 0;
+    stats.replies++;
+
+    // 12-bit period in us as eee mmmmmmmmm, then a CRC nibble making the
+    // four nibbles XOR to 0xF
+    uint32_t value = 0xFFFU;
+    float erpm = stats.rpm[esc] * ESC_POLE_PAIRS;
+    if (stats.rpm[esc] >= ESC_STOPPED_RPM) {
+        uint32_t period_us = (uint32_t)lroundf(60000000.0f / erpm);
+        uint32_t exponent = 0;
+        while (period_us > 0x1FFU) {
+            period_us >>= 1;
+            exponent++;
+        }
+        value = (exponent << 9) | period_us;
+    }
+    uint32_t crc = ~(value ^ (value >> 4) ^ (value >> 8)) & 0xFU;
+    uint32_t word = (value << 4) | crc;
+
+    uint32_t gcr = 0;
+    for (int nibble = 3; nibble >= 0; nibble--) gcr = (gcr << 5) | gcr_encode[(word >> (nibble * 4)) & 0xFU];
+
+    // Line idles high; start bit low, then every GCR 1 flips the level.
+    // The reply bit is 4/5 of the frame bit, in the same timer counts.
+    double bit = (double)frame_period * 4.0 / 5.0;
+    double start = (double)(jitter_state & 0xFFFFU) + ESC_TURNAROUND_US * 2.0 * HAL_RCC_GetPCLK1Freq() / 1e6;
+    uint32_t count = 0;
+    uint32_t level = 0;
+    edges[count++] = edge_time(start, bit, 0);
+    for (int k = 1; k < ESC_REPLY_BITS && count < max_edges; k++) {
+        if (!((gcr >> (ESC_REPLY_BITS - 1 - k)) & 1U)) continue;
+        level ^= 1U;
+        edges[count++] = edge_time(start, bit, k);
+    }
+    if (level == 0 && count < max_edges) edges[count++] = edge_time(start, bit, ESC_REPLY_BITS);   // Release
+    return count;
+}
+
+void EscModel_GetStats(EscModel_Stats_t *out) {
+    *out = stats;
+}
+
+void EscModel_GetOutputs(Motor_Output_t *outputs) {
+    float out[ESC_COUNT];
+    for (int esc = 0; esc < ESC_COUNT; esc++) {
+        uint16_t value = throttle_value[esc].load(std::memory_order_relaxed);
+        out[esc] = (value < ESC_THROTTLE_MIN) ? 0.0f
+                 : (float)(value - ESC_THROTTLE_MIN) / (float)(ESC_THROTTLE_MAX - ESC_THROTTLE_MIN);
+    }
+    outputs->motor1 = out[0];
+    outputs->motor2 = out[1];
+    outputs->motor3 = out[2];
+    outputs->motor4 = out[3];
+}
+
+/* --- Internals --- */
+
+static void spin(int esc, uint16_t value) {
+    uint64_t now_us = SystemClock_Micros();
+    float dt = (last_frame_us[esc] == 0) ? 0.0f : (float)(now_us - last_frame_us[esc]) * 1e-6f;
+    if (dt > 0.1f) dt = 0.1f;
+    last_frame_us[esc] = now_us;
+
+    float target = (value == 0) ? 0.0f : ESC_MAX_RPM * (float)(value - 47) / 2000.0f;
+    stats.rpm[esc] += (target - stats.rpm[esc]) * (1.0f - expf(-dt / ESC_SPINUP_TAU_S));
+    stats.value[esc] = value;
+    throttle_value[esc].store(value, std::memory_order_relaxed);
+}
+
+// Capture time of the level change starting reply bit k, +/-10% of a bit
+static uint16_t edge_time(double start, double bit, int k) {
+    jitter_state ^= jitter_state << 13;
+    jitter_state ^= jitter_state >> 17;
+    jitter_state ^= jitter_state << 5;
+    double jitter = ((double)(jitter_state & 0xFF) / 255.0 - 0.5) * bit * 0.2;
+    return (uint16_t)((uint32_t)lround(start + k * bit + jitter) & 0xFFFFU);
+}
+
+static void print_at_exit(void) {
+    printf("esc frames=%lu crc_errors=%lu timing_errors=%lu commands=%lu replies=%lu "
+           "rpm=%.0f/%.0f/%.0f/%.0f\n",
+           (unsigned long)stats.frames, (unsigned long)stats.crc_errors, (unsigned long)stats.timing_errors,
+           (unsigned long)stats.commands, (unsigned long)stats.replies, stats.rpm[0], stats.rpm[1],
+           stats.rpm[2], stats.rpm[3]);
+}
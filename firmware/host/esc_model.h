@@ -0,0 +1,48 @@
+/*
+ * esc_model.h - Simulated DShot ESCs and motors for SIL builds
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Four ESCs listening on the TIM3 channels. Each frame is recovered from
+ * the pulse widths the timer burst would put on the wire and checked the
+ * way an ESC does: every pulse must be a clean 0 or 1, the lines must
+ * return to idle, and the CRC must match (inverted when the outputs are
+ * inverted, i.e. bidirectional DShot). Good throttle values spin a motor
+ * with a first-order lag. When the pins are turned around, each ESC
+ * answers with its electrical period as GCR-coded edge times, with a few
+ * counts of jitter.
+ *
+ * A summary of frames, rejected frames and speeds is printed at exit.
+ */
+
+#ifndef ESC_MODEL_H
+#define ESC_MODEL_H
+
+#include "flight_control.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+typedef struct {
+    uint32_t frames;            // Frames received on all channels
+    uint32_t crc_errors;
+    uint32_t timing_errors;     // Pulse not a clean 0/1, or line not idle after the frame
+    uint32_t commands;          // Values 1-47
+    uint32_t replies;
+    uint16_t value[4];          // Last accepted throttle value
+    float rpm[4];
+} EscModel_Stats_t;
+
+// The timer burst for one frame (DSHOT rows of CCR1-CCR4) has gone out
+void EscModel_OnFrame(const TIM_HandleTypeDef *htim, const uint32_t *burst, uint32_t words);
+
+// Capture the reply on a channel; returns the number of edge times written
+uint32_t EscModel_Reply(const TIM_HandleTypeDef *htim, uint32_t channel, uint16_t *edges, uint32_t max_edges);
+
+void EscModel_GetStats(EscModel_Stats_t *stats);
+
+// The last accepted throttle of each ESC as a 0-1 motor output, for the
+// vehicle plant; safe to call from any thread
+void EscModel_GetOutputs(Motor_Output_t *outputs);
+
+#endif // ESC_MODEL_H
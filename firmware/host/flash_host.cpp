@@ -0,0 +1,109 @@
+/*
+ * flash_host.cpp - Host stand-in for the W25Q256JV logging flash
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * The flash array is a memory mapping. With TMF_FLASH_FILE=<path> it is a
+ * shared mapping of that file, so logs survive the run and can be decoded
+ * with tmf_blackbox_decode; otherwise it is anonymous memory that starts
+ * erased on every run.
+ *
+ * NOR semantics are kept: erase sets a sector to 0xFF, programming can
+ * only clear bits, and a program may not cross a page boundary. Each
+ * operation holds the busy flag for the datasheet's typical time on the
+ * system clock, so SIL runs see realistic back-pressure.
+ */
+
+#include "hardware_drivers.h"
+#include "system_clock.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FLASH_PAGE_PROGRAM_US   400     // tPP typical
+#define FLASH_SECTOR_ERASE_US   45000   // tSE typical
+
+static uint8_t *flash = NULL;
+static uint64_t busy_until_us = 0;
+
+static uint8_t *map_file(const char *path);
+
+bool Flash_Init(void) {
+    busy_until_us = 0;
+    if (flash != NULL) return true;
+
+    const char *path = getenv("TMF_FLASH_FILE");
+    if (path != NULL && path[0] != '\0') {
+        flash = map_file(path);
+    } else {
+        void *memory = mmap(NULL, FLASH_CAPACITY, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory != MAP_FAILED) {
+            flash = (uint8_t *)memory;
+            memset(flash, 0xFF, FLASH_CAPACITY);
+        }
+    }
+    return flash != NULL;
+}
+
+bool Flash_IsBusy(void) {
+    return SystemClock_Micros() < busy_until_us;
+}
+
+bool Flash_StartSectorErase(uint32_t address) {
+    if (flash == NULL || Flash_IsBusy() || address >= FLASH_CAPACITY) return false;
+    address -= address % FLASH_SECTOR_SIZE;
+    memset(flash + address, 0xFF, FLASH_SECTOR_SIZE);
+    busy_until_us = SystemClock_Micros() + FLASH_SECTOR_ERASE_US;
+    return true;
+}
+
+bool Flash_StartProgram(uint32_t address, const uint8_t *data, size_t length) {
+    if (flash == NULL || Flash_IsBusy() || length == 0 || length > FLASH_PAGE_SIZE) return false;
+    if (address % FLASH_PAGE_SIZE + length > FLASH_PAGE_SIZE) return false;
+    if (address >= FLASH_CAPACITY) return false;
+    for (size_t i = 0; i < length; i++) flash[address + i] &= data[i];
+    busy_until_us = SystemClock_Micros() + FLASH_PAGE_PROGRAM_US;
+    return true;
+}
+
+bool Flash_Read(uint32_t address, uint8_t *data, size_t length) {
+    if (flash == NULL || address > FLASH_CAPACITY || length > FLASH_CAPACITY - address) return false;
+    memcpy(data, flash + address, length);
+    return true;
+}
+
+// Open (creating or extending with erased bytes) and map the image file
+static uint8_t *map_file(const char *path) {
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    if ((uint64_t)st.st_size < FLASH_CAPACITY) {
+        static uint8_t erased[64 * 1024];
+        memset(erased, 0xFF, sizeof(erased));
+        off_t offset = st.st_size;
+        while ((uint64_t)offset < FLASH_CAPACITY) {
+            size_t chunk = sizeof(erased);
+            if ((uint64_t)offset + chunk > FLASH_CAPACITY) chunk = (size_t)(FLASH_CAPACITY - offset);
+            ssize_t written = pwrite(fd, erased, chunk, offset);
+            if (written <= 0) {
+                close(fd);
+                return NULL;
+            }
+            offset += written;
+        }
+    }
+
+    void *memory = mmap(NULL, FLASH_CAPACITY, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return (memory != MAP_FAILED) ? (uint8_t *)memory : NULL;
+}
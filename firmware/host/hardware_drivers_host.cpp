@@ -0,0 +1,313 @@
+/*
+ * hardware_drivers_host.cpp - Host stand-in for the sensor bus drivers
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Every chip "responds", and what they report comes from one simulated
+ * vehicle (see vehicle_plant.h) launched from the ground in San Francisco
+ * and flown by the motor commands the ESC model last accepted, so the
+ * flight loop runs closed.
+ *
+ * The IMU stream runs on its own thread, standing in for the FIFO watermark
+ * interrupt and DMA callback; it attaches to the host clock as a peer so
+ * batches land at the same simulated instants on every run. It also steps
+ * the plant, one step per IMU frame, and latches a GPS fix at the start of
+ * each navigation epoch. The GPS UART "receives" that fix as a GGA, RMC,
+ * VTG and UBX NAV-PVT burst every 100 ms at the configured baud rate,
+ * written into the circular buffer as simulated time passes. The baro
+ * reads the plant whenever it is sampled.
+ *
+ * TMF_WIND=<north>,<east>[,<gust>] sets the wind in m/s.
+ */
+
+#include "hardware_drivers.h"
+#include "esc_model.h"
+#include "host_clock.h"
+#include "imu_stream.h"
+#include "system_clock.h"
+#include "vehicle_plant.h"
+#include <atomic>
+#include <math.h>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#define GPS_EPOCH_US         100000   // 10 Hz navigation rate
+#define GPS_OUTPUT_DELAY_US  20000    // Epoch to first byte on the wire
+#define GPS_SCRIPT_MAX       512
+#define MS_TO_KNOTS          1.943844f
+
+#define LAUNCH_LATITUDE      37.7749
+#define LAUNCH_LONGITUDE     -122.4194
+#define LAUNCH_ALTITUDE      15.0f
+#define PLANT_SEED           1
+
+// The vehicle: stepped by the IMU thread, read by the GPS and baro drivers
+static std::mutex plant_lock;
+static VehiclePlant_t plant;
+static bool plant_ready = false;
+static GPS_Data_t gps_latched;               // Fix at the start of the newest epoch
+
+static uint8_t gps_script[GPS_SCRIPT_MAX];   // One epoch's worth of output
+static size_t gps_script_length = 0;
+static uint64_t gps_epoch = 0;               // Epoch the script belongs to
+static uint64_t gps_epoch_base = 0;          // Stream offset of its first byte
+static uint64_t gps_burst_end_us = 0;        // End of the last complete burst
+static uint8_t gps_rx[GPS_RX_BUFFER_SIZE];
+static uint64_t gps_delivered = 0;           // Bytes written since GPS_Init
+
+static void plant_start(void);
+static void gps_deliver(uint64_t target);
+static void gps_build_script(void);
+
+static std::thread imu_thread;
+static std::atomic<bool> imu_running{false};
+static int imu_peer = -1;
+
+static void imu_producer(uint32_t period_us, uint32_t watermark);
+static void imu_stop_at_exit(void);
+
+bool IMU_Init(void) {
+    plant_start();
+    return true;
+}
+
+bool IMU_StartStream(uint32_t odr_hz, uint32_t watermark) {
+    if (odr_hz == 0 || odr_hz > 1000000U || watermark == 0 || imu_running.load()) return false;
+
+    static bool exit_hook_registered = false;
+    if (!exit_hook_registered) {
+        atexit(imu_stop_at_exit);
+        exit_hook_registered = true;
+    }
+
+    // Attach before the thread starts so time cannot run ahead of it
+    imu_peer = HostClock_AttachPeer();
+    if (imu_peer < 0) return false;
+
+    imu_running.store(true);
+    imu_thread = std::thread(imu_producer, 1000000U / odr_hz, watermark);
+    return true;
+}
+
+void IMU_StopStream(void) {
+    if (!imu_running.exchange(false)) return;
+    HostClock_DetachPeer(imu_peer);
+    imu_thread.join();
+    imu_peer = -1;
+}
+
+bool GPS_Init(void) {
+    plant_start();
+    gps_epoch = 0;
+    gps_epoch_base = 0;
+    gps_burst_end_us = 0;
+    gps_delivered = 0;
+    gps_build_script();
+    return true;
+}
+
+const uint8_t *GPS_RxBuffer(void) {
+    return gps_rx;
+}
+
+size_t GPS_RxWriteIndex(uint64_t *last_byte_us) {
+    uint64_t now_us = SystemClock_Micros();
+    uint64_t epoch = now_us / GPS_EPOCH_US;
+
+    // Bursts of epochs that have ended went out whole; each script is
+    // built when its epoch comes up, from the fix latched then
+    while (gps_epoch < epoch) {
+        gps_deliver(gps_epoch_base + gps_script_length);
+        gps_burst_end_us = gps_epoch * GPS_EPOCH_US + GPS_OUTPUT_DELAY_US +
+                           gps_script_length * GPS_BYTE_TIME_NS / 1000U;
+        gps_epoch_base += gps_script_length;
+        gps_epoch++;
+        gps_build_script();
+    }
+
+    // Then the current burst, as far as the wire has got
+    uint64_t into_us = now_us % GPS_EPOCH_US;
+    uint64_t in_epoch = 0;
+    if (into_us >= GPS_OUTPUT_DELAY_US) {
+        in_epoch = (into_us - GPS_OUTPUT_DELAY_US) * 1000U / GPS_BYTE_TIME_NS;
+        if (in_epoch > gps_script_length) in_epoch = gps_script_length;
+    }
+    gps_deliver(gps_epoch_base + in_epoch);
+
+    // Idle-line latch: end of the last byte received
+    if (last_byte_us != NULL) {
+        *last_byte_us = (in_epoch > 0) ? epoch * GPS_EPOCH_US + GPS_OUTPUT_DELAY_US +
+                                         in_epoch * GPS_BYTE_TIME_NS / 1000U
+                                       : gps_burst_end_us;
+    }
+    return (size_t)(gps_delivered % GPS_RX_BUFFER_SIZE);
+}
+
+bool Baro_Init(void) {
+    plant_start();
+    return true;
+}
+
+bool Baro_ReadPressureTemp(float *pressure, float *temperature) {
+    std::lock_guard<std::mutex> guard(plant_lock);
+    VehiclePlant_SampleBaro(&plant, 0, pressure, temperature);
+    return true;
+}
+
+/* --- Vehicle --- */
+
+static void plant_start(void) {
+    std::lock_guard<std::mutex> guard(plant_lock);
+    if (plant_ready) return;
+    if (!VehiclePlant_Init(&plant, 1, LAUNCH_LATITUDE, LAUNCH_LONGITUDE, LAUNCH_ALTITUDE, PLANT_SEED)) {
+        fprintf(stderr, "plant: out of memory\n");
+        abort();
+    }
+
+    const char *wind_env = getenv("TMF_WIND");
+    if (wind_env != NULL) {
+        VehiclePlant_Wind_t wind = { { 0.0f, 0.0f, 0.0f }, 0.0f, 2.0f };
+        if (sscanf(wind_env, "%f,%f,%f", &wind.mean[0], &wind.mean[1], &wind.gust) < 2) {
+            fprintf(stderr, "plant: TMF_WIND wants <north>,<east>[,<gust>] in m/s\n");
+        } else {
+            VehiclePlant_SetWind(&plant, 0, &wind);
+        }
+    }
+
+    VehiclePlant_SampleGps(&plant, 0, 0, &gps_latched);
+    plant_ready = true;
+}
+
+/* --- IMU producer thread --- */
+
+static void imu_producer(uint32_t period_us, uint32_t watermark) {
+    uint64_t next_us = period_us;
+    float dt = (float)period_us * 1e-6f;
+
+    while (imu_running.load(std::memory_order_relaxed)) {
+        // Watermark interrupt fires when the last frame of the batch is ready
+        uint64_t irq_us = next_us + (uint64_t)(watermark - 1) * period_us;
+        if (!HostClock_PeerSleepUntil(imu_peer, irq_us)) break;
+
+        Motor_Output_t motors;
+        EscModel_GetOutputs(&motors);
+        for (uint32_t i = 0; i < watermark; i++) {
+            IMU_Sample_t sample;
+            {
+                std::lock_guard<std::mutex> guard(plant_lock);
+                VehiclePlant_SetMotors(&plant, 0, &motors);
+                VehiclePlant_Step(&plant, dt);
+                VehiclePlant_SampleImu(&plant, next_us, &sample);
+                if (next_us % GPS_EPOCH_US < period_us) {
+                    VehiclePlant_SampleGps(&plant, 0, next_us, &gps_latched);
+                }
+            }
+            ImuStream_Publish(&sample);
+            next_us += period_us;
+        }
+    }
+}
+
+static void imu_stop_at_exit(void) {
+    IMU_StopStream();
+
+    VehiclePlant_State_t truth;
+    {
+        std::lock_guard<std::mutex> guard(plant_lock);
+        if (!plant_ready) return;
+        VehiclePlant_GetState(&plant, 0, &truth);
+    }
+    printf("vehicle ned=%.1f/%.1f/%.1fm velocity=%.1f/%.1f/%.1fm/s attitude=%.1f/%.1f/%.1fdeg%s\n",
+           truth.position[0], truth.position[1], truth.position[2], truth.velocity[0], truth.velocity[1],
+           truth.velocity[2], truth.roll, truth.pitch, truth.yaw, truth.on_ground ? " on_ground" : "");
+}
+
+/* --- GPS output script --- */
+
+static void script_append(const void *data, size_t length) {
+    if (gps_script_length + length > GPS_SCRIPT_MAX) return;
+    memcpy(&gps_script[gps_script_length], data, length);
+    gps_script_length += length;
+}
+
+static void put_u32(uint8_t *payload, size_t offset, uint32_t value) {
+    for (int i = 0; i < 4; i++) payload[offset + i] = (uint8_t)(value >> (8 * i));
+}
+
+static void gps_deliver(uint64_t target) {
+    // Past a buffer's worth the ring simply laps, as the DMA would
+    while (gps_delivered < target) {
+        gps_rx[gps_delivered % GPS_RX_BUFFER_SIZE] = gps_script[gps_delivered - gps_epoch_base];
+        gps_delivered++;
+    }
+}
+
+static void script_sentence(const char *body) {
+    static const char hex[] = "0123456789ABCDEF";
+    uint8_t checksum = 0;
+    for (const char *c = body; *c; c++) checksum ^= (uint8_t)*c;
+
+    char tail[5] = { '*', hex[checksum >> 4], hex[checksum & 0x0F], '\r', '\n' };
+    script_append("$", 1);
+    script_append(body, strlen(body));
+    script_append(tail, sizeof(tail));
+}
+
+// ddmm.mmmmm (or dddmm.mmmmm) and hemisphere
+static void nmea_angle(char *out, size_t size, double degrees, int width, char positive, char negative) {
+    char hemisphere = degrees < 0.0 ? negative : positive;
+    degrees = fabs(degrees);
+    int whole = (int)degrees;
+    snprintf(out, size, "%0*d%08.5f,%c", width, whole, (degrees - whole) * 60.0, hemisphere);
+}
+
+static void gps_build_script(void) {
+    GPS_Data_t fix;
+    {
+        std::lock_guard<std::mutex> guard(plant_lock);
+        fix = gps_latched;
+    }
+    gps_script_length = 0;
+
+    uint64_t seconds = gps_epoch * GPS_EPOCH_US / 1000000U;
+    unsigned centis = (unsigned)(gps_epoch * GPS_EPOCH_US % 1000000U / 10000U);
+    char utc[16], lat[24], lon[24], body[128];
+    snprintf(utc, sizeof(utc), "%02u%02u%02u.%02u", (unsigned)(seconds / 3600 % 24), (unsigned)(seconds / 60 % 60),
+             (unsigned)(seconds % 60), centis);
+    nmea_angle(lat, sizeof(lat), fix.latitude, 2, 'N', 'S');
+    nmea_angle(lon, sizeof(lon), fix.longitude, 3, 'E', 'W');
+    float knots = fix.speed * MS_TO_KNOTS;
+
+    snprintf(body, sizeof(body), "GPGGA,%s,%s,%s,1,%02u,0.9,%.2f,M,0.0,M,,", utc, lat, lon,
+             (unsigned)fix.satellites, fix.altitude);
+    script_sentence(body);
+    snprintf(body, sizeof(body), "GPRMC,%s,A,%s,%s,%.2f,%.1f,010124,,,A", utc, lat, lon, knots, fix.course);
+    script_sentence(body);
+    snprintf(body, sizeof(body), "GPVTG,%.1f,T,,M,%.2f,N,%.2f,K,A", fix.course, knots, fix.speed * 3.6f);
+    script_sentence(body);
+
+    // UBX NAV-PVT for the same fix: 3D, gnssFixOK
+    uint8_t frame[6 + 92 + 2] = { 0xB5, 0x62, 0x01, 0x07, 92, 0 };
+    uint8_t *payload = &frame[6];
+    payload[20] = 3;
+    payload[21] = 0x01;
+    payload[23] = fix.satellites;
+    put_u32(payload, 24, (uint32_t)(int32_t)lround(fix.longitude * 1e7));
+    put_u32(payload, 28, (uint32_t)(int32_t)lround(fix.latitude * 1e7));
+    put_u32(payload, 36, (uint32_t)(int32_t)lroundf(fix.altitude * 1000.0f));
+    put_u32(payload, 60, (uint32_t)(int32_t)lroundf(fix.speed * 1000.0f));
+    put_u32(payload, 64, (uint32_t)(int32_t)lroundf(fix.course * 1e5f));
+
+    uint8_t ck_a = 0, ck_b = 0;
+    for (size_t i = 2; i < 6 + 92; i++) {
+        ck_a = (uint8_t)(ck_a + frame[i]);
+        ck_b = (uint8_t)(ck_b + ck_a);
+    }
+    frame[6 + 92] = ck_a;
+    frame[6 + 92 + 1] = ck_b;
+    script_append(frame, sizeof(frame));
+}
@@ -0,0 +1,175 @@
+/*
+ * host_clock.cpp - Virtual and wall-clock time sources for SIL builds
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ */
+
+#include "host_clock.h"
+#include "system_clock.h"
+#include "stm32f7xx_hal.h"
+#include <condition_variable>
+#include <mutex>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define HOST_CLOCK_MAX_PEERS 4
+
+typedef struct {
+    bool attached;
+    bool sleeping;
+    uint64_t wake_us;
+} HostClock_Peer_t;
+
+// virtual_now is written only with peer_lock held, so peers read it safely
+static uint64_t virtual_now = 0;
+static bool virtual_active = false;
+static uint64_t wall_epoch_ns = 0;
+
+static std::mutex peer_lock;
+static std::condition_variable peer_wake;
+static HostClock_Peer_t peers[HOST_CLOCK_MAX_PEERS];
+static int peer_count = 0;
+
+static uint64_t virtual_now_us(void);
+static void virtual_sleep_until_us(uint64_t deadline);
+static uint64_t wall_now_us(void);
+static void wall_sleep_until_us(uint64_t deadline);
+static bool peers_settled(void);
+
+static const SystemClock_Source_t virtual_source = {
+    virtual_now_us,
+    virtual_sleep_until_us,
+};
+
+static const SystemClock_Source_t wall_source = {
+    wall_now_us,
+    wall_sleep_until_us,
+};
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void HostClock_UseVirtual(void) {
+    std::lock_guard<std::mutex> guard(peer_lock);
+    virtual_now = 0;
+    virtual_active = true;
+    SystemClock_SetSource(&virtual_source);
+}
+
+void HostClock_UseWall(void) {
+    wall_epoch_ns = monotonic_ns();
+    virtual_active = false;
+    SystemClock_SetSource(&wall_source);
+}
+
+void HostClock_Advance(uint64_t delta_us) {
+    if (virtual_active) virtual_sleep_until_us(virtual_now + delta_us);
+}
+
+int HostClock_AttachPeer(void) {
+    std::lock_guard<std::mutex> guard(peer_lock);
+    for (int i = 0; i < HOST_CLOCK_MAX_PEERS; i++) {
+        if (!peers[i].attached) {
+            peers[i].attached = true;
+            peers[i].sleeping = false;
+            peers[i].wake_us = 0;
+            peer_count++;
+            return i;
+        }
+    }
+    return -1;
+}
+
+void HostClock_DetachPeer(int peer) {
+    if (peer < 0 || peer >= HOST_CLOCK_MAX_PEERS) return;
+
+    std::lock_guard<std::mutex> guard(peer_lock);
+    if (!peers[peer].attached) return;
+    peers[peer].attached = false;
+    peers[peer].sleeping = false;
+    peer_count--;
+    peer_wake.notify_all();
+}
+
+bool HostClock_PeerSleepUntil(int peer, uint64_t deadline_us) {
+    if (peer < 0 || peer >= HOST_CLOCK_MAX_PEERS) return false;
+
+    std::unique_lock<std::mutex> lock(peer_lock);
+    if (!virtual_active) {
+        lock.unlock();
+        wall_sleep_until_us(deadline_us);
+        lock.lock();
+        return peers[peer].attached;
+    }
+
+    HostClock_Peer_t *self = &peers[peer];
+    self->wake_us = deadline_us;
+    self->sleeping = true;
+    peer_wake.notify_all();
+    peer_wake.wait(lock, [&] { return !self->attached || virtual_now >= deadline_us; });
+    self->sleeping = false;
+    return self->attached;
+}
+
+void HostClock_ConfigureFromEnv(void) {
+    const char *mode = getenv("TMF_CLOCK");
+    if (mode != NULL && strcmp(mode, "wall") == 0) {
+        HostClock_UseWall();
+    } else {
+        HostClock_UseVirtual();
+    }
+
+    uint64_t seconds = 3600;
+    const char *limit = getenv("TMF_SIM_SECONDS");
+    if (limit != NULL) seconds = strtoull(limit, NULL, 10);
+    SystemClock_SetRunLimit(seconds * 1000000ULL);
+}
+
+/* --- Sources --- */
+
+static uint64_t virtual_now_us(void) {
+    return virtual_now;
+}
+
+static void virtual_sleep_until_us(uint64_t deadline) {
+    if (deadline <= virtual_now) return;
+
+    std::unique_lock<std::mutex> lock(peer_lock);
+    virtual_now = deadline;
+    if (peer_count == 0 || peers_settled()) return;
+
+    // Let every peer due by now run before the firmware sees the new time
+    peer_wake.notify_all();
+    peer_wake.wait(lock, [] { return peers_settled(); });
+}
+
+// True when every attached peer is asleep with a wake-up still in the future
+static bool peers_settled(void) {
+    for (int i = 0; i < HOST_CLOCK_MAX_PEERS; i++) {
+        if (!peers[i].attached) continue;
+        if (!peers[i].sleeping || peers[i].wake_us <= virtual_now) return false;
+    }
+    return true;
+}
+
+static uint64_t wall_now_us(void) {
+    return (monotonic_ns() - wall_epoch_ns) / 1000ULL;
+}
+
+static void wall_sleep_until_us(uint64_t deadline) {
+    uint64_t target_ns = wall_epoch_ns + deadline * 1000ULL;
+    struct timespec ts;
+    ts.tv_sec = (time_t)(target_ns / 1000000000ULL);
+    ts.tv_nsec = (long)(target_ns % 1000000000ULL);
+    int error;
+    while ((error = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) == EINTR) {
+    }
+    if (error != 0) fprintf(stderr, "host clock: clock_nanosleep failed: %s\n", strerror(error));
+}
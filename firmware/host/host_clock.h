@@ -0,0 +1,47 @@
+/*
+ * host_clock.h - Virtual and wall-clock time sources for SIL builds
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * The virtual clock only moves when the firmware sleeps (or a harness
+ * calls HostClock_Advance), so the control loop runs as fast as the host
+ * CPU allows while every timestamp it sees stays consistent.
+ *
+ * Threads that stand in for hardware (IMU interrupts, DMA) attach as
+ * peers. Virtual time never moves past a peer's wake-up until that peer
+ * has run and gone back to sleep, so SIL runs stay deterministic even with
+ * a producer thread on a single core.
+ *
+ * HAL_Init() picks the source from the environment:
+ *   TMF_CLOCK=virtual|wall   (default: virtual)
+ *   TMF_SIM_SECONDS=<n>      simulated run length (default: 3600, 0 = forever)
+ */
+
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+#include <stdint.h>
+
+// Install the virtual clock, reset to t = 0
+void HostClock_UseVirtual(void);
+
+// Install a CLOCK_MONOTONIC-backed clock that really sleeps
+void HostClock_UseWall(void);
+
+// Move virtual time forward (no-op under the wall clock)
+void HostClock_Advance(uint64_t delta_us);
+
+// Register the calling hardware thread; returns a peer id or -1 if full
+int HostClock_AttachPeer(void);
+
+// Release a peer and wake it if it is sleeping
+void HostClock_DetachPeer(int peer);
+
+// Block a peer until now >= deadline_us. Returns false once detached.
+bool HostClock_PeerSleepUntil(int peer, uint64_t deadline_us);
+
+// Read the environment and install the requested source and run limit
+void HostClock_ConfigureFromEnv(void);
+
+#endif // HOST_CLOCK_H
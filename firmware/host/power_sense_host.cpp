@@ -0,0 +1,153 @@
+/*
+ * power_sense_host.cpp - Host stand-in for the power sensing hardware
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * A thread plays the ADC3 DMA callback (one block of raw scans every
+ * 10 ms) and the thermocouple SPI callback (four raw MAX31855 frames
+ * every 100 ms, the first one conversion time after start-up). It attaches
+ * to the host clock as a peer, so the callbacks land at the same simulated
+ * instants on every run. Values come from a simple pack and coil model
+ * chosen by TMF_POWER:
+ *   nominal    6S pack from full over an hour, coils settle near 60 C
+ *   hot        coils heat 0.1 C/s: throttle at ~420 s, shutdown at ~570 s
+ *   brownout   pack sags 1 V/min: shed stage 1 at ~215 s, stage 2 at ~295 s
+ *   open       nominal, with thermocouple 2 open-circuit
+ */
+
+#include "hardware_drivers.h"
+#include "host_clock.h"
+#include "power_monitor.h"
+#include <atomic>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#define ADC_BLOCK_US   (POWER_ADC_BLOCK_SCANS * (1000000U / POWER_ADC_SCAN_HZ))
+#define THERMO_US      (POWER_THERMO_PERIOD_MS * 1000U)
+#define PACK_R_OHM     0.025     // Internal resistance
+
+typedef enum { SCENARIO_NOMINAL, SCENARIO_HOT, SCENARIO_BROWNOUT, SCENARIO_OPEN } Scenario_t;
+
+static std::thread sense_thread;
+static std::atomic<bool> sense_running{false};
+static int sense_peer = -1;
+static Scenario_t scenario = SCENARIO_NOMINAL;
+static uint32_t noise_state = 0x9E3779B9U;
+static uint32_t loads = 0;
+
+static void sense_producer(void);
+static void sense_stop_at_exit(void);
+
+bool PowerSense_Init(void) {
+    if (sense_running.load()) return true;
+
+    const char *name = getenv("TMF_POWER");
+    if (name == NULL || name[0] == '\0' || strcmp(name, "nominal") == 0) scenario = SCENARIO_NOMINAL;
+    else if (strcmp(name, "hot") == 0) scenario = SCENARIO_HOT;
+    else if (strcmp(name, "brownout") == 0) scenario = SCENARIO_BROWNOUT;
+    else if (strcmp(name, "open") == 0) scenario = SCENARIO_OPEN;
+    else {
+        fprintf(stderr, "power: unknown TMF_POWER scenario '%s'\n", name);
+        return false;
+    }
+
+    static bool exit_hook_registered = false;
+    if (!exit_hook_registered) {
+        atexit(sense_stop_at_exit);
+        exit_hook_registered = true;
+    }
+
+    sense_peer = HostClock_AttachPeer();
+    if (sense_peer < 0) return false;
+    sense_running.store(true);
+    sense_thread = std::thread(sense_producer);
+    return true;
+}
+
+void PowerSense_SetLoad(uint32_t load, bool on) {
+    if (on) loads |= 1U << load;
+    else loads &= ~(1U << load);
+}
+
+/* --- Model --- */
+
+static double pack_open_circuit_v(double t) {
+    double v = (scenario == SCENARIO_BROWNOUT) ? 25.2 - t / 60.0 : 25.2 - 2.4 * t / 3600.0;
+    return (v < 15.0) ? 15.0 : v;
+}
+
+static double coil_temp_c(double t, int coil) {
+    if (scenario == SCENARIO_HOT) return 25.0 + 0.1 * t + coil;
+    return 25.0 + (33.0 + 2.0 * coil) * (1.0 - exp(-t / 600.0));
+}
+
+// ADC code for a voltage at the pin, with about 1.5 counts RMS of noise
+static uint16_t adc_code(double pin_v) {
+    noise_state ^= noise_state << 13;
+    noise_state ^= noise_state >> 17;
+    noise_state ^= noise_state << 5;
+    double noise = ((double)(noise_state & 0xFFFF) / 65535.0 - 0.5) * 5.0;
+    long code = lround(pin_v / 3.3 * 4095.0 + noise);
+    if (code < 0) code = 0;
+    if (code > 4095) code = 4095;
+    return (uint16_t)code;
+}
+
+static void fill_scan(uint16_t *scan, double t) {
+    double shed_a = 3.0 * (double)__builtin_popcount(loads);   // Switched loads draw 3 A each
+    double battery_a = 15.0 + shed_a + 2.0 * sin(2.0 * M_PI * 0.5 * t);
+    double battery_v = pack_open_circuit_v(t) - PACK_R_OHM * battery_a;
+    double coil_a = 12.0 + 1.0 * sin(2.0 * M_PI * 0.5 * t);
+    double coil_v = 48.0 - 0.05 * coil_a;
+
+    scan[POWER_CH_BATTERY_V] = adc_code(battery_v / 11.0);
+    scan[POWER_CH_BATTERY_I] = adc_code(1.65 + 0.020 * battery_a);
+    scan[POWER_CH_COIL_V] = adc_code(coil_v / 20.0);
+    scan[POWER_CH_COIL_I] = adc_code(1.65 + 0.025 * coil_a);
+    scan[POWER_CH_AVIONICS_V] = adc_code(5.02 / 2.0);
+}
+
+static uint32_t max31855_frame(double celsius) {
+    uint32_t hot = (uint32_t)lround(celsius * 4.0) & 0x3FFFU;
+    uint32_t cold = (uint32_t)lround(25.0 * 16.0) & 0xFFFU;   // Board at 25 C
+    return (hot << 18) | (cold << 4);
+}
+
+static void sense_producer(void) {
+    static uint16_t block[POWER_ADC_BLOCK_SCANS * POWER_CHANNEL_COUNT];
+    uint64_t next_adc_us = ADC_BLOCK_US;
+    uint64_t next_thermo_us = THERMO_US;
+
+    while (sense_running.load(std::memory_order_relaxed)) {
+        uint64_t wake_us = (next_adc_us < next_thermo_us) ? next_adc_us : next_thermo_us;
+        if (!HostClock_PeerSleepUntil(sense_peer, wake_us)) break;
+
+        if (wake_us == next_adc_us) {
+            double start_s = (double)(next_adc_us - ADC_BLOCK_US) * 1e-6;
+            for (uint32_t s = 0; s < POWER_ADC_BLOCK_SCANS; s++) {
+                fill_scan(&block[s * POWER_CHANNEL_COUNT], start_s + (double)s / POWER_ADC_SCAN_HZ);
+            }
+            PowerMonitor_OnAdcBlock(block, POWER_ADC_BLOCK_SCANS, next_adc_us);
+            next_adc_us += ADC_BLOCK_US;
+        }
+        if (wake_us == next_thermo_us) {
+            double t = (double)next_thermo_us * 1e-6;
+            uint32_t frames[POWER_THERMOCOUPLES];
+            for (int i = 0; i < POWER_THERMOCOUPLES; i++) frames[i] = max31855_frame(coil_temp_c(t, i));
+            if (scenario == SCENARIO_OPEN) frames[2] = (1UL << 16) | 0x1UL;   // OC fault
+            PowerMonitor_OnThermocouples(frames, POWER_THERMOCOUPLES, next_thermo_us);
+            next_thermo_us += THERMO_US;
+        }
+    }
+}
+
+static void sense_stop_at_exit(void) {
+    if (!sense_running.exchange(false)) return;
+    HostClock_DetachPeer(sense_peer);
+    sense_thread.join();
+    sense_peer = -1;
+}
@@ -0,0 +1,201 @@
+/*
+ * stm32f7xx_hal.h - Host stand-in for the STM32F7 HAL
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Provides just enough of the STM32CubeF7 HAL and CMSIS surface for
+ * firmware/src to compile and run on a workstation. Peripheral registers
+ * are plain memory, so SIL runs can inspect what the firmware wrote.
+ * HAL_Init() installs the host clock (see host_clock.h).
+ */
+
+#ifndef STM32F7XX_HAL_H
+#define STM32F7XX_HAL_H
+
+#include <stdint.h>
+
+typedef enum {
+    HAL_OK = 0x00,
+    HAL_ERROR = 0x01,
+    HAL_BUSY = 0x02,
+    HAL_TIMEOUT = 0x03
+} HAL_StatusTypeDef;
+
+/* --- Core: clock, DWT, CoreDebug --- */
+
+extern uint32_t SystemCoreClock;
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern DWT_Type host_dwt;
+extern CoreDebug_Type host_core_debug;
+
+#define DWT        (&host_dwt)
+#define CoreDebug  (&host_core_debug)
+
+#define DWT_CTRL_CYCCNTENA_Msk        (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk    (1UL << 24)
+
+/* --- RCC --- */
+
+// APB1 clock; the clock tree runs it at HCLK / 4, timers on it at 2x
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+
+/* --- DMA --- */
+
+typedef struct {
+    volatile uint32_t CR;
+    volatile uint32_t NDTR;
+    volatile uintptr_t PAR;
+    volatile uintptr_t M0AR;
+    volatile uintptr_t M1AR;
+    volatile uint32_t FCR;
+} DMA_Stream_TypeDef;
+
+typedef struct {
+    DMA_Stream_TypeDef *Instance;
+} DMA_HandleTypeDef;
+
+#define DMA_SxCR_EN    (1UL << 0)
+#define DMA_SxCR_CIRC  (1UL << 8)
+
+// Addresses are 32-bit on target; uintptr_t keeps host pointers intact
+HAL_StatusTypeDef HAL_DMA_Start(DMA_HandleTypeDef *hdma, uintptr_t src, uintptr_t dst, uint32_t length);
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma);
+
+/* --- Timers --- */
+
+typedef struct {
+    volatile uint32_t CR1;
+    volatile uint32_t CR2;
+    volatile uint32_t SMCR;
+    volatile uint32_t DIER;
+    volatile uint32_t SR;
+    volatile uint32_t EGR;
+    volatile uint32_t CCMR1;
+    volatile uint32_t CCMR2;
+    volatile uint32_t CCER;
+    volatile uint32_t CNT;
+    volatile uint32_t PSC;
+    volatile uint32_t ARR;
+    volatile uint32_t RCR;
+    volatile uint32_t CCR1;
+    volatile uint32_t CCR2;
+    volatile uint32_t CCR3;
+    volatile uint32_t CCR4;
+    volatile uint32_t BDTR;
+    volatile uint32_t DCR;
+    volatile uint32_t DMAR;
+} TIM_TypeDef;
+
+typedef struct {
+    TIM_TypeDef *Instance;
+    DMA_HandleTypeDef *hdma[7];   // Indexed by TIM_DMA_ID_*
+} TIM_HandleTypeDef;
+
+#define TIM_CHANNEL_1  0x00000000U
+#define TIM_CHANNEL_2  0x00000004U
+#define TIM_CHANNEL_3  0x00000008U
+#define TIM_CHANNEL_4  0x0000000CU
+
+#define TIM_CR1_CEN    (1UL << 0)
+#define TIM_CR1_UDIS   (1UL << 1)
+#define TIM_CR1_ARPE   (1UL << 7)
+#define TIM_EGR_UG     (1UL << 0)
+#define TIM_CCMR1_OC1PE (1UL << 3)
+#define TIM_CCMR1_OC2PE (1UL << 11)
+#define TIM_CCMR2_OC3PE (1UL << 3)
+#define TIM_CCMR1_CC1S_0 (1UL << 0)
+#define TIM_CCMR1_OC1M_1 (1UL << 5)
+#define TIM_CCMR1_OC1M_2 (1UL << 6)
+#define TIM_CCER_CC1E  (1UL << 0)
+#define TIM_CCER_CC1P  (1UL << 1)
+#define TIM_CCER_CC1NP (1UL << 3)
+
+#define TIM_DMA_UPDATE  (1UL << 8)     // DIER.UDE
+#define TIM_DMA_ID_UPDATE 0U
+#define TIM_DMA_ID_CC1  1U
+#define TIM_DMA_ID_CC2  2U
+#define TIM_DMA_ID_CC3  3U
+#define TIM_DMA_ID_CC4  4U
+#define TIM_DMABASE_ARR 0x0000000BU    // Register offset in words from CR1
+#define TIM_DMABASE_CCR1 0x0000000DU
+#define TIM_DMABURSTLENGTH_4TRANSFERS 0x00000300U
+#define TIM_DMABURSTLENGTH_5TRANSFERS 0x00000400U
+
+#define __HAL_TIM_SET_COMPARE(__HANDLE__, __CHANNEL__, __COMPARE__) \
+    (*(&((__HANDLE__)->Instance->CCR1) + ((__CHANNEL__) >> 2U)) = (__COMPARE__))
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t channel);
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef *htim);
+
+// Burst DMA: every request writes BurstLength consecutive registers from
+// BurstBaseAddress. DataLength counts words over the whole buffer. A
+// circular stream replays the buffer until stopped; a normal one ends
+// with HAL_TIM_PeriodElapsedCallback.
+HAL_StatusTypeDef HAL_TIM_DMABurst_MultiWriteStart(TIM_HandleTypeDef *htim, uint32_t BurstBaseAddress,
+                                                   uint32_t BurstRequestSrc, uint32_t *BurstBuffer,
+                                                   uint32_t BurstLength, uint32_t DataLength);
+HAL_StatusTypeDef HAL_TIM_DMABurst_WriteStop(TIM_HandleTypeDef *htim, uint32_t BurstRequestSrc);
+
+// Input capture into memory by the channel's DMA stream; NDTR counts down
+// from Length as captures arrive
+HAL_StatusTypeDef HAL_TIM_IC_Start_DMA(TIM_HandleTypeDef *htim, uint32_t Channel, uint32_t *pData,
+                                       uint16_t Length);
+HAL_StatusTypeDef HAL_TIM_IC_Stop_DMA(TIM_HandleTypeDef *htim, uint32_t Channel);
+
+// Weak, overridden by the firmware
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+
+/* --- DAC --- */
+
+typedef struct {
+    volatile uint32_t CR;
+    volatile uint32_t SWTRIGR;
+    volatile uint32_t DHR12R1;
+    volatile uint32_t DHR12L1;
+    volatile uint32_t DHR8R1;
+    volatile uint32_t DHR12R2;
+    volatile uint32_t DHR12L2;
+    volatile uint32_t DHR8R2;
+    volatile uint32_t DHR12RD;
+    volatile uint32_t DHR12LD;
+    volatile uint32_t DHR8RD;
+    volatile uint32_t DOR1;
+    volatile uint32_t DOR2;
+    volatile uint32_t SR;
+} DAC_TypeDef;
+
+typedef struct {
+    DAC_TypeDef *Instance;
+    DMA_HandleTypeDef *DMA_Handle1;
+} DAC_HandleTypeDef;
+
+#define DAC_CHANNEL_1     0x00000000U
+#define DAC_CHANNEL_2     0x00000010U
+#define DAC_ALIGN_12B_R   0x00000000U
+
+HAL_StatusTypeDef HAL_DAC_Start(DAC_HandleTypeDef *hdac, uint32_t channel);
+HAL_StatusTypeDef HAL_DAC_Stop(DAC_HandleTypeDef *hdac, uint32_t channel);
+HAL_StatusTypeDef HAL_DAC_SetValue(DAC_HandleTypeDef *hdac, uint32_t channel,
+                                   uint32_t alignment, uint32_t data);
+HAL_StatusTypeDef HAL_DAC_Start_DMA(DAC_HandleTypeDef *hdac, uint32_t channel, uint32_t *data,
+                                    uint32_t length, uint32_t alignment);
+
+/* --- System --- */
+
+HAL_StatusTypeDef HAL_Init(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t delay_ms);
+
+#endif // STM32F7XX_HAL_H
@@ -0,0 +1,203 @@
+/*
+ * stm32f7xx_hal_host.cpp - Host stand-in for the STM32F7 HAL
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Backs the peripheral handles that CubeMX normally generates in main.c
+ * (htim1, htim2, htim3, htim6, hdac and their DMA streams) with in-memory
+ * register blocks. DMA transfers (halfword, as the DAC uses) complete
+ * instantly: the destination register ends up holding the last element. A
+ * circular timer burst loads its first burst into the registers and leaves
+ * the buffer address and length in the stream registers, where a simulated
+ * plant can replay it cycle by cycle; a normal one plays out at once and
+ * completes. TIM3 carries the ESC lines: its bursts and input captures go
+ * to the simulated ESCs (esc_model.h).
+ */
+
+#include "stm32f7xx_hal.h"
+#include "esc_model.h"
+#include "host_clock.h"
+#include "system_clock.h"
+#include <stddef.h>
+
+uint32_t SystemCoreClock = 216000000U;
+
+DWT_Type host_dwt;
+CoreDebug_Type host_core_debug;
+
+static TIM_TypeDef tim1_regs;
+static TIM_TypeDef tim2_regs;
+static TIM_TypeDef tim3_regs;
+static TIM_TypeDef tim6_regs;
+static DAC_TypeDef dac_regs;
+static DMA_Stream_TypeDef dac_dma_regs;
+static DMA_Stream_TypeDef tim2_up_dma_regs = { DMA_SxCR_CIRC, 0, 0, 0, 0, 0 };
+static DMA_Stream_TypeDef tim3_dma_regs[5];   // Update, CC1-CC4
+static DMA_HandleTypeDef hdma_dac1 = { &dac_dma_regs };
+static DMA_HandleTypeDef hdma_tim2_up = { &tim2_up_dma_regs };
+static DMA_HandleTypeDef hdma_tim3[5] = {
+    { &tim3_dma_regs[0] }, { &tim3_dma_regs[1] }, { &tim3_dma_regs[2] }, { &tim3_dma_regs[3] },
+    { &tim3_dma_regs[4] },
+};
+
+TIM_HandleTypeDef htim1 = { &tim1_regs, {} };
+TIM_HandleTypeDef htim2 = { &tim2_regs, { &hdma_tim2_up } };
+TIM_HandleTypeDef htim3 = { &tim3_regs, { &hdma_tim3[0], &hdma_tim3[1], &hdma_tim3[2], &hdma_tim3[3],
+                                          &hdma_tim3[4] } };
+TIM_HandleTypeDef htim6 = { &tim6_regs, {} };
+DAC_HandleTypeDef hdac = { &dac_regs, &hdma_dac1 };
+
+HAL_StatusTypeDef HAL_Init(void) {
+    HostClock_ConfigureFromEnv();
+    return HAL_OK;
+}
+
+uint32_t HAL_GetTick(void) {
+    return (uint32_t)(SystemClock_Micros() / 1000ULL);
+}
+
+void HAL_Delay(uint32_t delay_ms) {
+    SystemClock_SleepUntil(SystemClock_Micros() + (uint64_t)delay_ms * 1000ULL);
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void) {
+    return SystemCoreClock / 4U;
+}
+
+HAL_StatusTypeDef HAL_DMA_Start(DMA_HandleTypeDef *hdma, uintptr_t src, uintptr_t dst, uint32_t length) {
+    if (length == 0) return HAL_ERROR;
+    hdma->Instance->M0AR = src;
+    hdma->Instance->PAR = dst;
+    hdma->Instance->NDTR = 0;
+    *(volatile uint32_t *)dst = ((const uint16_t *)src)[length - 1];
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma) {
+    hdma->Instance->NDTR = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim) {
+    htim->Instance->CR1 |= TIM_CR1_CEN;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef *htim) {
+    htim->Instance->CR1 &= ~TIM_CR1_CEN;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_DMABurst_MultiWriteStart(TIM_HandleTypeDef *htim, uint32_t BurstBaseAddress,
+                                                   uint32_t BurstRequestSrc, uint32_t *BurstBuffer,
+                                                   uint32_t BurstLength, uint32_t DataLength) {
+    DMA_HandleTypeDef *hdma = htim->hdma[TIM_DMA_ID_UPDATE];
+    uint32_t transfers = (BurstLength >> 8) + 1U;
+    if (hdma == NULL || DataLength < transfers) return HAL_ERROR;
+
+    volatile uint32_t *base = &htim->Instance->CR1 + BurstBaseAddress;
+    for (uint32_t i = 0; i < transfers; i++) base[i] = BurstBuffer[i];
+    hdma->Instance->M0AR = (uintptr_t)BurstBuffer;
+    hdma->Instance->NDTR = DataLength;
+    hdma->Instance->CR |= DMA_SxCR_EN;
+    htim->Instance->DCR = BurstLength | BurstBaseAddress;
+    htim->Instance->DIER |= BurstRequestSrc;
+    if (hdma->Instance->CR & DMA_SxCR_CIRC) return HAL_OK;
+
+    // Normal mode: play the rest of the buffer and complete
+    for (uint32_t word = transfers; word + transfers <= DataLength; word += transfers) {
+        for (uint32_t i = 0; i < transfers; i++) base[i] = BurstBuffer[word + i];
+    }
+    if (htim == &htim3) EscModel_OnFrame(htim, BurstBuffer, DataLength);
+    hdma->Instance->NDTR = 0;
+    hdma->Instance->CR &= ~DMA_SxCR_EN;
+    HAL_TIM_PeriodElapsedCallback(htim);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_DMABurst_WriteStop(TIM_HandleTypeDef *htim, uint32_t BurstRequestSrc) {
+    DMA_HandleTypeDef *hdma = htim->hdma[TIM_DMA_ID_UPDATE];
+    htim->Instance->DIER &= ~BurstRequestSrc;
+    if (hdma != NULL) hdma->Instance->CR &= ~DMA_SxCR_EN;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_Start_DMA(TIM_HandleTypeDef *htim, uint32_t Channel, uint32_t *pData,
+                                       uint16_t Length) {
+    DMA_HandleTypeDef *hdma = htim->hdma[TIM_DMA_ID_CC1 + (Channel >> 2U)];
+    if (hdma == NULL || Length == 0) return HAL_ERROR;
+    hdma->Instance->M0AR = (uintptr_t)pData;
+    hdma->Instance->PAR = (uintptr_t)(&htim->Instance->CCR1 + (Channel >> 2U));
+    hdma->Instance->NDTR = Length;
+    hdma->Instance->CR |= DMA_SxCR_EN;
+    htim->Instance->DIER |= 1UL << (9U + (Channel >> 2U));   // CCxDE
+    htim->Instance->CR1 |= TIM_CR1_CEN;
+
+    // Captures arrive at once: halfword edge times from the ESC's reply
+    if (htim == &htim3) {
+        uint32_t captured = EscModel_Reply(htim, Channel, (uint16_t *)pData, Length);
+        hdma->Instance->NDTR = Length - captured;
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_Stop_DMA(TIM_HandleTypeDef *htim, uint32_t Channel) {
+    DMA_HandleTypeDef *hdma = htim->hdma[TIM_DMA_ID_CC1 + (Channel >> 2U)];
+    htim->Instance->DIER &= ~(1UL << (9U + (Channel >> 2U)));
+    if (hdma != NULL) hdma->Instance->CR &= ~DMA_SxCR_EN;
+    return HAL_OK;
+}
+
+__attribute__((weak)) void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
+    (void)htim;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t channel) {
+    htim->Instance->CCER |= 1UL << channel;
+    htim->Instance->CR1 |= TIM_CR1_CEN;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t channel) {
+    htim->Instance->CCER &= ~(1UL << channel);
+    if ((htim->Instance->CCER & 0x1111U) == 0) {
+        htim->Instance->CR1 &= ~TIM_CR1_CEN;
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DAC_Start(DAC_HandleTypeDef *hdac_handle, uint32_t channel) {
+    hdac_handle->Instance->CR |= 1UL << channel;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DAC_Stop(DAC_HandleTypeDef *hdac_handle, uint32_t channel) {
+    hdac_handle->Instance->CR &= ~(1UL << channel);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DAC_SetValue(DAC_HandleTypeDef *hdac_handle, uint32_t channel,
+                                   uint32_t alignment, uint32_t data) {
+    (void)alignment;
+    if (channel == DAC_CHANNEL_1) {
+        hdac_handle->Instance->DHR12R1 = data & 0xFFFU;
+        hdac_handle->Instance->DOR1 = data & 0xFFFU;
+    } else {
+        hdac_handle->Instance->DHR12R2 = data & 0xFFFU;
+        hdac_handle->Instance->DOR2 = data & 0xFFFU;
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DAC_Start_DMA(DAC_HandleTypeDef *hdac_handle, uint32_t channel, uint32_t *data,
+                                    uint32_t length, uint32_t alignment) {
+    (void)alignment;
+    volatile uint32_t *holding = (channel == DAC_CHANNEL_1) ? &hdac_handle->Instance->DHR12R1
+                                                            : &hdac_handle->Instance->DHR12R2;
+    hdac_handle->Instance->CR |= 1UL << channel;
+    HAL_DMA_Start(hdac_handle->DMA_Handle1, (uintptr_t)data, (uintptr_t)holding, length);
+    if (channel == DAC_CHANNEL_1) hdac_handle->Instance->DOR1 = *holding;
+    else hdac_handle->Instance->DOR2 = *holding;
+    return HAL_OK;
+}
@@ -0,0 +1,124 @@
+/*
+ * telemetry_link_host.cpp - Host stand-in for the telemetry radio UART
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Each transfer holds the busy flag for its time on the wire at
+ * TELEMETRY_UART_BAUD (on the system clock) and is written to the sink
+ * chosen by TMF_TELEMETRY:
+ *   unset        discarded
+ *   pty          a raw pseudo-terminal; its path is printed at start-up
+ *   udp:<port>   datagrams to 127.0.0.1:<port>
+ * Writes never block: if the reader falls behind the bytes are lost, as
+ * they would be over the air. tmf_telemetry_dump reads either sink.
+ *
+ * Uplink: bytes written to the pty, or datagrams sent back to the port
+ * the telemetry comes from, are what the radio received; reads never
+ * block either.
+ */
+
+#include "hardware_drivers.h"
+#include "system_clock.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define TELEMETRY_BYTE_TIME_NS  (10000000000ULL / TELEMETRY_UART_BAUD)   // 8N1
+
+static int link_fd = -1;
+static bool link_is_socket = false;
+static struct sockaddr_in link_peer;
+static uint64_t busy_until_us = 0;
+
+static int open_pty(void);
+static int open_udp(const char *port);
+
+bool TelemetryLink_Init(void) {
+    busy_until_us = 0;
+    if (link_fd >= 0) return true;
+
+    const char *sink = getenv("TMF_TELEMETRY");
+    if (sink == NULL || sink[0] == '\0') return true;
+
+    if (strcmp(sink, "pty") == 0) {
+        link_fd = open_pty();
+    } else if (strncmp(sink, "udp:", 4) == 0) {
+        link_fd = open_udp(sink + 4);
+        link_is_socket = true;
+    } else {
+        fprintf(stderr, "telemetry: unknown TMF_TELEMETRY sink '%s'\n", sink);
+        return false;
+    }
+    return link_fd >= 0;
+}
+
+bool TelemetryLink_TxBusy(void) {
+    return SystemClock_Micros() < busy_until_us;
+}
+
+bool TelemetryLink_StartTx(const uint8_t *data, size_t length) {
+    if (TelemetryLink_TxBusy() || length == 0) return false;
+
+    if (link_fd >= 0) {
+        ssize_t written;
+        if (link_is_socket) {
+            written = sendto(link_fd, data, length, MSG_DONTWAIT,
+                             (const struct sockaddr *)&link_peer, sizeof(link_peer));
+        } else {
+            written = write(link_fd, data, length);
+        }
+        (void)written;   // A full pty or socket buffer drops bytes, like a lossy radio
+    }
+
+    busy_until_us = SystemClock_Micros() + (length * TELEMETRY_BYTE_TIME_NS + 999U) / 1000U;
+    return true;
+}
+
+size_t TelemetryLink_Receive(uint8_t *data, size_t capacity) {
+    if (link_fd < 0 || capacity == 0) return 0;
+
+    ssize_t received;
+    if (link_is_socket) {
+        received = recv(link_fd, data, capacity, MSG_DONTWAIT);
+    } else {
+        received = read(link_fd, data, capacity);
+    }
+    return (received > 0) ? (size_t)received : 0;
+}
+
+static int open_pty(void) {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    printf("telemetry: pty %s\n", ptsname(fd));
+    return fd;
+}
+
+static int open_udp(const char *port) {
+    int number = atoi(port);
+    if (number <= 0 || number > 65535) return -1;
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+    memset(&link_peer, 0, sizeof(link_peer));
+    link_peer.sin_family = AF_INET;
+    link_peer.sin_port = htons((uint16_t)number);
+    link_peer.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    printf("telemetry: udp 127.0.0.1:%d\n", number);
+    return fd;
+}
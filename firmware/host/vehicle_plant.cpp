@@ -0,0 +1,555 @@
+/*
+ * vehicle_plant.cpp - Batched 6-DOF multirotor plant for SIL and batch runs
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * The step loop reads every array through the plant's pointers with no
+ * calls but sqrtf, so GCC vectorizes it across vehicles given
+ * -fno-math-errno and -fno-trapping-math (set for this file in
+ * CMakeLists.txt; check with -fopt-info-vec). Anything per-vehicle that needs trig is precomputed
+ * when the parameters or the step length change.
+ */
+
+#include "vehicle_plant.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GRAVITY        9.80665f
+#define DEG2RAD_F      0.017453293f
+#define RAD2DEG_F      57.29578f
+#define PLANT_ALIGN    64            // Every array starts on a cache line
+#define ISA_P0_HPA     1013.25f
+#define ISA_T0_K       288.15f
+#define ISA_LAPSE      0.0065f     // K/m
+#define ISA_EXPONENT   0.190263f   // R * lapse rate / g
+#define BARO_MIN_HPA   300.0f      // BMP388 range
+#define BARO_MAX_HPA   1250.0f
+
+typedef struct {
+    uint8_t *base;          // NULL while sizing
+    size_t used;
+} Carver_t;
+
+// State RK4 integrates (position is integrated from the stage velocities)
+typedef struct {
+    float vel[3];
+    float q[4];
+    float rate[3];
+    float thrust[4];
+} Body_t;
+
+typedef struct {
+    float command[4];
+    float thrust_max, inv_tau, inv_mass;
+    float inertia[3], inv_inertia[3];
+    float arm, yaw_torque, drag_linear, drag_quadratic, rot_damping;
+    float air[3];           // Wind plus gust, NED
+} Coeffs_t;
+
+static size_t layout(VehiclePlant_t *plant, uint8_t *base, uint32_t lanes);
+static void *carve(Carver_t *carver, size_t bytes);
+static void update_vibration_step(VehiclePlant_t *plant, float dt);
+static inline void derivative(const Coeffs_t *k, const Body_t *y, Body_t *dy, float specific[3]);
+static inline void stage(const Body_t *y, const Body_t *dy, float h, Body_t *out);
+static inline uint32_t xorshift(uint32_t *state);
+static inline float gauss(uint32_t *state);
+static uint64_t splitmix64(uint64_t *state);
+
+VehiclePlant_Airframe_t VehiclePlant_DefaultAirframe(void) {
+    VehiclePlant_Airframe_t airframe;
+    airframe.mass_kg = 1.5f;
+    airframe.inertia[0] = 0.015f;
+    airframe.inertia[1] = 0.015f;
+    airframe.inertia[2] = 0.028f;
+    airframe.arm_m = 0.177f;
+    airframe.motor_max_n = 2.0f * airframe.mass_kg * GRAVITY / 4.0f;
+    airframe.motor_tau_s = 0.03f;
+    airframe.yaw_torque_per_n = 0.016f;
+    airframe.drag_linear = 0.20f;
+    airframe.drag_quadratic = 0.015f;
+    airframe.rot_damping = 0.002f;
+    return airframe;
+}
+
+VehiclePlant_Sensors_t VehiclePlant_DefaultSensors(void) {
+    VehiclePlant_Sensors_t sensors;
+    memset(&sensors, 0, sizeof(sensors));
+    sensors.gyro_noise = 0.1f;
+    sensors.accel_noise = 0.05f;
+    sensors.mag_noise = 0.3f;
+    sensors.vibration_hz = 200.0f;
+    sensors.baro_noise_pa = 1.5f;
+    sensors.gps_noise = 0.5f;
+    sensors.gps_drift = 1.0f;
+    sensors.gps_drift_tau_s = 20.0f;
+    sensors.gps_velocity_noise = 0.1f;
+    return sensors;
+}
+
+bool VehiclePlant_Init(VehiclePlant_t *plant, uint32_t count, double latitude, double longitude,
+                       float altitude, uint64_t seed) {
+    memset(plant, 0, sizeof(*plant));
+    if (count == 0) return false;
+
+    // Pad to whole cache lines of floats so no array shares a line
+    uint32_t lanes = (count + 15U) & ~15U;
+    size_t bytes = layout(plant, NULL, lanes);
+    void *block = aligned_alloc(PLANT_ALIGN, bytes);
+    if (!block) return false;
+    memset(block, 0, bytes);
+    layout(plant, (uint8_t *)block, lanes);
+    plant->block = block;
+    plant->count = count;
+
+    LocalFrame_Init(&plant->launch, latitude, longitude, altitude);
+    plant->mag_nwu[0] = 21.5f;
+    plant->mag_nwu[1] = -0.7f;
+    plant->mag_nwu[2] = -43.0f;
+
+    VehiclePlant_Airframe_t airframe = VehiclePlant_DefaultAirframe();
+    VehiclePlant_Sensors_t sensors = VehiclePlant_DefaultSensors();
+    VehiclePlant_Wind_t still = { { 0.0f, 0.0f, 0.0f }, 0.0f, 2.0f };
+    const float ground[3] = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t state = seed ^ ((uint64_t)i * 0x9E3779B97F4A7C15ULL);
+        uint32_t word = (uint32_t)splitmix64(&state);
+        plant->rng[i] = word ? word : 0x6C8E9CF5U;
+        plant->free[i] = 1.0f;
+        VehiclePlant_SetAirframe(plant, i, &airframe);
+        VehiclePlant_SetSensors(plant, i, &sensors);
+        VehiclePlant_SetWind(plant, i, &still);
+        VehiclePlant_Place(plant, i, ground, 0.0f);
+    }
+    return true;
+}
+
+void VehiclePlant_Free(VehiclePlant_t *plant) {
+    free(plant->block);
+    memset(plant, 0, sizeof(*plant));
+}
+
+void VehiclePlant_SetAirframe(VehiclePlant_t *plant, uint32_t vehicle, const VehiclePlant_Airframe_t *airframe) {
+    if (vehicle >= plant->count) return;
+    plant->thrust_max[vehicle] = airframe->motor_max_n;
+    plant->inv_tau[vehicle] = 1.0f / airframe->motor_tau_s;
+    plant->inv_mass[vehicle] = 1.0f / airframe->mass_kg;
+    for (int axis = 0; axis < 3; axis++) {
+        plant->inertia[axis][vehicle] = airframe->inertia[axis];
+        plant->inv_inertia[axis][vehicle] = 1.0f / airframe->inertia[axis];
+    }
+    plant->arm[vehicle] = airframe->arm_m;
+    plant->yaw_torque[vehicle] = airframe->yaw_torque_per_n;
+    plant->drag_linear[vehicle] = airframe->drag_linear / airframe->mass_kg;
+    plant->drag_quadratic[vehicle] = airframe->drag_quadratic / airframe->mass_kg;
+    plant->rot_damping[vehicle] = airframe->rot_damping;
+}
+
+void VehiclePlant_SetWind(VehiclePlant_t *plant, uint32_t vehicle, const VehiclePlant_Wind_t *wind) {
+    if (vehicle >= plant->count) return;
+    for (int axis = 0; axis < 3; axis++) plant->wind[axis][vehicle] = wind->mean[axis];
+    plant->gust_rms[vehicle] = wind->gust;
+    plant->gust_tau[vehicle] = wind->gust_tau_s > 0.01f ? wind->gust_tau_s : 0.01f;
+}
+
+void VehiclePlant_SetSensors(VehiclePlant_t *plant, uint32_t vehicle, const VehiclePlant_Sensors_t *sensors) {
+    if (vehicle >= plant->count) return;
+    plant->sensors[vehicle] = *sensors;
+    if (plant->vibration[0][vehicle] == 0.0f && plant->vibration[1][vehicle] == 0.0f) {
+        plant->vibration[0][vehicle] = 1.0f;
+    }
+    plant->vibration_dt = 0.0f;   // Rotations recomputed on the next step
+}
+
+void VehiclePlant_Place(VehiclePlant_t *plant, uint32_t vehicle, const float ned[3], float yaw) {
+    if (vehicle >= plant->count) return;
+    bool grounded = ned[2] >= 0.0f;
+    plant->pos[0][vehicle] = ned[0];
+    plant->pos[1][vehicle] = ned[1];
+    plant->pos[2][vehicle] = grounded ? 0.0 : ned[2];
+
+    float half = -0.5f * yaw * DEG2RAD_F;   // Heading to NWU rotation
+    plant->q[0][vehicle] = cosf(half);
+    plant->q[1][vehicle] = 0.0f;
+    plant->q[2][vehicle] = 0.0f;
+    plant->q[3][vehicle] = sinf(half);
+
+    float hover = 0.25f * GRAVITY / plant->inv_mass[vehicle];
+    for (int axis = 0; axis < 3; axis++) {
+        plant->vel[axis][vehicle] = 0.0f;
+        plant->rate[axis][vehicle] = 0.0f;
+        plant->gust[axis][vehicle] = 0.0f;
+        plant->specific[axis][vehicle] = 0.0f;
+        plant->gps_drift[axis][vehicle] = 0.0f;
+    }
+    plant->specific[2][vehicle] = GRAVITY;
+    for (int m = 0; m < 4; m++) {
+        plant->thrust[m][vehicle] = grounded ? 0.0f : hover;
+        plant->command[m][vehicle] = grounded ? 0.0f : hover / plant->thrust_max[vehicle];
+    }
+    plant->on_ground[vehicle] = grounded ? 1.0f : 0.0f;
+    plant->gps_last_us[vehicle] = 0;
+}
+
+void VehiclePlant_Hold(VehiclePlant_t *plant, uint32_t vehicle, bool held) {
+    if (vehicle >= plant->count) return;
+    plant->free[vehicle] = held ? 0.0f : 1.0f;
+}
+
+void VehiclePlant_SetMotors(VehiclePlant_t *plant, uint32_t vehicle, const Motor_Output_t *motors) {
+    if (vehicle >= plant->count) return;
+    const float command[4] = { motors->motor1, motors->motor2, motors->motor3, motors->motor4 };
+    for (int m = 0; m < 4; m++) {
+        float c = command[m];
+        plant->command[m][vehicle] = c < 0.0f ? 0.0f : (c > 1.0f ? 1.0f : c);
+    }
+}
+
+void VehiclePlant_Step(VehiclePlant_t *plant, float dt) {
+    if (dt != plant->vibration_dt) update_vibration_step(plant, dt);
+    const uint32_t count = plant->count;
+    const float half = 0.5f * dt, sixth = dt / 6.0f;
+
+#pragma GCC ivdep
+    for (uint32_t i = 0; i < count; i++) {
+        // Gusts: first-order Gauss-Markov, held over the step
+        uint32_t rng = plant->rng[i];
+        float decay = dt / plant->gust_tau[i];
+        float drive = plant->gust_rms[i] * sqrtf(2.0f * decay);
+        float gust_n = plant->gust[0][i] * (1.0f - decay) + drive * gauss(&rng);
+        float gust_e = plant->gust[1][i] * (1.0f - decay) + drive * gauss(&rng);
+        float gust_d = plant->gust[2][i] * (1.0f - decay) + 0.5f * drive * gauss(&rng);
+        plant->gust[0][i] = gust_n;
+        plant->gust[1][i] = gust_e;
+        plant->gust[2][i] = gust_d;
+        plant->rng[i] = rng;
+
+        Coeffs_t k;
+        for (int m = 0; m < 4; m++) k.command[m] = plant->command[m][i];
+        k.thrust_max = plant->thrust_max[i];
+        k.inv_tau = plant->inv_tau[i];
+        k.inv_mass = plant->inv_mass[i];
+        for (int a = 0; a < 3; a++) {
+            k.inertia[a] = plant->inertia[a][i];
+            k.inv_inertia[a] = plant->inv_inertia[a][i];
+        }
+        k.arm = plant->arm[i];
+        k.yaw_torque = plant->yaw_torque[i];
+        k.drag_linear = plant->drag_linear[i];
+        k.drag_quadratic = plant->drag_quadratic[i];
+        k.rot_damping = plant->rot_damping[i];
+        k.air[0] = plant->wind[0][i] + gust_n;
+        k.air[1] = plant->wind[1][i] + gust_e;
+        k.air[2] = plant->wind[2][i] + gust_d;
+
+        Body_t y;
+        for (int a = 0; a < 3; a++) {
+            y.vel[a] = plant->vel[a][i];
+            y.rate[a] = plant->rate[a][i];
+        }
+        for (int c = 0; c < 4; c++) {
+            y.q[c] = plant->q[c][i];
+            y.thrust[c] = plant->thrust[c][i];
+        }
+
+        // Classical RK4
+        Body_t k1, k2, k3, k4, s;
+        float f1[3], f2[3], f3[3], f4[3];
+        derivative(&k, &y, &k1, f1);
+        stage(&y, &k1, half, &s);
+        derivative(&k, &s, &k2, f2);
+        stage(&y, &k2, half, &s);
+        derivative(&k, &s, &k3, f3);
+        stage(&y, &k3, dt, &s);
+        derivative(&k, &s, &k4, f4);
+
+        // A held vehicle keeps its state
+        float free = plant->free[i];
+        float h = sixth * free;
+        Body_t n;
+        for (int a = 0; a < 3; a++) {
+            n.vel[a] = y.vel[a] + h * (k1.vel[a] + 2.0f * (k2.vel[a] + k3.vel[a]) + k4.vel[a]);
+            n.rate[a] = y.rate[a] + h * (k1.rate[a] + 2.0f * (k2.rate[a] + k3.rate[a]) + k4.rate[a]);
+        }
+        for (int c = 0; c < 4; c++) {
+            n.q[c] = y.q[c] + h * (k1.q[c] + 2.0f * (k2.q[c] + k3.q[c]) + k4.q[c]);
+            n.thrust[c] = y.thrust[c] + h * (k1.thrust[c] + 2.0f * (k2.thrust[c] + k3.thrust[c]) + k4.thrust[c]);
+        }
+        float norm = 1.0f / sqrtf(n.q[0] * n.q[0] + n.q[1] * n.q[1] + n.q[2] * n.q[2] + n.q[3] * n.q[3]);
+        for (int c = 0; c < 4; c++) n.q[c] *= norm;
+
+        // The stage velocities are v, v + k1 dt/2, v + k2 dt/2, v + k3 dt
+        float move[3];
+        for (int a = 0; a < 3; a++) move[a] = free * dt * (y.vel[a] + sixth * (k1.vel[a] + k2.vel[a] + k3.vel[a]));
+        double down = plant->pos[2][i] + (double)move[2];
+
+        // Ground contact: resting on the plane, no sliding or turning
+        float contact = (float)(down > 0.0);
+        float loose = 1.0f - contact;
+        plant->pos[0][i] += (double)(move[0] * loose);
+        plant->pos[1][i] += (double)(move[1] * loose);
+        plant->pos[2][i] = down > 0.0 ? 0.0 : down;
+        for (int a = 0; a < 3; a++) {
+            plant->vel[a][i] = n.vel[a] * loose;
+            plant->rate[a][i] = n.rate[a] * loose;
+        }
+        for (int c = 0; c < 4; c++) {
+            plant->q[c][i] = n.q[c];
+            plant->thrust[c][i] = n.thrust[c];
+        }
+        plant->on_ground[i] = contact;
+
+        // Specific force: step average in flight, gravity alone when at rest
+        // (the third row of the body-to-NWU rotation, times g)
+        float w = n.q[0], x = n.q[1], yq = n.q[2], z = n.q[3];
+        float rest[3] = { 2.0f * (x * z - w * yq) * GRAVITY, 2.0f * (yq * z + w * x) * GRAVITY,
+                          (1.0f - 2.0f * (x * x + yq * yq)) * GRAVITY };
+        float moving = free * loose;
+        for (int a = 0; a < 3; a++) {
+            float average = (f1[a] + 2.0f * (f2[a] + f3[a]) + f4[a]) * (1.0f / 6.0f);
+            plant->specific[a][i] = moving * average + (1.0f - moving) * rest[a];
+        }
+
+        // Rotor vibration tone, renormalized as it turns
+        float vc = plant->vibration[0][i], vs = plant->vibration[1][i];
+        float rc = plant->vibration_step[0][i], rs = plant->vibration_step[1][i];
+        float nc = vc * rc - vs * rs, ns = vs * rc + vc * rs;
+        float fix = 1.5f - 0.5f * (nc * nc + ns * ns);
+        plant->vibration[0][i] = nc * fix;
+        plant->vibration[1][i] = ns * fix;
+    }
+}
+
+void VehiclePlant_SampleImu(VehiclePlant_t *plant, uint64_t time_us, IMU_Sample_t *samples) {
+    const float *mag = plant->mag_nwu;
+    for (uint32_t i = 0; i < plant->count; i++) {
+        const VehiclePlant_Sensors_t *s = &plant->sensors[i];
+        uint32_t rng = plant->rng[i];
+        float tone = plant->vibration[1][i];
+        float w = plant->q[0][i], x = plant->q[1][i], y = plant->q[2][i], z = plant->q[3][i];
+
+        // Body-to-NWU rotation; its transpose takes the field into the body
+        float r[3][3] = {
+            { 1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - w * z), 2.0f * (x * z + w * y) },
+            { 2.0f * (x * y + w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - w * x) },
+            { 2.0f * (x * z - w * y), 2.0f * (y * z + w * x), 1.0f - 2.0f * (x * x + y * y) },
+        };
+
+        IMU_Sample_t *out = &samples[i];
+        out->timestamp_us = time_us;
+        for (int a = 0; a < 3; a++) {
+            out->gyro[a] = plant->rate[a][i] * RAD2DEG_F + s->gyro_bias[a] + s->gyro_noise * gauss(&rng) +
+                           s->vibration_gyro * tone;
+            out->accel[a] = plant->specific[a][i] + s->accel_bias[a] + s->accel_noise * gauss(&rng) +
+                            s->vibration_accel * tone;
+            out->mag[a] = r[0][a] * mag[0] + r[1][a] * mag[1] + r[2][a] * mag[2] + s->mag_noise * gauss(&rng);
+        }
+        plant->rng[i] = rng;
+    }
+}
+
+void VehiclePlant_SampleBaro(VehiclePlant_t *plant, uint32_t vehicle, float *pressure, float *temperature) {
+    if (vehicle >= plant->count) return;
+    const VehiclePlant_Sensors_t *s = &plant->sensors[vehicle];
+    float altitude = plant->launch.ref_alt - (float)plant->pos[2][vehicle];
+
+    // ISA troposphere, the inverse of Sensors_PressureToAltitude
+    float ratio = 1.0f - altitude * (ISA_LAPSE / ISA_T0_K);
+    float p = ISA_P0_HPA * powf(ratio > 0.0f ? ratio : 0.0f, 1.0f / ISA_EXPONENT);
+    p += 0.01f * (s->baro_offset_pa + s->baro_noise_pa * gauss(&plant->rng[vehicle]));
+    *pressure = p < BARO_MIN_HPA ? BARO_MIN_HPA : (p > BARO_MAX_HPA ? BARO_MAX_HPA : p);
+    *temperature = 15.0f - 0.0065f * altitude;
+}
+
+void VehiclePlant_SampleGps(VehiclePlant_t *plant, uint32_t vehicle, uint64_t time_us, GPS_Data_t *fix) {
+    if (vehicle >= plant->count) return;
+    const VehiclePlant_Sensors_t *s = &plant->sensors[vehicle];
+    uint32_t *rng = &plant->rng[vehicle];
+
+    // Drift advances by the time since the last fix
+    uint64_t last = plant->gps_last_us[vehicle];
+    float elapsed = (last == 0 || time_us <= last) ? 0.0f : (float)(time_us - last) * 1e-6f;
+    float decay = elapsed / s->gps_drift_tau_s;
+    if (decay > 1.0f) decay = 1.0f;
+    float drive = s->gps_drift * sqrtf(2.0f * decay);
+    for (int a = 0; a < 3; a++) {
+        float scale = (a == 2) ? 1.5f : 1.0f;
+        plant->gps_drift[a][vehicle] += -decay * plant->gps_drift[a][vehicle] + scale * drive * gauss(rng);
+    }
+    plant->gps_last_us[vehicle] = time_us;
+
+    float ned[3];
+    for (int a = 0; a < 3; a++) {
+        float scale = (a == 2) ? 1.5f : 1.0f;
+        ned[a] = (float)plant->pos[a][vehicle] + plant->gps_drift[a][vehicle] + scale * s->gps_noise * gauss(rng);
+    }
+    LocalFrame_FromNED(&plant->launch, ned, &fix->latitude, &fix->longitude, &fix->altitude);
+
+    float vn = plant->vel[0][vehicle] + s->gps_velocity_noise * gauss(rng);
+    float ve = plant->vel[1][vehicle] + s->gps_velocity_noise * gauss(rng);
+    fix->speed = sqrtf(vn * vn + ve * ve);
+    fix->course = atan2f(ve, vn) * RAD2DEG_F;
+    if (fix->course < 0.0f) fix->course += 360.0f;
+    fix->fix_type = 2;
+    fix->satellites = 12;
+    fix->timestamp_us = time_us;
+}
+
+void VehiclePlant_GetState(const VehiclePlant_t *plant, uint32_t vehicle, VehiclePlant_State_t *state) {
+    if (vehicle >= plant->count) return;
+    for (int a = 0; a < 3; a++) {
+        state->position[a] = plant->pos[a][vehicle];
+        state->velocity[a] = plant->vel[a][vehicle];
+        state->rate[a] = plant->rate[a][vehicle] * RAD2DEG_F;
+    }
+    for (int m = 0; m < 4; m++) state->thrust[m] = plant->thrust[m][vehicle];
+    Quaternion_t q = { plant->q[0][vehicle], plant->q[1][vehicle], plant->q[2][vehicle], plant->q[3][vehicle] };
+    state->q = q;
+
+    state->roll = atan2f(2.0f * (q.w * q.x + q.y * q.z), 1.0f - 2.0f * (q.x * q.x + q.y * q.y)) * RAD2DEG_F;
+    float sp = 2.0f * (q.w * q.y - q.z * q.x);
+    if (sp > 1.0f) sp = 1.0f;
+    if (sp < -1.0f) sp = -1.0f;
+    state->pitch = asinf(sp) * RAD2DEG_F;
+    state->yaw = -atan2f(2.0f * (q.w * q.z + q.x * q.y), 1.0f - 2.0f * (q.y * q.y + q.z * q.z)) * RAD2DEG_F;
+    if (state->yaw < 0.0f) state->yaw += 360.0f;
+    state->on_ground = plant->on_ground[vehicle] > 0.5f;
+}
+
+/* --- Internals --- */
+
+static size_t layout(VehiclePlant_t *plant, uint8_t *base, uint32_t lanes) {
+    Carver_t carver = { base, 0 };
+    const size_t f = lanes * sizeof(float);
+    for (int a = 0; a < 3; a++) {
+        plant->pos[a] = (double *)carve(&carver, lanes * sizeof(double));
+        plant->vel[a] = (float *)carve(&carver, f);
+        plant->rate[a] = (float *)carve(&carver, f);
+        plant->gust[a] = (float *)carve(&carver, f);
+        plant->specific[a] = (float *)carve(&carver, f);
+        plant->inertia[a] = (float *)carve(&carver, f);
+        plant->inv_inertia[a] = (float *)carve(&carver, f);
+        plant->wind[a] = (float *)carve(&carver, f);
+        plant->gps_drift[a] = (float *)carve(&carver, f);
+    }
+    for (int c = 0; c < 4; c++) {
+        plant->q[c] = (float *)carve(&carver, f);
+        plant->thrust[c] = (float *)carve(&carver, f);
+        plant->command[c] = (float *)carve(&carver, f);
+    }
+    for (int c = 0; c < 2; c++) {
+        plant->vibration[c] = (float *)carve(&carver, f);
+        plant->vibration_step[c] = (float *)carve(&carver, f);
+    }
+    plant->on_ground = (float *)carve(&carver, f);
+    plant->free = (float *)carve(&carver, f);
+    plant->rng = (uint32_t *)carve(&carver, lanes * sizeof(uint32_t));
+    plant->thrust_max = (float *)carve(&carver, f);
+    plant->inv_tau = (float *)carve(&carver, f);
+    plant->inv_mass = (float *)carve(&carver, f);
+    plant->arm = (float *)carve(&carver, f);
+    plant->yaw_torque = (float *)carve(&carver, f);
+    plant->drag_linear = (float *)carve(&carver, f);
+    plant->drag_quadratic = (float *)carve(&carver, f);
+    plant->rot_damping = (float *)carve(&carver, f);
+    plant->gust_rms = (float *)carve(&carver, f);
+    plant->gust_tau = (float *)carve(&carver, f);
+    plant->sensors = (VehiclePlant_Sensors_t *)carve(&carver, lanes * sizeof(VehiclePlant_Sensors_t));
+    plant->gps_last_us = (uint64_t *)carve(&carver, lanes * sizeof(uint64_t));
+    return carver.used;
+}
+
+static void *carve(Carver_t *carver, size_t bytes) {
+    size_t at = carver->used;
+    carver->used += (bytes + PLANT_ALIGN - 1) & ~(size_t)(PLANT_ALIGN - 1);
+    return carver->base ? carver->base + at : NULL;
+}
+
+static void update_vibration_step(VehiclePlant_t *plant, float dt) {
+    for (uint32_t i = 0; i < plant->count; i++) {
+        float angle = 6.2831853f * plant->sensors[i].vibration_hz * dt;
+        plant->vibration_step[0][i] = cosf(angle);
+        plant->vibration_step[1][i] = sinf(angle);
+    }
+    plant->vibration_dt = dt;
+}
+
+static inline void derivative(const Coeffs_t *k, const Body_t *y, Body_t *dy, float specific[3]) {
+    // Motors, and the forces and torques they make (FLU offsets; CW rotors
+    // push the body counter-clockwise)
+    float t0 = y->thrust[0], t1 = y->thrust[1], t2 = y->thrust[2], t3 = y->thrust[3];
+    for (int m = 0; m < 4; m++) dy->thrust[m] = (k->command[m] * k->thrust_max - y->thrust[m]) * k->inv_tau;
+    float lift = (t0 + t1 + t2 + t3) * k->inv_mass;
+    float torque[3] = { k->arm * (t0 - t1 - t2 + t3), -k->arm * (t0 + t1 - t2 - t3),
+                        k->yaw_torque * (-t0 + t1 - t2 + t3) };
+
+    // Drag against the air, per unit mass, into NWU
+    float air[3] = { y->vel[0] - k->air[0], y->vel[1] - k->air[1], y->vel[2] - k->air[2] };
+    float speed = sqrtf(air[0] * air[0] + air[1] * air[1] + air[2] * air[2]);
+    float c = -(k->drag_linear + k->drag_quadratic * speed);
+    float drag[3] = { c * air[0], -c * air[1], -c * air[2] };
+
+    // Body-to-NWU rotation
+    float w = y->q[0], x = y->q[1], yq = y->q[2], z = y->q[3];
+    float r00 = 1.0f - 2.0f * (yq * yq + z * z), r01 = 2.0f * (x * yq - w * z), r02 = 2.0f * (x * z + w * yq);
+    float r10 = 2.0f * (x * yq + w * z), r11 = 1.0f - 2.0f * (x * x + z * z), r12 = 2.0f * (yq * z - w * x);
+    float r20 = 2.0f * (x * z - w * yq), r21 = 2.0f * (yq * z + w * x), r22 = 1.0f - 2.0f * (x * x + yq * yq);
+
+    // Specific force: thrust along body z plus drag, in NWU and in the body
+    float f[3] = { r02 * lift + drag[0], r12 * lift + drag[1], r22 * lift + drag[2] };
+    specific[0] = r00 * drag[0] + r10 * drag[1] + r20 * drag[2];
+    specific[1] = r01 * drag[0] + r11 * drag[1] + r21 * drag[2];
+    specific[2] = r02 * drag[0] + r12 * drag[1] + r22 * drag[2] + lift;
+    dy->vel[0] = f[0];
+    dy->vel[1] = -f[1];
+    dy->vel[2] = -f[2] + GRAVITY;
+
+    // q' = q (x) [0, w] / 2
+    float wx = y->rate[0], wy = y->rate[1], wz = y->rate[2];
+    dy->q[0] = -0.5f * (x * wx + yq * wy + z * wz);
+    dy->q[1] = 0.5f * (w * wx + yq * wz - z * wy);
+    dy->q[2] = 0.5f * (w * wy - x * wz + z * wx);
+    dy->q[3] = 0.5f * (w * wz + x * wy - yq * wx);
+
+    // I w' = torque - w x I w - damping w
+    float iw[3] = { k->inertia[0] * wx, k->inertia[1] * wy, k->inertia[2] * wz };
+    dy->rate[0] = (torque[0] - (wy * iw[2] - wz * iw[1]) - k->rot_damping * wx) * k->inv_inertia[0];
+    dy->rate[1] = (torque[1] - (wz * iw[0] - wx * iw[2]) - k->rot_damping * wy) * k->inv_inertia[1];
+    dy->rate[2] = (torque[2] - (wx * iw[1] - wy * iw[0]) - k->rot_damping * wz) * k->inv_inertia[2];
+}
+
+static inline void stage(const Body_t *y, const Body_t *dy, float h, Body_t *out) {
+    for (int a = 0; a < 3; a++) {
+        out->vel[a] = y->vel[a] + h * dy->vel[a];
+        out->rate[a] = y->rate[a] + h * dy->rate[a];
+    }
+    for (int c = 0; c < 4; c++) {
+        out->q[c] = y->q[c] + h * dy->q[c];
+        out->thrust[c] = y->thrust[c] + h * dy->thrust[c];
+    }
+}
+
+static inline uint32_t xorshift(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Sum of four uniforms, scaled to unit variance: close enough to normal
+// for sensor noise and gust forcing, and branch-free
+static inline float gauss(uint32_t *state) {
+    float sum = 0.0f;
+    for (int n = 0; n < 4; n++) sum += (float)(int32_t)(xorshift(state) >> 8) * (1.0f / 16777216.0f);
+    return (sum - 2.0f) * 1.7320508f;
+}
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
@@ -0,0 +1,185 @@
+/*
+ * vehicle_plant.h - Batched 6-DOF multirotor plant for SIL and batch runs
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * A rigid-body quad-X driven by the Motor_Output_t the flight controller
+ * produces, laid out like the mixer (motor 1 front-left CCW, 2 front-right
+ * CW, 3 rear-right CCW, 4 rear-left CW):
+ *   motors      thrust linear in command (as with thrust-linearized ESCs)
+ *               behind a first-order lag; rotor drag torque proportional
+ *               to thrust
+ *   body        thrust, gravity, and linear plus quadratic drag against
+ *               the air; Euler's equations with diagonal inertia,
+ *               gyroscopic coupling and rate damping
+ *   wind        a mean per vehicle plus first-order Gauss-Markov gusts
+ *   ground      a plane at launch height that the vehicle rests on
+ *
+ * Every vehicle in the batch advances together with classical RK4 (motor
+ * commands and gusts held over the step). State and parameters are kept
+ * struct-of-arrays, one array per component over the batch, and the step
+ * is a single straight-line loop over vehicles that the compiler
+ * vectorizes, so large batches run at 1-8 kHz physics rates (see the
+ * plant cases in tmf_bench). Position is double: at 8 kHz a step moves a
+ * vehicle a few millimetres, below float resolution a few km out.
+ *
+ * Frames: position and velocity are NED from the launch point; attitude
+ * rotates the body (FLU, like the sensors) into north-west-up, like the
+ * AHRS, so the truth compares directly with Sensors_ComputeEulerAngles.
+ *
+ * Sensors sample the truth with per-vehicle noise and bias:
+ *   IMU   gyro and accel with constant bias, white noise and a rotor
+ *         vibration tone; the accel reads the specific force averaged
+ *         over the last step, as a sensor's internal filter would; the
+ *         magnetometer reads the earth field rotated into the body
+ *   baro  ISA pressure at the true altitude, plus an offset and noise
+ *   GPS   position with first-order Gauss-Markov drift plus white noise,
+ *         velocity with white noise
+ * Each vehicle draws from its own generator, so its samples do not depend
+ * on the batch size or on its neighbours.
+ */
+
+#ifndef VEHICLE_PLANT_H
+#define VEHICLE_PLANT_H
+
+#include "ahrs.h"
+#include "flight_control.h"
+#include "imu_stream.h"
+#include "local_frame.h"
+#include "sensor_types.h"
+#include <stdint.h>
+
+typedef struct {
+    float mass_kg;
+    float inertia[3];           // kg m^2 about body x, y, z
+    float arm_m;                // Motor offset along each body axis
+    float motor_max_n;          // Thrust per motor at full command
+    float motor_tau_s;          // Motor lag time constant
+    float yaw_torque_per_n;     // Rotor drag torque per newton of thrust (m)
+    float drag_linear;          // N per m/s of airspeed
+    float drag_quadratic;       // N per (m/s)^2 of airspeed
+    float rot_damping;          // N m per rad/s
+} VehiclePlant_Airframe_t;
+
+typedef struct {
+    float mean[3];              // NED, m/s (the velocity of the air)
+    float gust;                 // RMS gust speed horizontally (half that vertically)
+    float gust_tau_s;           // Gust correlation time
+} VehiclePlant_Wind_t;
+
+typedef struct {
+    float gyro_noise;           // deg/s RMS per sample
+    float gyro_bias[3];         // deg/s
+    float accel_noise;          // m/s^2 RMS per sample
+    float accel_bias[3];        // m/s^2
+    float mag_noise;            // uT RMS per sample
+    float vibration_gyro;       // Rotor vibration amplitude on the gyro (deg/s)
+    float vibration_accel;      // and on the accel (m/s^2)
+    float vibration_hz;
+    float baro_noise_pa;        // Pa RMS per sample
+    float baro_offset_pa;
+    float gps_noise;            // m RMS per fix, horizontal (1.5x vertical)
+    float gps_drift;            // m RMS of the slow position error
+    float gps_drift_tau_s;
+    float gps_velocity_noise;   // m/s RMS per fix
+} VehiclePlant_Sensors_t;
+
+// Truth for one vehicle
+typedef struct {
+    double position[3];         // NED from the launch point (m)
+    float velocity[3];          // NED (m/s)
+    Quaternion_t q;             // Body (FLU) to north-west-up
+    float roll, pitch, yaw;     // Degrees, as the AHRS reports them
+    float rate[3];              // Body, deg/s
+    float thrust[4];            // N
+    bool on_ground;
+} VehiclePlant_State_t;
+
+typedef struct {
+    uint32_t count;
+    LocalFrame_t launch;        // Geodetic origin of the NED frame
+    float mag_nwu[3];           // Earth field (uT), set for mid northern latitudes
+    void *block;                // One allocation behind every array below
+
+    // State
+    double *pos[3];
+    float *vel[3];
+    float *q[4];                // w, x, y, z
+    float *rate[3];             // rad/s
+    float *thrust[4];
+    float *gust[3];
+    float *specific[3];         // Body specific force averaged over the last step
+    float *on_ground;           // 1 or 0
+    float *free;                // 0 holds the vehicle still
+    uint32_t *rng;
+    float *vibration[2];        // Tone phasor, cos and sin
+
+    // Inputs and parameters
+    float *command[4];
+    float *thrust_max;
+    float *inv_tau;
+    float *inv_mass;
+    float *inv_inertia[3];
+    float *inertia[3];
+    float *arm;
+    float *yaw_torque;
+    float *drag_linear;         // Per unit mass
+    float *drag_quadratic;
+    float *rot_damping;
+    float *wind[3];
+    float *gust_rms;
+    float *gust_tau;
+
+    // Sensor models (scalar per vehicle; sampled at sensor rates)
+    VehiclePlant_Sensors_t *sensors;
+    float *gps_drift[3];
+    uint64_t *gps_last_us;
+    float *vibration_step[2];   // Phasor rotation per step, for vibration_dt
+    float vibration_dt;
+} VehiclePlant_t;
+
+// The reference airframe: 1.5 kg quad-X, 250 mm arms, thrust to weight 2
+VehiclePlant_Airframe_t VehiclePlant_DefaultAirframe(void);
+
+// Typical MEMS IMU, BMP388-class baro and single-band GPS; no bias
+VehiclePlant_Sensors_t VehiclePlant_DefaultSensors(void);
+
+// Allocate a batch of count vehicles around a launch point, each resting
+// level on the ground facing north with the default airframe and
+// sensors and still air. Vehicle i's generator is seeded from seed and i.
+bool VehiclePlant_Init(VehiclePlant_t *plant, uint32_t count, double latitude, double longitude,
+                       float altitude, uint64_t seed);
+
+void VehiclePlant_Free(VehiclePlant_t *plant);
+
+void VehiclePlant_SetAirframe(VehiclePlant_t *plant, uint32_t vehicle, const VehiclePlant_Airframe_t *airframe);
+void VehiclePlant_SetWind(VehiclePlant_t *plant, uint32_t vehicle, const VehiclePlant_Wind_t *wind);
+void VehiclePlant_SetSensors(VehiclePlant_t *plant, uint32_t vehicle, const VehiclePlant_Sensors_t *sensors);
+
+// Put a vehicle at rest at an NED position with the given yaw (degrees,
+// clockwise from north as the AHRS reports it). In the air the
+// motors start at hover thrust, on the ground stopped.
+void VehiclePlant_Place(VehiclePlant_t *plant, uint32_t vehicle, const float ned[3], float yaw);
+
+// A held vehicle keeps its state and reads gravity only, as if on a stand
+void VehiclePlant_Hold(VehiclePlant_t *plant, uint32_t vehicle, bool held);
+
+// Motor commands (0-1) for the next steps
+void VehiclePlant_SetMotors(VehiclePlant_t *plant, uint32_t vehicle, const Motor_Output_t *motors);
+
+// Advance every vehicle by dt seconds
+void VehiclePlant_Step(VehiclePlant_t *plant, float dt);
+
+// One IMU sample per vehicle, taken at the end of the last step
+void VehiclePlant_SampleImu(VehiclePlant_t *plant, uint64_t time_us, IMU_Sample_t *samples);
+
+// Barometer reading (hPa, Celsius) of one vehicle
+void VehiclePlant_SampleBaro(VehiclePlant_t *plant, uint32_t vehicle, float *pressure, float *temperature);
+
+// GPS fix of one vehicle at time_us (3D fix, drift advanced since the last one)
+void VehiclePlant_SampleGps(VehiclePlant_t *plant, uint32_t vehicle, uint64_t time_us, GPS_Data_t *fix);
+
+void VehiclePlant_GetState(const VehiclePlant_t *plant, uint32_t vehicle, VehiclePlant_State_t *state);
+
+#endif // VEHICLE_PLANT_H
@@ -0,0 +1,140 @@
+/*
+ * work_pool.cpp - Work-stealing thread pool for host batch runs
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ */
+
+#include "work_pool.h"
+#include <mutex>
+#include <string.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// Remaining indices [begin, end) of one worker, on its own cache line
+typedef struct alignas(64) {
+    std::mutex lock;
+    uint32_t begin;
+    uint32_t end;
+} WorkPool_Range_t;
+
+typedef struct {
+    WorkPool_Range_t *ranges;
+    uint32_t workers;
+    WorkPool_Task_t task;
+    void *context;
+    uint32_t executed[WORK_POOL_MAX_WORKERS];
+    uint32_t steals[WORK_POOL_MAX_WORKERS];
+    uint32_t stolen[WORK_POOL_MAX_WORKERS];
+} WorkPool_Batch_t;
+
+static void run_worker(WorkPool_Batch_t *batch, uint32_t worker);
+static bool take_own(WorkPool_Range_t *range, uint32_t *index);
+static bool steal(WorkPool_Batch_t *batch, uint32_t worker);
+static double monotonic_s(void);
+
+uint32_t WorkPool_DefaultWorkers(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) return 1;
+    if (cpus > WORK_POOL_MAX_WORKERS) return WORK_POOL_MAX_WORKERS;
+    return (uint32_t)cpus;
+}
+
+void WorkPool_Run(uint32_t workers, uint32_t count, WorkPool_Task_t task, void *context,
+                  WorkPool_Stats_t *stats) {
+    if (workers < 1) workers = 1;
+    if (workers > WORK_POOL_MAX_WORKERS) workers = WORK_POOL_MAX_WORKERS;
+    if (workers > count && count > 0) workers = count;
+
+    std::vector<WorkPool_Range_t> ranges(workers);
+    WorkPool_Batch_t batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.ranges = ranges.data();
+    batch.workers = workers;
+    batch.task = task;
+    batch.context = context;
+
+    for (uint32_t w = 0; w < workers; w++) {
+        ranges[w].begin = (uint32_t)((uint64_t)count * w / workers);
+        ranges[w].end = (uint32_t)((uint64_t)count * (w + 1) / workers);
+    }
+
+    double start = monotonic_s();
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (uint32_t w = 1; w < workers; w++) threads.emplace_back(run_worker, &batch, w);
+    run_worker(&batch, 0);
+    for (std::thread &thread : threads) thread.join();
+
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+        stats->workers = workers;
+        for (uint32_t w = 0; w < workers; w++) {
+            stats->executed[w] = batch.executed[w];
+            stats->steals += batch.steals[w];
+            stats->stolen += batch.stolen[w];
+        }
+        stats->wall_s = monotonic_s() - start;
+    }
+}
+
+/* --- Internals --- */
+
+// Each worker writes only its own counters, so they need no lock
+static void run_worker(WorkPool_Batch_t *batch, uint32_t worker) {
+    WorkPool_Range_t *own = &batch->ranges[worker];
+    for (;;) {
+        uint32_t index;
+        if (take_own(own, &index)) {
+            batch->task(index, worker, batch->context);
+            batch->executed[worker]++;
+            continue;
+        }
+        if (!steal(batch, worker)) return;
+    }
+}
+
+static bool take_own(WorkPool_Range_t *range, uint32_t *index) {
+    std::lock_guard<std::mutex> guard(range->lock);
+    if (range->begin >= range->end) return false;
+    *index = range->begin++;
+    return true;
+}
+
+// Move the back half of the first non-empty victim range into our own
+// (empty) range. Work a thief is carrying between the two locks is never
+// visible to others, but the thief runs it itself, so nothing is lost:
+// at worst another worker finishes a little early.
+static bool steal(WorkPool_Batch_t *batch, uint32_t worker) {
+    for (uint32_t step = 1; step < batch->workers; step++) {
+        WorkPool_Range_t *victim = &batch->ranges[(worker + step) % batch->workers];
+        uint32_t begin, end;
+        {
+            std::lock_guard<std::mutex> guard(victim->lock);
+            uint32_t left = victim->end - victim->begin;
+            if (left == 0) continue;
+            begin = victim->begin + left / 2;
+            end = victim->end;
+            victim->end = begin;
+        }
+
+        WorkPool_Range_t *own = &batch->ranges[worker];
+        {
+            std::lock_guard<std::mutex> guard(own->lock);
+            own->begin = begin;
+            own->end = end;
+        }
+        batch->steals[worker]++;
+        batch->stolen[worker] += end - begin;
+        return true;
+    }
+    return false;
+}
+
+static double monotonic_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
@@ -0,0 +1,48 @@
+/*
+ * work_pool.h - Work-stealing thread pool for host batch runs
+ * Platform: Linux host (software-in-the-loop build)
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Runs tasks 0 .. count-1 across a set of worker threads. Each worker
+ * starts with an even, contiguous share of the indices and takes them
+ * from the front. A worker that runs dry steals the back half of another
+ * worker's remaining range, picking victims round-robin from a per-worker
+ * starting point, so long tasks on one thread do not leave the others
+ * idle at the end of a batch.
+ *
+ * The tasks this serves are whole simulated flights (tens of
+ * milliseconds each), so each range sits behind its own short lock;
+ * the lock is held for a few instructions per task.
+ *
+ * Tasks receive the index of the worker running them, so callers can
+ * keep one scratch context per worker instead of one per task.
+ */
+
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <stdint.h>
+
+#define WORK_POOL_MAX_WORKERS 256
+
+typedef void (*WorkPool_Task_t)(uint32_t index, uint32_t worker, void *context);
+
+typedef struct {
+    uint32_t workers;
+    uint32_t executed[WORK_POOL_MAX_WORKERS];   // Tasks run by each worker
+    uint32_t steals;                            // Successful steals
+    uint32_t stolen;                            // Tasks moved by them
+    double wall_s;
+} WorkPool_Stats_t;
+
+// One worker per online CPU, at least one
+uint32_t WorkPool_DefaultWorkers(void);
+
+// Run task(index, worker, context) once for every index below count on
+// workers threads (the caller's thread is worker 0) and wait for all of
+// them. stats may be NULL.
+void WorkPool_Run(uint32_t workers, uint32_t count, WorkPool_Task_t task, void *context,
+                  WorkPool_Stats_t *stats);
+
+#endif // WORK_POOL_H
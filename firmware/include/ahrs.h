@@ -0,0 +1,68 @@
+/*
+ * ahrs.h - Quaternion attitude and heading reference for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Mahony complementary filter: integrates body rates into a unit
+ * quaternion and corrects tilt from the accelerometer and heading from
+ * the magnetometer through a PI feedback on the cross-product error.
+ * The per-sample update uses only multiplies, adds and one reciprocal
+ * square root per normalized vector (no trig), so it runs at several kHz
+ * on the M7 FPU. Euler angles are extracted only when asked for.
+ *
+ * Frames: body is right-handed with z up (x forward, y left), so a level
+ * vehicle at rest reads +1 g on accel z (the IMU driver convention). The
+ * quaternion rotates body vectors into a north-west-up earth frame.
+ * Yaw leaves through AHRS_GetEuler as a heading, clockwise from north
+ * like navigation's bearings, so nothing downstream sees the NWU sign.
+ */
+
+#ifndef AHRS_H
+#define AHRS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define AHRS_DEFAULT_KP  1.0f    // Proportional correction gain (rad/s per unit error)
+#define AHRS_DEFAULT_KI  0.02f   // Integral gain, estimates gyro bias
+
+typedef struct {
+    float w;
+    float x;
+    float y;
+    float z;
+} Quaternion_t;
+
+typedef struct {
+    Quaternion_t q;
+    float kp;
+    float ki;
+    float bias_x;     // Integral feedback (rad/s), acts as gyro bias estimate
+    float bias_y;
+    float bias_z;
+    float gravity_sq; // Squared accel magnitude taken as 1 g, in the caller's units
+    bool aligned;     // Set once the quaternion has been seeded from accel/mag
+} AHRS_State_t;
+
+// Reset the filter to identity with the given gains
+void AHRS_Init(AHRS_State_t *ahrs, float kp, float ki);
+
+// Seed the attitude from a single accel/mag reading (uses trig, call once).
+// The vehicle must be at rest: the accel magnitude is learned as 1 g.
+void AHRS_Align(AHRS_State_t *ahrs, float ax, float ay, float az,
+                float mx, float my, float mz);
+
+// Advance the filter by dt seconds.
+// Gyro in rad/s; accel and mag in any consistent units (only direction is used).
+// Accel correction is skipped when |a| is outside 0.5 .. 1.5 of the 1 g
+// learned at AHRS_Align (or from the first update if never aligned).
+// Pass a zero magnetometer vector to run tilt-only correction.
+void AHRS_Update(AHRS_State_t *ahrs, float gx, float gy, float gz,
+                 float ax, float ay, float az,
+                 float mx, float my, float mz, float dt);
+
+// Extract roll, pitch and yaw in degrees (yaw 0 .. 360 clockwise from north)
+void AHRS_GetEuler(const AHRS_State_t *ahrs, float *roll, float *pitch, float *yaw);
+
+#endif // AHRS_H
@@ -0,0 +1,53 @@
+/*
+ * biquad.h - Second-order IIR filter sections for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * RBJ cookbook low-pass and notch sections in transposed direct form II:
+ * five multiplies and two state words per sample, and well behaved in
+ * single precision at the sample rates used here. Cascades are plain
+ * arrays of sections applied in order.
+ *
+ * Coefficients can be retuned while running (Biquad_SetNotch keeps the
+ * state), which is how the dynamic notch follows a moving peak without
+ * restarting the filter.
+ */
+
+#ifndef BIQUAD_H
+#define BIQUAD_H
+
+#include <stdint.h>
+
+#define BIQUAD_Q_BUTTERWORTH 0.70710678f
+
+typedef struct {
+    float b0, b1, b2;   // Feed-forward, normalised by a0
+    float a1, a2;       // Feedback, normalised by a0
+    float z1, z2;       // State
+} Biquad_t;
+
+// Clear the filter state, keep the coefficients
+void Biquad_Reset(Biquad_t *filter);
+
+// Low-pass at cutoff_hz; q = BIQUAD_Q_BUTTERWORTH for a maximally flat response
+void Biquad_SetLowpass(Biquad_t *filter, float cutoff_hz, float sample_hz, float q);
+
+// Notch at center_hz with quality q (-3 dB width is center_hz / q)
+void Biquad_SetNotch(Biquad_t *filter, float center_hz, float sample_hz, float q);
+
+// Filter one sample
+static inline float Biquad_Apply(Biquad_t *filter, float x) {
+    float y = filter->b0 * x + filter->z1;
+    filter->z1 = filter->b1 * x - filter->a1 * y + filter->z2;
+    filter->z2 = filter->b2 * x - filter->a2 * y;
+    return y;
+}
+
+// Run x through `count` sections in order
+static inline float Biquad_ApplyCascade(Biquad_t *sections, int count, float x) {
+    for (int i = 0; i < count; i++) x = Biquad_Apply(&sections[i], x);
+    return x;
+}
+
+#endif // BIQUAD_H
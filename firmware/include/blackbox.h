@@ -0,0 +1,124 @@
+/*
+ * blackbox.h - Onboard flight data recorder for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Logs one frame per control cycle (IMU, attitude, command, PID terms,
+ * motor outputs) to the W25Q256JV SPI NOR flash.
+ *
+ * Encoding: fields are quantised to fixed-point integers. An intra ('I')
+ * frame stores them whole every BLACKBOX_INTRA_INTERVAL frames; the
+ * frames in between ('P') store the difference from the previous frame.
+ * Values are zigzag mapped and written as LEB128 varints, so most fields
+ * of a delta frame take one byte.
+ *
+ * Buffering: the control loop encodes straight into one half of a double
+ * buffer. When a half is full it is handed to Blackbox_Service, which
+ * programs it page by page with DMA from a background task while the
+ * other half fills, and erases sectors ahead of the write pointer while
+ * the flash is otherwise idle. Blackbox_Log never waits on the flash: if
+ * the other half is still being written the frame is dropped and
+ * counted, and the next frame is forced intra so the log stays decodable.
+ *
+ * Layout: logs fill the flash from address 0 up to FLASH_LOG_END. Each
+ * log starts on a sector boundary with a header ('H') frame and runs
+ * contiguously from there; erased flash (0xFF where a frame type is
+ * expected) ends it.
+ */
+
+#ifndef BLACKBOX_H
+#define BLACKBOX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BLACKBOX_FIELD_COUNT      26     // Logged fields besides the timestamp
+#define BLACKBOX_BUFFER_BYTES     2048   // Per buffer half
+#define BLACKBOX_INTRA_INTERVAL   32     // Frames between intra frames
+#define BLACKBOX_MAX_FRAME_BYTES  (1 + 10 + 5 * BLACKBOX_FIELD_COUNT)
+#define BLACKBOX_ERASE_AHEAD      2      // Erased sectors kept ahead of the write pointer
+
+#define BLACKBOX_FRAME_HEADER 'H'
+#define BLACKBOX_FRAME_INTRA  'I'
+#define BLACKBOX_FRAME_DELTA  'P'
+
+// One logged control cycle
+typedef struct {
+    uint64_t time_us;
+    float gyro[3];        // deg/s, filtered
+    float accel[3];       // m/s^2, filtered
+    float attitude[3];    // roll, pitch, yaw in degrees
+    float command[4];     // roll, pitch, yaw setpoints (deg), throttle (0-1)
+    float pid_p[3];       // Roll, pitch, yaw PID terms
+    float pid_i[3];
+    float pid_d[3];
+    float motors[4];      // 0.0 - 1.0
+} Blackbox_Frame_t;
+
+// Prediction state shared by the encoder and the decoder
+typedef struct {
+    int32_t previous[BLACKBOX_FIELD_COUNT];   // Last quantised fields
+    uint64_t previous_time_us;
+    uint32_t frames_since_intra;
+    bool have_intra;
+    uint32_t log_index;                       // Decoder: header frames seen
+} Blackbox_Codec_t;
+
+typedef struct {
+    uint32_t frames_logged;
+    uint32_t frames_dropped;    // Other buffer half still being written
+    uint32_t frames_rejected;   // Flash full or logger not started
+    uint32_t bytes_logged;
+    uint32_t pages_programmed;
+    uint32_t sectors_erased;
+    uint32_t log_start;         // Flash address of this log's header
+    uint32_t write_address;     // Next flash address to program
+    bool flash_full;
+} Blackbox_Stats_t;
+
+// Start a new log after any existing ones. Returns false if the flash
+// does not respond or is full; Blackbox_Log then rejects every frame.
+bool Blackbox_Init(void);
+
+// Encode one frame from the control loop. Never blocks; returns false if
+// the frame was dropped or rejected.
+bool Blackbox_Log(const Blackbox_Frame_t *frame);
+
+// Background work: finish the last flash operation and start the next
+// page program or erase. Call often from a low-priority task.
+void Blackbox_Service(void);
+
+// Hand the partially filled buffer half to the service (disarm, shutdown)
+void Blackbox_Flush(void);
+
+// True when every logged byte has been programmed and the flash is idle
+bool Blackbox_IsIdle(void);
+
+void Blackbox_GetStats(Blackbox_Stats_t *stats);
+
+/* --- Frame codec (also used by the host decoder) --- */
+
+void Blackbox_CodecInit(Blackbox_Codec_t *codec);
+
+// Encode a frame into out (BLACKBOX_MAX_FRAME_BYTES available), intra if
+// forced or due. Returns the encoded length.
+size_t Blackbox_EncodeFrame(Blackbox_Codec_t *codec, const Blackbox_Frame_t *frame,
+                            bool force_intra, uint8_t *out);
+
+// Encode a log header frame into out; resets the codec
+size_t Blackbox_EncodeHeader(Blackbox_Codec_t *codec, uint8_t *out);
+
+// Decode the frame at data[0]. Returns the bytes consumed, or 0 at the
+// end of a log or on a truncated or unknown frame. *type receives the
+// frame type; only 'I' and 'P' frames fill *frame, and a 'P' frame
+// before any 'I' frame in a log is consumed but not reconstructed
+// (*type is set to 0).
+size_t Blackbox_DecodeFrame(Blackbox_Codec_t *codec, const uint8_t *data, size_t length,
+                            char *type, Blackbox_Frame_t *frame);
+
+// CSV column name of field i (0 .. BLACKBOX_FIELD_COUNT - 1)
+const char *Blackbox_FieldName(int field);
+
+#endif // BLACKBOX_H
@@ -6,6 +6,27 @@
  *
  * Provides functions to initialize and control high-frequency plasma coils
  * used for propulsion and plasma shell generation in the TMF drone.
+ *
+ * Drive timing: the coil PWM timer runs with ARR and CCR preload enabled,
+ * so period and duty are written to shadow registers and take effect
+ * together at the next update event. The running cycle always completes
+ * and the counter is never reset. Frequency-to-period conversion is a
+ * lookup with linear interpolation in a table built once at
+ * CoilControl_Init from the real timer clock.
+ *
+ * Period dithering: at the top of the band one timer count is over 1% of
+ * the period, far coarser than a high-Q resonance. The period is therefore
+ * resolved to 1/16 count and played as a COIL_DITHER_CYCLES pattern of
+ * N and N+1 count cycles, which the timer's update DMA burst writes into
+ * ARR/CCR1-3 one cycle ahead. The tank sees the average frequency. Each
+ * cycle also carries the two ADC trigger points the resonance tracker
+ * samples coil current at (see resonance_tracker.h).
+ *
+ * Power envelope: amplitude changes are ramps. The CPU fills a waveform
+ * buffer once (linear or raised-cosine shape from the current output to
+ * the target), then DMA feeds it to the DAC on a timer trigger at up to
+ * COIL_RAMP_MAX_RATE_HZ with no further CPU involvement. A new ramp
+ * starts from wherever the previous one had reached, so there is no step.
  */
 
 #ifndef COIL_CONTROL_H
@@ -14,16 +35,58 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#define COIL_FREQ_MIN_HZ        10000
+#define COIL_FREQ_MAX_HZ        1200000
+#define COIL_DITHER_CYCLES      16        // Period resolution 1/16 count
+
+#define COIL_RAMP_SAMPLES       512       // Waveform buffer length
+#define COIL_RAMP_MAX_RATE_HZ   1000000   // DAC update ceiling (1 MSPS)
+#define COIL_DEFAULT_RAMP_US    200       // CoilControl_SetAmplitude ramp time
+#define COIL_DEFAULT_DUTY       0.5f
+
+typedef enum {
+    COIL_RAMP_LINEAR = 0,
+    COIL_RAMP_SCURVE          // Raised cosine: zero slope at both ends
+} CoilControl_RampShape_t;
+
+// One coil cycle as the update DMA burst writes it (ARR through CCR3)
+typedef struct {
+    uint32_t arr;             // Period - 1
+    uint32_t rcr;             // Unused on TIM2, inside the burst span
+    uint32_t ccr_drive;       // CCR1: output high while CNT < this
+    uint32_t ccr_in_phase;    // CCR2: current sample at the pulse centre
+    uint32_t ccr_quadrature;  // CCR3: current sample a quarter cycle earlier
+} CoilControl_Cycle_t;
+
 // Initialize plasma coil hardware (GPIO, timers, DACs, etc.)
 void CoilControl_Init(void);
 
-// Set coil drive frequency in Hz (typical range: 10kHz - 1MHz)
+// Set coil drive frequency in Hz (COIL_FREQ_MIN_HZ - COIL_FREQ_MAX_HZ),
+// dithered to 1/16 count. Small retunes rewrite the pattern in place and
+// take effect within one pattern; larger ones restart it at the next
+// cycle boundary. Duty fraction preserved.
 // Returns true if frequency successfully set, false otherwise
 bool CoilControl_SetFrequency(uint32_t frequency_hz);
 
-// Set coil drive amplitude (0.0 to 1.0 normalized power output)
+// Set the PWM duty as a fraction of the period (0.0 - 1.0), applied
+// together with the period at the next cycle boundary
+void CoilControl_SetDuty(float duty);
+
+// Set coil drive amplitude (0.0 to 1.0 normalized power output), reached
+// by an S-curve ramp over COIL_DEFAULT_RAMP_US. Does not block.
 void CoilControl_SetAmplitude(float amplitude);
 
+// Ramp the amplitude to target over duration_us. Returns false if the
+// duration is zero (use a short ramp rather than a step).
+bool CoilControl_RampAmplitude(float target, uint32_t duration_us, CoilControl_RampShape_t shape);
+
+// True while an amplitude ramp is still being played out
+bool CoilControl_IsRamping(void);
+
+// Timer auto-reload value for a frequency, from the period table (0 if
+// out of range). Exposed for the resonance tracker and benchmarks.
+uint32_t CoilControl_PeriodForFrequency(uint32_t frequency_hz);
+
 // Enable plasma coil drive signal output
 void CoilControl_Enable(void);
 
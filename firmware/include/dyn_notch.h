@@ -0,0 +1,78 @@
+/*
+ * dyn_notch.h - FFT-tracked dynamic notch filter for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Keeps the last DYN_NOTCH_FFT_SIZE raw gyro samples per axis, finds the
+ * dominant vibration peak in [min_hz, max_hz] with a windowed FFT, and
+ * steers one notch per axis onto it.
+ *
+ * The FFT is fixed-size, radix-2 and in place, and it is incremental:
+ * each DynNotch_Step call does one slice of the work (load + window +
+ * bit-reverse, one butterfly stage, or the peak search) for one axis, so
+ * the cost per control frame is bounded and small. Axes take turns; with
+ * N = 128 an axis is re-analysed every 3 * 9 = 27 steps.
+ *
+ * No peak standing clear of the band average leaves the notch where it
+ * was (or bypassed, before the first detection).
+ */
+
+#ifndef DYN_NOTCH_H
+#define DYN_NOTCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "biquad.h"
+
+#define DYN_NOTCH_AXES        3
+#define DYN_NOTCH_FFT_LOG2    7
+#define DYN_NOTCH_FFT_SIZE    (1 << DYN_NOTCH_FFT_LOG2)
+
+typedef struct {
+    float sample_hz;
+    float min_hz;
+    float max_hz;
+    float q;
+
+    // Raw input history, circular per axis
+    float history[DYN_NOTCH_AXES][DYN_NOTCH_FFT_SIZE];
+    uint32_t history_pos;
+
+    // FFT working set
+    float work_re[DYN_NOTCH_FFT_SIZE];
+    float work_im[DYN_NOTCH_FFT_SIZE];
+    float window[DYN_NOTCH_FFT_SIZE];              // Hann
+    float twiddle_re[DYN_NOTCH_FFT_SIZE / 2];
+    float twiddle_im[DYN_NOTCH_FFT_SIZE / 2];
+    uint8_t bit_reverse[DYN_NOTCH_FFT_SIZE];
+    uint8_t axis;                                   // Axis being analysed
+    uint8_t step;                                   // Next slice for that axis
+
+    // Tracked peaks and the notches that follow them
+    float center_hz[DYN_NOTCH_AXES];
+    bool locked[DYN_NOTCH_AXES];
+    Biquad_t notch[DYN_NOTCH_AXES];
+} DynNotch_t;
+
+// Precompute window, twiddles and bit-reversal; clears history and peaks
+void DynNotch_Init(DynNotch_t *dn, float sample_hz, float min_hz, float max_hz, float q);
+
+// Record one raw (pre-notch) sample per axis for analysis
+static inline void DynNotch_AddSample(DynNotch_t *dn, const float *sample) {
+    uint32_t pos = dn->history_pos;
+    for (int axis = 0; axis < DYN_NOTCH_AXES; axis++) dn->history[axis][pos] = sample[axis];
+    dn->history_pos = (pos + 1) & (DYN_NOTCH_FFT_SIZE - 1);
+}
+
+// Notch each axis in place (axes without a detected peak pass through)
+static inline void DynNotch_Apply(DynNotch_t *dn, float *sample) {
+    for (int axis = 0; axis < DYN_NOTCH_AXES; axis++) {
+        if (dn->locked[axis]) sample[axis] = Biquad_Apply(&dn->notch[axis], sample[axis]);
+    }
+}
+
+// Do one slice of the incremental analysis
+void DynNotch_Step(DynNotch_t *dn);
+
+#endif // DYN_NOTCH_H
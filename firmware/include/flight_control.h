@@ -6,6 +6,11 @@
  *
  * Defines data structures and APIs for flight stabilization,
  * motor output control, and command processing.
+ *
+ * Controller state lives in a FlightControl_t owned by the caller, and
+ * the gains come in at init, so several vehicles with different tuning
+ * can run in one process. The gains are runtime parameters (params.h)
+ * and can be swapped between updates with FlightControl_SetGains.
  */
 
 #ifndef FLIGHT_CONTROL_H
@@ -13,6 +18,13 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "params.h"
+#include "pid_bank.h"
+
+// Attitude controller variant: no derivative kick on stick steps, filtered
+// D-term, back-calculation anti-windup, yaw wrapped at +-180 degrees
+#define FLIGHT_CONTROL_PID_OPTIONS  (PID_OPT_D_ON_MEASUREMENT | PID_OPT_D_LOWPASS | PID_OPT_BACK_CALCULATION | \
+                                     PID_OPT_ANGLE_WRAP)
 
 // PID controller data structure
 typedef struct {
@@ -42,15 +54,61 @@ typedef struct {
     float motor4;
 } Motor_Output_t;
 
+// Roll/pitch/yaw PID contributions from the last update
+typedef struct {
+    float p[3];
+    float i[3];
+    float d[3];
+} PID_Terms_t;
+
+// Roll/pitch/yaw attitude gains
+typedef struct {
+    float kp[3];
+    float ki[3];
+    float kd[3];
+    float output_limit;         // Symmetric limit on each axis demand
+    float d_cutoff_hz;         // Derivative low-pass
+} FlightControl_Gains_t;
+
+typedef struct FlightControl {
+    PidBank<3, FLIGHT_CONTROL_PID_OPTIONS> attitude_pid;
+    float attitude_error[3];   // Last update, for the P term readout
+} FlightControl_t;
+
+// The gains held in a parameter bank
+FlightControl_Gains_t FlightControl_GainsFromParams(const Params_Bank_t *bank);
+
+// The tuned gains for this airframe (the parameter defaults)
+FlightControl_Gains_t FlightControl_DefaultGains(void);
+
 // Initialize flight control subsystem
-bool FlightControl_Init(void);
+bool FlightControl_Init(FlightControl_t *control, const FlightControl_Gains_t *gains);
 
-// Compute motor outputs based on desired commands and current attitude
-void FlightControl_Update(const Flight_Command_t *cmd, 
+// Retune between updates; integrators and filters carry over
+void FlightControl_SetGains(FlightControl_t *control, const FlightControl_Gains_t *gains);
+
+// Compute motor outputs based on desired commands and current attitude.
+// dt is the measured time since the previous update in seconds.
+void FlightControl_Update(FlightControl_t *control, const Flight_Command_t *cmd,
                           float current_roll, float current_pitch, float current_yaw,
-                          Motor_Output_t *motors);
+                          float dt, Motor_Output_t *motors);
+
+// Copy the attitude PID terms of the last FlightControl_Update (logging)
+void FlightControl_GetTerms(const FlightControl_t *control, PID_Terms_t *terms);
 
 // Reset all PID controllers
-void FlightControl_Reset(void);
+void FlightControl_Reset(FlightControl_t *control);
+
+// Quad-X mixer: combine throttle and PID outputs into motor outputs, trading
+// throttle for attitude authority when a motor would saturate (see mixer.h)
+void FlightControl_MixQuadX(float throttle, float roll_output, float pitch_output, float yaw_output,
+                            Motor_Output_t *motors);
+
+// Initialize a single PID controller with gains and output limits
+void PID_Init(PID_Controller_t *pid, float kp, float ki, float kd, float out_min, float out_max);
+
+// Advance a PID controller by dt seconds, returns the clamped output.
+// A non-positive dt holds the integral and skips the derivative term.
+float PID_Update(PID_Controller_t *pid, float setpoint, float measured, float dt);
 
 #endif // FLIGHT_CONTROL_H
@@ -0,0 +1,129 @@
+/*
+ * geofence.h - Spatially indexed geofence for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Keep-in and keep-out volumes: polygons or cylinders in plan, each with
+ * an altitude band. The flyable space is the union of the keep-in
+ * volumes (everywhere, if there are none) minus the keep-out volumes.
+ *
+ * Fences are compiled once, when they are loaded, into a uniform grid in
+ * a local tangent frame. Each cell stores:
+ *   - which fences contain its centre (one bit per fence), and
+ *   - the boundary pieces (polygon edges, cylinder walls) that come
+ *     within GEOFENCE_NEAR_DISTANCE of any point in the cell.
+ * A query walks only its cell's list: crossings of the segment from the
+ * cell centre to the point flip the containment bits, and the nearest
+ * listed piece gives the distance to each boundary. The cost depends on
+ * how much boundary is near the vehicle, not on the total vertex count.
+ * Distances beyond GEOFENCE_NEAR_DISTANCE read as that distance.
+ *
+ * Breach prediction walks the line along a velocity, stepping by the
+ * clearance at each point (never less than GEOFENCE_PREDICT_MIN_STEP).
+ * The clearance is a lower bound on the distance to any breach, so no
+ * breach is stepped over except one thinner than the minimum step.
+ *
+ * Like the leg frames, the fence frame is a flat projection. Its error
+ * is about 0.1 m at 1 km from the origin and 10 m at 10 km, so the
+ * origin should be near the operating area.
+ *
+ * Everything lives in Geofence_t; there is no heap and no global state.
+ */
+
+#ifndef GEOFENCE_H
+#define GEOFENCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "local_frame.h"
+#include "nav_types.h"
+
+#define GEOFENCE_MAX_FENCES        32       // One containment bit each
+#define GEOFENCE_MAX_VERTICES      1024     // Polygon vertices over all fences
+#define GEOFENCE_GRID_CELLS        2048
+#define GEOFENCE_MAX_ENTRIES       8192     // Boundary pieces listed over all cells
+#define GEOFENCE_NEAR_DISTANCE     25.0f    // Clearance is exact up to this distance (m)
+#define GEOFENCE_MIN_CELL_SIZE     10.0f    // m
+#define GEOFENCE_PREDICT_MIN_STEP  2.0f     // m
+
+typedef enum {
+    GEOFENCE_KEEP_IN = 0,
+    GEOFENCE_KEEP_OUT
+} Geofence_Kind_t;
+
+typedef struct {
+    double latitude;    // Degrees, WGS84
+    double longitude;   // Degrees, WGS84
+} Geofence_Vertex_t;
+
+typedef struct {
+    Geofence_Kind_t kind;
+    bool cylinder;
+    uint16_t first_vertex;      // Polygon: vertices [first_vertex, first_vertex + vertex_count)
+    uint16_t vertex_count;
+    float center[2];            // Cylinder: NE centre (m) and radius (m)
+    float radius;
+    float floor_alt;            // Altitude band, meters above sea level
+    float ceiling_alt;
+} Geofence_Fence_t;
+
+typedef struct Geofence_Status {
+    float clearance;        // Distance to the nearest breach (m), negative inside one;
+                            // saturates at +-GEOFENCE_NEAR_DISTANCE
+    float breach_in_s;      // Predicted time to a breach along the velocity (0 when
+                            // breached, negative when none within the horizon)
+    int16_t fence;          // Fence setting the clearance, -1 if none is near
+    bool breached;
+} Geofence_Status_t;
+
+typedef struct Geofence {
+    LocalFrame_t frame;
+
+    Geofence_Fence_t fences[GEOFENCE_MAX_FENCES];
+    uint32_t fence_count;
+    bool has_keep_in;
+
+    float vertices[GEOFENCE_MAX_VERTICES][2];   // NE (m)
+    uint8_t vertex_fence[GEOFENCE_MAX_VERTICES];
+    uint32_t vertex_count;
+
+    // Grid: cell (col, row) covers origin + cell_size * [col, col + 1) x [row, row + 1)
+    float grid_origin[2];
+    float cell_size;
+    float inv_cell_size;
+    uint32_t cols;
+    uint32_t rows;
+    uint32_t cell_inside[GEOFENCE_GRID_CELLS];        // Fences containing the cell centre
+    uint16_t cell_start[GEOFENCE_GRID_CELLS + 1];     // Entries of cell i: [start[i], start[i + 1])
+    uint16_t entries[GEOFENCE_MAX_ENTRIES];           // Edge start vertex, or
+                                                      // GEOFENCE_MAX_VERTICES + cylinder fence
+    uint32_t entry_count;
+    bool built;
+} Geofence_t;
+
+// Start an empty fence set; vertices and cylinders are projected into a
+// frame anchored at the given origin
+void Geofence_Init(Geofence_t *geofence, double origin_latitude, double origin_longitude);
+
+// Add a polygon (at least 3 vertices, either winding, not self-intersecting)
+// or a cylinder. Returns false when the fence or vertex table is full.
+bool Geofence_AddPolygon(Geofence_t *geofence, Geofence_Kind_t kind, const Geofence_Vertex_t *vertices,
+                         uint32_t count, float floor_alt, float ceiling_alt);
+bool Geofence_AddCylinder(Geofence_t *geofence, Geofence_Kind_t kind, const Geofence_Vertex_t *center,
+                          float radius, float floor_alt, float ceiling_alt);
+
+// Compile the grid index. Cells grow until the boundary lists fit; false
+// if they never do. A few milliseconds for hundreds of vertices on the
+// bench host, so it runs when fences are loaded, never in the loop.
+bool Geofence_Build(Geofence_t *geofence);
+
+// Containment and clearance at a position (breach_in_s is 0 or -1)
+void Geofence_Check(const Geofence_t *geofence, const Position_t *position, Geofence_Status_t *status);
+
+// As Geofence_Check, plus the time until a vehicle moving at velocity
+// (NED, m/s) from position breaches a fence, looking horizon_s ahead
+void Geofence_Predict(const Geofence_t *geofence, const Position_t *position, const Velocity_t *velocity,
+                      float horizon_s, Geofence_Status_t *status);
+
+#endif // GEOFENCE_H
@@ -0,0 +1,91 @@
+/*
+ * gps_parser.h - Streaming NMEA / UBX GPS parser for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Consumes the GPS UART stream one byte at a time, straight out of the
+ * circular DMA receive buffer: no line buffer, no payload copy, no strtod.
+ * NMEA numeric fields are accumulated digit by digit and UBX NAV-PVT
+ * fields are assembled little-endian at their payload offsets, with the
+ * NMEA XOR and UBX Fletcher checksums running alongside.
+ *
+ * Supported: NMEA GGA, RMC, VTG (any talker, e.g. GP/GN) and UBX NAV-PVT.
+ * Fields go into a staging fix and are committed only when the checksum
+ * matches, so a corrupted message never leaks a partial update.
+ *
+ * Each published fix carries the arrival time of its first byte,
+ * reconstructed from the last byte's arrival time and the UART byte time.
+ */
+
+#ifndef GPS_PARSER_H
+#define GPS_PARSER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sensor_types.h"
+
+#define GPS_NMEA_MAX_LENGTH  96    // Longer sentences are discarded (spec max is 82)
+
+// Numeric field being accumulated
+typedef struct {
+    int64_t mantissa;
+    uint8_t decimals;
+    bool fraction;
+    bool negative;
+    bool present;
+    char letter;               // First non-numeric character (N/S/E/W/A/V/M...)
+} GpsParser_Field_t;
+
+typedef struct {
+    // Latest committed fix and the message being assembled
+    GPS_Data_t fix;
+    GPS_Data_t staged;
+    uint32_t staged_fields;    // Which parts of staged the message set
+
+    // Framing
+    uint8_t state;
+    uint8_t sentence;          // NMEA sentence type once identified
+    uint8_t field_index;
+    uint8_t length;
+    uint8_t checksum;
+    uint8_t received_checksum;
+    char type[5];
+    GpsParser_Field_t field;
+
+    // UBX
+    uint8_t ubx_class;
+    uint8_t ubx_id;
+    uint16_t ubx_length;
+    uint16_t ubx_offset;
+    uint8_t ubx_ck_a;
+    uint8_t ubx_ck_b;
+    uint32_t ubx_word;
+
+    uint64_t message_start_us;
+
+    // Statistics
+    uint32_t messages;         // Valid messages committed
+    uint32_t checksum_errors;
+    uint32_t framing_errors;   // Overlong sentences, bad hex digits
+} GpsParser_t;
+
+// Reset parser state and statistics
+void GpsParser_Init(GpsParser_t *parser);
+
+// Feed one byte. byte_us is its arrival time and is only read when the
+// byte starts a message. Returns true when it completed a valid position
+// message (GGA, RMC or NAV-PVT) and parser->fix changed.
+bool GpsParser_Feed(GpsParser_t *parser, uint8_t byte, uint64_t byte_us);
+
+// Parse every byte between *read_index and write_index in a circular
+// buffer of `size` bytes, advancing *read_index. last_byte_us is the
+// arrival time of the byte before write_index and byte_ns the UART byte
+// time; together they timestamp each message. Returns the number of
+// position fixes published.
+uint32_t GpsParser_Consume(GpsParser_t *parser, const uint8_t *ring, size_t size,
+                           size_t *read_index, size_t write_index,
+                           uint64_t last_byte_us, uint32_t byte_ns);
+
+#endif // GPS_PARSER_H
@@ -0,0 +1,124 @@
+/*
+ * hardware_drivers.h - Low-level bus driver interface for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Abstracts SPI/I2C/UART access to the sensor chips and the logging flash
+ * so the layers above do not depend on a particular bus wiring. The board
+ * port provides the implementation; firmware/host provides stand-ins for
+ * SIL builds.
+ */
+
+#ifndef HARDWARE_DRIVERS_H
+#define HARDWARE_DRIVERS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bring up the IMU (BMI270) over SPI, returns true if the chip responds
+bool IMU_Init(void);
+
+// Start streaming IMU samples into imu_stream at odr_hz. The FIFO
+// watermark interrupt fires every `watermark` frames; each frame is
+// timestamped and published with ImuStream_Publish from the DMA callback.
+bool IMU_StartStream(uint32_t odr_hz, uint32_t watermark);
+
+// Stop the IMU stream (interrupt masked, DMA aborted)
+void IMU_StopStream(void);
+
+// GPS UART: received by circular DMA, parsed in place (see gps_parser.h).
+// The buffer must hold everything that arrives between two GPS task runs.
+#define GPS_UART_BAUD        115200
+#define GPS_BYTE_TIME_NS     ((uint32_t)(10000000000ULL / GPS_UART_BAUD))   // 8N1
+#define GPS_RX_BUFFER_SIZE   1024
+
+// Bring up the GPS receiver UART and start circular DMA reception
+bool GPS_Init(void);
+
+// Base of the circular receive buffer (GPS_RX_BUFFER_SIZE bytes)
+const uint8_t *GPS_RxBuffer(void);
+
+// Current DMA write position in the receive buffer (size minus NDTR).
+// last_byte_us receives the arrival time of the byte just before it,
+// latched by the UART idle-line interrupt at the end of each burst.
+size_t GPS_RxWriteIndex(uint64_t *last_byte_us);
+
+// Bring up the barometer (BMP388) over I2C, returns true if the chip responds
+bool Baro_Init(void);
+
+// Read one compensated pressure (hPa) and temperature (Celsius) sample
+bool Baro_ReadPressureTemp(float *pressure, float *temperature);
+
+// Telemetry radio UART, transmit by DMA, receive into a circular buffer
+// (see telemetry.h)
+#define TELEMETRY_UART_BAUD  57600
+
+// Bring up the radio UART
+bool TelemetryLink_Init(void);
+
+// True while a transmit DMA is running
+bool TelemetryLink_TxBusy(void);
+
+// Start transmitting length bytes; data must stay untouched until
+// TelemetryLink_TxBusy is false
+bool TelemetryLink_StartTx(const uint8_t *data, size_t length);
+
+// Copy out up to capacity bytes received from the ground since the last
+// call; returns the count and never waits
+size_t TelemetryLink_Receive(uint8_t *data, size_t capacity);
+
+// Power sensing (see power_monitor.h). ADC3 scans POWER_CHANNEL_COUNT
+// channels on every TIM8 trigger into a circular DMA buffer of two blocks;
+// each half/complete callback passes the finished block to
+// PowerMonitor_OnAdcBlock. The MAX31855 thermocouple converters share
+// SPI4 and are read back to back by DMA every POWER_THERMO_PERIOD_MS,
+// their frames passed to PowerMonitor_OnThermocouples.
+#define POWER_ADC_SCAN_HZ       10000
+#define POWER_ADC_BLOCK_SCANS   100       // 10 ms per callback
+#define POWER_THERMO_PERIOD_MS  100       // MAX31855 conversion time
+
+// Start the ADC scan and the thermocouple reads
+bool PowerSense_Init(void);
+
+// Switch a non-critical load (Power_Load_t) on or off
+void PowerSense_SetLoad(uint32_t load, bool on);
+
+// Logging flash (W25Q256JV) on QUADSPI, 4-byte addressing. Erase and
+// program are started by DMA and complete in the background; poll
+// Flash_IsBusy (status register WIP bit) before starting the next one.
+#define FLASH_PAGE_SIZE      256
+#define FLASH_SECTOR_SIZE    4096
+#define FLASH_CAPACITY       (32UL * 1024UL * 1024UL)
+
+// Partitions: flight logs fill upwards from address 0 up to FLASH_LOG_END;
+// above them sit the parameter images (see params.h), the terrain tiles
+// (see terrain.h) and, at the top of the array, the stored mission (see
+// mission.h)
+#define FLASH_MISSION_SIZE   (1UL * 1024UL * 1024UL)
+#define FLASH_MISSION_BASE   (FLASH_CAPACITY - FLASH_MISSION_SIZE)
+#define FLASH_TERRAIN_SIZE   (8UL * 1024UL * 1024UL)
+#define FLASH_TERRAIN_BASE   (FLASH_MISSION_BASE - FLASH_TERRAIN_SIZE)
+#define FLASH_PARAMS_SIZE    (64UL * 1024UL)
+#define FLASH_PARAMS_BASE    (FLASH_TERRAIN_BASE - FLASH_PARAMS_SIZE)
+#define FLASH_LOG_END        FLASH_PARAMS_BASE
+
+// Bring up the flash and verify its JEDEC ID
+bool Flash_Init(void);
+
+// True while an erase or program is in progress
+bool Flash_IsBusy(void);
+
+// Start erasing the sector containing address
+bool Flash_StartSectorErase(uint32_t address);
+
+// Start programming length bytes at address; the range must not cross a
+// page boundary and data must stay untouched until Flash_IsBusy is false
+bool Flash_StartProgram(uint32_t address, const uint8_t *data, size_t length);
+
+// Blocking read (start-up scans, log download, and short mission and
+// terrain tile reads between programs; see mission.h and terrain.h)
+bool Flash_Read(uint32_t address, uint8_t *data, size_t length);
+
+#endif // HARDWARE_DRIVERS_H
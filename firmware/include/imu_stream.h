@@ -0,0 +1,52 @@
+/*
+ * imu_stream.h - Interrupt-fed IMU sample queue for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * The IMU driver runs off the BMI270 FIFO watermark interrupt: the EXTI
+ * handler latches a timestamp and starts an SPI DMA read of the FIFO, and
+ * the DMA-complete callback converts each frame and publishes it here.
+ * The control loop drains whatever has accumulated, so it never waits on
+ * the bus and sees every sample at the full output data rate.
+ *
+ * Exactly one producer (the DMA callback, or the host IMU thread) and one
+ * consumer (Sensors_UpdateIMU on the context Sensors_Init set up) are
+ * allowed.
+ */
+
+#ifndef IMU_STREAM_H
+#define IMU_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define IMU_STREAM_CAPACITY 64   // 32 ms at 2 kHz; must be a power of two
+
+typedef struct {
+    uint64_t timestamp_us;   // Sample instant on the SystemClock time base
+    float accel[3];          // m/s^2
+    float gyro[3];           // deg/s
+    float mag[3];            // uT
+} IMU_Sample_t;
+
+typedef struct {
+    uint32_t published;      // Samples accepted into the ring
+    uint32_t dropped;        // Samples lost because the ring was full
+    uint32_t max_depth;      // Deepest backlog seen by the consumer
+} IMU_StreamStats_t;
+
+// Empty the ring and clear statistics (call before the producer starts)
+void ImuStream_Reset(void);
+
+// Producer: queue one sample. Wait-free; returns false if it was dropped.
+bool ImuStream_Publish(const IMU_Sample_t *sample);
+
+// Consumer: move up to max queued samples into out, oldest first
+size_t ImuStream_Drain(IMU_Sample_t *out, size_t max);
+
+// Counters for health reporting
+void ImuStream_GetStats(IMU_StreamStats_t *stats);
+
+#endif // IMU_STREAM_H
@@ -0,0 +1,51 @@
+/*
+ * local_frame.h - Local tangent-plane projection for TMF navigation
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Linearizes WGS84 around a reference point: metres per degree of
+ * latitude and longitude are computed once (with the trig) when the frame
+ * is set up, after which converting a geodetic position costs two double
+ * subtractions and multiplies. Latitude and longitude stay in double
+ * until after the subtraction, so no precision is lost to float casts;
+ * only the small local offsets are single precision.
+ *
+ * Error grows with the square of the distance from the reference (about
+ * 0.1 m at 1 km and 10 m at 10 km at mid latitudes), so frames should be
+ * anchored near where they are used.
+ */
+
+#ifndef LOCAL_FRAME_H
+#define LOCAL_FRAME_H
+
+#include <stdint.h>
+
+typedef struct {
+    double ref_lat;           // Degrees
+    double ref_lon;           // Degrees
+    float ref_alt;            // Meters
+    double meters_per_deg_n;  // Meridional scale at ref_lat
+    double meters_per_deg_e;  // Parallel scale at ref_lat
+} LocalFrame_t;
+
+// Anchor a frame at the given geodetic reference
+void LocalFrame_Init(LocalFrame_t *frame, double latitude, double longitude, float altitude);
+
+// NED offset (m) of a geodetic position from the frame reference
+static inline void LocalFrame_ToNED(const LocalFrame_t *frame, double latitude, double longitude,
+                                    float altitude, float ned[3]) {
+    ned[0] = (float)((latitude - frame->ref_lat) * frame->meters_per_deg_n);
+    ned[1] = (float)((longitude - frame->ref_lon) * frame->meters_per_deg_e);
+    ned[2] = frame->ref_alt - altitude;
+}
+
+// Geodetic position of an NED offset (m) from the frame reference
+static inline void LocalFrame_FromNED(const LocalFrame_t *frame, const float ned[3],
+                                      double *latitude, double *longitude, float *altitude) {
+    *latitude = frame->ref_lat + (double)ned[0] / frame->meters_per_deg_n;
+    *longitude = frame->ref_lon + (double)ned[1] / frame->meters_per_deg_e;
+    *altitude = frame->ref_alt - ned[2];
+}
+
+#endif // LOCAL_FRAME_H
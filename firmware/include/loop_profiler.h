@@ -0,0 +1,76 @@
+/*
+ * loop_profiler.h - Control loop timing instrumentation for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Records per-stage execution time and loop period into fixed-size
+ * log-linear histograms (12.5% bucket resolution). Stage times come from
+ * the DWT cycle counter on target and CLOCK_MONOTONIC on host; the loop
+ * period comes from system_clock so it follows the virtual clock in SIL.
+ *
+ * The control loop is the only writer. Each channel is guarded by a
+ * sequence counter, so recording never blocks and Profiler_Snapshot can
+ * run from any other context (telemetry task, debugger, host thread).
+ */
+
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Instrumented channels
+typedef enum {
+    PROFILE_SENSORS = 0,      // Sensors_UpdateIMU
+    PROFILE_FLIGHT_CONTROL,   // FlightControl_Update
+    PROFILE_PROPULSION,       // PropulsionDriver_SetOutputs
+    PROFILE_BLACKBOX,         // Blackbox_Log (frame encode)
+    PROFILE_POWER,            // PowerMonitor_CheckHealth
+    PROFILE_NAVIGATION,       // Navigation_Update (EKF)
+    PROFILE_LOOP_PERIOD,      // Frame start to frame start
+    PROFILE_LOOP_JITTER,      // |period - nominal period|
+    PROFILE_CHANNEL_COUNT
+} Profile_Channel_t;
+
+// 16 linear buckets, then 8 sub-buckets per power of two up to 2^32
+#define PROFILE_BUCKET_COUNT 240
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_ticks;
+    uint32_t max_ticks;
+    uint64_t sum_ticks;
+    uint32_t buckets[PROFILE_BUCKET_COUNT];
+} Profile_Histogram_t;
+
+typedef struct {
+    uint32_t ticks_per_us;    // Tick rate of every histogram in the snapshot
+    Profile_Histogram_t channels[PROFILE_CHANNEL_COUNT];
+} Profile_Snapshot_t;
+
+// Clear all histograms and set the nominal loop period used for jitter.
+// Not safe to call while the control loop is recording.
+void Profiler_Init(uint32_t nominal_period_us);
+
+// Free-running tick counter for stage timing (wraps at 32 bits)
+uint32_t Profiler_Now(void);
+
+// Record one sample for a channel, in ticks
+void Profiler_Record(Profile_Channel_t channel, uint32_t ticks);
+
+// Call once at the top of every frame to record period and jitter
+void Profiler_MarkFrameStart(void);
+
+// Copy a consistent view of all channels. Returns false if the writer kept
+// a channel busy through every retry (the copy is then best effort).
+bool Profiler_Snapshot(Profile_Snapshot_t *snapshot);
+
+// Upper bound of the bucket holding the given percentile (0.0 - 100.0)
+uint32_t Profiler_Percentile(const Profile_Histogram_t *hist, float percentile);
+
+// Render a snapshot as CSV text; returns characters written (excluding NUL)
+size_t Profiler_Dump(const Profile_Snapshot_t *snapshot, char *buffer, size_t length);
+
+#endif // LOOP_PROFILER_H
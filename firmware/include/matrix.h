@@ -0,0 +1,151 @@
+/*
+ * matrix.h - Fixed-size matrix templates for TMF estimators
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Dimensions are template parameters, storage is inline and nothing
+ * allocates. Loops have constant trip counts so the compiler unrolls the
+ * small (3x3) cases used by the estimators. SymMatrix keeps only the upper
+ * triangle of a symmetric matrix, which halves covariance storage and
+ * makes symmetry structural rather than something to re-enforce.
+ */
+
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <stdint.h>
+
+template <int R, int C>
+struct Matrix {
+    float m[R][C];
+
+    float &operator()(int r, int c) { return m[r][c]; }
+    float operator()(int r, int c) const { return m[r][c]; }
+
+    static Matrix Zeros() {
+        Matrix out;
+        for (int r = 0; r < R; r++)
+            for (int c = 0; c < C; c++) out.m[r][c] = 0.0f;
+        return out;
+    }
+
+    static Matrix Identity() {
+        Matrix out = Zeros();
+        for (int i = 0; i < R && i < C; i++) out.m[i][i] = 1.0f;
+        return out;
+    }
+
+    Matrix<C, R> Transposed() const {
+        Matrix<C, R> out;
+        for (int r = 0; r < R; r++)
+            for (int c = 0; c < C; c++) out.m[c][r] = m[r][c];
+        return out;
+    }
+};
+
+template <int R, int C>
+static inline Matrix<R, C> operator+(const Matrix<R, C> &a, const Matrix<R, C> &b) {
+    Matrix<R, C> out;
+    for (int r = 0; r < R; r++)
+        for (int c = 0; c < C; c++) out.m[r][c] = a.m[r][c] + b.m[r][c];
+    return out;
+}
+
+template <int R, int C>
+static inline Matrix<R, C> operator-(const Matrix<R, C> &a, const Matrix<R, C> &b) {
+    Matrix<R, C> out;
+    for (int r = 0; r < R; r++)
+        for (int c = 0; c < C; c++) out.m[r][c] = a.m[r][c] - b.m[r][c];
+    return out;
+}
+
+template <int R, int C>
+static inline Matrix<R, C> operator*(const Matrix<R, C> &a, float s) {
+    Matrix<R, C> out;
+    for (int r = 0; r < R; r++)
+        for (int c = 0; c < C; c++) out.m[r][c] = a.m[r][c] * s;
+    return out;
+}
+
+template <int R, int K, int C>
+static inline Matrix<R, C> operator*(const Matrix<R, K> &a, const Matrix<K, C> &b) {
+    Matrix<R, C> out;
+    for (int r = 0; r < R; r++) {
+        for (int c = 0; c < C; c++) {
+            float sum = 0.0f;
+            for (int k = 0; k < K; k++) sum += a.m[r][k] * b.m[k][c];
+            out.m[r][c] = sum;
+        }
+    }
+    return out;
+}
+
+// a * b^T without forming the transpose
+template <int R, int K, int C>
+static inline Matrix<R, C> MultiplyTransposed(const Matrix<R, K> &a, const Matrix<C, K> &b) {
+    Matrix<R, C> out;
+    for (int r = 0; r < R; r++) {
+        for (int c = 0; c < C; c++) {
+            float sum = 0.0f;
+            for (int k = 0; k < K; k++) sum += a.m[r][k] * b.m[c][k];
+            out.m[r][c] = sum;
+        }
+    }
+    return out;
+}
+
+// Cross-product matrix: Skew(v) * x == v x x
+static inline Matrix<3, 3> Skew(float x, float y, float z) {
+    Matrix<3, 3> out;
+    out.m[0][0] = 0.0f; out.m[0][1] = -z;   out.m[0][2] = y;
+    out.m[1][0] = z;    out.m[1][1] = 0.0f; out.m[1][2] = -x;
+    out.m[2][0] = -y;   out.m[2][1] = x;    out.m[2][2] = 0.0f;
+    return out;
+}
+
+// Symmetric N x N matrix, packed upper triangle (row-major)
+template <int N>
+struct SymMatrix {
+    static constexpr int kSize = N * (N + 1) / 2;
+    float d[kSize];
+
+    static constexpr int Index(int i, int j) {
+        return (i <= j) ? i * N - (i * (i - 1)) / 2 + (j - i)
+                        : j * N - (j * (j - 1)) / 2 + (i - j);
+    }
+
+    float &operator()(int i, int j) { return d[Index(i, j)]; }
+    float operator()(int i, int j) const { return d[Index(i, j)]; }
+
+    void SetZero() {
+        for (int i = 0; i < kSize; i++) d[i] = 0.0f;
+    }
+
+    // Copy out a B x B block starting at (r0, c0)
+    template <int B>
+    Matrix<B, B> Block(int r0, int c0) const {
+        Matrix<B, B> out;
+        for (int r = 0; r < B; r++)
+            for (int c = 0; c < B; c++) out.m[r][c] = (*this)(r0 + r, c0 + c);
+        return out;
+    }
+
+    // Store an off-diagonal block (r0 < c0); the mirror is implied
+    template <int B>
+    void SetBlock(int r0, int c0, const Matrix<B, B> &block) {
+        for (int r = 0; r < B; r++)
+            for (int c = 0; c < B; c++) (*this)(r0 + r, c0 + c) = block.m[r][c];
+    }
+
+    // Store a diagonal block, averaging the two triangles of a nearly
+    // symmetric input so rounding does not bias one side
+    template <int B>
+    void SetDiagonalBlock(int r0, const Matrix<B, B> &block) {
+        for (int r = 0; r < B; r++)
+            for (int c = r; c < B; c++)
+                (*this)(r0 + r, r0 + c) = 0.5f * (block.m[r][c] + block.m[c][r]);
+    }
+};
+
+#endif // MATRIX_H
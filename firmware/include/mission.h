@@ -0,0 +1,68 @@
+/*
+ * mission.h - Streamed mission storage for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * A mission is read through a Mission_Source_t a few waypoints at a time,
+ * so its length is bounded by the backing store, not by RAM. Sources:
+ *   array   waypoints already in memory (uploads, tests)
+ *   flash   the mission partition of the logging flash (FLASH_MISSION_BASE);
+ *           on the host the flash can be a file (TMF_FLASH_FILE)
+ *
+ * Flash layout, little-endian:
+ *   header  'T' 'M' 'F' 'M', version u16, record size u16, count u32,
+ *           flags u16 (MISSION_FLAG_*), CRC-16 u16 over the preceding
+ *           14 bytes
+ *   record  latitude i32 (1e-7 deg), longitude i32 (1e-7 deg),
+ *           altitude i32 (mm), hold time u16 (0.1 s), CRC-16 u16 over
+ *           the preceding 14 bytes
+ * Records follow the header back to back. Opening a flash mission reads
+ * only the header; each record is checked as it is streamed in.
+ */
+
+#ifndef MISSION_H
+#define MISSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "nav_types.h"
+
+#define MISSION_VERSION        2
+#define MISSION_HEADER_BYTES   16
+#define MISSION_RECORD_BYTES   16
+#define MISSION_MAX_HOLD_S     6553.5f
+
+#define MISSION_FLAG_TERRAIN   0x0001   // Altitudes are heights above the terrain (terrain.h)
+
+typedef struct Mission_Source {
+    // Copy up to count waypoints starting at first into out. Returns the
+    // number copied, which may be fewer (0 while the store is busy: try
+    // again later). A corrupt record ends the copy and sets failed.
+    uint32_t (*read)(struct Mission_Source *source, uint32_t first, Waypoint_t *out, uint32_t count);
+    const void *context;  // Array sources: the waypoints
+    uint32_t address;     // Flash sources: the first record
+    uint32_t count;       // Waypoints in the mission
+    uint16_t flags;       // MISSION_FLAG_*
+    bool failed;          // Set by the source on a corrupt record
+} Mission_Source_t;
+
+// Source over a caller-owned array, which must outlive the mission.
+// Altitudes are above sea level unless flags is set afterwards.
+void Mission_ArraySource(Mission_Source_t *source, const Waypoint_t *waypoints, uint32_t count);
+
+// Source over a mission stored at address in the logging flash. Reads
+// wait for the flash to be idle rather than blocking on a program or
+// erase. Returns false if no valid mission header is there.
+bool Mission_FlashSource(Mission_Source_t *source, uint32_t address);
+
+// Encode the header and one record of the flash layout
+void Mission_EncodeHeader(uint32_t count, uint16_t flags, uint8_t header[MISSION_HEADER_BYTES]);
+void Mission_EncodeRecord(const Waypoint_t *waypoint, uint8_t record[MISSION_RECORD_BYTES]);
+
+// Decode a header (returns the count and flags) or a record; false if malformed
+bool Mission_DecodeHeader(const uint8_t header[MISSION_HEADER_BYTES], uint32_t *count, uint16_t *flags);
+bool Mission_DecodeRecord(const uint8_t record[MISSION_RECORD_BYTES], Waypoint_t *waypoint);
+
+#endif // MISSION_H
@@ -0,0 +1,133 @@
+/*
+ * mixer.h - Compile-time actuator mixer for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * An airframe is a constexpr table with one row per actuator giving its
+ * response to roll, pitch, yaw and throttle demand. Mixer_Apply<Geometry>
+ * expands every loop over the table at compile time, so coefficients
+ * become immediates and zero terms disappear; cost grows linearly with the
+ * actuator count and there is no data-dependent branching.
+ *
+ * Desaturation, in a fixed number of operations:
+ *  1. If the attitude demand alone spans more than the output range, scale
+ *     roll/pitch/yaw down together (keeps the torque direction).
+ *  2. Shift throttle by the least amount that brings every actuator inside
+ *     the range, i.e. give up collective thrust before attitude authority.
+ *  3. Clamp, which only trims rounding once 1 and 2 have run.
+ *
+ * Sign convention follows FlightControl_MixQuadX: positive roll raises
+ * the left side, positive pitch raises the front, positive yaw speeds up
+ * CW props. Throttle coefficients must be positive.
+ */
+
+#ifndef MIXER_H
+#define MIXER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <utility>
+
+typedef struct {
+    float roll;
+    float pitch;
+    float yaw;
+    float throttle;
+} Mixer_Row_t;
+
+template <int M>
+struct MixerGeometry {
+    static constexpr int kActuators = M;
+    Mixer_Row_t rows[M];
+};
+
+// Quad-X, motors front-left (CCW), front-right (CW), rear-right (CCW), rear-left (CW)
+constexpr MixerGeometry<4> MIXER_QUAD_X = {{
+    { +1.0f, +1.0f, -1.0f, 1.0f },
+    { -1.0f, +1.0f, +1.0f, 1.0f },
+    { -1.0f, -1.0f, -1.0f, 1.0f },
+    { +1.0f, -1.0f, +1.0f, 1.0f },
+}};
+
+// Hex-X, counter-clockwise from front-left (30 deg), alternating CCW/CW
+constexpr MixerGeometry<6> MIXER_HEX_X = {{
+    { +0.5f, +0.866025f, -1.0f, 1.0f },
+    { +1.0f,  0.0f,      +1.0f, 1.0f },
+    { +0.5f, -0.866025f, -1.0f, 1.0f },
+    { -0.5f, -0.866025f, +1.0f, 1.0f },
+    { -1.0f,  0.0f,      -1.0f, 1.0f },
+    { -0.5f, +0.866025f, +1.0f, 1.0f },
+}};
+
+// Octo-X, counter-clockwise from front-left (22.5 deg), alternating CCW/CW
+constexpr MixerGeometry<8> MIXER_OCTO_X = {{
+    { +0.382683f, +0.923880f, -1.0f, 1.0f },
+    { +0.923880f, +0.382683f, +1.0f, 1.0f },
+    { +0.923880f, -0.382683f, -1.0f, 1.0f },
+    { +0.382683f, -0.923880f, +1.0f, 1.0f },
+    { -0.382683f, -0.923880f, -1.0f, 1.0f },
+    { -0.923880f, -0.382683f, +1.0f, 1.0f },
+    { -0.923880f, +0.382683f, -1.0f, 1.0f },
+    { -0.382683f, +0.923880f, +1.0f, 1.0f },
+}};
+
+namespace mixer_detail {
+
+template <const auto &G, size_t... I>
+inline bool apply(float throttle, float roll, float pitch, float yaw,
+                  float out_min, float out_max, float *out, std::index_sequence<I...>) {
+    constexpr int M = sizeof...(I);
+    static_assert(((G.rows[I].throttle > 0.0f) && ...), "throttle coefficients must be positive");
+
+    // Attitude-only contribution per actuator
+    float attitude[M] = { (G.rows[I].roll * roll + G.rows[I].pitch * pitch + G.rows[I].yaw * yaw)... };
+
+    float lo = attitude[0];
+    float hi = attitude[0];
+    ((lo = (attitude[I] < lo) ? attitude[I] : lo), ...);
+    ((hi = (attitude[I] > hi) ? attitude[I] : hi), ...);
+
+    // 1. Fit the attitude spread into the output range
+    float range = out_max - out_min;
+    float spread = hi - lo;
+    float scale = (spread > range) ? range / spread : 1.0f;
+    ((attitude[I] *= scale), ...);
+
+    // 2. Throttle window that keeps every actuator in range
+    float t_lo = -1e30f;
+    float t_hi = 1e30f;
+    constexpr float inv_t[M] = { (1.0f / G.rows[I].throttle)... };
+    ((t_lo = ((out_min - attitude[I]) * inv_t[I] > t_lo) ? (out_min - attitude[I]) * inv_t[I] : t_lo), ...);
+    ((t_hi = ((out_max - attitude[I]) * inv_t[I] < t_hi) ? (out_max - attitude[I]) * inv_t[I] : t_hi), ...);
+
+    float t = throttle;
+    if (t_lo > t_hi) {
+        t = 0.5f * (t_lo + t_hi);   // Unequal thrust weights: best compromise
+    } else {
+        t = (t < t_lo) ? t_lo : t;
+        t = (t > t_hi) ? t_hi : t;
+    }
+
+    // 3. Compose and clamp
+    ((out[I] = G.rows[I].throttle * t + attitude[I]), ...);
+    ((out[I] = (out[I] < out_min) ? out_min : out[I]), ...);
+    ((out[I] = (out[I] > out_max) ? out_max : out[I]), ...);
+
+    return scale < 1.0f || t != throttle;
+}
+
+} // namespace mixer_detail
+
+// Mix throttle and attitude demand into G.kActuators outputs within
+// [out_min, out_max]. Returns true if throttle was moved or attitude
+// demand was scaled to stay in range.
+template <const auto &G>
+inline bool Mixer_Apply(float throttle, float roll, float pitch, float yaw,
+                        float out_min, float out_max, float *out) {
+    return mixer_detail::apply<G>(throttle, roll, pitch, yaw, out_min, out_max, out,
+                                  std::make_index_sequence<G.kActuators>{});
+}
+
+#endif // MIXER_H
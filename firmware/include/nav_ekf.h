@@ -0,0 +1,111 @@
+/*
+ * nav_ekf.h - Navigation extended Kalman filter for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Error-state EKF over position (NED, m), velocity (NED, m/s), attitude
+ * error (rad) and gyro bias (body, rad/s). The nominal state is
+ * propagated from the IMU; GPS position and barometric altitude correct
+ * it through scalar sequential updates, so no matrix is ever inverted.
+ *
+ * Cost control:
+ *  - Covariance is a packed SymMatrix<12> (78 floats) and the prediction
+ *    is written block-wise from the known sparsity of F, so it costs a
+ *    handful of 3x3 products instead of two dense 12x12 multiplies.
+ *  - Every measurement selects a single state (H is a unit row), so each
+ *    update is a rank-1 downdate of the upper triangle.
+ *
+ * Delayed GPS: each prediction appends the dead-reckoned displacement to
+ * a ring buffer. A fix stamped in the past is compared against the
+ * current position minus the displacement flown since its timestamp, so
+ * receiver latency does not show up as a position error.
+ *
+ * Gyro bias: the attitude is carried by integrating the gyro, so a bias
+ * the filter does not model tilts the estimated gravity vector and walks
+ * velocity and position off until GPS starts rejecting fixes. The bias
+ * is observed through that same tilt, as a GPS / baro position residual.
+ *
+ * Everything lives in NavEkf_t; there is no heap and no global state.
+ */
+
+#ifndef NAV_EKF_H
+#define NAV_EKF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ahrs.h"
+#include "local_frame.h"
+#include "matrix.h"
+#include "sensor_types.h"
+
+#define NAV_EKF_STATES        12
+#define NAV_EKF_HISTORY_LEN   128    // 256 ms of history at 500 Hz
+#define NAV_EKF_GPS_RESET     10     // Consecutive GPS rejects before a position reset
+
+typedef struct {
+    float accel_noise;        // Accelerometer white noise (m/s^2)
+    float gyro_noise;         // Gyro white noise (rad/s)
+    float gyro_bias_noise;    // Gyro bias random walk (rad/s^2)
+    float gps_pos_noise_h;    // GPS horizontal position sigma (m)
+    float gps_pos_noise_v;    // GPS vertical position sigma (m)
+    float baro_noise;         // Barometric altitude sigma (m)
+    float innovation_gate;    // Reject measurements beyond this many sigma
+} NavEkf_Config_t;
+
+typedef struct {
+    uint64_t time_us;
+    float displacement[3];    // Dead-reckoned NED displacement since start
+} NavEkf_History_t;
+
+typedef struct {
+    NavEkf_Config_t config;
+
+    // Nominal state
+    float pos[3];             // NED relative to origin (m)
+    float vel[3];             // NED (m/s)
+    Quaternion_t q;           // Body (FLU) to north-west-up
+    float gyro_bias[3];       // Body (rad/s), subtracted from the gyro
+
+    SymMatrix<NAV_EKF_STATES> P;   // Error-state covariance: dpos, dvel, dtheta, dbias
+
+    // Local tangent-plane origin, set by the first GPS fix
+    LocalFrame_t origin;
+    bool origin_set;
+
+    float baro_offset;        // Baro altitude minus EKF altitude at first fusion
+    bool baro_referenced;
+
+    NavEkf_History_t history[NAV_EKF_HISTORY_LEN];
+    float displacement[3];
+    uint32_t history_head;
+    uint32_t history_count;
+    uint64_t time_us;
+
+    uint32_t gps_rejects;
+    uint32_t gps_reject_streak;
+    uint32_t baro_rejects;
+} NavEkf_t;
+
+// Default noise and gating configuration
+NavEkf_Config_t NavEkf_DefaultConfig(void);
+
+// Reset the filter; attitude starts at q
+void NavEkf_Init(NavEkf_t *ekf, const NavEkf_Config_t *config, Quaternion_t q);
+
+// Propagate with one IMU sample taken at time_us (gyro deg/s, accel m/s^2)
+void NavEkf_Predict(NavEkf_t *ekf, const IMU_Data_t *imu, float dt, uint64_t time_us);
+
+// Fuse barometric altitude (m). Returns false if rejected by the gate.
+bool NavEkf_FuseBaro(NavEkf_t *ekf, float altitude);
+
+// Fuse a GPS position measured at measured_us (may be in the past).
+// The first call sets the local origin. Returns false if rejected; after
+// NAV_EKF_GPS_RESET rejects in a row the position is reset to the fix.
+bool NavEkf_FuseGps(NavEkf_t *ekf, double latitude, double longitude, float altitude,
+                    uint64_t measured_us);
+
+// Current estimate as a geodetic position (zeros until the origin is set)
+void NavEkf_GetPosition(const NavEkf_t *ekf, double *latitude, double *longitude, float *altitude);
+
+#endif // NAV_EKF_H
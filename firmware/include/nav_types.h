@@ -0,0 +1,43 @@
+/*
+ * nav_types.h - Navigation state types for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Position, velocity, attitude and waypoint structs shared by navigation
+ * and the modules it is built from (missions, trajectories, terrain,
+ * geofence), kept apart from navigation.h so that the navigation context
+ * can embed them.
+ */
+
+#ifndef NAV_TYPES_H
+#define NAV_TYPES_H
+
+// Position structure (latitude, longitude, altitude)
+typedef struct {
+    double latitude;   // Degrees, WGS84
+    double longitude;  // Degrees, WGS84
+    float altitude;    // Meters above sea level
+} Position_t;
+
+// Velocity structure (m/s in NED frame)
+typedef struct {
+    float north;   // Velocity north
+    float east;    // Velocity east
+    float down;    // Velocity down (positive down)
+} Velocity_t;
+
+// Attitude structure (Euler angles in degrees)
+typedef struct {
+    float roll;    // Rotation about X-axis
+    float pitch;   // Rotation about Y-axis
+    float yaw;     // Rotation about Z-axis (heading)
+} Attitude_t;
+
+// Waypoint structure
+typedef struct {
+    Position_t position;
+    float hold_time;    // Seconds to hover at waypoint
+} Waypoint_t;
+
+#endif // NAV_TYPES_H
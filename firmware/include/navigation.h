@@ -9,6 +9,25 @@
  * - Sensor fusion integration
  * - Flight path planning
  * - Velocity and attitude control
+ *
+ * Missions are streamed (see mission.h) and flown along minimum-snap
+ * trajectories (see trajectory.h): the velocity command is the
+ * trajectory's feed-forward plus a position correction, and each
+ * waypoint's hold_time is honoured.
+ *
+ * Missions flagged MISSION_FLAG_TERRAIN give altitudes above the terrain
+ * (see terrain.h): the trajectory is planned and tracked in height above
+ * the ground ahead, and the ground's rate of change is fed forward into
+ * the vertical command.
+ *
+ * With a geofence set (see geofence.h), the velocity command is checked
+ * every tick: it slows so the vehicle stops short of a breach predicted
+ * along it, and while breached only commands leading back toward
+ * flyable space stand.
+ *
+ * All state lives in a Navigation_t owned by the caller; the update takes
+ * its time as an argument rather than reading the system clock, so
+ * simulated vehicles can run side by side (see tools/monte_carlo.cpp).
  */
 
 #ifndef NAVIGATION_H
@@ -16,58 +35,113 @@
 
 #include <stdbool.h>
 #include <stdint.h>
-
-// Position structure (latitude, longitude, altitude)
-typedef struct {
-    double latitude;   // Degrees, WGS84
-    double longitude;  // Degrees, WGS84
-    float altitude;    // Meters above sea level
-} Position_t;
-
-// Velocity structure (m/s in NED frame)
-typedef struct {
-    float north;   // Velocity north
-    float east;    // Velocity east
-    float down;    // Velocity down (positive down)
-} Velocity_t;
-
-// Attitude structure (Euler angles in degrees)
-typedef struct {
-    float roll;    // Rotation about X-axis
-    float pitch;   // Rotation about Y-axis
-    float yaw;     // Rotation about Z-axis (heading)
-} Attitude_t;
-
-// Waypoint structure
-typedef struct {
-    Position_t position;
-    float hold_time;    // Seconds to hover at waypoint
-} Waypoint_t;
-
-#define MAX_WAYPOINTS 50
-
-// Initialize navigation system and sensor fusion
-bool Navigation_Init(void);
-
-// Update navigation loop with sensor inputs and current state
-void Navigation_Update(IMU_Data_t *imu, Barometer_Data_t *baro, Position_t *gps_pos);
-
-// Set target waypoints for autonomous flight
-bool Navigation_SetWaypoints(Waypoint_t *waypoints, uint8_t count);
+#include "geofence.h"
+#include "local_frame.h"
+#include "mission.h"
+#include "nav_ekf.h"
+#include "nav_types.h"
+#include "sensors.h"
+#include "terrain.h"
+#include "trajectory.h"
+
+// How waypoint distance and bearing are computed each tick
+typedef enum {
+    NAV_GEOMETRY_LOCAL_TANGENT = 0,   // Leg projected once into a local NED frame (default)
+    NAV_GEOMETRY_GREAT_CIRCLE         // Float haversine and bearing every tick
+} Navigation_GeometryMode_t;
+
+typedef struct Navigation {
+    const Sensors_t *sensors;           // Seeds the EKF attitude
+
+    Mission_Source_t mission;
+    TrajectoryPlanner_t planner;
+    bool mission_loaded;
+    bool mission_started;
+    uint32_t current_wp_index;
+    bool mission_complete;
+
+    Position_t current_position;
+    Velocity_t velocity_command;
+    Attitude_t attitude_command;
+
+    Navigation_GeometryMode_t geometry_mode;
+    LocalFrame_t leg_frame;             // Anchored at the active waypoint
+    Position_t leg_target;
+    bool leg_active;
+
+    Terrain_t *terrain;
+    TerrainFollower_t follower;
+    bool terrain_relative;
+
+    const Geofence_t *geofence;
+    Geofence_Status_t fence_status;
+    bool fence_valid;
+
+    NavEkf_t ekf;
+    bool ekf_started;
+    uint64_t last_update_us;
+} Navigation_t;
+
+// Initialize navigation system and sensor fusion. The EKF takes its
+// initial attitude from sensors, which must outlive nav.
+bool Navigation_Init(Navigation_t *nav, const Sensors_t *sensors);
+
+// Update navigation loop with sensor inputs and current state.
+// Runs the navigation EKF: imu propagates, baro and gps (either may be
+// NULL when no new sample is available) correct. now_us is the update
+// time (SystemClock_Micros in flight); gps->timestamp_us, on the same
+// time base, is when the fix was measured.
+void Navigation_Update(Navigation_t *nav, IMU_Data_t *imu, Barometer_Data_t *baro, const GPS_Data_t *gps,
+                       uint64_t now_us);
+
+// Set target waypoints for autonomous flight. The array is read as the
+// mission is flown, so it must stay valid until the mission ends.
+bool Navigation_SetWaypoints(Navigation_t *nav, const Waypoint_t *waypoints, uint32_t count);
+
+// Fly a mission streamed from a source (e.g. Mission_FlashSource). A
+// terrain-relative mission needs Navigation_SetTerrain first.
+bool Navigation_SetMission(Navigation_t *nav, const Mission_Source_t *source);
+
+// Elevation model for terrain-relative missions (NULL for none). The
+// navigation task services its tile loads, so it must stay valid while set.
+void Navigation_SetTerrain(Navigation_t *nav, Terrain_t *terrain);
+
+// Enforce a built geofence (NULL for none). It is read every tick, so it
+// must stay valid while set.
+void Navigation_SetGeofence(Navigation_t *nav, const Geofence_t *geofence);
+
+// Latest geofence status; false when no geofence is set or the position
+// is not yet known
+bool Navigation_GetGeofenceStatus(const Navigation_t *nav, Geofence_Status_t *status);
+
+// Select the per-tick waypoint geometry
+void Navigation_SetGeometryMode(Navigation_t *nav, Navigation_GeometryMode_t mode);
+
+// Get fused position estimate
+Position_t Navigation_GetPosition(const Navigation_t *nav);
+
+// Get fused velocity estimate (NED, m/s)
+Velocity_t Navigation_GetVelocity(const Navigation_t *nav);
 
 // Get current desired velocity command
-Velocity_t Navigation_GetVelocityCommand(void);
+Velocity_t Navigation_GetVelocityCommand(const Navigation_t *nav);
 
 // Get current desired attitude command
-Attitude_t Navigation_GetAttitudeCommand(void);
+Attitude_t Navigation_GetAttitudeCommand(const Navigation_t *nav);
 
 // Get current target waypoint index
-uint8_t Navigation_GetCurrentWaypoint(void);
+uint32_t Navigation_GetCurrentWaypoint(const Navigation_t *nav);
 
 // Check if mission is complete
-bool Navigation_IsMissionComplete(void);
+bool Navigation_IsMissionComplete(const Navigation_t *nav);
 
 // Abort mission and return control to manual pilot
-void Navigation_AbortMission(void);
+void Navigation_AbortMission(Navigation_t *nav);
+
+// Great-circle (haversine) distance between two positions in meters
+float Navigation_DistanceBetween(const Position_t *a, const Position_t *b);
+
+// Initial bearing from a to b in degrees (0 - 360, clockwise from north)
+float Navigation_BearingBetween(const Position_t *a, const Position_t *b);
 
 #endif // NAVIGATION_H
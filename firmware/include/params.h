@@ -0,0 +1,204 @@
+/*
+ * params.h - Runtime parameter store for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Every tunable is listed once in PARAMS_TABLE with its type, default and
+ * range. Its enum id (PARAM_<NAME>) indexes a bank of values, so the hot
+ * path reads a parameter with one load: Params_Float(bank, PARAM_ATT_ROLL_KP).
+ *
+ * Names: outside the firmware (ground link, flash images) a parameter is
+ * known by the FNV-1a hash of its name, which Params_Hash computes at
+ * compile time. A perfect hash over the table, also built at compile
+ * time, takes a name hash to its id with one multiply, one table load and
+ * one compare; nothing compares strings at run time.
+ *
+ * Updates: the store keeps two banks. The control loop reads the active
+ * one for a whole frame. A tuner edits the other with Params_Set* and
+ * publishes the edits with Params_Commit; the control loop adopts them at
+ * its next frame boundary in Params_BeginFrame, which is one flag check
+ * and an index flip. A frame therefore never sees half an update, and
+ * neither side waits for the other. Until the control loop has adopted a
+ * commit, further edits are refused.
+ *
+ * Persistence: Params_Save snapshots the committed values into an image
+ * and Params_Service programs it, a page at a time, from the flash
+ * service task, sharing the flash with the blackbox. Images go into the
+ * FLASH_PARAMS partition slot after slot around a ring of sectors, and a
+ * sector is erased only when the ring comes back round to it, so every
+ * sector wears at the same rate (16 sectors of 8 slots: each sector is
+ * erased once per 128 saves). At start-up the newest image whose CRC
+ * checks wins. Names it does not know are skipped, and parameters it
+ * lacks or holds out of range keep their defaults, so images survive
+ * firmware updates that add or drop parameters.
+ *
+ * Image layout (one PARAMS_SLOT_BYTES slot), little-endian:
+ *   header  'T' 'M' 'F' 'P', version u16, count u16, sequence u32,
+ *           flags u16, CRC-16 u16 over the preceding 14 bytes and the
+ *           records
+ *   record  name hash u32, value u32 (float bits or int32)
+ * The header is programmed first, so a slot whose first word is still
+ * erased was never started.
+ *
+ * Contexts: Set/Commit/Save belong to one tuner context (in the firmware
+ * the telemetry task, driven by the ground uplink; see telemetry.h),
+ * BeginFrame and Active to the control loop, Service to the flash service
+ * task.
+ */
+
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <atomic>
+#include "hardware_drivers.h"
+
+typedef enum { PARAM_FLOAT = 0, PARAM_INT32 } Param_Type_t;
+
+// X(name, type, default, min, max); integer defaults and ranges are
+// written as floats (exact to 2^24). Motor differential per degree; the
+// attitude gains fly the reference airframe of tools/monte_carlo.cpp.
+#define PARAMS_TABLE(X)                                        \
+    X(ATT_ROLL_KP,      PARAM_FLOAT, 0.015f,  0.0f, 0.2f)      \
+    X(ATT_ROLL_KI,      PARAM_FLOAT, 0.004f,  0.0f, 0.2f)      \
+    X(ATT_ROLL_KD,      PARAM_FLOAT, 0.0018f, 0.0f, 0.05f)     \
+    X(ATT_PITCH_KP,     PARAM_FLOAT, 0.015f,  0.0f, 0.2f)      \
+    X(ATT_PITCH_KI,     PARAM_FLOAT, 0.004f,  0.0f, 0.2f)      \
+    X(ATT_PITCH_KD,     PARAM_FLOAT, 0.0018f, 0.0f, 0.05f)     \
+    X(ATT_YAW_KP,       PARAM_FLOAT, 0.03f,   0.0f, 0.2f)      \
+    X(ATT_YAW_KI,       PARAM_FLOAT, 0.005f,  0.0f, 0.2f)      \
+    X(ATT_YAW_KD,       PARAM_FLOAT, 0.008f,  0.0f, 0.05f)     \
+    X(ATT_OUT_LIMIT,    PARAM_FLOAT, 1.0f,    0.05f, 1.0f)     \
+    X(ATT_D_CUTOFF_HZ,  PARAM_FLOAT, 40.0f,   5.0f, 200.0f)
+
+#define PARAM_ENUM_ENTRY(name, type, def, lo, hi) PARAM_##name,
+typedef enum { PARAMS_TABLE(PARAM_ENUM_ENTRY) PARAM_COUNT } Param_Id_t;
+#undef PARAM_ENUM_ENTRY
+
+#define PARAMS_VERSION       1
+#define PARAMS_HEADER_BYTES  16
+#define PARAMS_RECORD_BYTES  8
+#define PARAMS_SLOT_BYTES    512     // Two flash pages per image
+#define PARAMS_SLOTS         (FLASH_PARAMS_SIZE / PARAMS_SLOT_BYTES)
+
+static_assert(PARAMS_HEADER_BYTES + PARAM_COUNT * PARAMS_RECORD_BYTES <= PARAMS_SLOT_BYTES,
+              "parameter image does not fit a slot");
+
+typedef union {
+    float f;
+    int32_t i;
+} Param_Value_t;
+
+typedef struct {
+    Param_Value_t value[PARAM_COUNT];
+} Params_Bank_t;
+
+typedef struct {
+    const char *name;
+    uint32_t hash;
+    Param_Type_t type;
+    float default_value;
+    float min;
+    float max;
+} Params_Info_t;
+
+typedef struct {
+    uint32_t loaded;            // Values taken from flash at start-up
+    uint32_t skipped;           // Stored values unknown or out of range
+    uint32_t sequence;          // Newest image in flash, 0 = none
+    uint32_t slot;              // Where it is
+    uint32_t commits;           // Updates adopted by the control loop
+    uint32_t saves;             // Images written
+    uint32_t sectors_erased;
+} Params_Stats_t;
+
+typedef struct Params {
+    Params_Bank_t bank[2];
+    std::atomic<uint32_t> active{0};        // Bank the control loop reads
+    std::atomic<bool> pending{false};       // The other bank is committed
+    bool staging_open;                      // Tuner: the other bank is being edited
+
+    // Flash writer: Save queues an image, Service writes it
+    std::atomic<bool> save_queued{false};
+    bool flash_ok;
+    uint8_t image[PARAMS_SLOT_BYTES];
+    uint32_t image_length;
+    uint32_t next_sequence;
+    uint32_t next_slot;
+    uint32_t write_slot;
+    uint32_t write_offset;                  // Image bytes programmed
+    uint32_t inflight;                      // Bytes of the program in progress
+    bool writing;                           // write_slot chosen
+    bool erase_pending;
+    Params_Stats_t stats;
+} Params_t;
+
+// 32-bit FNV-1a of a name; constant-folded for literal names
+constexpr uint32_t Params_Hash(const char *name) {
+    uint32_t hash = 2166136261U;
+    while (*name) hash = (hash ^ (uint8_t)*name++) * 16777619U;
+    return hash;
+}
+
+// Defaults, then the newest valid image in the FLASH_PARAMS partition.
+// Returns false if the flash is unavailable: defaults are in place and
+// nothing can be saved.
+bool Params_Init(Params_t *params);
+
+// The compiled-in defaults
+const Params_Bank_t *Params_Defaults(void);
+
+// Id of the parameter with this name hash, PARAM_COUNT if there is none
+Param_Id_t Params_Find(uint32_t hash);
+
+// Name, type, default and range of a parameter
+const Params_Info_t *Params_GetInfo(Param_Id_t id);
+
+/* --- Control loop --- */
+
+// Adopt a committed update at the start of a frame; true if the active
+// bank changed
+bool Params_BeginFrame(Params_t *params);
+
+// The bank to read for the rest of the frame
+static inline const Params_Bank_t *Params_Active(const Params_t *params) {
+    return &params->bank[params->active.load(std::memory_order_relaxed)];
+}
+
+static inline float Params_Float(const Params_Bank_t *bank, Param_Id_t id) {
+    return bank->value[id].f;
+}
+
+static inline int32_t Params_Int(const Params_Bank_t *bank, Param_Id_t id) {
+    return bank->value[id].i;
+}
+
+/* --- Tuner --- */
+
+// Stage a new value. False if the type is wrong, the value is out of
+// range, or the last commit has not been adopted yet.
+bool Params_SetFloat(Params_t *params, Param_Id_t id, float value);
+bool Params_SetInt(Params_t *params, Param_Id_t id, int32_t value);
+
+// Publish the staged values for the next frame boundary; false if
+// nothing is staged
+bool Params_Commit(Params_t *params);
+
+// Queue the committed values for writing to flash; false if the flash is
+// unavailable or the previous image is still being written
+bool Params_Save(Params_t *params);
+
+// True while an image is queued or being written
+bool Params_IsSaving(const Params_t *params);
+
+/* --- Flash service task --- */
+
+// Advance the image write by at most one erase or page program; never
+// waits on the flash
+void Params_Service(Params_t *params);
+
+void Params_GetStats(const Params_t *params, Params_Stats_t *stats);
+
+#endif // PARAMS_H
@@ -0,0 +1,191 @@
+/*
+ * pid_bank.h - Struct-of-arrays PID controller bank for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Holds N independent PID axes with each parameter and state variable in
+ * its own contiguous array, and updates all of them in a single
+ * branch-free loop the compiler can vectorize (4 or 8 lanes on host; the
+ * M7 still benefits from the straight-line code). Behaviour is selected
+ * at compile time through the Options bit mask, so unused features cost
+ * nothing:
+ *
+ *   PID_OPT_D_ON_MEASUREMENT  differentiate -measurement instead of error
+ *                             (no derivative kick on setpoint steps)
+ *   PID_OPT_D_LOWPASS         first-order low-pass on the derivative term
+ *   PID_OPT_BACK_CALCULATION  anti-windup by bleeding the integrator with
+ *                             kaw * (saturated - unsaturated output);
+ *                             without it the integral term is clamped
+ *   PID_OPT_ANGLE_WRAP        axes given a period with SetWrap() (e.g. 360
+ *                             for heading) take the error and the input
+ *                             step the short way round, so crossing the
+ *                             +-180 seam is neither a full-turn error nor
+ *                             a derivative kick
+ *
+ * The time step is set once per frame with SetTiming(), which precomputes
+ * 1/dt and the filter coefficient for every axis; Update() never divides.
+ * A bank of 3 covers roll/pitch/yaw; larger banks serve rate, velocity or
+ * many-vehicle batch loops. The bank pays off in throughput only when the
+ * lanes fill vectors: on host 64 axes take 83 ns against 188 ns of scalar
+ * PID_Update calls, but 3 axes take about 18 ns against 10 ns, since the
+ * per-frame SetTiming divide and the options above (which PID_Update does
+ * not have) are not amortized. The attitude loop keeps the bank for those
+ * options, not for speed.
+ */
+
+#ifndef PID_BANK_H
+#define PID_BANK_H
+
+#include <stdint.h>
+#include <math.h>
+
+enum {
+    PID_OPT_D_ON_MEASUREMENT = 1u << 0,
+    PID_OPT_D_LOWPASS        = 1u << 1,
+    PID_OPT_BACK_CALCULATION = 1u << 2,
+    PID_OPT_ANGLE_WRAP       = 1u << 3,
+};
+
+#define PID_WRAP_MAX_TURNS  64.0f   // Largest angle PID_OPT_ANGLE_WRAP folds back, in periods
+
+template <int N, uint32_t Options>
+struct PidBank {
+    static constexpr int kAxes = N;
+    static constexpr bool kDOnMeasurement = (Options & PID_OPT_D_ON_MEASUREMENT) != 0;
+    static constexpr bool kDLowPass = (Options & PID_OPT_D_LOWPASS) != 0;
+    static constexpr bool kBackCalculation = (Options & PID_OPT_BACK_CALCULATION) != 0;
+    static constexpr bool kAngleWrap = (Options & PID_OPT_ANGLE_WRAP) != 0;
+
+    // Parameters
+    alignas(32) float kp[N];
+    alignas(32) float ki[N];
+    alignas(32) float kd[N];
+    alignas(32) float kaw[N];        // Back-calculation gain (1/s)
+    alignas(32) float out_min[N];
+    alignas(32) float out_max[N];
+    alignas(32) float wrap_period[N];  // 0 for a linear axis (PID_OPT_ANGLE_WRAP)
+    alignas(32) float inv_wrap[N];
+
+    // State
+    alignas(32) float i_term[N];     // Integral contribution (already scaled by ki)
+    alignas(32) float prev_input[N]; // Last error, or last measurement
+    alignas(32) float d_term[N];     // Derivative (per second), filtered with PID_OPT_D_LOWPASS
+    alignas(32) float output[N];
+
+    // Per-frame timing, shared by all axes
+    float dt;
+    float inv_dt;
+    float d_alpha;
+    float d_cutoff_hz;
+    bool primed;
+
+    // Set gains and limits for one axis; kaw defaults to 1 / sqrt(Ti * Td)
+    void Configure(int axis, float p, float i, float d, float lo, float hi) {
+        kp[axis] = p;
+        ki[axis] = i;
+        kd[axis] = d;
+        out_min[axis] = lo;
+        out_max[axis] = hi;
+
+        float tracking = (p > 0.0f && i > 0.0f) ? p / i : 1.0f;   // Ti
+        if (p > 0.0f && d > 0.0f) tracking = sqrtf(tracking * d / p);
+        kaw[axis] = 1.0f / tracking;
+        wrap_period[axis] = 0.0f;
+        inv_wrap[axis] = 0.0f;
+    }
+
+    // Treat an axis as an angle with the given period (PID_OPT_ANGLE_WRAP)
+    void SetWrap(int axis, float period) {
+        wrap_period[axis] = period;
+        inv_wrap[axis] = (period > 0.0f) ? 1.0f / period : 0.0f;
+    }
+
+    // x on the axis' period, in [-period/2, period/2) for |x| up to
+    // PID_WRAP_MAX_TURNS periods; unchanged on a linear axis or without
+    // PID_OPT_ANGLE_WRAP
+    float Wrap(int axis, float x) const {
+        if (!kAngleWrap) return x;
+        // floor() as truncation of a value kept positive: no libm call and
+        // no compare, so the update loop still vectorizes
+        float turns = x * inv_wrap[axis] + (0.5f + PID_WRAP_MAX_TURNS);
+        float whole = (float)(int32_t)turns - PID_WRAP_MAX_TURNS;
+        return x - wrap_period[axis] * whole;
+    }
+
+    // Derivative low-pass cutoff in Hz (used with PID_OPT_D_LOWPASS)
+    void SetDerivativeCutoff(float hz) {
+        d_cutoff_hz = hz;
+        SetTiming(dt);
+    }
+
+    // Clear controller state, keep gains
+    void Reset() {
+        for (int i = 0; i < N; i++) {
+            i_term[i] = 0.0f;
+            prev_input[i] = 0.0f;
+            d_term[i] = 0.0f;
+            output[i] = 0.0f;
+        }
+        primed = false;
+    }
+
+    // Precompute per-frame constants. dt <= 0 holds the integrator and
+    // zeroes the derivative for this frame.
+    void SetTiming(float seconds) {
+        if (seconds > 0.0f) {
+            dt = seconds;
+            inv_dt = 1.0f / seconds;
+            float rc = (d_cutoff_hz > 0.0f) ? 1.0f / (6.2831853f * d_cutoff_hz) : 0.0f;
+            d_alpha = seconds / (rc + seconds);
+        } else {
+            dt = 0.0f;
+            inv_dt = 0.0f;
+            d_alpha = 0.0f;
+        }
+    }
+
+    // Advance every axis one step; results land in output[]
+    void Update(const float *setpoint, const float *measured) {
+        if (!primed) {
+            for (int i = 0; i < N; i++) {
+                prev_input[i] = kDOnMeasurement ? measured[i] : setpoint[i] - measured[i];
+            }
+            primed = true;
+        }
+
+        const float step = dt;
+        const float rate = inv_dt;
+        const float alpha = d_alpha;
+
+        for (int i = 0; i < N; i++) {
+            float error = Wrap(i, setpoint[i] - measured[i]);
+
+            float input = kDOnMeasurement ? measured[i] : error;
+            float raw_d = Wrap(i, input - prev_input[i]) * rate;
+            if (kDOnMeasurement) raw_d = -raw_d;
+            prev_input[i] = input;
+
+            float d = kDLowPass ? d_term[i] + alpha * (raw_d - d_term[i]) : raw_d;
+            d_term[i] = d;
+
+            float integral = i_term[i] + ki[i] * error * step;
+            float unsaturated = kp[i] * error + integral + kd[i] * d;
+
+            float u = unsaturated;
+            u = (u > out_max[i]) ? out_max[i] : u;
+            u = (u < out_min[i]) ? out_min[i] : u;
+            output[i] = u;
+
+            if (kBackCalculation) {
+                integral += kaw[i] * (u - unsaturated) * step;
+            } else {
+                integral = (integral > out_max[i]) ? out_max[i] : integral;
+                integral = (integral < out_min[i]) ? out_min[i] : integral;
+            }
+            i_term[i] = integral;
+        }
+    }
+};
+
+#endif // PID_BANK_H
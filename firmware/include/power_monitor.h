@@ -0,0 +1,128 @@
+/*
+ * power_monitor.h - Power rail and thermal health interface for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Monitors supply rails and coil temperatures and reports system health
+ * to the main control loop.
+ *
+ * Acquisition never runs in the loop. ADC3 scans the rail channels
+ * continuously into a circular DMA buffer and its half/complete callback
+ * hands each finished block to PowerMonitor_OnAdcBlock; the coil
+ * thermocouples (MAX31855) are read by SPI DMA and arrive through
+ * PowerMonitor_OnThermocouples. Both callbacks fold every sample into
+ * O(1) running statistics (EMA, min/max, energy and charge integration)
+ * and publish them under a sequence counter.
+ *
+ * PowerMonitor_CheckHealth (the 10 Hz power task) applies the limits:
+ * thermal throttle above 70 C and shutdown at 85 C with hysteresis, rail
+ * and coil current limits, and staged load shedding on battery voltage.
+ * Everything else, the control loop included, only reads the latest
+ * snapshot with PowerMonitor_GetSnapshot, which never blocks.
+ */
+
+#ifndef POWER_MONITOR_H
+#define POWER_MONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ADC scan order
+typedef enum {
+    POWER_CH_BATTERY_V = 0,   // Battery pack voltage
+    POWER_CH_BATTERY_I,       // Battery current (positive = discharge)
+    POWER_CH_COIL_V,          // Coil drive bus voltage
+    POWER_CH_COIL_I,          // Coil drive bus current
+    POWER_CH_AVIONICS_V,      // 5 V avionics rail
+    POWER_CHANNEL_COUNT
+} Power_Channel_t;
+
+#define POWER_THERMOCOUPLES      4        // One MAX31855 per coil
+
+// Thermal limits (coil mounts)
+#define POWER_THROTTLE_C         70.0f
+#define POWER_THROTTLE_CLEAR_C   65.0f
+#define POWER_SHUTDOWN_C         85.0f
+#define POWER_SHUTDOWN_CLEAR_C   60.0f    // Shutdown latches until the coils cool to this
+#define POWER_THROTTLE_FLOOR     0.5f     // Output limit reached at POWER_SHUTDOWN_C
+
+// Battery (6S Li-ion) load shedding, on the filtered per-cell voltage
+#define POWER_BATTERY_CELLS      6
+#define POWER_SHED1_CELL_V       3.50f    // Shed payload and lights
+#define POWER_SHED2_CELL_V       3.30f    // Also drop the radio to low power
+#define POWER_SHED_HYSTERESIS_V  0.10f
+
+// Rail and current limits
+#define POWER_AVIONICS_MIN_V     4.75f
+#define POWER_AVIONICS_MAX_V     5.25f
+#define POWER_COIL_MAX_A         60.0f
+#define POWER_STALE_US           500000   // Data older than this is a fault
+
+typedef enum {
+    POWER_THERMAL_NORMAL = 0,
+    POWER_THERMAL_THROTTLE,
+    POWER_THERMAL_SHUTDOWN
+} Power_Thermal_t;
+
+// Non-critical loads on switched outputs, in shedding order
+typedef enum {
+    POWER_LOAD_PAYLOAD = 0,
+    POWER_LOAD_LIGHTS,
+    POWER_LOAD_RADIO_BOOST,
+    POWER_LOAD_COUNT
+} Power_Load_t;
+
+typedef struct {
+    float value;              // Latest sample
+    float mean;               // Exponential moving average
+    float min;                // Extremes of raw samples since init
+    float max;
+} Power_Stat_t;
+
+typedef struct {
+    // Rails, from the ADC callback
+    uint64_t rails_us;        // Time of the newest ADC block
+    uint32_t scans;           // ADC scans folded in since init
+    Power_Stat_t channels[POWER_CHANNEL_COUNT];
+    float battery_power_w;    // EMA of V * I
+    float battery_energy_wh;  // Drawn since init
+    float battery_charge_mah;
+    float coil_power_w;
+    float coil_energy_wh;
+
+    // Coil temperatures, from the thermocouple callback
+    uint64_t thermal_us;      // Time of the newest thermocouple read
+    float coil_temp_c[POWER_THERMOCOUPLES];   // EMA, last good value on a fault
+    float coil_temp_max_c;    // Hottest reading since init
+    uint8_t sensor_faults;    // Bit per thermocouple faulted now or never read
+
+    // Decisions of the latest PowerMonitor_CheckHealth
+    Power_Thermal_t thermal;
+    float output_limit;       // Throttle cap for the flight controller, 0 - 1
+    uint8_t shed_level;       // 0 none, 1 payload and lights, 2 also radio boost
+    bool healthy;
+} PowerMonitor_Snapshot_t;
+
+// Initialize power monitoring hardware, returns true if successful
+bool PowerMonitor_Init(void);
+
+// Evaluate rail and thermal health, returns true if all limits are satisfied
+bool PowerMonitor_CheckHealth(void);
+
+// Copy the latest snapshot. Wait-free for the caller; may be called from
+// any context.
+void PowerMonitor_GetSnapshot(PowerMonitor_Snapshot_t *snapshot);
+
+// ADC DMA callback: count complete scans (POWER_CHANNEL_COUNT samples
+// each) ending at timestamp_us
+void PowerMonitor_OnAdcBlock(const uint16_t *scans, uint32_t count, uint64_t timestamp_us);
+
+// SPI DMA callback: one raw MAX31855 frame per thermocouple
+void PowerMonitor_OnThermocouples(const uint32_t *frames, uint32_t count, uint64_t timestamp_us);
+
+// Decode a MAX31855 frame. Returns false on a fault (open, short to GND
+// or VCC), leaving celsius untouched.
+bool PowerMonitor_DecodeMax31855(uint32_t frame, float *celsius);
+
+#endif // POWER_MONITOR_H
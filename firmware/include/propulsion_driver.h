@@ -0,0 +1,84 @@
+/*
+ * propulsion_driver.h - Propulsion actuator output interface for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Translates normalized motor outputs from the flight controller into
+ * actuator drive signals.
+ *
+ * The ESCs speak DShot: each update is a 16-bit frame (11-bit throttle,
+ * telemetry request bit, 4-bit CRC) sent as fixed-period pulses whose
+ * width encodes the bit. TIM3 CH1-CH4 drive the four ESCs; an update-event
+ * burst DMA writes CCR1-CCR4 once per bit, so all four frames go out
+ * together and the CPU only fills the buffer. No calibration is needed and
+ * the update rate is bounded by the frame time (27 us at DShot600).
+ *
+ * With bidirectional DShot the signal is inverted and, once the frame has
+ * gone, the pins turn around to input capture: each ESC replies with its
+ * electrical period (GCR-coded, 5/4 of the bit rate) and the captured
+ * edges are decoded at the next update.
+ */
+
+#ifndef PROPULSION_DRIVER_H
+#define PROPULSION_DRIVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "flight_control.h"
+
+#define PROPULSION_MOTORS        4
+
+// DShot bit rates
+typedef enum {
+    DSHOT_150 = 150000,
+    DSHOT_300 = 300000,
+    DSHOT_600 = 600000
+} DShot_Rate_t;
+
+#define PROPULSION_DSHOT_RATE     DSHOT_600
+#define PROPULSION_BIDIRECTIONAL  true
+#define PROPULSION_POLE_PAIRS     7         // 14-pole motors: mechanical RPM = eRPM / 7
+
+// Throttle values; 1-47 are ESC commands and never sent from the loop
+#define DSHOT_THROTTLE_MIN        48
+#define DSHOT_THROTTLE_MAX        2047
+
+#define DSHOT_FRAME_BITS          16
+#define DSHOT_REPLY_BITS          21        // Start bit + 20 GCR bits
+#define DSHOT_CAPTURE_EDGES       24        // One edge per level change, plus slack
+
+typedef struct {
+    float rpm[PROPULSION_MOTORS];           // Mechanical RPM, 0 when stopped
+    bool valid[PROPULSION_MOTORS];          // Last reply decoded and passed its CRC
+    uint32_t frames_sent;
+    uint32_t frames_skipped;                // Update arrived while a frame was in flight
+    uint32_t replies_ok;
+    uint32_t replies_bad;                   // Missing, malformed or failed CRC
+} PropulsionDriver_Telemetry_t;
+
+// Initialize propulsion actuator outputs, returns true if successful
+bool PropulsionDriver_Init(void);
+
+// Apply normalized (0.0 - 1.0) motor outputs to the actuators. 0 stops
+// the motor; anything above maps onto DSHOT_THROTTLE_MIN..MAX.
+void PropulsionDriver_SetOutputs(const Motor_Output_t *motors);
+
+// Latest decoded telemetry
+void PropulsionDriver_GetTelemetry(PropulsionDriver_Telemetry_t *telemetry);
+
+// Timer DMA complete: turn the pins around for the ESC replies. Called
+// from HAL_TIM_PeriodElapsedCallback.
+void PropulsionDriver_OnFrameSent(void);
+
+// Build a DShot frame. The CRC is inverted for bidirectional DShot.
+uint16_t PropulsionDriver_EncodeFrame(uint16_t value, bool telemetry_request, bool bidirectional);
+
+// Decode an eRPM reply from captured edge times (timer counts; the first
+// edge is the start bit). bit_counts is the reply bit time in the same
+// counts. Returns false if the reply is malformed or fails its CRC;
+// erpm is 0 for a stopped motor.
+bool PropulsionDriver_DecodeReply(const uint16_t *edges, uint32_t count, uint32_t bit_counts,
+                                  uint32_t *erpm);
+
+#endif // PROPULSION_DRIVER_H
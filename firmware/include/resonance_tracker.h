@@ -0,0 +1,79 @@
+/*
+ * resonance_tracker.h - Closed-loop coil resonance tracking for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Keeps the coil drive on the plasma tank's resonance (900 kHz - 1.2 MHz),
+ * where the current is in phase with the drive and power transfer peaks.
+ *
+ * Phase detector: every drive cycle the coil timer triggers two ADC
+ * conversions of the coil current sense (see coil_control.h): one at the
+ * centre of the drive pulse, where the drive fundamental peaks, and one a
+ * quarter cycle earlier. For a current A*cos(wt + phi) they read
+ * A*cos(phi) and A*sin(phi). Summed over a block of cycles their ratio is
+ * tan(phi), which for a series tank is 2Q(f0 - f)/f0: a frequency error
+ * estimate that costs two sums and one divide per block, no trigonometry.
+ * Positive phase (current leading) means the drive is below resonance.
+ *
+ * Loop filter: proportional-integral on the frequency error estimate,
+ * slew limited, run once per block. The integrator carries the resonance
+ * frequency, so a steady drift leaves only a small constant phase error.
+ *
+ * Data path: both ADCs fill circular DMA buffers; the half- and
+ * full-transfer callback passes the finished half (RESONANCE_BLOCK_CYCLES
+ * cycles) to ResonanceTracker_ProcessBlock, which retunes the coil timer.
+ * On the host the block comes from the simulated plant (coil_plant.h).
+ */
+
+#ifndef RESONANCE_TRACKER_H
+#define RESONANCE_TRACKER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RESONANCE_MIN_HZ        900000
+#define RESONANCE_MAX_HZ        1200000
+#define RESONANCE_BLOCK_CYCLES  64        // Cycles per update (~55 us at 1.15 MHz)
+#define RESONANCE_ADC_MIDSCALE  2048      // Zero current on the 12-bit sense ADC
+
+typedef struct {
+    float quality;          // Nominal tank Q, scales tan(phase) to Hz
+    float kp;               // Proportional gain on the estimated error
+    float ki;               // Integral gain, fraction of the error per block
+    float max_step_hz;      // Slew limit per block
+    float max_tangent;      // Detector clamp, |tan(phase)|
+    float lock_tangent;     // |tan(phase)| counted as in lock
+    uint32_t lock_blocks;   // Consecutive in-lock blocks to declare lock
+    float min_amplitude;    // Mean current (ADC counts) below which updates hold
+    float phase_trim_rad;   // Fixed sampling delay removed from the phase
+} ResonanceTracker_Config_t;
+
+typedef struct {
+    float frequency_hz;     // Drive frequency last commanded
+    float phase_rad;        // Last measured current phase
+    float amplitude;        // Last mean current amplitude, ADC counts
+    bool locked;
+    uint32_t blocks;        // Blocks processed
+    uint32_t lock_losses;   // Lock declared then lost
+    uint32_t low_signal;    // Blocks held for lack of current
+    uint32_t slew_limited;  // Blocks whose step hit max_step_hz
+} ResonanceTracker_Status_t;
+
+// Defaults for a Q of about 50
+void ResonanceTracker_DefaultConfig(ResonanceTracker_Config_t *config);
+
+// Reset the loop and drive the coil at start_hz (clamped to the band)
+void ResonanceTracker_Init(const ResonanceTracker_Config_t *config, uint32_t start_hz);
+
+// One block of paired samples, oldest first. Called from the coil ADC DMA
+// half/complete callback; retunes the coil timer.
+void ResonanceTracker_ProcessBlock(const uint16_t *in_phase, const uint16_t *quadrature, uint32_t cycles);
+
+// Phase detector alone: tan(phase) of the block, mean amplitude in counts
+float ResonanceTracker_Detect(const uint16_t *in_phase, const uint16_t *quadrature, uint32_t cycles,
+                              float *amplitude);
+
+void ResonanceTracker_GetStatus(ResonanceTracker_Status_t *status);
+
+#endif // RESONANCE_TRACKER_H
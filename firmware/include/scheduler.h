@@ -0,0 +1,59 @@
+/*
+ * scheduler.h - Multi-rate cooperative task scheduler for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Rate-monotonic, non-preemptive executive: every task has a fixed period
+ * and phase offset, and when several are ready the shortest period runs
+ * first. Each task receives the measured time since its previous start,
+ * so controllers integrate over real elapsed time instead of a nominal
+ * frame length. Deadlines are implicit (release + period).
+ *
+ * All timing comes from system_clock, so the same schedule runs
+ * deterministically on the host virtual clock.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SCHEDULER_MAX_TASKS 8
+
+// Task body; dt is seconds since this task last started (period on first run)
+typedef void (*Scheduler_TaskFn_t)(float dt, void *context);
+
+typedef struct {
+    const char *name;
+    uint32_t period_us;
+    uint32_t phase_us;
+    uint32_t run_count;
+    uint32_t deadline_misses;   // Finished after deadline, or release skipped
+    uint32_t skipped_releases;  // Whole periods lost while the CPU was busy
+    uint32_t last_dt_us;
+    uint32_t max_exec_us;
+} Scheduler_TaskStats_t;
+
+// Clear the task table
+void Scheduler_Init(void);
+
+// Register a task; returns its id or -1 if the table is full or period is 0.
+// Tasks may only be added before Scheduler_Start().
+int Scheduler_AddTask(const char *name, Scheduler_TaskFn_t fn, void *context,
+                      uint32_t period_us, uint32_t phase_us);
+
+// Release every task at now + phase
+void Scheduler_Start(void);
+
+// Run all ready tasks in priority order, then sleep until the next release
+void Scheduler_RunOnce(void);
+
+// Copy statistics for a task id, returns false for an unknown id
+bool Scheduler_GetStats(int task_id, Scheduler_TaskStats_t *stats);
+
+// Number of registered tasks (ids are 0 .. count-1)
+int Scheduler_TaskCount(void);
+
+#endif // SCHEDULER_H
@@ -0,0 +1,59 @@
+/*
+ * sensor_types.h - Sensor sample types for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Plain sample structs shared by the sensor layer, the GPS parser and the
+ * estimators, kept apart from sensors.h so that the sensor context can
+ * embed the modules that produce them.
+ */
+
+#ifndef SENSOR_TYPES_H
+#define SENSOR_TYPES_H
+
+#include <stdint.h>
+
+// IMU sensor raw and processed data structure
+typedef struct {
+    float accel_x;  // Acceleration in m/s²
+    float accel_y;
+    float accel_z;
+    float gyro_x;   // Angular velocity in deg/s
+    float gyro_y;
+    float gyro_z;
+    float mag_x;    // Magnetometer readings in µT
+    float mag_y;
+    float mag_z;
+    float roll;     // Attitude angles in degrees, filled by Sensors_ComputeEulerAngles
+    float pitch;
+    float yaw;
+} IMU_Data_t;
+
+// GPS data structure
+typedef struct {
+    double latitude;      // degrees
+    double longitude;     // degrees
+    float altitude;       // meters above sea level
+    float speed;          // meters per second
+    uint8_t fix_type;     // 0 = no fix, 1 = 2D fix, 2 = 3D fix
+    float course;         // degrees true, ground track
+    uint8_t satellites;   // satellites used in the solution
+    uint64_t timestamp_us;// arrival of the message that carried the position
+} GPS_Data_t;
+
+// Barometer data structure
+typedef struct {
+    float pressure;   // hPa
+    float altitude;   // meters, derived from pressure
+    float temperature;// Celsius
+} Barometer_Data_t;
+
+// Magnetometer data structure (if separate from IMU)
+typedef struct {
+    float x;  // microteslas
+    float y;
+    float z;
+} Magnetometer_Data_t;
+
+#endif // SENSOR_TYPES_H
@@ -6,6 +6,22 @@
  *
  * Defines data structures and interfaces for IMU, GPS,
  * barometer, and magnetometer sensor data acquisition.
+ *
+ * Filter, attitude and parser state lives in a Sensors_t owned by the
+ * caller, so several vehicles can run in one process (see
+ * tools/monte_carlo.cpp). The hardware behind Sensors_Init and the
+ * Sensors_Update* reads is the board's own, and only one context may
+ * use it: the IMU stream (imu_stream.h) is a single-consumer queue that
+ * Sensors_Init empties and hands to its context. Sensors_Reset and the
+ * Sensors_Feed* calls touch nothing but the context, so they are the
+ * re-entrant path for samples from elsewhere.
+ *
+ * Barometric altitude is taken against a reference (pressure and air
+ * temperature at a known altitude) that defaults to the standard
+ * atmosphere at sea level and can be moved to the launch point. Every IMU
+ * sample and every baro sample also run the vertical estimator
+ * (vertical_estimator.h), which gives altitude and climb rate at the IMU
+ * rate.
  */
 
 #ifndef SENSORS_H
@@ -13,59 +29,146 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include "ahrs.h"
+#include "biquad.h"
+#include "dyn_notch.h"
+#include "gps_parser.h"
+#include "imu_stream.h"
+#include "sensor_types.h"
+#include "vertical_estimator.h"
 
-// IMU sensor raw and processed data structure
-typedef struct {
-    float accel_x;  // Acceleration in m/s²
-    float accel_y;
-    float accel_z;
-    float gyro_x;   // Angular velocity in deg/s
-    float gyro_y;
-    float gyro_z;
-    float mag_x;    // Magnetometer readings in µT
-    float mag_y;
-    float mag_z;
-    float roll;     // Computed attitude angles in degrees
-    float pitch;
-    float yaw;
-} IMU_Data_t;
-
-// GPS data structure
-typedef struct {
-    double latitude;      // degrees
-    double longitude;     // degrees
-    float altitude;       // meters above sea level
-    float speed;          // meters per second
-    uint8_t fix_type;     // 0 = no fix, 1 = 2D fix, 2 = 3D fix
-} GPS_Data_t;
-
-// Barometer data structure
+// IMU stream configuration (BMI270 FIFO)
+#define SENSORS_IMU_ODR_HZ     2000   // Output data rate
+#define SENSORS_IMU_WATERMARK  4      // Frames per FIFO interrupt (one per 2 ms frame)
+
+// IMU filtering, applied to every sample before the AHRS. Each channel
+// runs a cascade of up to SENSORS_FILTER_MAX_STAGES biquads (the gyro's
+// after the dynamic notch); the defaults are one low-pass each.
+#define SENSORS_FILTER_MAX_STAGES  4
+#define SENSORS_GYRO_LPF_HZ        150.0f  // Default gyro cascade
+#define SENSORS_ACCEL_LPF_HZ       30.0f   // Default accel cascade
+#define SENSORS_DYN_NOTCH_MIN_HZ   80.0f   // Vibration peak search band
+#define SENSORS_DYN_NOTCH_MAX_HZ   900.0f
+#define SENSORS_DYN_NOTCH_Q        3.5f
+
+// Vertical estimator time constant: baro below 1/tau, accel above
+#define SENSORS_VERTICAL_TAU_S     VERT_EST_DEFAULT_TAU_S
+
+typedef enum {
+    SENSORS_FILTER_GYRO = 0,
+    SENSORS_FILTER_ACCEL,
+} Sensors_FilterChannel_t;
+
+typedef enum {
+    SENSORS_STAGE_LOWPASS = 0,
+    SENSORS_STAGE_NOTCH,
+} Sensors_StageType_t;
+
+// One biquad of a channel's cascade: cutoff or centre frequency and Q
 typedef struct {
-    float pressure;   // hPa
-    float altitude;   // meters, derived from pressure
-    float temperature;// Celsius
-} Barometer_Data_t;
+    Sensors_StageType_t type;
+    float hz;
+    float q;
+} Sensors_FilterStage_t;
 
-// Magnetometer data structure (if separate from IMU)
+// Barometric altitude reference. Sensors_MakeBaroReference fills in the
+// derived fields.
 typedef struct {
-    float x;  // microteslas
-    float y;
-    float z;
-} Magnetometer_Data_t;
+    float pressure;         // hPa at the reference
+    float temperature;      // Air temperature at the reference (Celsius)
+    float altitude;         // m
+    float inv_pressure;     // 1 / pressure
+    float scale;            // Reference temperature over the lapse rate (m)
+} Sensors_BaroReference_t;
+
+typedef struct Sensors {
+    IMU_Data_t imu_cache;
+    GPS_Data_t gps_cache;
+    Barometer_Data_t baro_cache;
+    Sensors_BaroReference_t baro_reference;
+
+    GpsParser_t gps_parser;
+    size_t gps_read_index;
+
+    DynNotch_t gyro_notch;
+    Biquad_t gyro_filter[3][SENSORS_FILTER_MAX_STAGES];
+    Biquad_t accel_filter[3][SENSORS_FILTER_MAX_STAGES];
+    int gyro_filter_stages;
+    int accel_filter_stages;
+
+    AHRS_State_t ahrs;
+    uint64_t last_imu_us;
 
-// Initialize all sensors, returns true if successful
-bool Sensors_Init(void);
+    VertEst_t vertical;
+} Sensors_t;
 
-// Update IMU sensor data, returns true if data valid
-bool Sensors_UpdateIMU(IMU_Data_t *imu_data);
+// Initialize all sensors, returns true if successful. The IMU stream is
+// emptied and from then on drained only by this context.
+bool Sensors_Init(Sensors_t *sensors);
 
-// Update GPS sensor data, returns true if data valid
-bool Sensors_UpdateGPS(GPS_Data_t *gps_data);
+// Clear filters, attitude and parser state without touching the hardware.
+// The filter cascades go back to the defaults.
+void Sensors_Reset(Sensors_t *sensors);
+
+// Replace one channel's filter cascade; the new sections start from rest.
+// Returns false, keeping the old cascade, for more than
+// SENSORS_FILTER_MAX_STAGES stages or a frequency outside (0, Nyquist).
+bool Sensors_SetFilterCascade(Sensors_t *sensors, Sensors_FilterChannel_t channel,
+                              const Sensors_FilterStage_t *stages, int count);
+
+// Drain every IMU sample queued since the last call, filtering it (dynamic
+// notch and cascade on gyro, cascade on accel) and advancing the attitude
+// filter once per sample with its own timestamp. One slice of the notch
+// tracker's FFT runs per call. imu_data receives the newest
+// sample; returns false if none arrived. roll/pitch/yaw are not recomputed
+// here; they hold the angles from the last Sensors_ComputeEulerAngles call,
+// which should be made only when needed. Returns false without draining
+// for any context other than the one last passed to Sensors_Init.
+bool Sensors_UpdateIMU(Sensors_t *sensors, IMU_Data_t *imu_data);
+
+// As Sensors_UpdateIMU, for count samples supplied by the caller; safe
+// on any number of contexts at once
+bool Sensors_FeedIMU(Sensors_t *sensors, const IMU_Sample_t *samples, size_t count, IMU_Data_t *imu_data);
+
+// Parse everything the GPS UART received since the last call. Returns true
+// if at least one position message arrived; gps_data then holds the newest.
+bool Sensors_UpdateGPS(Sensors_t *sensors, GPS_Data_t *gps_data);
 
 // Update barometer data, returns true if data valid
-bool Sensors_UpdateBarometer(Barometer_Data_t *baro_data);
+bool Sensors_UpdateBarometer(Sensors_t *sensors, Barometer_Data_t *baro_data);
+
+// As Sensors_UpdateBarometer, for a reading supplied by the caller
+void Sensors_FeedBarometer(Sensors_t *sensors, float pressure, float temperature, Barometer_Data_t *baro_data);
 
 // Optional: Update magnetometer data separately if needed
-bool Sensors_UpdateMagnetometer(Magnetometer_Data_t *mag_data);
+bool Sensors_UpdateMagnetometer(Sensors_t *sensors, Magnetometer_Data_t *mag_data);
+
+// Fill roll/pitch/yaw (degrees) from the current attitude estimate
+void Sensors_ComputeEulerAngles(Sensors_t *sensors, IMU_Data_t *imu);
+
+// Current attitude quaternion (body to earth)
+Quaternion_t Sensors_GetAttitude(const Sensors_t *sensors);
+
+// Altitude (m) and climb rate (m/s, positive up) from the vertical
+// estimator; false until the first baro sample
+bool Sensors_GetVertical(const Sensors_t *sensors, float *altitude, float *climb_rate);
+
+// Reference for pressure (hPa) and air temperature (Celsius) measured at
+// altitude (m), e.g. the launch point before take-off
+Sensors_BaroReference_t Sensors_MakeBaroReference(float pressure, float temperature, float altitude);
+
+// Measure baro altitudes against a new reference from now on. The
+// vertical estimator moves with it, so the climb rate sees no step.
+void Sensors_SetBaroReference(Sensors_t *sensors, const Sensors_BaroReference_t *reference);
+
+// Altitude (m) of a static pressure (hPa) against a reference, in a
+// troposphere with the standard lapse rate. A table and a cubic instead
+// of powf; within 1 cm of the exact expression for pressures from 1/16
+// to twice the reference.
+float Sensors_BaroAltitude(const Sensors_BaroReference_t *reference, float pressure);
+
+// Convert static pressure (hPa) to altitude (m) in the standard atmosphere
+float Sensors_PressureToAltitude(float pressure);
 
 #endif // SENSORS_H
@@ -0,0 +1,74 @@
+/*
+ * spsc_ring.h - Wait-free single-producer/single-consumer ring for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Fixed-capacity queue between exactly one producer (an ISR, DMA callback
+ * or host thread) and one consumer (a scheduler task). Each side owns one
+ * index and only reads the other, so push and pop are a bounded number of
+ * loads and stores with no locks, retries or disabled interrupts.
+ *
+ * Indices run freely and wrap at 2^32; capacity must be a power of two so
+ * the slot is a mask away. A full ring rejects the push instead of
+ * overwriting, leaving the oldest unread data intact.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+template <typename T, uint32_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+    static constexpr uint32_t kCapacity = N;
+
+    // Discard all contents. Only safe while neither side is running.
+    void Reset() {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+    // Producer side. Returns false (and stores nothing) if the ring is full.
+    bool Push(const T &item) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        if (head - tail == N) return false;
+
+        slots_[head & (N - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Copies up to max items in FIFO order, returns the count.
+    size_t PopBatch(T *out, size_t max) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        uint32_t head = head_.load(std::memory_order_acquire);
+        uint32_t available = head - tail;
+        uint32_t count = (available < max) ? available : (uint32_t)max;
+
+        for (uint32_t i = 0; i < count; i++) {
+            out[i] = slots_[(tail + i) & (N - 1)];
+        }
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Items currently queued (exact from either side, approximate elsewhere)
+    uint32_t Size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    // Separate cache lines so the two sides never false-share
+    alignas(64) std::atomic<uint32_t> head_{0};   // Written by the producer
+    alignas(64) std::atomic<uint32_t> tail_{0};   // Written by the consumer
+    alignas(64) T slots_[N];
+};
+
+#endif // SPSC_RING_H
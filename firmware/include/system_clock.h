@@ -0,0 +1,44 @@
+/*
+ * system_clock.h - Monotonic time base for TMF drone firmware
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * All loop pacing and timestamps go through this module so the time source
+ * can be swapped at runtime. On target the default source is the Cortex-M7
+ * DWT cycle counter; the host build injects a virtual clock that advances
+ * instantly when the firmware sleeps, so hours of flight run in seconds.
+ */
+
+#ifndef SYSTEM_CLOCK_H
+#define SYSTEM_CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Pluggable time source
+typedef struct {
+    uint64_t (*now_us)(void);                  // Monotonic microseconds since start
+    void (*sleep_until_us)(uint64_t deadline); // Block until now_us() >= deadline
+} SystemClock_Source_t;
+
+// Initialize the default (hardware) time source
+void SystemClock_Init(void);
+
+// Replace the active time source (NULL restores the hardware default)
+void SystemClock_SetSource(const SystemClock_Source_t *source);
+
+// Current monotonic time in microseconds
+uint64_t SystemClock_Micros(void);
+
+// Sleep until the absolute deadline; returns immediately if already past
+void SystemClock_SleepUntil(uint64_t deadline_us);
+
+// Optional run limit in microseconds (0 = run forever). Used by host builds
+// to end the otherwise infinite control loop after a simulated duration.
+void SystemClock_SetRunLimit(uint64_t limit_us);
+
+// True while the run limit has not been reached
+bool SystemClock_ShouldRun(void);
+
+#endif // SYSTEM_CLOCK_H
@@ -0,0 +1,158 @@
+/*
+ * telemetry.h - Prioritized, rate-limited binary telemetry for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Each stream names a live firmware struct (IMU_Data_t, Velocity_t,
+ * Motor_Output_t, ...), a maximum rate and a priority. Telemetry_Service,
+ * run from a low-rate task, sends every due stream in priority order,
+ * serializing straight from the source struct into a preallocated TX
+ * ring that the radio UART drains by DMA. There is no staging copy: the
+ * payload is the struct's in-memory (little-endian) layout.
+ *
+ * Link budget: a token bucket refilled at TELEMETRY_BUDGET_BYTES_PER_S
+ * (below the UART byte rate) and capped at TELEMETRY_BURST_BYTES gates
+ * every frame, and a frame is only written if it fits in the ring. When a
+ * due frame does not fit, it and every lower-priority stream wait for a
+ * later pass (counted as deferred), so higher priorities always get the
+ * bandwidth first and the radio is never handed more than it can send.
+ * Each pass does O(streams) work and copies at most one burst.
+ *
+ * Uplink: the ground sends frames the same way. Telemetry_Receive hands
+ * them over one at a time from the telemetry task, which is the
+ * parameter store's tuner context: PARAM_SET stages a value by name hash,
+ * PARAM_COMMIT publishes the staged values to the control loop's next
+ * frame and PARAM_SAVE queues them for flash. The result of the last
+ * command goes back in the diagnostics stream.
+ *
+ * Frame:
+ *   0      TELEMETRY_SYNC
+ *   1      payload length
+ *   2      message id (Telemetry_MessageId_t)
+ *   3      sequence number (per link, wraps)
+ *   4..    payload
+ *   n, n+1 CRC-16/CCITT-FALSE over bytes 1 .. n-1, little-endian
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TELEMETRY_SYNC               0xA5
+#define TELEMETRY_OVERHEAD           6
+#define TELEMETRY_MAX_PAYLOAD        64
+#define TELEMETRY_MAX_STREAMS        8
+#define TELEMETRY_TX_RING_SIZE       1024    // Power of two
+#define TELEMETRY_BUDGET_BYTES_PER_S 5000    // 87% of a 57600 baud 8N1 link
+#define TELEMETRY_BURST_BYTES        256
+
+typedef enum {
+    TELEMETRY_MSG_ATTITUDE = 1,     // IMU_Data_t
+    TELEMETRY_MSG_VELOCITY = 2,     // Velocity_t (NED)
+    TELEMETRY_MSG_POSITION = 3,     // Position_t
+    TELEMETRY_MSG_MOTORS = 4,       // Motor_Output_t
+    TELEMETRY_MSG_DIAGNOSTICS = 5,  // Telemetry_Diagnostics_t
+
+    // Ground to vehicle
+    TELEMETRY_MSG_PARAM_SET = 16,     // Telemetry_ParamSet_t
+    TELEMETRY_MSG_PARAM_COMMIT = 17,  // No payload
+    TELEMETRY_MSG_PARAM_SAVE = 18,    // No payload
+} Telemetry_MessageId_t;
+
+// Outcome of the last uplink command, reported in the diagnostics stream
+typedef enum {
+    TELEMETRY_UPLINK_NONE = 0,
+    TELEMETRY_UPLINK_OK = 1,
+    TELEMETRY_UPLINK_UNKNOWN = 2,   // Unknown message or parameter, or a bad payload
+    TELEMETRY_UPLINK_REJECTED = 3,  // Out of range, nothing staged, or the store is busy
+} Telemetry_UplinkResult_t;
+
+typedef struct {
+    uint32_t hash;                  // Params_Hash of the name
+    uint32_t value;                 // Float bits or int32, as the parameter's type
+} Telemetry_ParamSet_t;
+
+// Health counters gathered by the main loop for the diagnostics stream
+typedef struct {
+    uint32_t uptime_ms;
+    uint32_t deadline_misses;       // Sum over scheduler tasks
+    uint32_t imu_dropped;
+    uint32_t blackbox_dropped;
+    uint32_t telemetry_deferred;
+    uint8_t health_ok;              // PowerMonitor_CheckHealth
+    uint8_t geofence;               // 0 clear or no fence, 1 breach predicted ahead, 2 breached
+    uint8_t uplink;                 // Telemetry_UplinkResult_t
+    uint8_t reserved;
+} Telemetry_Diagnostics_t;
+
+typedef struct {
+    uint32_t frames_sent;
+    uint32_t bytes_sent;
+    uint32_t deferred;              // Passes where the stream was due but held back
+} Telemetry_StreamStats_t;
+
+typedef struct {
+    uint32_t frames_sent;
+    uint32_t bytes_queued;
+    uint32_t deferred;
+    uint32_t max_ring_depth;
+    uint32_t demand_bytes_per_s;    // What the registered streams ask for
+} Telemetry_Stats_t;
+
+// Frame parser: ground side, and the vehicle's uplink
+typedef struct {
+    uint8_t state;
+    uint8_t length;
+    uint8_t index;
+    uint8_t buffer[TELEMETRY_MAX_PAYLOAD + 4];   // length, id, sequence, payload
+    uint8_t message_id;
+    uint8_t sequence;
+    const uint8_t *payload;          // Valid after Telemetry_ParseByte returns true
+    uint32_t frames;
+    uint32_t crc_errors;
+    uint32_t lost;                   // Gaps in the sequence numbers
+    bool have_sequence;
+} Telemetry_Parser_t;
+
+// Clear streams and the TX ring and bring up the radio link
+bool Telemetry_Init(void);
+
+// Register a stream. source must stay valid and is read at send time;
+// priority 0 is the highest. Returns false if the table is full, the
+// payload is too large or the rate is not positive.
+bool Telemetry_AddStream(Telemetry_MessageId_t id, const void *source, uint8_t size,
+                         float rate_hz, uint8_t priority);
+
+// Send due streams within the link budget and keep the TX DMA going.
+// Sources are read here, so call it from a task that does not preempt
+// their writers.
+void Telemetry_Service(void);
+
+void Telemetry_GetStats(Telemetry_Stats_t *stats);
+
+// Parse received uplink bytes until a frame completes; true with the frame
+// in parser, false once everything received so far is used up. Call it
+// repeatedly from the telemetry task.
+bool Telemetry_Receive(Telemetry_Parser_t *parser);
+
+// Statistics for one message id, returns false if it is not registered
+bool Telemetry_GetStreamStats(Telemetry_MessageId_t id, Telemetry_StreamStats_t *stats);
+
+// CRC-16/CCITT-FALSE (poly 0x1021), continue from crc (start at 0xFFFF)
+uint16_t Telemetry_Crc16(uint16_t crc, const uint8_t *data, size_t length);
+
+void Telemetry_ParserInit(Telemetry_Parser_t *parser);
+
+// Feed one received byte; true when a frame with a valid CRC completed
+bool Telemetry_ParseByte(Telemetry_Parser_t *parser, uint8_t byte);
+
+// Write one frame into out (length + TELEMETRY_OVERHEAD bytes); returns
+// the frame length, or 0 if the payload is too long
+size_t Telemetry_EncodeFrame(uint8_t id, uint8_t sequence, const void *payload, uint8_t length,
+                             uint8_t *out);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,168 @@
+/*
+ * terrain.h - Digital elevation model and terrain following for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * The DEM is a regular latitude/longitude grid of height posts cut into
+ * square tiles of TERRAIN_TILE_POSTS posts a side. Neighbouring tiles
+ * share their edge posts, so a bilinear lookup never leaves its tile.
+ * Tiles are stored compressed in the terrain partition of the logging
+ * flash (on the host that flash is a memory-mapped file, TMF_FLASH_FILE)
+ * and decoded into a fixed LRU cache of TERRAIN_CACHE_TILES tiles.
+ *
+ * Lookups only read the cache and never touch storage: a miss returns
+ * false and queues the tile. Terrain_Service loads one queued tile per
+ * call while the flash is idle, in the same way missions are streamed
+ * between blackbox programs. Terrain_Prefetch queues the tiles along a
+ * path, so the tiles around the active leg are decoded before the
+ * vehicle reaches them.
+ *
+ * Store layout, little-endian:
+ *   header  'T' 'M' 'F' 'T', version u16, tile posts u16,
+ *           south-west post latitude and longitude i32 (1e-7 deg),
+ *           post spacing in latitude and longitude u32 (1e-9 deg),
+ *           tiles north u16, tiles east u16, 2 bytes padding,
+ *           CRC-16 u16 over the preceding 30 bytes
+ *   index   one entry per tile, row-major from the south-west:
+ *           offset from the store start u32, length u16, 2 bytes padding
+ *   tile    lowest height i32 (0.1 m), residual width u8, 1 byte padding,
+ *           CRC-16 u16 over the residuals, then one residual per post,
+ *           row-major, each `width` bits, LSB first
+ * Heights are decimetres above the tile's lowest post. Each residual is
+ * the zig-zag coded difference from the JPEG-LS median predictor over
+ * the west, south and south-west posts (the one neighbour on the first
+ * row and column), so smooth terrain packs into a few bits a post.
+ *
+ * Everything lives in Terrain_t; there is no heap and no global state.
+ */
+
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "local_frame.h"
+#include "nav_types.h"
+
+#define TERRAIN_VERSION            1
+#define TERRAIN_TILE_POSTS         33       // 32 x 32 cells, shared edges
+#define TERRAIN_TILE_CELLS         (TERRAIN_TILE_POSTS - 1)
+#define TERRAIN_CACHE_TILES        12
+#define TERRAIN_QUEUE              8        // Tiles waiting to be loaded
+#define TERRAIN_PREFETCH_TILES     8        // Distinct tiles queued or kept per prefetch
+
+#define TERRAIN_HEADER_BYTES       32
+#define TERRAIN_INDEX_BYTES        8
+#define TERRAIN_TILE_HEADER_BYTES  8
+#define TERRAIN_MAX_RESIDUAL_BITS  17
+#define TERRAIN_MAX_TILE_BYTES     (TERRAIN_TILE_HEADER_BYTES + \
+                                    (TERRAIN_TILE_POSTS * TERRAIN_TILE_POSTS * TERRAIN_MAX_RESIDUAL_BITS + 7) / 8)
+
+// Terrain following: the ground the vehicle flies over is the highest
+// terrain within TERRAIN_LOOKAHEAD_S along its horizontal velocity, less
+// what climbing at TERRAIN_CLIMB_ALLOWANCE would gain by then
+#define TERRAIN_LOOKAHEAD_S        5.0f
+#define TERRAIN_LOOKAHEAD_SAMPLES  10
+#define TERRAIN_CLIMB_ALLOWANCE    1.5f     // m/s
+#define TERRAIN_RATE_TAU_S         0.5f     // Ground rate low-pass
+
+typedef struct {
+    double origin_latitude;     // South-west post, degrees
+    double origin_longitude;
+    double spacing_latitude;    // Degrees between posts
+    double spacing_longitude;
+    uint32_t tiles_north;
+    uint32_t tiles_east;
+} Terrain_Grid_t;
+
+typedef struct {
+    int32_t key;                // Tile row * tiles_east + column, -1 when empty
+    uint32_t last_used;         // LRU stamp
+    float base_m;               // Height of the lowest post (m)
+    uint16_t posts[TERRAIN_TILE_POSTS * TERRAIN_TILE_POSTS];   // Decimetres above base, row-major from the south
+} Terrain_Tile_t;
+
+typedef struct {
+    uint32_t lookups;
+    uint32_t misses;            // Tile not cached (queued instead)
+    uint32_t outside;           // Position not covered by the DEM
+    uint32_t loads;
+    uint32_t load_errors;       // Bad index entry or tile CRC
+    uint32_t evictions;
+    uint32_t deferred;          // Service calls that found the flash busy
+    uint32_t queue_full;        // Tile requests dropped
+} Terrain_Stats_t;
+
+typedef struct Terrain {
+    Terrain_Grid_t grid;
+    uint32_t address;                       // Store start in the logging flash (Terrain_Open)
+    double posts_per_deg_lat;
+    double posts_per_deg_lon;
+    LocalFrame_t frame;                     // Metres per degree near the DEM
+
+    Terrain_Tile_t cache[TERRAIN_CACHE_TILES];
+    uint32_t clock;
+    uint32_t last_slot;                     // Most recent hit, tried first
+
+    int32_t queue[TERRAIN_QUEUE];           // Tile keys, next to load first
+    uint32_t queue_count;
+
+    uint8_t scratch[TERRAIN_MAX_TILE_BYTES];
+    Terrain_Stats_t stats;
+    bool from_flash;
+} Terrain_t;
+
+typedef struct {
+    float ground_alt;           // Ground to fly above (m above sea level)
+    float ground_rate;          // Its rate of change (m/s, rising positive)
+    uint32_t stale;             // Consecutive updates without terrain under the vehicle
+    bool valid;
+} TerrainFollower_t;
+
+// Set up from a grid description with an empty cache. Tiles then come
+// from Terrain_LoadTile (or the flash, if opened with Terrain_Open).
+void Terrain_Init(Terrain_t *terrain, const Terrain_Grid_t *grid);
+
+// Open the store at address in the logging flash; false if there is no
+// valid header there
+bool Terrain_Open(Terrain_t *terrain, uint32_t address);
+
+// Height (m above sea level) at a position by bilinear interpolation.
+// Never blocks: returns false if the tile is not cached, and queues it.
+bool Terrain_Height(Terrain_t *terrain, double latitude, double longitude, float *height);
+
+// Queue (or keep cached) the tiles along the line from -> to, nearest
+// first, up to TERRAIN_PREFETCH_TILES of them
+void Terrain_Prefetch(Terrain_t *terrain, const Position_t *from, const Position_t *to);
+
+// Load at most one queued tile from the flash, if it is idle. Returns
+// true if a tile was loaded.
+bool Terrain_Service(Terrain_t *terrain);
+
+// Decode a tile into the cache, evicting the least recently used one.
+// false on a malformed tile.
+bool Terrain_LoadTile(Terrain_t *terrain, uint32_t key, const uint8_t *data, uint32_t length);
+
+// Encode the header, an index entry or a tile of the store layout. The
+// tile takes heights in metres, row-major from the south-west post, and
+// returns its length in bytes (0 if the heights span more than 6.5 km).
+void Terrain_EncodeHeader(const Terrain_Grid_t *grid, uint8_t header[TERRAIN_HEADER_BYTES]);
+void Terrain_EncodeIndex(uint32_t offset, uint32_t length, uint8_t entry[TERRAIN_INDEX_BYTES]);
+uint32_t Terrain_EncodeTile(const float heights[TERRAIN_TILE_POSTS * TERRAIN_TILE_POSTS],
+                            uint8_t out[TERRAIN_MAX_TILE_BYTES]);
+
+// Decode a header; false if malformed
+bool Terrain_DecodeHeader(const uint8_t header[TERRAIN_HEADER_BYTES], Terrain_Grid_t *grid);
+
+// Start following terrain from scratch
+void TerrainFollower_Reset(TerrainFollower_t *follower);
+
+// Update the ground for a vehicle at position moving at velocity_ne
+// (m/s) over the last dt seconds, and prefetch the tiles ahead. Without
+// terrain under the vehicle the ground is held (never lowered) and false
+// is returned.
+bool TerrainFollower_Update(TerrainFollower_t *follower, Terrain_t *terrain, const Position_t *position,
+                            const float velocity_ne[2], float dt);
+
+#endif // TERRAIN_H
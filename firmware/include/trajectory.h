@@ -0,0 +1,131 @@
+/*
+ * trajectory.h - Minimum-snap trajectory planner for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Turns a streamed waypoint list into piecewise 7th-order polynomials in
+ * N/E/D that pass through every waypoint with continuous velocity,
+ * acceleration and jerk and the least integrated snap. Smooth
+ * feed-forward lets the position loop stay soft, so legs can be flown
+ * fast without the acceleration spikes of point-to-point steering.
+ *
+ * Planning is receding-horizon. Each plan optimizes a window of up to
+ * TRAJECTORY_WINDOW_LEGS segments from the current planning knot (its
+ * velocity, acceleration and jerk are fixed by the previous segment) and
+ * commits only the first, so a plan never needs more than a few
+ * waypoints in RAM. The window ends early at a stop knot (a waypoint with
+ * a hold time, or the last one), which is flown to rest. Legs longer than
+ * TRAJECTORY_SPLIT_DISTANCE become several segments, so a long leg can
+ * cruise instead of following one polynomial's bell-shaped speed.
+ * Interior knot derivatives are the unknowns: at most 12 of them, solved
+ * with one Cholesky factorization shared by the three axes. Segment
+ * times start from a trapezoidal speed profile and are rescaled, a few
+ * times at most, until each segment just meets the speed and
+ * acceleration limits.
+ *
+ * A plan takes about 10 us on the bench host and happens once per
+ * segment; evaluating the active segment is three Horner passes per axis
+ * (about 25 ns).
+ *
+ * Everything lives in TrajectoryPlanner_t; there is no heap and no
+ * global state beyond constant tables built at start-up.
+ */
+
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "local_frame.h"
+#include "mission.h"
+#include "nav_types.h"
+
+#define TRAJECTORY_COEFFS        8        // 7th-order polynomial
+#define TRAJECTORY_WINDOW_LEGS   4        // Legs optimized per plan
+#define TRAJECTORY_QUEUE         3        // Segments planned ahead, including the active one
+#define TRAJECTORY_CACHE         8        // Waypoints read ahead from the mission source
+
+#define TRAJECTORY_CRUISE_SPEED  15.0f    // m/s
+#define TRAJECTORY_MAX_ACCEL     4.0f     // m/s^2
+#define TRAJECTORY_MIN_SEGMENT_S 1.0f
+#define TRAJECTORY_SPLIT_DISTANCE 60.0f   // Longer legs are flown as several segments (m)
+#define TRAJECTORY_HOLD_RADIUS   2.0f     // Hold time only counts inside this distance (m)
+#define TRAJECTORY_SLOW_ERROR    3.0f     // Reference time slows beyond this tracking error (m)...
+#define TRAJECTORY_STOP_ERROR    10.0f    // ...and stops at this one
+
+typedef struct {
+    LocalFrame_t frame;                     // Anchored at the segment start
+    float coeff[3][TRAJECTORY_COEFFS];      // NED position (m) in tau = t / duration
+    float duration_s;
+    Waypoint_t target;                      // Waypoint the segment ends at
+    uint32_t target_index;
+    bool stop;                              // Comes to rest at the end
+} Trajectory_Segment_t;
+
+typedef struct {
+    float position_error[3];      // Reference minus vehicle, NED (m)
+    float velocity[3];            // Feed-forward, NED (m/s)
+    float acceleration[3];        // Feed-forward, NED (m/s^2)
+    const Waypoint_t *target;     // Waypoint being flown to (NULL before the first plan)
+    uint32_t target_index;
+    bool holding;                 // At rest on a stop knot
+    bool complete;                // Last waypoint reached and held
+} Trajectory_Setpoint_t;
+
+typedef struct {
+    uint32_t segments;            // Segments planned
+    uint32_t solves;              // Window solves, including stretch retries
+    uint32_t stretched;           // Plans whose times were stretched to meet the limits
+    uint32_t starved;             // Segment ended before the next one was planned
+    uint32_t waypoints_read;
+    bool source_failed;           // Mission cut short at a corrupt record
+} Trajectory_Stats_t;
+
+typedef struct {
+    Mission_Source_t source;
+    uint32_t mission_count;       // Waypoints that will be flown
+
+    // Read-ahead: waypoints [cache_first, cache_first + cache_count)
+    Waypoint_t cache[TRAJECTORY_CACHE];
+    uint32_t cache_first;
+    uint32_t cache_count;
+
+    // Planning knot: where the next segment starts
+    Position_t plan_position;
+    float plan_derivatives[3][3];   // Velocity, acceleration, jerk per NED axis
+    uint32_t plan_next;             // Waypoint the next segment ends at
+
+    Trajectory_Segment_t queue[TRAJECTORY_QUEUE];
+    uint32_t queue_head;
+    uint32_t queue_count;
+
+    // Flying the head segment
+    float segment_time;             // Reference time into the segment (s)
+    float hold_elapsed;             // Time at rest within the hold radius (s)
+    uint64_t last_sample_us;
+    bool starving;                  // Waiting at a segment end for the next plan
+    bool complete;
+
+    Trajectory_Stats_t stats;
+} TrajectoryPlanner_t;
+
+// Begin a mission from the vehicle's position and NED velocity (m/s). The
+// source is copied; its backing store must outlive the mission.
+void TrajectoryPlanner_Start(TrajectoryPlanner_t *planner, const Mission_Source_t *source,
+                             const Position_t *start, const float velocity[3], uint64_t now_us);
+
+// Plan at most one segment if the queue has room. Returns true if it did.
+bool TrajectoryPlanner_Service(TrajectoryPlanner_t *planner);
+
+// Reference at now_us for a vehicle at position. Advances through the
+// queue, counts hold time and slows the reference when tracking lags.
+void TrajectoryPlanner_Sample(TrajectoryPlanner_t *planner, uint64_t now_us, const Position_t *position,
+                              Trajectory_Setpoint_t *setpoint);
+
+// Position (m), velocity (m/s) and acceleration (m/s^2) of a segment at
+// t seconds from its start, in its frame; any output may be NULL
+void Trajectory_Evaluate(const Trajectory_Segment_t *segment, float t, float position[3],
+                         float velocity[3], float acceleration[3]);
+
+#endif // TRAJECTORY_H
@@ -0,0 +1,55 @@
+/*
+ * vertical_estimator.h - Altitude and climb rate from accel and baro
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Third-order complementary filter on the vertical channel. Every IMU
+ * sample integrates the earth-frame vertical acceleration into climb rate
+ * and altitude; every baro sample becomes the altitude the integration is
+ * pulled towards. The error between the two feeds back into altitude,
+ * climb rate and an accelerometer bias estimate with gains set by one
+ * time constant:
+ *   k1 = 3 / tau,  k2 = 3 / tau^2,  k3 = 1 / tau^3
+ * (all three closed-loop poles at -1 / tau). Below 1 / tau the output
+ * follows the baro, above it the accelerometer, so the climb rate is
+ * available at the IMU rate without differentiating the baro and the
+ * altitude does not lag behind it by the baro's noise filtering.
+ *
+ * The update is a handful of multiply-adds per sample and has no state
+ * beyond the struct, so it runs inside the IMU sample loop.
+ */
+
+#ifndef VERTICAL_ESTIMATOR_H
+#define VERTICAL_ESTIMATOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define VERT_EST_DEFAULT_TAU_S  1.0f
+
+typedef struct {
+    float altitude;         // m, on the baro's datum
+    float climb_rate;       // m/s, positive up
+    float accel_bias;       // m/s^2, added to the measured acceleration
+    float baro_altitude;    // Newest baro altitude, held until the next one
+    float k1, k2, k3;
+    bool initialized;       // Set by the first baro sample
+    uint32_t baro_samples;
+} VertEst_t;
+
+// Reset to uninitialized with the given time constant (s)
+void VertEst_Init(VertEst_t *est, float tau_s);
+
+// Integrate dt seconds of vertical acceleration (m/s^2, positive up,
+// gravity removed). Does nothing before the first baro sample.
+void VertEst_Predict(VertEst_t *est, float accel_up, float dt);
+
+// New baro altitude (m); the first one also sets the altitude
+void VertEst_FuseBaro(VertEst_t *est, float altitude);
+
+// Move the altitude datum by delta metres (the baro reference changed),
+// without disturbing the climb rate
+void VertEst_Shift(VertEst_t *est, float delta);
+
+#endif // VERTICAL_ESTIMATOR_H
@@ -0,0 +1,159 @@
+/*
+ * ahrs.cpp - Quaternion attitude and heading reference for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Formulation follows Mahony et al., "Nonlinear Complementary Filters on
+ * the Special Orthogonal Group" (2008), with the magnetometer reference
+ * rebuilt each step so only its horizontal direction corrects heading.
+ */
+
+#include "ahrs.h"
+#include <math.h>
+
+#define RAD2DEG 57.2957795f
+
+// Accelerometer correction is skipped outside 0.5 g .. 1.5 g (squared
+// ratios), with 1 g the magnitude learned at alignment
+#define ACCEL_TRUST_MIN_SQ  0.25f
+#define ACCEL_TRUST_MAX_SQ  2.25f
+
+void AHRS_Init(AHRS_State_t *ahrs, float kp, float ki) {
+    ahrs->q.w = 1.0f;
+    ahrs->q.x = 0.0f;
+    ahrs->q.y = 0.0f;
+    ahrs->q.z = 0.0f;
+    ahrs->kp = kp;
+    ahrs->ki = ki;
+    ahrs->bias_x = 0.0f;
+    ahrs->bias_y = 0.0f;
+    ahrs->bias_z = 0.0f;
+    ahrs->gravity_sq = 0.0f;
+    ahrs->aligned = false;
+}
+
+void AHRS_Align(AHRS_State_t *ahrs, float ax, float ay, float az,
+                float mx, float my, float mz) {
+    ahrs->gravity_sq = ax * ax + ay * ay + az * az;   // At rest this is 1 g
+    float roll = atan2f(ay, az);
+    float pitch = atan2f(-ax, sqrtf(ay * ay + az * az));
+
+    // Tilt-compensated heading
+    float sr = sinf(roll), cr = cosf(roll);
+    float sp = sinf(pitch), cp = cosf(pitch);
+    float bx = mx * cp + my * sr * sp + mz * cr * sp;
+    float by = my * cr - mz * sr;
+    float yaw = (bx != 0.0f || by != 0.0f) ? atan2f(-by, bx) : 0.0f;
+
+    float hr = 0.5f * roll, hp = 0.5f * pitch, hy = 0.5f * yaw;
+    float c1 = cosf(hr), s1 = sinf(hr);
+    float c2 = cosf(hp), s2 = sinf(hp);
+    float c3 = cosf(hy), s3 = sinf(hy);
+
+    ahrs->q.w = c1 * c2 * c3 + s1 * s2 * s3;
+    ahrs->q.x = s1 * c2 * c3 - c1 * s2 * s3;
+    ahrs->q.y = c1 * s2 * c3 + s1 * c2 * s3;
+    ahrs->q.z = c1 * c2 * s3 - s1 * s2 * c3;
+    ahrs->aligned = true;
+}
+
+void AHRS_Update(AHRS_State_t *ahrs, float gx, float gy, float gz,
+                 float ax, float ay, float az,
+                 float mx, float my, float mz, float dt) {
+    float q0 = ahrs->q.w, q1 = ahrs->q.x, q2 = ahrs->q.y, q3 = ahrs->q.z;
+    float ex = 0.0f, ey = 0.0f, ez = 0.0f;
+
+    // Never aligned: the first reading stands in for 1 g
+    float a_sq = ax * ax + ay * ay + az * az;
+    if (ahrs->gravity_sq == 0.0f) ahrs->gravity_sq = a_sq;
+    if (a_sq > ACCEL_TRUST_MIN_SQ * ahrs->gravity_sq && a_sq < ACCEL_TRUST_MAX_SQ * ahrs->gravity_sq) {
+        float inv = 1.0f / sqrtf(a_sq);
+        ax *= inv;
+        ay *= inv;
+        az *= inv;
+
+        // Estimated gravity direction (half magnitude)
+        float vx = q1 * q3 - q0 * q2;
+        float vy = q0 * q1 + q2 * q3;
+        float vz = q0 * q0 - 0.5f + q3 * q3;
+
+        ex = ay * vz - az * vy;
+        ey = az * vx - ax * vz;
+        ez = ax * vy - ay * vx;
+
+        float m_sq = mx * mx + my * my + mz * mz;
+        if (m_sq > 0.0f) {
+            inv = 1.0f / sqrtf(m_sq);
+            mx *= inv;
+            my *= inv;
+            mz *= inv;
+
+            float q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+            float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+            float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+
+            // Earth-frame field, folded into the x-z plane
+            float hx = 2.0f * (mx * (0.5f - q2q2 - q3q3) + my * (q1q2 - q0q3) + mz * (q1q3 + q0q2));
+            float hy = 2.0f * (mx * (q1q2 + q0q3) + my * (0.5f - q1q1 - q3q3) + mz * (q2q3 - q0q1));
+            float bx = sqrtf(hx * hx + hy * hy);
+            float bz = 2.0f * (mx * (q1q3 - q0q2) + my * (q2q3 + q0q1) + mz * (0.5f - q1q1 - q2q2));
+
+            // Estimated field direction in body frame (half magnitude)
+            float wx = bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2);
+            float wy = bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3);
+            float wz = bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2);
+
+            ex += my * wz - mz * wy;
+            ey += mz * wx - mx * wz;
+            ez += mx * wy - my * wx;
+        }
+
+        // Error terms above are half-scale
+        ex *= 2.0f;
+        ey *= 2.0f;
+        ez *= 2.0f;
+
+        if (ahrs->ki > 0.0f) {
+            ahrs->bias_x += ahrs->ki * ex * dt;
+            ahrs->bias_y += ahrs->ki * ey * dt;
+            ahrs->bias_z += ahrs->ki * ez * dt;
+        }
+    }
+
+    gx += ahrs->bias_x + ahrs->kp * ex;
+    gy += ahrs->bias_y + ahrs->kp * ey;
+    gz += ahrs->bias_z + ahrs->kp * ez;
+
+    // First-order quaternion integration: q += 0.5 * q (x) omega * dt
+    float half_dt = 0.5f * dt;
+    gx *= half_dt;
+    gy *= half_dt;
+    gz *= half_dt;
+
+    float nq0 = q0 - q1 * gx - q2 * gy - q3 * gz;
+    float nq1 = q1 + q0 * gx + q2 * gz - q3 * gy;
+    float nq2 = q2 + q0 * gy - q1 * gz + q3 * gx;
+    float nq3 = q3 + q0 * gz + q1 * gy - q2 * gx;
+
+    float inv = 1.0f / sqrtf(nq0 * nq0 + nq1 * nq1 + nq2 * nq2 + nq3 * nq3);
+    ahrs->q.w = nq0 * inv;
+    ahrs->q.x = nq1 * inv;
+    ahrs->q.y = nq2 * inv;
+    ahrs->q.z = nq3 * inv;
+}
+
+void AHRS_GetEuler(const AHRS_State_t *ahrs, float *roll, float *pitch, float *yaw) {
+    float q0 = ahrs->q.w, q1 = ahrs->q.x, q2 = ahrs->q.y, q3 = ahrs->q.z;
+
+    float sinp = 2.0f * (q0 * q2 - q3 * q1);
+    if (sinp > 1.0f) sinp = 1.0f;
+    else if (sinp < -1.0f) sinp = -1.0f;
+
+    *roll = atan2f(2.0f * (q0 * q1 + q2 * q3), 1.0f - 2.0f * (q1 * q1 + q2 * q2)) * RAD2DEG;
+    *pitch = asinf(sinp) * RAD2DEG;
+
+    // NWU yaw is counter-clockwise; report it as a compass heading
+    float heading = -atan2f(2.0f * (q0 * q3 + q1 * q2), 1.0f - 2.0f * (q2 * q2 + q3 * q3)) * RAD2DEG;
+    *yaw = (heading < 0.0f) ? heading + 360.0f : heading;
+}
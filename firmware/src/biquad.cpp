@@ -0,0 +1,46 @@
+/*
+ * biquad.cpp - Second-order IIR filter sections for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ */
+
+#include "biquad.h"
+#include <math.h>
+
+#define TWO_PI 6.28318530718f
+
+static void set_coefficients(Biquad_t *filter, float b0, float b1, float b2,
+                             float a0, float a1, float a2);
+
+void Biquad_Reset(Biquad_t *filter) {
+    filter->z1 = 0.0f;
+    filter->z2 = 0.0f;
+}
+
+void Biquad_SetLowpass(Biquad_t *filter, float cutoff_hz, float sample_hz, float q) {
+    float omega = TWO_PI * cutoff_hz / sample_hz;
+    float cs = cosf(omega);
+    float alpha = sinf(omega) / (2.0f * q);
+
+    set_coefficients(filter, 0.5f * (1.0f - cs), 1.0f - cs, 0.5f * (1.0f - cs),
+                     1.0f + alpha, -2.0f * cs, 1.0f - alpha);
+}
+
+void Biquad_SetNotch(Biquad_t *filter, float center_hz, float sample_hz, float q) {
+    float omega = TWO_PI * center_hz / sample_hz;
+    float cs = cosf(omega);
+    float alpha = sinf(omega) / (2.0f * q);
+
+    set_coefficients(filter, 1.0f, -2.0f * cs, 1.0f, 1.0f + alpha, -2.0f * cs, 1.0f - alpha);
+}
+
+static void set_coefficients(Biquad_t *filter, float b0, float b1, float b2,
+                             float a0, float a1, float a2) {
+    float inv_a0 = 1.0f / a0;
+    filter->b0 = b0 * inv_a0;
+    filter->b1 = b1 * inv_a0;
+    filter->b2 = b2 * inv_a0;
+    filter->a1 = a1 * inv_a0;
+    filter->a2 = a2 * inv_a0;
+}
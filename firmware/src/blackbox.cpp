@@ -0,0 +1,381 @@
+/*
+ * blackbox.cpp - Onboard flight data recorder for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Frame formats (all integers LEB128 varints, signed ones zigzag mapped):
+ *   'H' "TMFB" version field_count
+ *   'I' time_us q[0] .. q[N-1]                 absolute values
+ *   'P' dt_us (q[0]-p[0]) .. (q[N-1]-p[N-1])   deltas from the previous frame
+ * q[i] = round(value * scale[i]). Deltas wrap modulo 2^32 so any jump
+ * round-trips exactly.
+ *
+ * The control loop owns the half being filled; Blackbox_Service owns a
+ * half from the moment its length is published in pending_length until
+ * it stores 0 there again.
+ */
+
+#include "blackbox.h"
+#include "hardware_drivers.h"
+#include <atomic>
+#include <stddef.h>
+#include <string.h>
+
+#define BLACKBOX_VERSION  1
+
+static const uint8_t header_magic[4] = { 'T', 'M', 'F', 'B' };
+
+typedef struct {
+    size_t offset;       // Byte offset of the float in Blackbox_Frame_t
+    float scale;         // Quantisation steps per unit
+    const char *name;
+} Blackbox_Field_t;
+
+#define FIELD(member, index, scale, name) \
+    { offsetof(Blackbox_Frame_t, member) + (index) * sizeof(float), scale, name }
+
+static const Blackbox_Field_t fields[BLACKBOX_FIELD_COUNT] = {
+    FIELD(gyro, 0, 10.0f, "gyro_x"),           // 0.1 deg/s
+    FIELD(gyro, 1, 10.0f, "gyro_y"),
+    FIELD(gyro, 2, 10.0f, "gyro_z"),
+    FIELD(accel, 0, 1000.0f, "accel_x"),       // mm/s^2
+    FIELD(accel, 1, 1000.0f, "accel_y"),
+    FIELD(accel, 2, 1000.0f, "accel_z"),
+    FIELD(attitude, 0, 100.0f, "roll"),        // 0.01 deg
+    FIELD(attitude, 1, 100.0f, "pitch"),
+    FIELD(attitude, 2, 100.0f, "yaw"),
+    FIELD(command, 0, 100.0f, "cmd_roll"),
+    FIELD(command, 1, 100.0f, "cmd_pitch"),
+    FIELD(command, 2, 100.0f, "cmd_yaw"),
+    FIELD(command, 3, 1000.0f, "cmd_throttle"),
+    FIELD(pid_p, 0, 1000.0f, "p_roll"),        // Controller output units / 1000
+    FIELD(pid_p, 1, 1000.0f, "p_pitch"),
+    FIELD(pid_p, 2, 1000.0f, "p_yaw"),
+    FIELD(pid_i, 0, 1000.0f, "i_roll"),
+    FIELD(pid_i, 1, 1000.0f, "i_pitch"),
+    FIELD(pid_i, 2, 1000.0f, "i_yaw"),
+    FIELD(pid_d, 0, 1000.0f, "d_roll"),
+    FIELD(pid_d, 1, 1000.0f, "d_pitch"),
+    FIELD(pid_d, 2, 1000.0f, "d_yaw"),
+    FIELD(motors, 0, 1000.0f, "motor1"),
+    FIELD(motors, 1, 1000.0f, "motor2"),
+    FIELD(motors, 2, 1000.0f, "motor3"),
+    FIELD(motors, 3, 1000.0f, "motor4"),
+};
+
+// Double buffer
+static uint8_t buffers[2][BLACKBOX_BUFFER_BYTES];
+static uint32_t fill_index = 0;                       // Control loop
+static uint32_t fill_length = 0;                      // Control loop
+static std::atomic<uint32_t> pending_length[2];       // Control loop publishes, service clears
+static Blackbox_Codec_t encoder;
+static bool force_intra = false;
+
+// Flash side, owned by the service
+static uint32_t service_index = 0;      // Half being programmed
+static uint32_t service_offset = 0;     // Bytes of it already programmed
+static uint32_t inflight_length = 0;    // Program in progress
+static uint32_t erased_end = 0;         // Everything below is erased or written
+
+static bool started = false;
+static std::atomic<bool> flash_full{false};
+static Blackbox_Stats_t stats;
+
+static bool hand_off(void);
+static void start_erase(void);
+static void retire_half(void);
+
+/* --- Logger --- */
+
+bool Blackbox_Init(void) {
+    started = false;
+    fill_index = 0;
+    fill_length = 0;
+    pending_length[0].store(0);
+    pending_length[1].store(0);
+    service_index = 0;
+    service_offset = 0;
+    inflight_length = 0;
+    force_intra = false;
+    flash_full.store(false);
+    memset(&stats, 0, sizeof(stats));
+
+    if (!Flash_Init()) return false;
+
+    // Logs fill the flash upwards from address 0, so the used area is a
+    // prefix: binary search for the first sector that starts erased
+    uint32_t lo = 0;
+    uint32_t hi = FLASH_LOG_END / FLASH_SECTOR_SIZE;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint8_t first = 0;
+        if (!Flash_Read(mid * FLASH_SECTOR_SIZE, &first, 1)) return false;
+        if (first == 0xFF) hi = mid;
+        else lo = mid + 1;
+    }
+    if (lo == FLASH_LOG_END / FLASH_SECTOR_SIZE) {
+        stats.flash_full = true;
+        flash_full.store(true);
+        return false;
+    }
+
+    stats.log_start = lo * FLASH_SECTOR_SIZE;
+    stats.write_address = stats.log_start;
+    erased_end = stats.log_start;   // Sector may hold stray data; erase it anyway
+
+    fill_length = (uint32_t)Blackbox_EncodeHeader(&encoder, buffers[0]);
+    started = true;
+    return true;
+}
+
+bool Blackbox_Log(const Blackbox_Frame_t *frame) {
+    if (!started || flash_full.load(std::memory_order_relaxed)) {
+        stats.frames_rejected++;
+        return false;
+    }
+
+    // A half that could not be handed off last frame is still full
+    if (fill_length + BLACKBOX_MAX_FRAME_BYTES > BLACKBOX_BUFFER_BYTES && !hand_off()) {
+        stats.frames_dropped++;
+        force_intra = true;
+        return false;
+    }
+
+    size_t length = Blackbox_EncodeFrame(&encoder, frame, force_intra, &buffers[fill_index][fill_length]);
+    force_intra = false;
+    fill_length += (uint32_t)length;
+    stats.frames_logged++;
+    stats.bytes_logged += (uint32_t)length;
+
+    // Hand off as soon as the next frame might not fit
+    if (fill_length + BLACKBOX_MAX_FRAME_BYTES > BLACKBOX_BUFFER_BYTES) hand_off();
+    return true;
+}
+
+void Blackbox_Flush(void) {
+    if (fill_length > 0) hand_off();
+}
+
+void Blackbox_Service(void) {
+    if (!started || Flash_IsBusy()) return;
+
+    if (inflight_length > 0) {
+        stats.write_address += inflight_length;
+        stats.pages_programmed++;
+        service_offset += inflight_length;
+        inflight_length = 0;
+        if (service_offset == pending_length[service_index].load(std::memory_order_acquire)) retire_half();
+    }
+
+    uint32_t length = pending_length[service_index].load(std::memory_order_acquire);
+    if (length == 0) {
+        // Idle: keep erased sectors ahead so programs never wait on an erase
+        if (erased_end < FLASH_LOG_END &&
+            erased_end - stats.write_address < BLACKBOX_ERASE_AHEAD * FLASH_SECTOR_SIZE) {
+            start_erase();
+        }
+        return;
+    }
+
+    if (stats.write_address >= FLASH_LOG_END) {
+        stats.flash_full = true;
+        flash_full.store(true, std::memory_order_relaxed);
+        retire_half();   // Nowhere to put it
+        return;
+    }
+
+    if (stats.write_address >= erased_end) {
+        start_erase();
+        return;
+    }
+
+    // One page-bounded chunk per operation
+    uint32_t chunk = length - service_offset;
+    uint32_t page_room = FLASH_PAGE_SIZE - (stats.write_address % FLASH_PAGE_SIZE);
+    if (chunk > page_room) chunk = page_room;
+    if (Flash_StartProgram(stats.write_address, &buffers[service_index][service_offset], chunk)) {
+        inflight_length = chunk;
+    }
+}
+
+bool Blackbox_IsIdle(void) {
+    if (!started) return true;
+    return fill_length == 0 && inflight_length == 0 &&
+           pending_length[0].load(std::memory_order_acquire) == 0 &&
+           pending_length[1].load(std::memory_order_acquire) == 0 &&
+           !Flash_IsBusy();
+}
+
+void Blackbox_GetStats(Blackbox_Stats_t *out) {
+    *out = stats;
+}
+
+static bool hand_off(void) {
+    uint32_t other = fill_index ^ 1U;
+    if (pending_length[other].load(std::memory_order_acquire) != 0) return false;
+    pending_length[fill_index].store(fill_length, std::memory_order_release);
+    fill_index = other;
+    fill_length = 0;
+    return true;
+}
+
+static void start_erase(void) {
+    if (Flash_StartSectorErase(erased_end)) {
+        erased_end += FLASH_SECTOR_SIZE;
+        stats.sectors_erased++;
+    }
+}
+
+static void retire_half(void) {
+    pending_length[service_index].store(0, std::memory_order_release);
+    service_index ^= 1U;
+    service_offset = 0;
+}
+
+/* --- Codec --- */
+
+static inline int32_t quantise(float value, float scale) {
+    float scaled = value * scale;
+    if (scaled != scaled) return 0;   // NaN
+    if (scaled > 2.0e9f) scaled = 2.0e9f;
+    if (scaled < -2.0e9f) scaled = -2.0e9f;
+    return (int32_t)(scaled + (scaled >= 0.0f ? 0.5f : -0.5f));
+}
+
+static inline uint32_t zigzag(uint32_t value) {
+    return (value << 1) ^ (uint32_t)((int32_t)value >> 31);
+}
+
+static inline uint32_t unzigzag(uint32_t value) {
+    return (value >> 1) ^ (0U - (value & 1U));
+}
+
+static inline uint8_t *put_varint(uint8_t *out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+// Returns NULL on truncation or an overlong encoding
+static const uint8_t *get_varint(const uint8_t *in, const uint8_t *end, int max_bytes, uint64_t *value) {
+    uint64_t result = 0;
+    for (int i = 0; i < max_bytes && in < end; i++) {
+        uint8_t byte = *in++;
+        result |= (uint64_t)(byte & 0x7F) << (7 * i);
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return in;
+        }
+    }
+    return NULL;
+}
+
+void Blackbox_CodecInit(Blackbox_Codec_t *codec) {
+    memset(codec, 0, sizeof(*codec));
+}
+
+size_t Blackbox_EncodeHeader(Blackbox_Codec_t *codec, uint8_t *out) {
+    uint32_t log_index = codec->log_index;
+    Blackbox_CodecInit(codec);
+    codec->log_index = log_index + 1;
+
+    uint8_t *p = out;
+    *p++ = BLACKBOX_FRAME_HEADER;
+    memcpy(p, header_magic, sizeof(header_magic));
+    p += sizeof(header_magic);
+    *p++ = BLACKBOX_VERSION;
+    p = put_varint(p, BLACKBOX_FIELD_COUNT);
+    return (size_t)(p - out);
+}
+
+size_t Blackbox_EncodeFrame(Blackbox_Codec_t *codec, const Blackbox_Frame_t *frame,
+                            bool force_intra, uint8_t *out) {
+    bool intra = force_intra || !codec->have_intra ||
+                 codec->frames_since_intra >= BLACKBOX_INTRA_INTERVAL - 1;
+    const uint8_t *base = (const uint8_t *)frame;
+
+    uint8_t *p = out;
+    *p++ = intra ? BLACKBOX_FRAME_INTRA : BLACKBOX_FRAME_DELTA;
+    p = put_varint(p, intra ? frame->time_us : frame->time_us - codec->previous_time_us);
+
+    for (int i = 0; i < BLACKBOX_FIELD_COUNT; i++) {
+        float value;
+        memcpy(&value, base + fields[i].offset, sizeof(value));
+        int32_t q = quantise(value, fields[i].scale);
+        uint32_t coded = intra ? (uint32_t)q : (uint32_t)q - (uint32_t)codec->previous[i];
+        p = put_varint(p, zigzag(coded));
+        codec->previous[i] = q;
+    }
+
+    codec->previous_time_us = frame->time_us;
+    codec->frames_since_intra = intra ? 0 : codec->frames_since_intra + 1;
+    codec->have_intra = true;
+    return (size_t)(p - out);
+}
+
+size_t Blackbox_DecodeFrame(Blackbox_Codec_t *codec, const uint8_t *data, size_t length,
+                            char *type, Blackbox_Frame_t *frame) {
+    *type = 0;
+    if (length == 0) return 0;
+    const uint8_t *p = data + 1;
+    const uint8_t *end = data + length;
+    uint64_t value;
+
+    if (data[0] == BLACKBOX_FRAME_HEADER) {
+        if ((size_t)(end - p) < sizeof(header_magic) + 1) return 0;
+        if (memcmp(p, header_magic, sizeof(header_magic)) != 0) return 0;
+        p += sizeof(header_magic);
+        if (*p++ != BLACKBOX_VERSION) return 0;
+        p = get_varint(p, end, 5, &value);
+        if (p == NULL || value != BLACKBOX_FIELD_COUNT) return 0;
+
+        uint32_t log_index = codec->log_index;
+        Blackbox_CodecInit(codec);
+        codec->log_index = log_index + 1;
+        *type = BLACKBOX_FRAME_HEADER;
+        return (size_t)(p - data);
+    }
+
+    bool intra = data[0] == BLACKBOX_FRAME_INTRA;
+    if (!intra && data[0] != BLACKBOX_FRAME_DELTA) return 0;   // Erased flash or garbage
+
+    uint64_t time;
+    p = get_varint(p, end, 10, &time);
+    if (p == NULL) return 0;
+    uint32_t q[BLACKBOX_FIELD_COUNT];
+    for (int i = 0; i < BLACKBOX_FIELD_COUNT; i++) {
+        p = get_varint(p, end, 5, &value);
+        if (p == NULL) return 0;
+        q[i] = unzigzag((uint32_t)value);
+    }
+    size_t consumed = (size_t)(p - data);
+
+    // Deltas before the first intra frame have nothing to apply to
+    if (!intra && !codec->have_intra) return consumed;
+
+    if (!intra) {
+        time += codec->previous_time_us;
+        for (int i = 0; i < BLACKBOX_FIELD_COUNT; i++) q[i] += (uint32_t)codec->previous[i];
+    }
+
+    uint8_t *base = (uint8_t *)frame;
+    frame->time_us = time;
+    for (int i = 0; i < BLACKBOX_FIELD_COUNT; i++) {
+        codec->previous[i] = (int32_t)q[i];
+        float decoded = (float)(int32_t)q[i] / fields[i].scale;
+        memcpy(base + fields[i].offset, &decoded, sizeof(decoded));
+    }
+    codec->previous_time_us = time;
+    codec->have_intra = true;
+    *type = (char)data[0];
+    return consumed;
+}
+
+const char *Blackbox_FieldName(int field) {
+    if (field < 0 || field >= BLACKBOX_FIELD_COUNT) return "";
+    return fields[field].name;
+}
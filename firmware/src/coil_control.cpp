@@ -6,87 +6,206 @@
  *
  * Controls high-frequency PWM or DAC output for plasma coil thruster drive.
  * Uses hardware timers and DAC channels configured for high-frequency signals.
+ *
+ * CubeMX configuration this relies on: DAC channel 1 triggered by TIM6
+ * TRGO (update event), its DMA stream memory-to-peripheral, halfword,
+ * normal mode. The DAC stays enabled in DMA mode; a ramp is started by
+ * re-arming the DMA stream and starting TIM6, and it ends by itself with
+ * the DAC holding the last sample.
+ *
+ * The PWM timer's update event requests a circular DMA burst of five
+ * words (ARR, RCR, CCR1, CCR2, CCR3) from the dither pattern, so each
+ * cycle's period, drive edge and ADC trigger points come from the next
+ * pattern entry. ADC1 is triggered by TIM2 CC2 and ADC2 by TIM2 TRGO
+ * (OC3REF, PWM mode 2).
  */
 
 #include "coil_control.h"
 #include "stm32f7xx_hal.h"
+#include "system_clock.h"
 #include <math.h>
 
 // Example hardware definitions (adjust to actual MCU pins and peripherals)
 #define COIL_PWM_TIMER          htim2
 #define COIL_PWM_CHANNEL        TIM_CHANNEL_1
+#define COIL_RAMP_TIMER         htim6     // DAC trigger
 
 extern TIM_HandleTypeDef COIL_PWM_TIMER;
+extern TIM_HandleTypeDef COIL_RAMP_TIMER;
 
 // For amplitude control, using DAC channel (if available)
 #define COIL_DAC_CHANNEL        DAC_CHANNEL_1
+#define COIL_DAC_MAX_CODE       4095
 extern DAC_HandleTypeDef hdac;
 
+// Period table: 100 Hz steps up to the split, 1 kHz steps above it, so
+// linear interpolation stays well inside one timer count everywhere
+#define COIL_TABLE_SPLIT_HZ     100000
+#define COIL_TABLE_FINE_STEP    100
+#define COIL_TABLE_COARSE_STEP  1000
+#define COIL_TABLE_FINE_COUNT   ((COIL_TABLE_SPLIT_HZ - COIL_FREQ_MIN_HZ) / COIL_TABLE_FINE_STEP)
+#define COIL_TABLE_SIZE         (COIL_TABLE_FINE_COUNT + \
+                                 (COIL_FREQ_MAX_HZ - COIL_TABLE_SPLIT_HZ) / COIL_TABLE_COARSE_STEP + 1)
+
 // Internal state tracking
 static uint32_t current_frequency = 0;
 static float current_amplitude = 0.0f;
 static bool coil_active = false;
 
-// Helper: Calculate timer period for given frequency
-static uint32_t FrequencyToTimerPeriod(uint32_t frequency) {
-    // Assuming timer clock 100MHz (adjust as per clock config)
-    // Timer period = TimerClock / frequency - 1
-    if (frequency == 0) return 0xFFFFFFFF;
-    return (100000000 / frequency) - 1;
-}
+static uint32_t timer_clock_hz = 0;
+static uint32_t period_q8[COIL_TABLE_SIZE];   // Timer counts per cycle, 24.8 fixed point
+static uint32_t current_period_q4 = 0;       // Dithered period, 1/16 counts
+static uint32_t duty_q16 = 0;
+static CoilControl_Cycle_t dither_pattern[COIL_DITHER_CYCLES];
+static bool burst_running = false;
+
+// Ramp shapes in Q15 (32768 = 1.0) and the two waveform buffers
+static uint16_t ramp_shapes[2][COIL_RAMP_SAMPLES];
+static uint16_t ramp_buffers[2][COIL_RAMP_SAMPLES];
+static uint16_t hold_sample = 0;              // One-sample "ramp" used to arm DMA mode
+static uint32_t ramp_buffer = 0;              // Buffer being played
+static uint32_t ramp_samples = 0;
+static uint64_t ramp_start_us = 0;
+static uint32_t ramp_duration_us = 0;
+static uint16_t ramp_target_code = 0;
+
+static void build_period_table(void);
+static void build_ramp_shapes(void);
+static uint32_t period_q8_for(uint32_t frequency_hz);
+static void load_pattern(uint32_t period_q4);
+static void load_shadow(const CoilControl_Cycle_t *cycle);
+static void start_burst(void);
+static void stop_burst(void);
+static uint16_t current_dac_code(uint64_t now_us);
 
 void CoilControl_Init(void) {
+    // APB1 runs at HCLK / 4, so TIM2 and TIM6 are clocked at 2 x PCLK1
+    timer_clock_hz = 2U * HAL_RCC_GetPCLK1Freq();
+    build_period_table();
+    build_ramp_shapes();
+
+    // Preload the period and all three compare registers: writes land in
+    // shadow registers and transfer together at the next update event
+    TIM_TypeDef *tim = COIL_PWM_TIMER.Instance;
+    tim->CR1 |= TIM_CR1_ARPE;
+    tim->CCMR1 |= TIM_CCMR1_OC1PE | TIM_CCMR1_OC2PE;
+    tim->CCMR2 |= TIM_CCMR2_OC3PE;
+    duty_q16 = (uint32_t)(COIL_DEFAULT_DUTY * 65536.0f);
+    stop_burst();
+    current_period_q4 = 0;
+    load_pattern((period_q8_for(COIL_FREQ_MIN_HZ) + 8U) >> 4);
+    current_frequency = COIL_FREQ_MIN_HZ;
+    tim->EGR = TIM_EGR_UG;   // Load the shadows once before the first cycle
+
     // Initialize PWM timer and DAC for coil control
     HAL_TIM_PWM_Start(&COIL_PWM_TIMER, COIL_PWM_CHANNEL);
-    HAL_DAC_Start(&hdac, COIL_DAC_CHANNEL);
+    start_burst();
+    hold_sample = 0;
+    HAL_DAC_Start_DMA(&hdac, COIL_DAC_CHANNEL, (uint32_t *)&hold_sample, 1, DAC_ALIGN_12B_R);
+    ramp_samples = 0;
+    ramp_target_code = 0;
+    current_amplitude = 0.0f;
     coil_active = false;
 }
 
+uint32_t CoilControl_PeriodForFrequency(uint32_t frequency_hz) {
+    if (frequency_hz < COIL_FREQ_MIN_HZ || frequency_hz > COIL_FREQ_MAX_HZ) return 0;
+    return ((period_q8_for(frequency_hz) + 128U) >> 8) - 1U;
+}
+
 bool CoilControl_SetFrequency(uint32_t frequency_hz) {
-    if (frequency_hz < 10000 || frequency_hz > 1000000) {
+    if (frequency_hz < COIL_FREQ_MIN_HZ || frequency_hz > COIL_FREQ_MAX_HZ) {
         // Out of range
         return false;
     }
 
-    uint32_t period = FrequencyToTimerPeriod(frequency_hz);
-    if (period == 0xFFFFFFFF) return false;
-
-    // Update timer period register to adjust PWM frequency
-    COIL_PWM_TIMER.Instance->ARR = period;
-
-    // Reset timer counter to avoid glitches
-    COIL_PWM_TIMER.Instance->CNT = 0;
-
+    load_pattern((period_q8_for(frequency_hz) + 8U) >> 4);
     current_frequency = frequency_hz;
     return true;
 }
 
+void CoilControl_SetDuty(float duty) {
+    if (duty < 0.0f) duty = 0.0f;
+    if (duty > 1.0f) duty = 1.0f;
+    duty_q16 = (uint32_t)(duty * 65536.0f);
+    load_pattern(current_period_q4);
+}
+
 void CoilControl_SetAmplitude(float amplitude) {
+    CoilControl_RampAmplitude(amplitude, COIL_DEFAULT_RAMP_US, COIL_RAMP_SCURVE);
+}
+
+bool CoilControl_RampAmplitude(float target, uint32_t duration_us, CoilControl_RampShape_t shape) {
+    if (duration_us == 0) return false;
+
     // Clamp amplitude between 0 and 1
-    if (amplitude < 0.0f) amplitude = 0.0f;
-    if (amplitude > 1.0f) amplitude = 1.0f;
+    if (target < 0.0f) target = 0.0f;
+    if (target > 1.0f) target = 1.0f;
+    current_amplitude = target;
+
+    // Freeze the output where the running ramp has got to
+    uint64_t now_us = SystemClock_Micros();
+    int32_t start = current_dac_code(now_us);
+    HAL_TIM_Base_Stop(&COIL_RAMP_TIMER);
+    HAL_DMA_Abort(hdac.DMA_Handle1);
 
-    current_amplitude = amplitude;
+    // One sample per microsecond at most, up to the buffer length
+    uint32_t samples = duration_us;
+    if (samples > COIL_RAMP_SAMPLES) samples = COIL_RAMP_SAMPLES;
+    if (samples < 2) samples = 2;
 
-    // Convert amplitude to DAC output value (12-bit resolution assumed)
-    uint32_t dac_value = (uint32_t)(amplitude * 4095);
+    // Fill the idle buffer, resampling the shape table
+    int32_t end = (int32_t)(target * (float)COIL_DAC_MAX_CODE + 0.5f);
+    int32_t delta = end - start;
+    uint32_t buffer = ramp_buffer ^ 1U;
+    const uint16_t *table = ramp_shapes[shape == COIL_RAMP_LINEAR ? 0 : 1];
+    uint16_t *out = ramp_buffers[buffer];
+    uint32_t stride_q16 = ((uint32_t)(COIL_RAMP_SAMPLES - 1) << 16) / (samples - 1);
+    for (uint32_t i = 0; i < samples; i++) {
+        uint32_t weight = table[(i * stride_q16) >> 16];
+        out[i] = (uint16_t)(start + ((delta * (int32_t)weight) >> 15));
+    }
+    out[samples - 1] = (uint16_t)end;
+
+    // Trigger period: duration spread evenly over the samples
+    uint64_t ticks = (uint64_t)duration_us * (timer_clock_hz / 1000000U) / samples;
+    if (ticks < timer_clock_hz / COIL_RAMP_MAX_RATE_HZ) ticks = timer_clock_hz / COIL_RAMP_MAX_RATE_HZ;
+    uint32_t prescaler = (uint32_t)((ticks - 1U) >> 16);
+    TIM_TypeDef *trigger = COIL_RAMP_TIMER.Instance;
+    trigger->PSC = prescaler;
+    trigger->ARR = (uint32_t)(ticks / (prescaler + 1U)) - 1U;
+    trigger->EGR = TIM_EGR_UG;
+
+    HAL_DMA_Start(hdac.DMA_Handle1, (uintptr_t)out, (uintptr_t)&hdac.Instance->DHR12R1, samples);
+    HAL_TIM_Base_Start(&COIL_RAMP_TIMER);
 
-    // Set DAC output to modulate coil power
-    HAL_DAC_SetValue(&hdac, COIL_DAC_CHANNEL, DAC_ALIGN_12B_R, dac_value);
+    ramp_buffer = buffer;
+    ramp_samples = samples;
+    ramp_start_us = now_us;
+    ramp_duration_us = duration_us;
+    ramp_target_code = (uint16_t)end;
+    return true;
+}
 
-    // Adjust PWM duty cycle proportional to amplitude
-    uint32_t pulse = (uint32_t)(COIL_PWM_TIMER.Instance->ARR * amplitude);
-    __HAL_TIM_SET_COMPARE(&COIL_PWM_TIMER, COIL_PWM_CHANNEL, pulse);
+bool CoilControl_IsRamping(void) {
+    return ramp_samples > 0 && SystemClock_Micros() - ramp_start_us < ramp_duration_us;
 }
 
 void CoilControl_Enable(void) {
     HAL_TIM_PWM_Start(&COIL_PWM_TIMER, COIL_PWM_CHANNEL);
-    HAL_DAC_Start(&hdac, COIL_DAC_CHANNEL);
+    start_burst();
+    HAL_DAC_Start_DMA(&hdac, COIL_DAC_CHANNEL, (uint32_t *)&hold_sample, 1, DAC_ALIGN_12B_R);
     coil_active = true;
 }
 
 void CoilControl_Disable(void) {
+    // Remember the level so Enable resumes from it
+    hold_sample = current_dac_code(SystemClock_Micros());
+    ramp_samples = 0;
+
+    stop_burst();
     HAL_TIM_PWM_Stop(&COIL_PWM_TIMER, COIL_PWM_CHANNEL);
+    HAL_TIM_Base_Stop(&COIL_RAMP_TIMER);
     HAL_DAC_Stop(&hdac, COIL_DAC_CHANNEL);
     coil_active = false;
 }
@@ -94,3 +213,112 @@ void CoilControl_Disable(void) {
 bool CoilControl_IsActive(void) {
     return coil_active;
 }
+
+/* --- Internals --- */
+
+// Timer counts per cycle in 24.8 fixed point, frequency already range checked
+static uint32_t period_q8_for(uint32_t frequency_hz) {
+    // Constant divisors: the compiler turns these into multiplies
+    uint32_t period;
+    if (frequency_hz < COIL_TABLE_SPLIT_HZ) {
+        uint32_t offset = frequency_hz - COIL_FREQ_MIN_HZ;
+        uint32_t index = offset / COIL_TABLE_FINE_STEP;
+        uint32_t frac = offset % COIL_TABLE_FINE_STEP;
+        period = period_q8[index];
+        if (frac != 0) period -= (period - period_q8[index + 1]) * frac / COIL_TABLE_FINE_STEP;
+    } else {
+        uint32_t offset = frequency_hz - COIL_TABLE_SPLIT_HZ;
+        uint32_t index = COIL_TABLE_FINE_COUNT + offset / COIL_TABLE_COARSE_STEP;
+        uint32_t frac = offset % COIL_TABLE_COARSE_STEP;
+        period = period_q8[index];
+        if (frac != 0) period -= (period - period_q8[index + 1]) * frac / COIL_TABLE_COARSE_STEP;
+    }
+    return period;
+}
+
+static void build_period_table(void) {
+    uint64_t clock_q8 = (uint64_t)timer_clock_hz << 8;
+    for (uint32_t i = 0; i < COIL_TABLE_SIZE; i++) {
+        uint32_t frequency = (i < COIL_TABLE_FINE_COUNT)
+            ? COIL_FREQ_MIN_HZ + i * COIL_TABLE_FINE_STEP
+            : COIL_TABLE_SPLIT_HZ + (i - COIL_TABLE_FINE_COUNT) * COIL_TABLE_COARSE_STEP;
+        period_q8[i] = (uint32_t)((clock_q8 + frequency / 2U) / frequency);
+    }
+}
+
+static void build_ramp_shapes(void) {
+    for (uint32_t i = 0; i < COIL_RAMP_SAMPLES; i++) {
+        float x = (float)i / (float)(COIL_RAMP_SAMPLES - 1);
+        ramp_shapes[0][i] = (uint16_t)(x * 32768.0f + 0.5f);
+        ramp_shapes[1][i] = (uint16_t)((0.5f - 0.5f * cosf(3.14159265f * x)) * 32768.0f + 0.5f);
+    }
+}
+
+// Spread the 1/16 count fraction over the pattern: entry k is one count
+// longer whenever the running sum of the fraction crosses a whole count.
+// A period change of more than 1/16 restarts the burst so no cycle mixes
+// old and new values; a smaller one is rewritten under the running DMA,
+// where a torn entry costs at most one cycle with its edges a count off.
+static void load_pattern(uint32_t period_q4) {
+    uint32_t base = period_q4 >> 4;
+    uint32_t frac = period_q4 & 15U;
+    uint32_t previous = current_period_q4 >> 4;
+    uint32_t change = (base > previous) ? base - previous : previous - base;
+    bool running = burst_running;
+    bool restart = !running || change * 16U > base;
+
+    if (restart) stop_burst();
+    for (uint32_t k = 0; k < COIL_DITHER_CYCLES; k++) {
+        uint32_t count = base + (((k + 1U) * frac) >> 4) - ((k * frac) >> 4);
+        uint32_t high = (count * duty_q16) >> 16;
+        uint32_t centre = high >> 1;
+        uint32_t quadrature = centre + count - (count >> 2);   // Centre - T/4, wrapped
+        if (quadrature >= count) quadrature -= count;
+
+        CoilControl_Cycle_t *cycle = &dither_pattern[k];
+        cycle->arr = count - 1U;
+        cycle->rcr = 0;
+        cycle->ccr_drive = high;
+        cycle->ccr_in_phase = centre;
+        cycle->ccr_quadrature = quadrature;
+    }
+    current_period_q4 = period_q4;
+
+    if (restart) {
+        load_shadow(&dither_pattern[0]);
+        if (running) start_burst();
+    }
+}
+
+// Write period and compares so that all transfer at the same update event
+static void load_shadow(const CoilControl_Cycle_t *cycle) {
+    TIM_TypeDef *tim = COIL_PWM_TIMER.Instance;
+    tim->CR1 |= TIM_CR1_UDIS;     // Hold the shadow transfer while all are written
+    tim->ARR = cycle->arr;
+    tim->CCR1 = cycle->ccr_drive;
+    tim->CCR2 = cycle->ccr_in_phase;
+    tim->CCR3 = cycle->ccr_quadrature;
+    tim->CR1 &= ~TIM_CR1_UDIS;
+}
+
+static void start_burst(void) {
+    if (burst_running) return;
+    HAL_TIM_DMABurst_MultiWriteStart(&COIL_PWM_TIMER, TIM_DMABASE_ARR, TIM_DMA_UPDATE,
+                                     (uint32_t *)dither_pattern, TIM_DMABURSTLENGTH_5TRANSFERS,
+                                     COIL_DITHER_CYCLES * (sizeof(CoilControl_Cycle_t) / sizeof(uint32_t)));
+    burst_running = true;
+}
+
+static void stop_burst(void) {
+    if (!burst_running) return;
+    HAL_TIM_DMABurst_WriteStop(&COIL_PWM_TIMER, TIM_DMA_UPDATE);
+    burst_running = false;
+}
+// DAC code the running ramp has reached, from the ramp's own clock
+static uint16_t current_dac_code(uint64_t now_us) {
+    if (ramp_samples == 0) return hold_sample;
+    uint64_t elapsed = now_us - ramp_start_us;
+    if (elapsed >= ramp_duration_us) return ramp_target_code;
+    uint32_t index = (uint32_t)(elapsed * ramp_samples / ramp_duration_us);
+    return ramp_buffers[ramp_buffer][index];
+}
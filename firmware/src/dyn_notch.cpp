@@ -0,0 +1,153 @@
+/*
+ * dyn_notch.cpp - FFT-tracked dynamic notch filter for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Step sequence per axis:
+ *   0              copy the history oldest-first, remove the mean, apply
+ *                  the window and store in bit-reversed order
+ *   1 .. LOG2      one radix-2 butterfly stage each
+ *   LOG2 + 1       magnitudes over the search band, peak pick with
+ *                  parabolic interpolation, notch retune
+ * Trig runs only in DynNotch_Init and on a retune.
+ */
+
+#include "dyn_notch.h"
+#include <math.h>
+#include <string.h>
+
+#define TWO_PI 6.28318530718f
+
+#define PEAK_TO_MEAN_MIN  10.0f   // Peak must stand this far above the band average
+#define CENTER_SMOOTHING  0.3f    // Share of a new estimate taken per analysis
+
+static void load_axis(DynNotch_t *dn);
+static void butterfly_stage(DynNotch_t *dn, int stage);
+static void find_peak(DynNotch_t *dn);
+
+void DynNotch_Init(DynNotch_t *dn, float sample_hz, float min_hz, float max_hz, float q) {
+    memset(dn, 0, sizeof(*dn));
+    dn->sample_hz = sample_hz;
+    dn->min_hz = min_hz;
+    dn->max_hz = (max_hz < 0.5f * sample_hz) ? max_hz : 0.5f * sample_hz;
+    dn->q = q;
+
+    for (int i = 0; i < DYN_NOTCH_FFT_SIZE; i++) {
+        dn->window[i] = 0.5f - 0.5f * cosf(TWO_PI * (float)i / (float)DYN_NOTCH_FFT_SIZE);
+
+        uint32_t reversed = 0;
+        for (int bit = 0; bit < DYN_NOTCH_FFT_LOG2; bit++) {
+            if (i & (1 << bit)) reversed |= 1U << (DYN_NOTCH_FFT_LOG2 - 1 - bit);
+        }
+        dn->bit_reverse[i] = (uint8_t)reversed;
+    }
+    for (int k = 0; k < DYN_NOTCH_FFT_SIZE / 2; k++) {
+        float angle = -TWO_PI * (float)k / (float)DYN_NOTCH_FFT_SIZE;
+        dn->twiddle_re[k] = cosf(angle);
+        dn->twiddle_im[k] = sinf(angle);
+    }
+}
+
+void DynNotch_Step(DynNotch_t *dn) {
+    if (dn->step == 0) {
+        load_axis(dn);
+    } else if (dn->step <= DYN_NOTCH_FFT_LOG2) {
+        butterfly_stage(dn, dn->step - 1);
+    } else {
+        find_peak(dn);
+        dn->step = 0;
+        dn->axis = (uint8_t)((dn->axis + 1) % DYN_NOTCH_AXES);
+        return;
+    }
+    dn->step++;
+}
+
+/* --- Slices --- */
+
+static void load_axis(DynNotch_t *dn) {
+    const float *history = dn->history[dn->axis];
+    uint32_t start = dn->history_pos;   // Oldest sample
+
+    float mean = 0.0f;
+    for (int i = 0; i < DYN_NOTCH_FFT_SIZE; i++) mean += history[i];
+    mean *= 1.0f / (float)DYN_NOTCH_FFT_SIZE;
+
+    for (int i = 0; i < DYN_NOTCH_FFT_SIZE; i++) {
+        float x = history[(start + i) & (DYN_NOTCH_FFT_SIZE - 1)] - mean;
+        uint8_t slot = dn->bit_reverse[i];
+        dn->work_re[slot] = x * dn->window[i];
+        dn->work_im[slot] = 0.0f;
+    }
+}
+
+static void butterfly_stage(DynNotch_t *dn, int stage) {
+    int half = 1 << stage;
+    int span = half << 1;
+    int twiddle_stride = DYN_NOTCH_FFT_SIZE / span;
+    float *re = dn->work_re;
+    float *im = dn->work_im;
+
+    for (int group = 0; group < DYN_NOTCH_FFT_SIZE; group += span) {
+        for (int j = 0; j < half; j++) {
+            float wr = dn->twiddle_re[j * twiddle_stride];
+            float wi = dn->twiddle_im[j * twiddle_stride];
+            int a = group + j;
+            int b = a + half;
+
+            float tr = re[b] * wr - im[b] * wi;
+            float ti = re[b] * wi + im[b] * wr;
+            re[b] = re[a] - tr;
+            im[b] = im[a] - ti;
+            re[a] += tr;
+            im[a] += ti;
+        }
+    }
+}
+
+static void find_peak(DynNotch_t *dn) {
+    float bin_hz = dn->sample_hz / (float)DYN_NOTCH_FFT_SIZE;
+    int lo = (int)(dn->min_hz / bin_hz);
+    int hi = (int)(dn->max_hz / bin_hz);
+    if (lo < 1) lo = 1;
+    if (hi > DYN_NOTCH_FFT_SIZE / 2 - 1) hi = DYN_NOTCH_FFT_SIZE / 2 - 1;
+    if (hi <= lo) return;
+
+    // Squared magnitudes in place of the real part; sqrt only around the peak
+    float *power = dn->work_re;
+    float total = 0.0f;
+    int peak = lo;
+    for (int k = lo; k <= hi; k++) {
+        power[k] = dn->work_re[k] * dn->work_re[k] + dn->work_im[k] * dn->work_im[k];
+        total += power[k];
+        if (power[k] > power[peak]) peak = k;
+    }
+    power[lo - 1] = dn->work_re[lo - 1] * dn->work_re[lo - 1] + dn->work_im[lo - 1] * dn->work_im[lo - 1];
+    power[hi + 1] = dn->work_re[hi + 1] * dn->work_re[hi + 1] + dn->work_im[hi + 1] * dn->work_im[hi + 1];
+
+    float mean = total / (float)(hi - lo + 1);
+    if (power[peak] <= 0.0f || power[peak] < PEAK_TO_MEAN_MIN * mean) return;
+
+    // Parabolic interpolation on magnitudes
+    float m0 = sqrtf(power[peak - 1]);
+    float m1 = sqrtf(power[peak]);
+    float m2 = sqrtf(power[peak + 1]);
+    float denom = m0 - 2.0f * m1 + m2;
+    float delta = (denom != 0.0f) ? 0.5f * (m0 - m2) / denom : 0.0f;
+    if (delta > 0.5f) delta = 0.5f;
+    if (delta < -0.5f) delta = -0.5f;
+
+    float estimate = ((float)peak + delta) * bin_hz;
+    if (estimate < dn->min_hz) estimate = dn->min_hz;
+    if (estimate > dn->max_hz) estimate = dn->max_hz;
+
+    int axis = dn->axis;
+    if (dn->locked[axis]) {
+        dn->center_hz[axis] += CENTER_SMOOTHING * (estimate - dn->center_hz[axis]);
+    } else {
+        dn->center_hz[axis] = estimate;
+        Biquad_Reset(&dn->notch[axis]);
+        dn->locked[axis] = true;
+    }
+    Biquad_SetNotch(&dn->notch[axis], dn->center_hz[axis], dn->sample_hz, dn->q);
+}
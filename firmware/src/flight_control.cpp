@@ -6,81 +6,109 @@
  *
  * Implements PID control loops for roll, pitch, yaw stabilization
  * and computes motor outputs accordingly.
+ *
+ * The attitude loops run as one 3-axis PidBank (see pid_bank.h); the
+ * scalar PID_Update below is kept for callers outside the control loop.
  */
 
 #include "flight_control.h"
+#include "mixer.h"
 #include <math.h>
 #include <string.h>
 
-static PID_Controller_t pid_roll;
-static PID_Controller_t pid_pitch;
-static PID_Controller_t pid_yaw;
+enum { AXIS_ROLL = 0, AXIS_PITCH, AXIS_YAW, AXIS_COUNT };
 
-static void PID_Init(PID_Controller_t *pid, float kp, float ki, float kd, float out_min, float out_max);
-static float PID_Update(PID_Controller_t *pid, float setpoint, float measured, float dt);
+#define MOTOR_OUTPUT_MIN  0.0f
+#define MOTOR_OUTPUT_MAX  1.0f
 
-// Constants: tune these for your drone
-#define PID_ROLL_KP  6.0f
-#define PID_ROLL_KI  0.3f
-#define PID_ROLL_KD  0.05f
+FlightControl_Gains_t FlightControl_GainsFromParams(const Params_Bank_t *bank) {
+    FlightControl_Gains_t gains = {
+        { Params_Float(bank, PARAM_ATT_ROLL_KP), Params_Float(bank, PARAM_ATT_PITCH_KP), Params_Float(bank, PARAM_ATT_YAW_KP) },
+        { Params_Float(bank, PARAM_ATT_ROLL_KI), Params_Float(bank, PARAM_ATT_PITCH_KI), Params_Float(bank, PARAM_ATT_YAW_KI) },
+        { Params_Float(bank, PARAM_ATT_ROLL_KD), Params_Float(bank, PARAM_ATT_PITCH_KD), Params_Float(bank, PARAM_ATT_YAW_KD) },
+        Params_Float(bank, PARAM_ATT_OUT_LIMIT),
+        Params_Float(bank, PARAM_ATT_D_CUTOFF_HZ),
+    };
+    return gains;
+}
 
-#define PID_PITCH_KP  6.0f
-#define PID_PITCH_KI  0.3f
-#define PID_PITCH_KD  0.05f
+FlightControl_Gains_t FlightControl_DefaultGains(void) {
+    return FlightControl_GainsFromParams(Params_Defaults());
+}
 
-#define PID_YAW_KP  4.0f
-#define PID_YAW_KI  0.2f
-#define PID_YAW_KD  0.02f
+bool FlightControl_Init(FlightControl_t *control, const FlightControl_Gains_t *gains) {
+    control->attitude_pid.SetTiming(0.0f);
+    FlightControl_SetGains(control, gains);
+    FlightControl_Reset(control);
+    return true;
+}
 
-#define MOTOR_OUTPUT_MIN  0.0f
-#define MOTOR_OUTPUT_MAX  1.0f
+void FlightControl_SetGains(FlightControl_t *control, const FlightControl_Gains_t *gains) {
+    // Attitude demand is signed; the mixer keeps it within motor range
+    for (int axis = 0; axis < AXIS_COUNT; axis++) {
+        control->attitude_pid.Configure(axis, gains->kp[axis], gains->ki[axis], gains->kd[axis],
+                                        -gains->output_limit, gains->output_limit);
+    }
+    // Heading setpoint and AHRS yaw are both 0..360 clockwise from north;
+    // the error is taken the short way round across north
+    control->attitude_pid.SetWrap(AXIS_YAW, 360.0f);
+    control->attitude_pid.SetDerivativeCutoff(gains->d_cutoff_hz);
+}
 
-bool FlightControl_Init(void) {
-    PID_Init(&pid_roll, PID_ROLL_KP, PID_ROLL_KI, PID_ROLL_KD, MOTOR_OUTPUT_MIN, MOTOR_OUTPUT_MAX);
-    PID_Init(&pid_pitch, PID_PITCH_KP, PID_PITCH_KI, PID_PITCH_KD, MOTOR_OUTPUT_MIN, MOTOR_OUTPUT_MAX);
-    PID_Init(&pid_yaw, PID_YAW_KP, PID_YAW_KI, PID_YAW_KD, MOTOR_OUTPUT_MIN, MOTOR_OUTPUT_MAX);
-    return true;
+void FlightControl_Reset(FlightControl_t *control) {
+    control->attitude_pid.Reset();
+    memset(control->attitude_error, 0, sizeof(control->attitude_error));
 }
 
-void FlightControl_Reset(void) {
-    memset(&pid_roll, 0, sizeof(pid_roll));
-    memset(&pid_pitch, 0, sizeof(pid_pitch));
-    memset(&pid_yaw, 0, sizeof(pid_yaw));
+void FlightControl_GetTerms(const FlightControl_t *control, PID_Terms_t *terms) {
+    const PidBank<AXIS_COUNT, FLIGHT_CONTROL_PID_OPTIONS> &pid = control->attitude_pid;
+    for (int axis = 0; axis < AXIS_COUNT; axis++) {
+        terms->p[axis] = pid.kp[axis] * control->attitude_error[axis];
+        terms->i[axis] = pid.i_term[axis];
+        terms->d[axis] = pid.kd[axis] * pid.d_term[axis];
+    }
 }
 
-void FlightControl_Update(const Flight_Command_t *cmd, 
+void FlightControl_Update(FlightControl_t *control, const Flight_Command_t *cmd,
                           float current_roll, float current_pitch, float current_yaw,
-                          Motor_Output_t *motors) {
-    // Assume dt is fixed timestep; adjust for actual control loop timing in real code
-    const float dt = 0.01f; // 10ms typical control loop
-
-    float roll_output = PID_Update(&pid_roll, cmd->roll, current_roll, dt);
-    float pitch_output = PID_Update(&pid_pitch, cmd->pitch, current_pitch, dt);
-    float yaw_output = PID_Update(&pid_yaw, cmd->yaw, current_yaw, dt);
+                          float dt, Motor_Output_t *motors) {
+    const float setpoint[AXIS_COUNT] = { cmd->roll, cmd->pitch, cmd->yaw };
+    const float measured[AXIS_COUNT] = { current_roll, current_pitch, current_yaw };
+    PidBank<AXIS_COUNT, FLIGHT_CONTROL_PID_OPTIONS> &pid = control->attitude_pid;
+
+    pid.SetTiming(dt);
+    pid.Update(setpoint, measured);
+    for (int axis = 0; axis < AXIS_COUNT; axis++) {
+        control->attitude_error[axis] = pid.Wrap(axis, setpoint[axis] - measured[axis]);
+    }
+
+    // Attitude pitch is positive nose-down (about the FLU y axis, see
+    // ahrs.h) but the mixer raises the front for a positive pitch demand.
+    // Likewise a positive heading error wants a clockwise turn, while
+    // speeding up the CW props turns the vehicle counter-clockwise.
+    FlightControl_MixQuadX(cmd->throttle, pid.output[AXIS_ROLL], -pid.output[AXIS_PITCH], -pid.output[AXIS_YAW],
+                           motors);
+}
 
-    // Mix motor outputs for quadcopter (X configuration)
-    // Motor layout:
+void FlightControl_MixQuadX(float throttle, float roll_output, float pitch_output, float yaw_output,
+                            Motor_Output_t *motors) {
+    // Motor layout (see MIXER_QUAD_X):
     // motor1: front-left (CCW)
     // motor2: front-right (CW)
     // motor3: rear-right (CCW)
     // motor4: rear-left (CW)
-    //
-    // Adjust motor speeds by adding/subtracting roll, pitch, yaw PID outputs
-    motors->motor1 = cmd->throttle + pitch_output + roll_output - yaw_output;
-    motors->motor2 = cmd->throttle + pitch_output - roll_output + yaw_output;
-    motors->motor3 = cmd->throttle - pitch_output - roll_output - yaw_output;
-    motors->motor4 = cmd->throttle - pitch_output + roll_output + yaw_output;
-
-    // Clamp motor outputs to allowed range
-    motors->motor1 = fminf(fmaxf(motors->motor1, MOTOR_OUTPUT_MIN), MOTOR_OUTPUT_MAX);
-    motors->motor2 = fminf(fmaxf(motors->motor2, MOTOR_OUTPUT_MIN), MOTOR_OUTPUT_MAX);
-    motors->motor3 = fminf(fmaxf(motors->motor3, MOTOR_OUTPUT_MIN), MOTOR_OUTPUT_MAX);
-    motors->motor4 = fminf(fmaxf(motors->motor4, MOTOR_OUTPUT_MIN), MOTOR_OUTPUT_MAX);
+    float out[4];
+    Mixer_Apply<MIXER_QUAD_X>(throttle, roll_output, pitch_output, yaw_output,
+                              MOTOR_OUTPUT_MIN, MOTOR_OUTPUT_MAX, out);
+    motors->motor1 = out[0];
+    motors->motor2 = out[1];
+    motors->motor3 = out[2];
+    motors->motor4 = out[3];
 }
 
-/* --- Internal PID functions --- */
+/* --- PID functions --- */
 
-static void PID_Init(PID_Controller_t *pid, float kp, float ki, float kd, float out_min, float out_max) {
+void PID_Init(PID_Controller_t *pid, float kp, float ki, float kd, float out_min, float out_max) {
     pid->kp = kp;
     pid->ki = ki;
     pid->kd = kd;
@@ -91,15 +119,16 @@ static void PID_Init(PID_Controller_t *pid, float kp, float ki, float kd, float
     pid->output = 0.0f;
 }
 
-static float PID_Update(PID_Controller_t *pid, float setpoint, float measured, float dt) {
+float PID_Update(PID_Controller_t *pid, float setpoint, float measured, float dt) {
     float error = setpoint - measured;
+    if (dt <= 0.0f) dt = 0.0f;
     pid->integral += error * dt;
 
     // Prevent integral windup by clamping
     if (pid->integral > pid->output_max) pid->integral = pid->output_max;
     else if (pid->integral < pid->output_min) pid->integral = pid->output_min;
 
-    float derivative = (error - pid->last_error) / dt;
+    float derivative = (dt > 0.0f) ? (error - pid->last_error) / dt : 0.0f;
     pid->last_error = error;
 
     float output = pid->kp * error + pid->ki * pid->integral + pid->kd * derivative;
@@ -0,0 +1,417 @@
+/*
+ * geofence.cpp - Spatially indexed geofence for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * A boundary piece is listed in a cell if it passes within
+ * GEOFENCE_NEAR_DISTANCE plus half the cell diagonal of the cell centre,
+ * which covers every piece within GEOFENCE_NEAR_DISTANCE of any point in
+ * the cell. That makes the in-cell distance exact up to that range, and
+ * any boundary between the centre and a point in the cell is listed, so
+ * counting crossings of the centre-to-point segment gives containment.
+ * Both crossing tests are half-open, so a vertex lying exactly on the
+ * test line is counted once.
+ */
+
+#include "geofence.h"
+#include <math.h>
+#include <string.h>
+
+#define GEOFENCE_BUILD_TRIES   24
+#define GEOFENCE_CELL_GROWTH   1.25f
+
+static bool fill_grid(Geofence_t *geofence, const float lo[2], const float hi[2], float cell_size);
+static void entry_bounds(const Geofence_t *geofence, uint32_t entry, float lo[2], float hi[2]);
+static bool entry_near(const Geofence_t *geofence, uint32_t entry, const float point[2], float reach);
+static bool polygon_contains(const Geofence_t *geofence, const Geofence_Fence_t *fence, const float point[2]);
+static uint32_t edge_end(const Geofence_t *geofence, uint32_t vertex);
+static bool crosses(const float from[2], const float to[2], const float a[2], const float b[2]);
+static float segment_distance_sq(const float point[2], const float a[2], const float b[2]);
+static float volume_distance(float horizontal, float altitude, const Geofence_Fence_t *fence);
+static void query(const Geofence_t *geofence, const float ned[3], Geofence_Status_t *status);
+
+void Geofence_Init(Geofence_t *geofence, double origin_latitude, double origin_longitude) {
+    LocalFrame_Init(&geofence->frame, origin_latitude, origin_longitude, 0.0f);
+    geofence->fence_count = 0;
+    geofence->has_keep_in = false;
+    geofence->vertex_count = 0;
+    geofence->cols = 0;
+    geofence->rows = 0;
+    geofence->entry_count = 0;
+    geofence->built = false;
+}
+
+bool Geofence_AddPolygon(Geofence_t *geofence, Geofence_Kind_t kind, const Geofence_Vertex_t *vertices,
+                         uint32_t count, float floor_alt, float ceiling_alt) {
+    if (count < 3 || geofence->fence_count >= GEOFENCE_MAX_FENCES) return false;
+    if (geofence->vertex_count + count > GEOFENCE_MAX_VERTICES) return false;
+
+    uint32_t index = geofence->fence_count++;
+    Geofence_Fence_t *fence = &geofence->fences[index];
+    fence->kind = kind;
+    fence->cylinder = false;
+    fence->first_vertex = (uint16_t)geofence->vertex_count;
+    fence->vertex_count = (uint16_t)count;
+    fence->floor_alt = floor_alt;
+    fence->ceiling_alt = ceiling_alt;
+
+    for (uint32_t i = 0; i < count; i++) {
+        float ned[3];
+        LocalFrame_ToNED(&geofence->frame, vertices[i].latitude, vertices[i].longitude, 0.0f, ned);
+        geofence->vertices[geofence->vertex_count][0] = ned[0];
+        geofence->vertices[geofence->vertex_count][1] = ned[1];
+        geofence->vertex_fence[geofence->vertex_count] = (uint8_t)index;
+        geofence->vertex_count++;
+    }
+    if (kind == GEOFENCE_KEEP_IN) geofence->has_keep_in = true;
+    geofence->built = false;
+    return true;
+}
+
+bool Geofence_AddCylinder(Geofence_t *geofence, Geofence_Kind_t kind, const Geofence_Vertex_t *center,
+                          float radius, float floor_alt, float ceiling_alt) {
+    if (!(radius > 0.0f) || geofence->fence_count >= GEOFENCE_MAX_FENCES) return false;
+
+    Geofence_Fence_t *fence = &geofence->fences[geofence->fence_count++];
+    float ned[3];
+    LocalFrame_ToNED(&geofence->frame, center->latitude, center->longitude, 0.0f, ned);
+    fence->kind = kind;
+    fence->cylinder = true;
+    fence->first_vertex = 0;
+    fence->vertex_count = 0;
+    fence->center[0] = ned[0];
+    fence->center[1] = ned[1];
+    fence->radius = radius;
+    fence->floor_alt = floor_alt;
+    fence->ceiling_alt = ceiling_alt;
+
+    if (kind == GEOFENCE_KEEP_IN) geofence->has_keep_in = true;
+    geofence->built = false;
+    return true;
+}
+
+bool Geofence_Build(Geofence_t *geofence) {
+    geofence->built = false;
+    geofence->cols = 0;
+    geofence->rows = 0;
+    geofence->entry_count = 0;
+    if (geofence->fence_count == 0) {
+        geofence->built = true;
+        return true;
+    }
+
+    // Bounding box of every boundary, padded so points near the outside
+    // of a fence still land in a cell that lists it
+    float lo[2] = { INFINITY, INFINITY }, hi[2] = { -INFINITY, -INFINITY };
+    for (uint32_t v = 0; v < geofence->vertex_count; v++) {
+        for (int axis = 0; axis < 2; axis++) {
+            lo[axis] = fminf(lo[axis], geofence->vertices[v][axis]);
+            hi[axis] = fmaxf(hi[axis], geofence->vertices[v][axis]);
+        }
+    }
+    for (uint32_t f = 0; f < geofence->fence_count; f++) {
+        const Geofence_Fence_t *fence = &geofence->fences[f];
+        if (!fence->cylinder) continue;
+        for (int axis = 0; axis < 2; axis++) {
+            lo[axis] = fminf(lo[axis], fence->center[axis] - fence->radius);
+            hi[axis] = fmaxf(hi[axis], fence->center[axis] + fence->radius);
+        }
+    }
+    for (int axis = 0; axis < 2; axis++) {
+        lo[axis] -= GEOFENCE_NEAR_DISTANCE;
+        hi[axis] += GEOFENCE_NEAR_DISTANCE;
+    }
+
+    float area = (hi[0] - lo[0]) * (hi[1] - lo[1]);
+    float cell_size = fmaxf(sqrtf(area / GEOFENCE_GRID_CELLS), GEOFENCE_MIN_CELL_SIZE);
+    for (int attempt = 0; attempt < GEOFENCE_BUILD_TRIES; attempt++) {
+        if (fill_grid(geofence, lo, hi, cell_size)) {
+            geofence->built = true;
+            return true;
+        }
+        cell_size *= GEOFENCE_CELL_GROWTH;
+    }
+    geofence->cols = 0;
+    geofence->rows = 0;
+    return false;
+}
+
+void Geofence_Check(const Geofence_t *geofence, const Position_t *position, Geofence_Status_t *status) {
+    float ned[3];
+    LocalFrame_ToNED(&geofence->frame, position->latitude, position->longitude, position->altitude, ned);
+    query(geofence, ned, status);
+    status->breach_in_s = status->breached ? 0.0f : -1.0f;
+}
+
+void Geofence_Predict(const Geofence_t *geofence, const Position_t *position, const Velocity_t *velocity,
+                      float horizon_s, Geofence_Status_t *status) {
+    float start[3];
+    LocalFrame_ToNED(&geofence->frame, position->latitude, position->longitude, position->altitude, start);
+    query(geofence, start, status);
+    status->breach_in_s = status->breached ? 0.0f : -1.0f;
+
+    float v[3] = { velocity->north, velocity->east, velocity->down };
+    float speed = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (status->breached || speed < 1e-3f) return;
+
+    // Sphere tracing: nothing within the clearance of a point can be a
+    // breach, so step by it
+    float t = 0.0f, clearance = status->clearance;
+    for (;;) {
+        float safe_until = t + clearance / speed;
+        t += ((clearance > GEOFENCE_PREDICT_MIN_STEP) ? clearance : GEOFENCE_PREDICT_MIN_STEP) / speed;
+        if (t > horizon_s) return;
+
+        float ned[3] = { start[0] + v[0] * t, start[1] + v[1] * t, start[2] + v[2] * t };
+        Geofence_Status_t ahead;
+        query(geofence, ned, &ahead);
+        if (ahead.breached) {
+            status->breach_in_s = safe_until;
+            return;
+        }
+        clearance = ahead.clearance;
+    }
+}
+
+/* --- Internals --- */
+
+static bool fill_grid(Geofence_t *geofence, const float lo[2], const float hi[2], float cell_size) {
+    uint32_t cols = (uint32_t)ceilf((hi[0] - lo[0]) / cell_size);
+    uint32_t rows = (uint32_t)ceilf((hi[1] - lo[1]) / cell_size);
+    if (cols == 0) cols = 1;
+    if (rows == 0) rows = 1;
+    if ((uint64_t)cols * rows > GEOFENCE_GRID_CELLS) return false;
+
+    uint32_t cells = cols * rows;
+    geofence->grid_origin[0] = lo[0];
+    geofence->grid_origin[1] = lo[1];
+    geofence->cell_size = cell_size;
+    geofence->inv_cell_size = 1.0f / cell_size;
+    geofence->cols = cols;
+    geofence->rows = rows;
+
+    // Two passes over the boundary pieces: count per cell, then place.
+    // Counts accumulate into cell_start as running ends, and placing
+    // walks each end back down to its cell's start.
+    float reach = GEOFENCE_NEAR_DISTANCE + 0.70710678f * cell_size;
+    uint32_t total = 0;
+    memset(geofence->cell_start, 0, sizeof(geofence->cell_start));
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t e = 0; e < geofence->vertex_count + geofence->fence_count; e++) {
+            uint32_t entry;
+            if (e < geofence->vertex_count) {
+                entry = e;
+            } else {
+                if (!geofence->fences[e - geofence->vertex_count].cylinder) continue;
+                entry = GEOFENCE_MAX_VERTICES + (e - geofence->vertex_count);
+            }
+
+            float entry_lo[2], entry_hi[2];
+            entry_bounds(geofence, entry, entry_lo, entry_hi);
+            int32_t c0 = (int32_t)floorf((entry_lo[0] - reach - lo[0]) * geofence->inv_cell_size);
+            int32_t c1 = (int32_t)floorf((entry_hi[0] + reach - lo[0]) * geofence->inv_cell_size);
+            int32_t r0 = (int32_t)floorf((entry_lo[1] - reach - lo[1]) * geofence->inv_cell_size);
+            int32_t r1 = (int32_t)floorf((entry_hi[1] + reach - lo[1]) * geofence->inv_cell_size);
+            if (c0 < 0) c0 = 0;
+            if (r0 < 0) r0 = 0;
+            if (c1 >= (int32_t)cols) c1 = (int32_t)cols - 1;
+            if (r1 >= (int32_t)rows) r1 = (int32_t)rows - 1;
+
+            for (int32_t row = r0; row <= r1; row++) {
+                for (int32_t col = c0; col <= c1; col++) {
+                    float center[2] = { lo[0] + ((float)col + 0.5f) * cell_size,
+                                        lo[1] + ((float)row + 0.5f) * cell_size };
+                    if (!entry_near(geofence, entry, center, reach)) continue;
+                    uint32_t cell = (uint32_t)row * cols + (uint32_t)col;
+                    if (pass == 0) {
+                        geofence->cell_start[cell]++;
+                        total++;
+                    } else {
+                        geofence->entries[--geofence->cell_start[cell]] = (uint16_t)entry;
+                    }
+                }
+            }
+        }
+        if (pass == 0) {
+            if (total > GEOFENCE_MAX_ENTRIES) return false;
+            for (uint32_t cell = 1; cell < cells; cell++) {
+                geofence->cell_start[cell] += geofence->cell_start[cell - 1];
+            }
+        }
+    }
+    geofence->cell_start[cells] = (uint16_t)total;
+    geofence->entry_count = total;
+
+    // Containment of each cell centre, by brute force once
+    for (uint32_t cell = 0; cell < cells; cell++) {
+        float center[2] = { lo[0] + ((float)(cell % cols) + 0.5f) * cell_size,
+                            lo[1] + ((float)(cell / cols) + 0.5f) * cell_size };
+        uint32_t inside = 0;
+        for (uint32_t f = 0; f < geofence->fence_count; f++) {
+            const Geofence_Fence_t *fence = &geofence->fences[f];
+            bool contains;
+            if (fence->cylinder) {
+                float dn = center[0] - fence->center[0], de = center[1] - fence->center[1];
+                contains = dn * dn + de * de < fence->radius * fence->radius;
+            } else {
+                contains = polygon_contains(geofence, fence, center);
+            }
+            if (contains) inside |= 1u << f;
+        }
+        geofence->cell_inside[cell] = inside;
+    }
+    return true;
+}
+
+static void entry_bounds(const Geofence_t *geofence, uint32_t entry, float lo[2], float hi[2]) {
+    if (entry >= GEOFENCE_MAX_VERTICES) {
+        const Geofence_Fence_t *fence = &geofence->fences[entry - GEOFENCE_MAX_VERTICES];
+        for (int axis = 0; axis < 2; axis++) {
+            lo[axis] = fence->center[axis] - fence->radius;
+            hi[axis] = fence->center[axis] + fence->radius;
+        }
+        return;
+    }
+    const float *a = geofence->vertices[entry];
+    const float *b = geofence->vertices[edge_end(geofence, entry)];
+    for (int axis = 0; axis < 2; axis++) {
+        lo[axis] = fminf(a[axis], b[axis]);
+        hi[axis] = fmaxf(a[axis], b[axis]);
+    }
+}
+
+static bool entry_near(const Geofence_t *geofence, uint32_t entry, const float point[2], float reach) {
+    if (entry >= GEOFENCE_MAX_VERTICES) {
+        const Geofence_Fence_t *fence = &geofence->fences[entry - GEOFENCE_MAX_VERTICES];
+        float dn = point[0] - fence->center[0], de = point[1] - fence->center[1];
+        return fabsf(sqrtf(dn * dn + de * de) - fence->radius) <= reach;
+    }
+    return segment_distance_sq(point, geofence->vertices[entry],
+                               geofence->vertices[edge_end(geofence, entry)]) <= reach * reach;
+}
+
+static bool polygon_contains(const Geofence_t *geofence, const Geofence_Fence_t *fence, const float point[2]) {
+    // Even-odd rule, casting a ray toward +east
+    bool inside = false;
+    for (uint32_t i = fence->first_vertex; i < (uint32_t)fence->first_vertex + fence->vertex_count; i++) {
+        const float *a = geofence->vertices[i];
+        const float *b = geofence->vertices[edge_end(geofence, i)];
+        if ((a[0] > point[0]) != (b[0] > point[0])) {
+            float east = a[1] + (point[0] - a[0]) * (b[1] - a[1]) / (b[0] - a[0]);
+            if (point[1] < east) inside = !inside;
+        }
+    }
+    return inside;
+}
+
+static uint32_t edge_end(const Geofence_t *geofence, uint32_t vertex) {
+    const Geofence_Fence_t *fence = &geofence->fences[geofence->vertex_fence[vertex]];
+    return (vertex + 1 == (uint32_t)fence->first_vertex + fence->vertex_count) ? fence->first_vertex : vertex + 1;
+}
+
+static bool crosses(const float from[2], const float to[2], const float a[2], const float b[2]) {
+    float dx = to[0] - from[0], dy = to[1] - from[1];
+    float side_a = dx * (a[1] - from[1]) - dy * (a[0] - from[0]);
+    float side_b = dx * (b[1] - from[1]) - dy * (b[0] - from[0]);
+    if ((side_a > 0.0f) == (side_b > 0.0f)) return false;
+
+    float ex = b[0] - a[0], ey = b[1] - a[1];
+    float side_from = ex * (from[1] - a[1]) - ey * (from[0] - a[0]);
+    float side_to = ex * (to[1] - a[1]) - ey * (to[0] - a[0]);
+    return (side_from > 0.0f) != (side_to > 0.0f);
+}
+
+static float segment_distance_sq(const float point[2], const float a[2], const float b[2]) {
+    float ex = b[0] - a[0], ey = b[1] - a[1];
+    float px = point[0] - a[0], py = point[1] - a[1];
+    float length_sq = ex * ex + ey * ey;
+    float t = (length_sq > 0.0f) ? (px * ex + py * ey) / length_sq : 0.0f;
+    if (t < 0.0f) t = 0.0f;
+    if (t > 1.0f) t = 1.0f;
+    float dx = px - t * ex, dy = py - t * ey;
+    return dx * dx + dy * dy;
+}
+
+// Signed distance to a fence volume (positive inside) from the signed
+// horizontal distance to its wall
+static float volume_distance(float horizontal, float altitude, const Geofence_Fence_t *fence) {
+    float below = fence->floor_alt - altitude;
+    float above = altitude - fence->ceiling_alt;
+    float vertical = (below > above) ? below : above;   // Negative inside the band
+    if (horizontal > 0.0f && vertical < 0.0f) return (horizontal < -vertical) ? horizontal : -vertical;
+
+    float h = (horizontal < 0.0f) ? -horizontal : 0.0f;
+    float v = (vertical > 0.0f) ? vertical : 0.0f;
+    return -sqrtf(h * h + v * v);
+}
+
+static void query(const Geofence_t *geofence, const float ned[3], Geofence_Status_t *status) {
+    // Fences with no bit in near are more than the near distance away,
+    // and their distance_sq is never read
+    float distance_sq[GEOFENCE_MAX_FENCES];
+    float near_sq = GEOFENCE_NEAR_DISTANCE * GEOFENCE_NEAR_DISTANCE;
+    uint32_t inside = 0, near = 0;
+    float col_f = floorf((ned[0] - geofence->grid_origin[0]) * geofence->inv_cell_size);
+    float row_f = floorf((ned[1] - geofence->grid_origin[1]) * geofence->inv_cell_size);
+    if (col_f >= 0.0f && row_f >= 0.0f && col_f < (float)geofence->cols && row_f < (float)geofence->rows) {
+        uint32_t col = (uint32_t)col_f, row = (uint32_t)row_f;
+        uint32_t cell = row * geofence->cols + col;
+        float center[2] = { geofence->grid_origin[0] + (col_f + 0.5f) * geofence->cell_size,
+                            geofence->grid_origin[1] + (row_f + 0.5f) * geofence->cell_size };
+        inside = geofence->cell_inside[cell];
+
+        for (uint32_t i = geofence->cell_start[cell]; i < geofence->cell_start[cell + 1]; i++) {
+            uint32_t entry = geofence->entries[i];
+            if (entry >= GEOFENCE_MAX_VERTICES) {
+                uint32_t f = entry - GEOFENCE_MAX_VERTICES;
+                const Geofence_Fence_t *fence = &geofence->fences[f];
+                float dn = ned[0] - fence->center[0], de = ned[1] - fence->center[1];
+                float wall = sqrtf(dn * dn + de * de) - fence->radius;
+                inside = (wall < 0.0f) ? (inside | (1u << f)) : (inside & ~(1u << f));
+                if (!(near & (1u << f))) distance_sq[f] = near_sq;
+                near |= 1u << f;
+                if (wall * wall < distance_sq[f]) distance_sq[f] = wall * wall;
+            } else {
+                uint32_t f = geofence->vertex_fence[entry];
+                const float *a = geofence->vertices[entry];
+                const float *b = geofence->vertices[edge_end(geofence, entry)];
+                if (crosses(center, ned, a, b)) inside ^= 1u << f;
+                if (!(near & (1u << f))) distance_sq[f] = near_sq;
+                near |= 1u << f;
+                float d_sq = segment_distance_sq(ned, a, b);
+                if (d_sq < distance_sq[f]) distance_sq[f] = d_sq;
+            }
+        }
+    }
+
+    // Flyable space is the union of the keep-ins minus the keep-outs: the
+    // clearance is the deepest keep-in margin or the nearest keep-out
+    float altitude = geofence->frame.ref_alt - ned[2];
+    float keep_in = geofence->has_keep_in ? -INFINITY : GEOFENCE_NEAR_DISTANCE;
+    float keep_out = GEOFENCE_NEAR_DISTANCE;
+    int16_t keep_in_fence = -1, keep_out_fence = -1;
+    for (uint32_t f = 0; f < geofence->fence_count; f++) {
+        const Geofence_Fence_t *fence = &geofence->fences[f];
+        float horizontal = (near & (1u << f)) ? sqrtf(distance_sq[f]) : GEOFENCE_NEAR_DISTANCE;
+        if (!(inside & (1u << f))) horizontal = -horizontal;
+        float margin = volume_distance(horizontal, altitude, fence);
+        if (fence->kind == GEOFENCE_KEEP_IN) {
+            if (margin > keep_in) {
+                keep_in = margin;
+                keep_in_fence = (int16_t)f;
+            }
+        } else if (-margin < keep_out) {
+            keep_out = -margin;
+            keep_out_fence = (int16_t)f;
+        }
+    }
+
+    float clearance = (keep_in < keep_out) ? keep_in : keep_out;
+    status->fence = (keep_in < keep_out) ? keep_in_fence : keep_out_fence;
+    if (clearance > GEOFENCE_NEAR_DISTANCE) clearance = GEOFENCE_NEAR_DISTANCE;
+    if (clearance < -GEOFENCE_NEAR_DISTANCE) clearance = -GEOFENCE_NEAR_DISTANCE;
+    if (clearance >= GEOFENCE_NEAR_DISTANCE) status->fence = -1;
+    status->clearance = clearance;
+    status->breached = clearance < 0.0f;
+}
@@ -0,0 +1,509 @@
+/*
+ * gps_parser.cpp - Streaming NMEA / UBX GPS parser for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * One state machine handles both protocols: '$' opens an NMEA sentence,
+ * 0xB5 0x62 a UBX frame. Per byte the work is a switch, a checksum step
+ * and at most one multiply-accumulate; conversions to degrees and m/s run
+ * once per field.
+ */
+
+#include "gps_parser.h"
+#include <string.h>
+
+#define KNOTS_TO_MPS 0.514444f
+#define KMH_TO_MPS   (1.0f / 3.6f)
+
+#define UBX_SYNC1          0xB5
+#define UBX_SYNC2          0x62
+#define UBX_CLASS_NAV      0x01
+#define UBX_ID_NAV_PVT     0x07
+#define UBX_NAV_PVT_MIN    68      // Payload bytes up to and including headMot
+#define UBX_MAX_PAYLOAD    1024
+
+// Parser states
+enum {
+    STATE_IDLE = 0,
+    STATE_NMEA_BODY,
+    STATE_NMEA_CK1,
+    STATE_NMEA_CK2,
+    STATE_UBX_SYNC2,
+    STATE_UBX_CLASS,
+    STATE_UBX_ID,
+    STATE_UBX_LEN1,
+    STATE_UBX_LEN2,
+    STATE_UBX_PAYLOAD,
+    STATE_UBX_CK_A,
+    STATE_UBX_CK_B,
+};
+
+// NMEA sentences we decode
+enum {
+    SENTENCE_NONE = 0,
+    SENTENCE_GGA,
+    SENTENCE_RMC,
+    SENTENCE_VTG,
+};
+
+// staged_fields bits
+#define STAGED_POSITION   (1u << 0)
+#define STAGED_ALTITUDE   (1u << 1)
+#define STAGED_SPEED      (1u << 2)
+#define STAGED_COURSE     (1u << 3)
+#define STAGED_FIX        (1u << 4)
+#define STAGED_SATELLITES (1u << 5)
+
+static const double pow10_table[] = {
+    1.0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+};
+#define MAX_DECIMALS 9
+
+static void start_message(GpsParser_t *parser, uint8_t state, uint64_t byte_us);
+static void nmea_body(GpsParser_t *parser, uint8_t byte);
+static void nmea_field_end(GpsParser_t *parser);
+static void nmea_gga(GpsParser_t *parser, double value);
+static void nmea_rmc(GpsParser_t *parser, double value);
+static void nmea_vtg(GpsParser_t *parser, double value);
+static bool ubx_byte(GpsParser_t *parser, uint8_t byte);
+static void ubx_payload(GpsParser_t *parser, uint8_t byte);
+static bool commit(GpsParser_t *parser);
+static int hex_value(uint8_t c);
+static double ddmm_to_degrees(double ddmm);
+
+void GpsParser_Init(GpsParser_t *parser) {
+    memset(parser, 0, sizeof(*parser));
+    parser->state = STATE_IDLE;
+}
+
+bool GpsParser_Feed(GpsParser_t *parser, uint8_t byte, uint64_t byte_us) {
+    switch (parser->state) {
+    case STATE_IDLE:
+        if (byte == '$') start_message(parser, STATE_NMEA_BODY, byte_us);
+        else if (byte == UBX_SYNC1) start_message(parser, STATE_UBX_SYNC2, byte_us);
+        return false;
+
+    case STATE_NMEA_BODY:
+        if (byte == '$') {
+            // Restart: the previous sentence was cut short
+            parser->framing_errors++;
+            start_message(parser, STATE_NMEA_BODY, byte_us);
+        } else {
+            nmea_body(parser, byte);
+        }
+        return false;
+
+    case STATE_NMEA_CK1:
+    case STATE_NMEA_CK2: {
+        int nibble = hex_value(byte);
+        if (nibble < 0) {
+            parser->framing_errors++;
+            parser->state = STATE_IDLE;
+            return false;
+        }
+        parser->received_checksum = (uint8_t)((parser->received_checksum << 4) | nibble);
+        if (parser->state == STATE_NMEA_CK1) {
+            parser->state = STATE_NMEA_CK2;
+            return false;
+        }
+        parser->state = STATE_IDLE;
+        if (parser->received_checksum != parser->checksum) {
+            parser->checksum_errors++;
+            return false;
+        }
+        return commit(parser);
+    }
+
+    default:
+        return ubx_byte(parser, byte);
+    }
+}
+
+uint32_t GpsParser_Consume(GpsParser_t *parser, const uint8_t *ring, size_t size,
+                           size_t *read_index, size_t write_index,
+                           uint64_t last_byte_us, uint32_t byte_ns) {
+    size_t read = *read_index;
+    size_t pending = (write_index >= read) ? write_index - read : write_index + size - read;
+    uint32_t published = 0;
+
+    for (size_t i = 0; i < pending; i++) {
+        uint8_t byte = ring[read];
+        uint64_t byte_us = 0;
+
+        // Timestamp only candidate message starts: the byte arrived
+        // (pending - 1 - i) byte times before the last one
+        if (byte == '$' || byte == UBX_SYNC1) {
+            uint64_t age_us = (uint64_t)(pending - 1 - i) * byte_ns / 1000U;
+            byte_us = (last_byte_us > age_us) ? last_byte_us - age_us : 0;
+        }
+
+        if (GpsParser_Feed(parser, byte, byte_us)) published++;
+        if (++read == size) read = 0;
+    }
+
+    *read_index = read;
+    return published;
+}
+
+/* --- NMEA --- */
+
+static void start_message(GpsParser_t *parser, uint8_t state, uint64_t byte_us) {
+    parser->state = state;
+    parser->message_start_us = byte_us;
+    parser->staged = parser->fix;
+    parser->staged_fields = 0;
+
+    parser->sentence = SENTENCE_NONE;
+    parser->field_index = 0;
+    parser->length = 0;
+    parser->checksum = 0;
+    parser->received_checksum = 0;
+    memset(&parser->field, 0, sizeof(parser->field));
+}
+
+static void nmea_body(GpsParser_t *parser, uint8_t byte) {
+    if (byte == '*') {
+        nmea_field_end(parser);
+        parser->state = STATE_NMEA_CK1;
+        return;
+    }
+
+    if (++parser->length > GPS_NMEA_MAX_LENGTH) {
+        parser->framing_errors++;
+        parser->state = STATE_IDLE;
+        return;
+    }
+    parser->checksum ^= byte;
+
+    if (byte == ',') {
+        nmea_field_end(parser);
+        parser->field_index++;
+        memset(&parser->field, 0, sizeof(parser->field));
+        return;
+    }
+
+    GpsParser_Field_t *field = &parser->field;
+    if (parser->field_index == 0) {
+        if (parser->length <= sizeof(parser->type)) parser->type[parser->length - 1] = (char)byte;
+        return;
+    }
+
+    if (byte >= '0' && byte <= '9') {
+        if (!field->fraction) {
+            field->mantissa = field->mantissa * 10 + (byte - '0');
+        } else if (field->decimals < MAX_DECIMALS) {
+            field->mantissa = field->mantissa * 10 + (byte - '0');
+            field->decimals++;
+        }
+        field->present = true;
+    } else if (byte == '.') {
+        field->fraction = true;
+    } else if (byte == '-') {
+        field->negative = true;
+    } else if (field->letter == 0) {
+        field->letter = (char)byte;
+        field->present = true;
+    }
+}
+
+static void nmea_field_end(GpsParser_t *parser) {
+    GpsParser_Field_t *field = &parser->field;
+
+    if (parser->field_index == 0) {
+        // Talker ID is ignored; the last three characters name the sentence
+        const char *t = &parser->type[2];
+        if (parser->length < 5) parser->sentence = SENTENCE_NONE;
+        else if (t[0] == 'G' && t[1] == 'G' && t[2] == 'A') parser->sentence = SENTENCE_GGA;
+        else if (t[0] == 'R' && t[1] == 'M' && t[2] == 'C') parser->sentence = SENTENCE_RMC;
+        else if (t[0] == 'V' && t[1] == 'T' && t[2] == 'G') parser->sentence = SENTENCE_VTG;
+        else parser->sentence = SENTENCE_NONE;
+
+        // Nothing to decode: skip the rest instead of checksumming it
+        if (parser->sentence == SENTENCE_NONE) parser->state = STATE_IDLE;
+        return;
+    }
+
+    double value = (double)field->mantissa / pow10_table[field->decimals];
+    if (field->negative) value = -value;
+
+    switch (parser->sentence) {
+    case SENTENCE_GGA: nmea_gga(parser, value); break;
+    case SENTENCE_RMC: nmea_rmc(parser, value); break;
+    case SENTENCE_VTG: nmea_vtg(parser, value); break;
+    default: break;
+    }
+}
+
+// $xxGGA,time,lat,N,lon,E,quality,numSV,hdop,alt,M,...
+static void nmea_gga(GpsParser_t *parser, double value) {
+    GpsParser_Field_t *field = &parser->field;
+    GPS_Data_t *fix = &parser->staged;
+
+    switch (parser->field_index) {
+    case 2:
+        if (field->present) fix->latitude = ddmm_to_degrees(value);
+        break;
+    case 3:
+        if (field->letter == 'S') fix->latitude = -fix->latitude;
+        break;
+    case 4:
+        if (field->present) {
+            fix->longitude = ddmm_to_degrees(value);
+            parser->staged_fields |= STAGED_POSITION;
+        }
+        break;
+    case 5:
+        if (field->letter == 'W') fix->longitude = -fix->longitude;
+        break;
+    case 6:
+        fix->fix_type = (field->present && value > 0.0) ? 2 : 0;
+        parser->staged_fields |= STAGED_FIX;
+        if (fix->fix_type == 0) parser->staged_fields &= ~STAGED_POSITION;
+        break;
+    case 7:
+        if (field->present) {
+            fix->satellites = (uint8_t)value;
+            parser->staged_fields |= STAGED_SATELLITES;
+        }
+        break;
+    case 9:
+        if (field->present) {
+            fix->altitude = (float)value;
+            parser->staged_fields |= STAGED_ALTITUDE;
+        } else if (fix->fix_type > 0) {
+            fix->fix_type = 1;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// $xxRMC,time,status,lat,N,lon,E,speed_kn,course,date,...
+static void nmea_rmc(GpsParser_t *parser, double value) {
+    GpsParser_Field_t *field = &parser->field;
+    GPS_Data_t *fix = &parser->staged;
+
+    switch (parser->field_index) {
+    case 2:
+        if (field->letter != 'A') {
+            fix->fix_type = 0;
+            parser->staged_fields |= STAGED_FIX;
+        }
+        break;
+    case 3:
+        if (field->present) fix->latitude = ddmm_to_degrees(value);
+        break;
+    case 4:
+        if (field->letter == 'S') fix->latitude = -fix->latitude;
+        break;
+    case 5:
+        if (field->present && !(parser->staged_fields & STAGED_FIX)) {
+            fix->longitude = ddmm_to_degrees(value);
+            parser->staged_fields |= STAGED_POSITION;
+        }
+        break;
+    case 6:
+        if (field->letter == 'W') fix->longitude = -fix->longitude;
+        break;
+    case 7:
+        if (field->present) {
+            fix->speed = (float)value * KNOTS_TO_MPS;
+            parser->staged_fields |= STAGED_SPEED;
+        }
+        break;
+    case 8:
+        if (field->present) {
+            fix->course = (float)value;
+            parser->staged_fields |= STAGED_COURSE;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// $xxVTG,course_t,T,course_m,M,speed_kn,N,speed_kmh,K,mode
+static void nmea_vtg(GpsParser_t *parser, double value) {
+    GpsParser_Field_t *field = &parser->field;
+    GPS_Data_t *fix = &parser->staged;
+
+    switch (parser->field_index) {
+    case 1:
+        if (field->present) {
+            fix->course = (float)value;
+            parser->staged_fields |= STAGED_COURSE;
+        }
+        break;
+    case 7:
+        if (field->present) {
+            fix->speed = (float)value * KMH_TO_MPS;
+            parser->staged_fields |= STAGED_SPEED;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* --- UBX --- */
+
+static bool ubx_byte(GpsParser_t *parser, uint8_t byte) {
+    uint8_t state = parser->state;
+
+    // Fletcher-8 covers class, id, length and payload
+    if (state >= STATE_UBX_CLASS && state <= STATE_UBX_PAYLOAD) {
+        parser->ubx_ck_a = (uint8_t)(parser->ubx_ck_a + byte);
+        parser->ubx_ck_b = (uint8_t)(parser->ubx_ck_b + parser->ubx_ck_a);
+    }
+
+    switch (state) {
+    case STATE_UBX_SYNC2:
+        if (byte == UBX_SYNC2) {
+            parser->ubx_ck_a = 0;
+            parser->ubx_ck_b = 0;
+            parser->state = STATE_UBX_CLASS;
+        } else {
+            parser->state = STATE_IDLE;
+        }
+        break;
+    case STATE_UBX_CLASS:
+        parser->ubx_class = byte;
+        parser->state = STATE_UBX_ID;
+        break;
+    case STATE_UBX_ID:
+        parser->ubx_id = byte;
+        parser->state = STATE_UBX_LEN1;
+        break;
+    case STATE_UBX_LEN1:
+        parser->ubx_length = byte;
+        parser->state = STATE_UBX_LEN2;
+        break;
+    case STATE_UBX_LEN2:
+        parser->ubx_length |= (uint16_t)(byte << 8);
+        parser->ubx_offset = 0;
+        parser->ubx_word = 0;
+        if (parser->ubx_length > UBX_MAX_PAYLOAD) {
+            parser->framing_errors++;
+            parser->state = STATE_IDLE;
+        } else {
+            parser->state = (parser->ubx_length > 0) ? STATE_UBX_PAYLOAD : STATE_UBX_CK_A;
+        }
+        break;
+    case STATE_UBX_PAYLOAD:
+        ubx_payload(parser, byte);
+        if (++parser->ubx_offset == parser->ubx_length) parser->state = STATE_UBX_CK_A;
+        break;
+    case STATE_UBX_CK_A:
+        if (byte != parser->ubx_ck_a) {
+            parser->checksum_errors++;
+            parser->state = STATE_IDLE;
+        } else {
+            parser->state = STATE_UBX_CK_B;
+        }
+        break;
+    case STATE_UBX_CK_B:
+        parser->state = STATE_IDLE;
+        if (byte != parser->ubx_ck_b) {
+            parser->checksum_errors++;
+            return false;
+        }
+        return commit(parser);
+    default:
+        parser->state = STATE_IDLE;
+        break;
+    }
+    return false;
+}
+
+// NAV-PVT fields are word aligned: assemble each little-endian word as its
+// bytes arrive and decode it on the last one
+static void ubx_payload(GpsParser_t *parser, uint8_t byte) {
+    if (parser->ubx_class != UBX_CLASS_NAV || parser->ubx_id != UBX_ID_NAV_PVT ||
+        parser->ubx_length < UBX_NAV_PVT_MIN) {
+        return;
+    }
+
+    uint16_t offset = parser->ubx_offset;
+    parser->ubx_word |= (uint32_t)byte << (8 * (offset & 3));
+    if ((offset & 3) != 3) return;
+
+    uint32_t word = parser->ubx_word;
+    int32_t value = (int32_t)word;
+    GPS_Data_t *fix = &parser->staged;
+    parser->ubx_word = 0;
+
+    switch (offset >> 2) {
+    case 5: {   // fixType, flags, flags2, numSV
+        uint8_t fix_type = (uint8_t)(word & 0xFF);
+        bool fix_ok = (word >> 8) & 0x01;
+        if (!fix_ok) fix->fix_type = 0;
+        else if (fix_type == 3 || fix_type == 4) fix->fix_type = 2;
+        else if (fix_type == 2) fix->fix_type = 1;
+        else fix->fix_type = 0;
+        fix->satellites = (uint8_t)(word >> 24);
+        parser->staged_fields |= STAGED_FIX | STAGED_SATELLITES;
+        break;
+    }
+    case 6:     // lon, 1e-7 deg
+        fix->longitude = value * 1e-7;
+        break;
+    case 7:     // lat, 1e-7 deg
+        fix->latitude = value * 1e-7;
+        if (fix->fix_type > 0) parser->staged_fields |= STAGED_POSITION;
+        break;
+    case 9:     // hMSL, mm
+        fix->altitude = (float)value * 1e-3f;
+        parser->staged_fields |= STAGED_ALTITUDE;
+        break;
+    case 15:    // gSpeed, mm/s
+        fix->speed = (float)value * 1e-3f;
+        parser->staged_fields |= STAGED_SPEED;
+        break;
+    case 16:    // headMot, 1e-5 deg
+        fix->course = (float)value * 1e-5f;
+        parser->staged_fields |= STAGED_COURSE;
+        break;
+    default:
+        break;
+    }
+}
+
+/* --- Shared helpers --- */
+
+// Checksum passed: publish what the message carried
+static bool commit(GpsParser_t *parser) {
+    uint32_t fields = parser->staged_fields;
+    if (fields == 0) return false;
+
+    const GPS_Data_t *staged = &parser->staged;
+    GPS_Data_t *fix = &parser->fix;
+    parser->messages++;
+
+    if (fields & STAGED_FIX) fix->fix_type = staged->fix_type;
+    if (fields & STAGED_SATELLITES) fix->satellites = staged->satellites;
+    if (fields & STAGED_SPEED) fix->speed = staged->speed;
+    if (fields & STAGED_COURSE) fix->course = staged->course;
+    if (fields & STAGED_ALTITUDE) fix->altitude = staged->altitude;
+
+    if (fields & STAGED_POSITION) {
+        fix->latitude = staged->latitude;
+        fix->longitude = staged->longitude;
+        fix->timestamp_us = parser->message_start_us;
+        return true;
+    }
+    return false;
+}
+
+static int hex_value(uint8_t c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static double ddmm_to_degrees(double ddmm) {
+    double degrees = (double)(int32_t)(ddmm / 100.0);
+    return degrees + (ddmm - degrees * 100.0) / 60.0;
+}
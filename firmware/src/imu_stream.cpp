@@ -0,0 +1,45 @@
+/*
+ * imu_stream.cpp - Interrupt-fed IMU sample queue for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ */
+
+#include "imu_stream.h"
+#include "spsc_ring.h"
+#include <atomic>
+
+static SpscRing<IMU_Sample_t, IMU_STREAM_CAPACITY> ring;
+
+// Each counter has a single writer, so relaxed stores are enough
+static std::atomic<uint32_t> published{0};   // Producer
+static std::atomic<uint32_t> dropped{0};     // Producer
+static uint32_t max_depth = 0;               // Consumer
+
+void ImuStream_Reset(void) {
+    ring.Reset();
+    published.store(0, std::memory_order_relaxed);
+    dropped.store(0, std::memory_order_relaxed);
+    max_depth = 0;
+}
+
+bool ImuStream_Publish(const IMU_Sample_t *sample) {
+    if (!ring.Push(*sample)) {
+        dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+    published.store(published.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return true;
+}
+
+size_t ImuStream_Drain(IMU_Sample_t *out, size_t max) {
+    uint32_t depth = ring.Size();
+    if (depth > max_depth) max_depth = depth;
+    return ring.PopBatch(out, max);
+}
+
+void ImuStream_GetStats(IMU_StreamStats_t *stats) {
+    stats->published = published.load(std::memory_order_relaxed);
+    stats->dropped = dropped.load(std::memory_order_relaxed);
+    stats->max_depth = max_depth;
+}
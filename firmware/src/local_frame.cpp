@@ -0,0 +1,29 @@
+/*
+ * local_frame.cpp - Local tangent-plane projection for TMF navigation
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ */
+
+#include "local_frame.h"
+#include <math.h>
+
+#define WGS84_A    6378137.0
+#define WGS84_E2   6.69437999014e-3
+#define DEG2RAD_D  0.017453292519943295
+
+void LocalFrame_Init(LocalFrame_t *frame, double latitude, double longitude, float altitude) {
+    double sin_lat = sin(latitude * DEG2RAD_D);
+    double w = 1.0 - WGS84_E2 * sin_lat * sin_lat;
+    double sqrt_w = sqrt(w);
+
+    // Meridional (M) and prime-vertical (N) radii of curvature
+    double radius_m = WGS84_A * (1.0 - WGS84_E2) / (w * sqrt_w);
+    double radius_n = WGS84_A / sqrt_w;
+
+    frame->ref_lat = latitude;
+    frame->ref_lon = longitude;
+    frame->ref_alt = altitude;
+    frame->meters_per_deg_n = radius_m * DEG2RAD_D;
+    frame->meters_per_deg_e = radius_n * cos(latitude * DEG2RAD_D) * DEG2RAD_D;
+}
@@ -0,0 +1,217 @@
+/*
+ * loop_profiler.cpp - Control loop timing instrumentation for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Bucket layout: values below 16 ticks map 1:1, larger values use the
+ * position of the leading bit plus the next three bits. Indexing is a CLZ
+ * and two shifts, so recording costs a few dozen cycles on the M7.
+ */
+
+#include "loop_profiler.h"
+#include "system_clock.h"
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef TMF_HOST
+#include <time.h>
+#else
+#include "stm32f7xx_hal.h"
+#endif
+
+#define SNAPSHOT_RETRIES 8
+
+typedef struct {
+    std::atomic<uint32_t> sequence;   // Odd while the writer is mid-update
+    Profile_Histogram_t hist;
+} Profile_ChannelState_t;
+
+static Profile_ChannelState_t channels[PROFILE_CHANNEL_COUNT];
+static uint32_t nominal_period_us = 0;
+static uint64_t last_frame_us = 0;
+static bool have_last_frame = false;
+
+static const char *const channel_names[PROFILE_CHANNEL_COUNT] = {
+    "sensors",
+    "flight_control",
+    "propulsion",
+    "blackbox",
+    "power",
+    "navigation",
+    "loop_period",
+    "loop_jitter",
+};
+
+static uint32_t ticks_per_us(void);
+static uint32_t bucket_index(uint32_t ticks);
+static uint64_t bucket_upper_bound(uint32_t index);
+
+void Profiler_Init(uint32_t nominal_us) {
+    for (int i = 0; i < PROFILE_CHANNEL_COUNT; i++) {
+        memset(&channels[i].hist, 0, sizeof(Profile_Histogram_t));
+        channels[i].hist.min_ticks = UINT32_MAX;
+        channels[i].sequence.store(0, std::memory_order_relaxed);
+    }
+    nominal_period_us = nominal_us;
+    have_last_frame = false;
+}
+
+uint32_t Profiler_Now(void) {
+#ifdef TMF_HOST
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+#else
+    return DWT->CYCCNT;
+#endif
+}
+
+void Profiler_Record(Profile_Channel_t channel, uint32_t ticks) {
+    Profile_ChannelState_t *state = &channels[channel];
+    Profile_Histogram_t *hist = &state->hist;
+
+    uint32_t seq = state->sequence.load(std::memory_order_relaxed);
+    state->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    hist->count++;
+    hist->sum_ticks += ticks;
+    if (ticks < hist->min_ticks) hist->min_ticks = ticks;
+    if (ticks > hist->max_ticks) hist->max_ticks = ticks;
+    hist->buckets[bucket_index(ticks)]++;
+
+    state->sequence.store(seq + 2, std::memory_order_release);
+}
+
+void Profiler_MarkFrameStart(void) {
+    uint64_t now_us = SystemClock_Micros();
+
+    if (have_last_frame) {
+        uint32_t period_us = (uint32_t)(now_us - last_frame_us);
+        uint32_t jitter_us = (period_us > nominal_period_us) ? period_us - nominal_period_us
+                                                             : nominal_period_us - period_us;
+        uint32_t scale = ticks_per_us();
+        Profiler_Record(PROFILE_LOOP_PERIOD, period_us * scale);
+        Profiler_Record(PROFILE_LOOP_JITTER, jitter_us * scale);
+    }
+
+    last_frame_us = now_us;
+    have_last_frame = true;
+}
+
+bool Profiler_Snapshot(Profile_Snapshot_t *snapshot) {
+    bool consistent = true;
+    snapshot->ticks_per_us = ticks_per_us();
+
+    for (int i = 0; i < PROFILE_CHANNEL_COUNT; i++) {
+        Profile_ChannelState_t *state = &channels[i];
+        bool captured = false;
+
+        for (int attempt = 0; attempt < SNAPSHOT_RETRIES && !captured; attempt++) {
+            uint32_t before = state->sequence.load(std::memory_order_acquire);
+            if (before & 1U) continue;
+
+            memcpy(&snapshot->channels[i], &state->hist, sizeof(Profile_Histogram_t));
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            captured = (state->sequence.load(std::memory_order_relaxed) == before);
+        }
+
+        if (!captured) {
+            memcpy(&snapshot->channels[i], &state->hist, sizeof(Profile_Histogram_t));
+            consistent = false;
+        }
+    }
+    return consistent;
+}
+
+uint32_t Profiler_Percentile(const Profile_Histogram_t *hist, float percentile) {
+    if (hist->count == 0) return 0;
+
+    uint64_t rank = (uint64_t)((percentile / 100.0f) * (float)hist->count + 0.5f);
+    if (rank < 1) rank = 1;
+    if (rank > hist->count) rank = hist->count;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < PROFILE_BUCKET_COUNT; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            // Never report beyond the observed extremes
+            uint64_t bound = bucket_upper_bound(i);
+            if (bound > hist->max_ticks) bound = hist->max_ticks;
+            if (bound < hist->min_ticks) bound = hist->min_ticks;
+            return (uint32_t)bound;
+        }
+    }
+    return hist->max_ticks;
+}
+
+size_t Profiler_Dump(const Profile_Snapshot_t *snapshot, char *buffer, size_t length) {
+    static const float percentiles[] = { 50.0f, 90.0f, 99.0f, 99.9f };
+    size_t used = 0;
+    int n;
+
+    if (buffer == NULL || length == 0) return 0;
+    buffer[0] = '\0';
+
+    float scale = 1.0f / (float)snapshot->ticks_per_us;
+
+    n = snprintf(buffer, length,
+                 "# tmf-profile v1 ticks_per_us=%lu\n"
+                 "channel,count,min_us,mean_us,p50_us,p90_us,p99_us,p999_us,max_us\n",
+                 (unsigned long)snapshot->ticks_per_us);
+    if (n < 0 || (size_t)n >= length) return length - 1;
+    used = (size_t)n;
+
+    for (int i = 0; i < PROFILE_CHANNEL_COUNT; i++) {
+        const Profile_Histogram_t *hist = &snapshot->channels[i];
+        float mean = hist->count ? (float)hist->sum_ticks / (float)hist->count : 0.0f;
+        uint32_t min_ticks = hist->count ? hist->min_ticks : 0;
+
+        n = snprintf(buffer + used, length - used, "%s,%lu,%.3f,%.3f",
+                     channel_names[i], (unsigned long)hist->count,
+                     min_ticks * scale, mean * scale);
+        if (n < 0 || (size_t)n >= length - used) return length - 1;
+        used += (size_t)n;
+
+        for (size_t p = 0; p < sizeof(percentiles) / sizeof(percentiles[0]); p++) {
+            n = snprintf(buffer + used, length - used, ",%.3f",
+                         Profiler_Percentile(hist, percentiles[p]) * scale);
+            if (n < 0 || (size_t)n >= length - used) return length - 1;
+            used += (size_t)n;
+        }
+
+        n = snprintf(buffer + used, length - used, ",%.3f\n", hist->max_ticks * scale);
+        if (n < 0 || (size_t)n >= length - used) return length - 1;
+        used += (size_t)n;
+    }
+    return used;
+}
+
+/* --- Internal helpers --- */
+
+static uint32_t ticks_per_us(void) {
+#ifdef TMF_HOST
+    return 1000U;   // CLOCK_MONOTONIC nanoseconds
+#else
+    return SystemCoreClock / 1000000U;
+#endif
+}
+
+static uint32_t bucket_index(uint32_t ticks) {
+    if (ticks < 16) return ticks;
+
+    uint32_t msb = 31U - (uint32_t)__builtin_clz(ticks);
+    uint32_t sub = (ticks >> (msb - 3U)) & 7U;
+    return 16U + (msb - 4U) * 8U + sub;
+}
+
+static uint64_t bucket_upper_bound(uint32_t index) {
+    if (index < 16) return index;
+
+    uint32_t msb = (index - 16U) / 8U + 4U;
+    uint32_t sub = (index - 16U) % 8U;
+    return ((uint64_t)(9U + sub) << (msb - 3U)) - 1U;
+}
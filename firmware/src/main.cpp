@@ -4,22 +4,255 @@
  * Author: BryceWDesign
  * License: Apache-2.0
  *
- * Initializes all subsystems and runs the real-time flight control loop.
+ * Initializes all subsystems and runs the multi-rate flight control tasks.
  * This version assumes test mode inputs are simulated.
  */
 
+#include "blackbox.h"
 #include "flight_control.h"
+#include "geofence.h"
+#include "hardware_drivers.h"
+#include "imu_stream.h"
+#include "loop_profiler.h"
+#include "mission.h"
+#include "navigation.h"
+#include "params.h"
 #include "power_monitor.h"
 #include "propulsion_driver.h"
+#include "scheduler.h"
 #include "sensors.h"
+#include "system_clock.h"
+#include "telemetry.h"
+#include "terrain.h"
+#include "stm32f7xx_hal.h"
 #include <cstdio>
 #include <cmath>
-#include <chrono>
-#include <thread>
+#include <cstring>
 
-#define LOOP_INTERVAL_MS 10
+// Task rates; phases stagger releases so tasks never share a tick.
+// IMU samples arrive by interrupt (see imu_stream.h) and the control task
+// drains them, so there is no polling task.
+#define CONTROL_PERIOD_US  2000    // 500 Hz attitude control
+#define CONTROL_PHASE_US   250
+#define NAV_PERIOD_US      2000    // 500 Hz navigation EKF
+#define NAV_PHASE_US       1250
+#define BARO_PERIOD_US     20000   // 50 Hz barometer
+#define BARO_PHASE_US      500
+#define GPS_PERIOD_US      100000  // 10 Hz GPS
+#define GPS_PHASE_US       750
+#define POWER_PERIOD_US    100000  // 10 Hz health checks
+#define POWER_PHASE_US     1750
+#define BLACKBOX_PERIOD_US 1000    // 1 kHz flash service (one page program each)
+#define BLACKBOX_PHASE_US  0
+#define TELEMETRY_PERIOD_US 10000  // 100 Hz radio service (streams are rate-limited inside)
+#define TELEMETRY_PHASE_US  125
+
+// Telemetry stream rates (Hz) and priorities (0 = highest)
+#define TELEMETRY_ATTITUDE_HZ    50.0f
+#define TELEMETRY_MOTORS_HZ      50.0f
+#define TELEMETRY_VELOCITY_HZ    20.0f
+#define TELEMETRY_POSITION_HZ    5.0f
+#define TELEMETRY_DIAGNOSTICS_HZ 2.0f
+
+static IMU_Data_t imu_state;
+static bool imu_valid = false;
+
+static Motor_Output_t motor_state;
+static Velocity_t velocity_state;
+static Position_t position_state;
+static Telemetry_Diagnostics_t diagnostics;
+
+static Barometer_Data_t baro_state;
+static bool baro_fresh = false;
+static GPS_Data_t gps_fix;
+static bool gps_fresh = false;
+
+// Vehicle state, one context per module
+static Sensors_t sensors;
+static FlightControl_t flight_control;
+static Navigation_t navigation;
+static Terrain_t terrain;
+static Params_t params;
+
+static Telemetry_Parser_t uplink;
+
+static void control_task(float dt, void *context) {
+    const Flight_Command_t *pilot = (const Flight_Command_t *)context;
+
+    Profiler_MarkFrameStart();
+
+    // Tuning updates land between frames, never inside one
+    if (Params_BeginFrame(&params)) {
+        FlightControl_Gains_t gains = FlightControl_GainsFromParams(Params_Active(&params));
+        FlightControl_SetGains(&flight_control, &gains);
+    }
+
+    // Drain the IMU batch; an empty ring keeps the previous attitude
+    uint32_t t0 = Profiler_Now();
+    if (Sensors_UpdateIMU(&sensors, &imu_state)) imu_valid = true;
+    Profiler_Record(PROFILE_SENSORS, Profiler_Now() - t0);
+    if (!imu_valid) return;
+
+    // The power monitor caps throttle while the coils are hot and stops
+    // the motors on a thermal shutdown; the snapshot read never blocks
+    PowerMonitor_Snapshot_t power;
+    PowerMonitor_GetSnapshot(&power);
+    Flight_Command_t limited = *pilot;
+    if (limited.throttle > power.output_limit) limited.throttle = power.output_limit;
+    const Flight_Command_t *command = &limited;
+
+    Motor_Output_t motors;
+    t0 = Profiler_Now();
+    Sensors_ComputeEulerAngles(&sensors, &imu_state);
+    FlightControl_Update(&flight_control, command, imu_state.roll, imu_state.pitch, imu_state.yaw, dt, &motors);
+    if (power.thermal == POWER_THERMAL_SHUTDOWN) memset(&motors, 0, sizeof(motors));
+    uint32_t t1 = Profiler_Now();
+    Profiler_Record(PROFILE_FLIGHT_CONTROL, t1 - t0);
+
+    PropulsionDriver_SetOutputs(&motors);
+    motor_state = motors;
+    uint32_t t2 = Profiler_Now();
+    Profiler_Record(PROFILE_PROPULSION, t2 - t1);
+
+    PID_Terms_t terms;
+    FlightControl_GetTerms(&flight_control, &terms);
+    Blackbox_Frame_t frame = {
+        .time_us = SystemClock_Micros(),
+        .gyro = { imu_state.gyro_x, imu_state.gyro_y, imu_state.gyro_z },
+        .accel = { imu_state.accel_x, imu_state.accel_y, imu_state.accel_z },
+        .attitude = { imu_state.roll, imu_state.pitch, imu_state.yaw },
+        .command = { command->roll, command->pitch, command->yaw, command->throttle },
+        .pid_p = { terms.p[0], terms.p[1], terms.p[2] },
+        .pid_i = { terms.i[0], terms.i[1], terms.i[2] },
+        .pid_d = { terms.d[0], terms.d[1], terms.d[2] },
+        .motors = { motors.motor1, motors.motor2, motors.motor3, motors.motor4 },
+    };
+    Blackbox_Log(&frame);
+    Profiler_Record(PROFILE_BLACKBOX, Profiler_Now() - t2);
+}
+
+static void baro_task(float dt, void *context) {
+    (void)dt;
+    (void)context;
+    baro_fresh = Sensors_UpdateBarometer(&sensors, &baro_state);
+}
+
+static void gps_task(float dt, void *context) {
+    (void)dt;
+    (void)context;
+
+    GPS_Data_t gps;
+    if (Sensors_UpdateGPS(&sensors, &gps) && gps.fix_type >= 2) {
+        gps_fix = gps;
+        gps_fresh = true;
+    }
+}
+
+static void nav_task(float dt, void *context) {
+    (void)dt;
+    (void)context;
+
+    uint32_t t0 = Profiler_Now();
+    Navigation_Update(&navigation,
+                      imu_valid ? &imu_state : NULL,
+                      baro_fresh ? &baro_state : NULL,
+                      gps_fresh ? &gps_fix : NULL,
+                      SystemClock_Micros());
+    Profiler_Record(PROFILE_NAVIGATION, Profiler_Now() - t0);
+
+    velocity_state = Navigation_GetVelocity(&navigation);
+    position_state = Navigation_GetPosition(&navigation);
+
+    // Each sample is fused exactly once
+    baro_fresh = false;
+    gps_fresh = false;
+}
+
+static void blackbox_task(float dt, void *context) {
+    (void)dt;
+    (void)context;
+    Blackbox_Service();
+    Params_Service(&params);
+}
+
+static void power_task(float dt, void *context) {
+    (void)dt;
+    (void)context;
+
+    uint32_t t0 = Profiler_Now();
+    bool healthy = PowerMonitor_CheckHealth();
+    Profiler_Record(PROFILE_POWER, Profiler_Now() - t0);
+
+    // Refresh the diagnostics telemetry stream
+    uint32_t misses = 0;
+    for (int id = 0; id < Scheduler_TaskCount(); id++) {
+        Scheduler_TaskStats_t task;
+        if (Scheduler_GetStats(id, &task)) misses += task.deadline_misses;
+    }
+    IMU_StreamStats_t imu_stats;
+    ImuStream_GetStats(&imu_stats);
+    Blackbox_Stats_t log_stats;
+    Blackbox_GetStats(&log_stats);
+    Telemetry_Stats_t link_stats;
+    Telemetry_GetStats(&link_stats);
+
+    diagnostics.uptime_ms = (uint32_t)(SystemClock_Micros() / 1000U);
+    diagnostics.deadline_misses = misses;
+    diagnostics.imu_dropped = imu_stats.dropped;
+    diagnostics.blackbox_dropped = log_stats.frames_dropped;
+    diagnostics.telemetry_deferred = link_stats.deferred;
+    diagnostics.health_ok = healthy ? 1 : 0;
+
+    Geofence_Status_t fence;
+    diagnostics.geofence = 0;
+    if (Navigation_GetGeofenceStatus(&navigation, &fence)) {
+        if (fence.breached) diagnostics.geofence = 2;
+        else if (fence.breach_in_s >= 0.0f) diagnostics.geofence = 1;
+    }
+}
+
+// Ground tuning commands. This task is the parameter store's tuner
+// context: edits land in the staging bank, a commit reaches the control
+// task at its next frame start, and a save is written by the flash
+// service task.
+static Telemetry_UplinkResult_t handle_uplink(const Telemetry_Parser_t *frame) {
+    switch (frame->message_id) {
+    case TELEMETRY_MSG_PARAM_SET: {
+        Telemetry_ParamSet_t set;
+        if (frame->length != sizeof(set)) return TELEMETRY_UPLINK_UNKNOWN;
+        memcpy(&set, frame->payload, sizeof(set));
+
+        Param_Id_t id = Params_Find(set.hash);
+        if (id == PARAM_COUNT) return TELEMETRY_UPLINK_UNKNOWN;
+        Param_Value_t value;
+        value.i = (int32_t)set.value;
+        bool ok = (Params_GetInfo(id)->type == PARAM_INT32) ? Params_SetInt(&params, id, value.i)
+                                                            : Params_SetFloat(&params, id, value.f);
+        return ok ? TELEMETRY_UPLINK_OK : TELEMETRY_UPLINK_REJECTED;
+    }
+    case TELEMETRY_MSG_PARAM_COMMIT:
+        return Params_Commit(&params) ? TELEMETRY_UPLINK_OK : TELEMETRY_UPLINK_REJECTED;
+    case TELEMETRY_MSG_PARAM_SAVE:
+        return Params_Save(&params) ? TELEMETRY_UPLINK_OK : TELEMETRY_UPLINK_REJECTED;
+    default:
+        return TELEMETRY_UPLINK_UNKNOWN;
+    }
+}
+
+static void telemetry_task(float dt, void *context) {
+    (void)dt;
+    (void)context;
+
+    while (Telemetry_Receive(&uplink)) {
+        diagnostics.uplink = (uint8_t)handle_uplink(&uplink);
+    }
+    Telemetry_Service();
+}
 
 int main() {
+    HAL_Init();
+    SystemClock_Init();
+
     printf("Initializing TMF Drone Firmware...\n");
 
     if (!PowerMonitor_Init()) {
@@ -27,12 +260,38 @@ int main() {
         return -1;
     }
 
-    if (!Sensors_Init()) {
+    if (!Sensors_Init(&sensors)) {
         printf("Sensor initialization failed.\n");
         return -1;
     }
 
-    if (!FlightControl_Init()) {
+    // Baro altitudes are heights above the launch point
+    Barometer_Data_t ground;
+    if (Sensors_UpdateBarometer(&sensors, &ground)) {
+        Sensors_BaroReference_t reference = Sensors_MakeBaroReference(ground.pressure, ground.temperature, 0.0f);
+        Sensors_SetBaroReference(&sensors, &reference);
+    }
+
+    if (!Navigation_Init(&navigation, &sensors)) {
+        printf("Navigation initialization failed.\n");
+        return -1;
+    }
+
+    // Tuned parameters saved in flash override the compiled-in defaults
+    if (Params_Init(&params)) {
+        Params_Stats_t param_stats;
+        Params_GetStats(&params, &param_stats);
+        if (param_stats.sequence != 0) {
+            printf("Parameters loaded: %lu values (%lu skipped), image %lu.\n",
+                   (unsigned long)param_stats.loaded, (unsigned long)param_stats.skipped,
+                   (unsigned long)param_stats.sequence);
+        }
+    } else {
+        printf("Parameter store unavailable, flying the defaults.\n");
+    }
+
+    FlightControl_Gains_t gains = FlightControl_GainsFromParams(Params_Active(&params));
+    if (!FlightControl_Init(&flight_control, &gains)) {
         printf("Flight control initialization failed.\n");
         return -1;
     }
@@ -42,34 +301,144 @@ int main() {
         return -1;
     }
 
+    // Logging is optional: without the flash the logger rejects frames
+    if (!Blackbox_Init()) {
+        printf("Blackbox unavailable, flight will not be logged.\n");
+    }
+
+    // Terrain tiles stored below the mission let it fly heights above ground
+    if (Terrain_Open(&terrain, FLASH_TERRAIN_BASE)) {
+        Navigation_SetTerrain(&navigation, &terrain);
+        printf("Terrain loaded: %lu x %lu tiles.\n", (unsigned long)terrain.grid.tiles_north,
+               (unsigned long)terrain.grid.tiles_east);
+    }
+
+    // A mission stored in the flash partition is flown once GPS is up
+    Mission_Source_t stored_mission;
+    if (Mission_FlashSource(&stored_mission, FLASH_MISSION_BASE) && Navigation_SetMission(&navigation, &stored_mission)) {
+        printf("Mission loaded: %lu waypoints.\n", (unsigned long)stored_mission.count);
+    }
+
+    Telemetry_ParserInit(&uplink);
+    if (Telemetry_Init()) {
+        Telemetry_AddStream(TELEMETRY_MSG_ATTITUDE, &imu_state, sizeof(imu_state), TELEMETRY_ATTITUDE_HZ, 0);
+        Telemetry_AddStream(TELEMETRY_MSG_MOTORS, &motor_state, sizeof(motor_state), TELEMETRY_MOTORS_HZ, 1);
+        Telemetry_AddStream(TELEMETRY_MSG_VELOCITY, &velocity_state, sizeof(velocity_state),
+                            TELEMETRY_VELOCITY_HZ, 2);
+        Telemetry_AddStream(TELEMETRY_MSG_POSITION, &position_state, sizeof(position_state),
+                            TELEMETRY_POSITION_HZ, 3);
+        Telemetry_AddStream(TELEMETRY_MSG_DIAGNOSTICS, &diagnostics, sizeof(diagnostics),
+                            TELEMETRY_DIAGNOSTICS_HZ, 4);
+    } else {
+        printf("Telemetry link unavailable.\n");
+    }
+
     printf("Initialization complete. Entering control loop...\n");
 
     // Dummy command: can later be replaced by RC input, AI pilot, or BCI interface
-    Flight_Command_t command = {
+    static Flight_Command_t command = {
         .roll = 0.0f,
         .pitch = 0.0f,
         .yaw = 0.0f,
         .throttle = 0.6f
     };
 
-    while (true) {
-        float current_roll = 0.0f;
-        float current_pitch = 0.0f;
-        float current_yaw = 0.0f;
+    Profiler_Init(CONTROL_PERIOD_US);
 
-        if (!Sensors_ReadIMU(&current_roll, &current_pitch, &current_yaw)) {
-            printf("Sensor read error. Skipping frame.\n");
-            continue;
-        }
+    Scheduler_Init();
+    Scheduler_AddTask("control", control_task, &command, CONTROL_PERIOD_US, CONTROL_PHASE_US);
+    Scheduler_AddTask("nav", nav_task, NULL, NAV_PERIOD_US, NAV_PHASE_US);
+    Scheduler_AddTask("baro", baro_task, NULL, BARO_PERIOD_US, BARO_PHASE_US);
+    Scheduler_AddTask("gps", gps_task, NULL, GPS_PERIOD_US, GPS_PHASE_US);
+    Scheduler_AddTask("power", power_task, NULL, POWER_PERIOD_US, POWER_PHASE_US);
+    Scheduler_AddTask("blackbox", blackbox_task, NULL, BLACKBOX_PERIOD_US, BLACKBOX_PHASE_US);
+    Scheduler_AddTask("telemetry", telemetry_task, NULL, TELEMETRY_PERIOD_US, TELEMETRY_PHASE_US);
+    Scheduler_Start();
+
+    while (SystemClock_ShouldRun()) {
+        Scheduler_RunOnce();
+    }
 
-        Motor_Output_t motors;
-        FlightControl_Update(&command, current_roll, current_pitch, current_yaw, &motors);
-        PropulsionDriver_SetOutputs(&motors);
+    printf("Control loop stopped at t=%llu us.\n", (unsigned long long)SystemClock_Micros());
 
-        PowerMonitor_CheckHealth(); // Optional: alert/log on issues
+    // Write out the tail of the log
+    while (!Blackbox_IsIdle()) {
+        Blackbox_Flush();
+        Blackbox_Service();
+        SystemClock_SleepUntil(SystemClock_Micros() + 100);
+    }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(LOOP_INTERVAL_MS));
+    for (int id = 0; id < Scheduler_TaskCount(); id++) {
+        Scheduler_TaskStats_t stats;
+        Scheduler_GetStats(id, &stats);
+        printf("task %-9s period=%luus runs=%lu misses=%lu skipped=%lu max_exec=%luus\n",
+               stats.name, (unsigned long)stats.period_us, (unsigned long)stats.run_count,
+               (unsigned long)stats.deadline_misses, (unsigned long)stats.skipped_releases,
+               (unsigned long)stats.max_exec_us);
     }
 
+    IMU_StreamStats_t imu_stats;
+    ImuStream_GetStats(&imu_stats);
+    printf("imu stream published=%lu dropped=%lu max_depth=%lu\n",
+           (unsigned long)imu_stats.published, (unsigned long)imu_stats.dropped,
+           (unsigned long)imu_stats.max_depth);
+
+    Blackbox_Stats_t log_stats;
+    Blackbox_GetStats(&log_stats);
+    printf("blackbox logged=%lu dropped=%lu rejected=%lu bytes=%lu pages=%lu sectors=%lu "
+           "span=0x%08lx-0x%08lx%s\n",
+           (unsigned long)log_stats.frames_logged, (unsigned long)log_stats.frames_dropped,
+           (unsigned long)log_stats.frames_rejected, (unsigned long)log_stats.bytes_logged,
+           (unsigned long)log_stats.pages_programmed, (unsigned long)log_stats.sectors_erased,
+           (unsigned long)log_stats.log_start, (unsigned long)log_stats.write_address,
+           log_stats.flash_full ? " (flash full)" : "");
+
+    float vertical_altitude = 0.0f, climb_rate = 0.0f;
+    Sensors_GetVertical(&sensors, &vertical_altitude, &climb_rate);
+    printf("vertical altitude=%.2fm climb=%.2fm/s accel_bias=%.3fm/s2 baro_samples=%lu\n", vertical_altitude,
+           climb_rate, sensors.vertical.accel_bias, (unsigned long)sensors.vertical.baro_samples);
+
+    Params_Stats_t param_stats;
+    Params_GetStats(&params, &param_stats);
+    printf("params loaded=%lu skipped=%lu commits=%lu saves=%lu image=%lu slot=%lu\n",
+           (unsigned long)param_stats.loaded, (unsigned long)param_stats.skipped,
+           (unsigned long)param_stats.commits, (unsigned long)param_stats.saves,
+           (unsigned long)param_stats.sequence, (unsigned long)param_stats.slot);
+
+    Telemetry_Stats_t link_stats;
+    Telemetry_GetStats(&link_stats);
+    printf("telemetry frames=%lu bytes=%lu deferred=%lu max_ring=%lu demand=%lu/%d B/s\n",
+           (unsigned long)link_stats.frames_sent, (unsigned long)link_stats.bytes_queued,
+           (unsigned long)link_stats.deferred, (unsigned long)link_stats.max_ring_depth,
+           (unsigned long)link_stats.demand_bytes_per_s, TELEMETRY_BUDGET_BYTES_PER_S);
+
+    PropulsionDriver_Telemetry_t esc;
+    PropulsionDriver_GetTelemetry(&esc);
+    printf("propulsion dshot%d frames=%lu skipped=%lu replies=%lu bad=%lu rpm=%.0f/%.0f/%.0f/%.0f\n",
+           PROPULSION_DSHOT_RATE / 1000, (unsigned long)esc.frames_sent, (unsigned long)esc.frames_skipped,
+           (unsigned long)esc.replies_ok, (unsigned long)esc.replies_bad, esc.rpm[0], esc.rpm[1],
+           esc.rpm[2], esc.rpm[3]);
+
+    PowerMonitor_Snapshot_t power;
+    PowerMonitor_GetSnapshot(&power);
+    printf("power battery=%.2fV (%.2f-%.2f) %.1fA %.1fW energy=%.2fWh charge=%.0fmAh shed=%u\n",
+           power.channels[POWER_CH_BATTERY_V].mean, power.channels[POWER_CH_BATTERY_V].min,
+           power.channels[POWER_CH_BATTERY_V].max, power.channels[POWER_CH_BATTERY_I].mean,
+           power.battery_power_w, power.battery_energy_wh, power.battery_charge_mah,
+           (unsigned)power.shed_level);
+    printf("power coil=%.1fW energy=%.2fWh temp=%.1f/%.1f/%.1f/%.1fC max=%.1fC faults=0x%x "
+           "thermal=%s limit=%.2f avionics=%.2fV healthy=%d\n",
+           power.coil_power_w, power.coil_energy_wh, power.coil_temp_c[0], power.coil_temp_c[1],
+           power.coil_temp_c[2], power.coil_temp_c[3], power.coil_temp_max_c,
+           (unsigned)power.sensor_faults,
+           power.thermal == POWER_THERMAL_SHUTDOWN ? "shutdown" :
+           power.thermal == POWER_THERMAL_THROTTLE ? "throttle" : "normal",
+           power.output_limit, power.channels[POWER_CH_AVIONICS_V].mean, power.healthy ? 1 : 0);
+
+    static Profile_Snapshot_t snapshot;
+    static char report[1024];
+    Profiler_Snapshot(&snapshot);
+    Profiler_Dump(&snapshot, report, sizeof(report));
+    printf("%s", report);
     return 0;
 }
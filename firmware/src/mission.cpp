@@ -0,0 +1,138 @@
+/*
+ * mission.cpp - Streamed mission storage for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * The flash source shares the logging flash with the blackbox, whose
+ * page programs and erases run in the background. A read is a short QSPI
+ * transfer, so it is only issued while the flash is idle; when it is busy
+ * the source returns nothing and the planner asks again next tick.
+ */
+
+#include "mission.h"
+#include "hardware_drivers.h"
+#include "telemetry.h"
+#include <math.h>
+#include <string.h>
+
+#define MISSION_READ_CHUNK 8   // Records per flash read
+
+static const uint8_t mission_magic[4] = { 'T', 'M', 'F', 'M' };
+
+static uint32_t array_read(Mission_Source_t *source, uint32_t first, Waypoint_t *out, uint32_t count);
+static uint32_t flash_read(Mission_Source_t *source, uint32_t first, Waypoint_t *out, uint32_t count);
+static void put_u16(uint8_t *p, uint16_t v);
+static void put_u32(uint8_t *p, uint32_t v);
+static uint16_t get_u16(const uint8_t *p);
+static uint32_t get_u32(const uint8_t *p);
+
+void Mission_ArraySource(Mission_Source_t *source, const Waypoint_t *waypoints, uint32_t count) {
+    source->read = array_read;
+    source->context = waypoints;
+    source->address = 0;
+    source->count = count;
+    source->flags = 0;
+    source->failed = false;
+}
+
+bool Mission_FlashSource(Mission_Source_t *source, uint32_t address) {
+    uint8_t header[MISSION_HEADER_BYTES];
+    uint32_t count;
+    uint16_t flags;
+    if (!Flash_Read(address, header, sizeof(header))) return false;
+    if (!Mission_DecodeHeader(header, &count, &flags)) return false;
+    if ((uint64_t)count * MISSION_RECORD_BYTES > FLASH_CAPACITY - address - MISSION_HEADER_BYTES) return false;
+
+    source->read = flash_read;
+    source->context = NULL;
+    source->address = address + MISSION_HEADER_BYTES;
+    source->count = count;
+    source->flags = flags;
+    source->failed = false;
+    return true;
+}
+
+void Mission_EncodeHeader(uint32_t count, uint16_t flags, uint8_t header[MISSION_HEADER_BYTES]) {
+    memcpy(header, mission_magic, sizeof(mission_magic));
+    put_u16(header + 4, MISSION_VERSION);
+    put_u16(header + 6, MISSION_RECORD_BYTES);
+    put_u32(header + 8, count);
+    put_u16(header + 12, flags);
+    put_u16(header + 14, Telemetry_Crc16(0xFFFF, header, 14));
+}
+
+void Mission_EncodeRecord(const Waypoint_t *waypoint, uint8_t record[MISSION_RECORD_BYTES]) {
+    float hold = waypoint->hold_time;
+    if (!(hold > 0.0f)) hold = 0.0f;
+    if (hold > MISSION_MAX_HOLD_S) hold = MISSION_MAX_HOLD_S;
+
+    put_u32(record + 0, (uint32_t)(int32_t)llround(waypoint->position.latitude * 1e7));
+    put_u32(record + 4, (uint32_t)(int32_t)llround(waypoint->position.longitude * 1e7));
+    put_u32(record + 8, (uint32_t)(int32_t)lroundf(waypoint->position.altitude * 1000.0f));
+    put_u16(record + 12, (uint16_t)lroundf(hold * 10.0f));
+    put_u16(record + 14, Telemetry_Crc16(0xFFFF, record, 14));
+}
+
+bool Mission_DecodeHeader(const uint8_t header[MISSION_HEADER_BYTES], uint32_t *count, uint16_t *flags) {
+    if (memcmp(header, mission_magic, sizeof(mission_magic)) != 0) return false;
+    if (get_u16(header + 14) != Telemetry_Crc16(0xFFFF, header, 14)) return false;
+    if (get_u16(header + 4) != MISSION_VERSION || get_u16(header + 6) != MISSION_RECORD_BYTES) return false;
+    *count = get_u32(header + 8);
+    *flags = get_u16(header + 12);
+    return true;
+}
+
+bool Mission_DecodeRecord(const uint8_t record[MISSION_RECORD_BYTES], Waypoint_t *waypoint) {
+    if (get_u16(record + 14) != Telemetry_Crc16(0xFFFF, record, 14)) return false;
+    waypoint->position.latitude = (double)(int32_t)get_u32(record + 0) * 1e-7;
+    waypoint->position.longitude = (double)(int32_t)get_u32(record + 4) * 1e-7;
+    waypoint->position.altitude = (float)(int32_t)get_u32(record + 8) * 0.001f;
+    waypoint->hold_time = (float)get_u16(record + 12) * 0.1f;
+    return true;
+}
+
+/* --- Sources --- */
+
+static uint32_t array_read(Mission_Source_t *source, uint32_t first, Waypoint_t *out, uint32_t count) {
+    memcpy(out, (const Waypoint_t *)source->context + first, count * sizeof(Waypoint_t));
+    return count;
+}
+
+static uint32_t flash_read(Mission_Source_t *source, uint32_t first, Waypoint_t *out, uint32_t count) {
+    if (Flash_IsBusy()) return 0;
+
+    uint8_t records[MISSION_READ_CHUNK * MISSION_RECORD_BYTES];
+    if (count > MISSION_READ_CHUNK) count = MISSION_READ_CHUNK;
+    if (!Flash_Read(source->address + first * MISSION_RECORD_BYTES, records,
+                    count * MISSION_RECORD_BYTES)) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (!Mission_DecodeRecord(&records[i * MISSION_RECORD_BYTES], &out[i])) {
+            source->failed = true;
+            return i;
+        }
+    }
+    return count;
+}
+
+/* --- Byte order --- */
+
+static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
@@ -0,0 +1,333 @@
+/*
+ * nav_ekf.cpp - Navigation extended Kalman filter for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Error-state dynamics (NED, global attitude error, body gyro bias):
+ *   d(dp)/dt = dv
+ *   d(dv)/dt = -[f_n]x dtheta + accel noise
+ *   d(dtheta)/dt = -R db + gyro noise
+ *   d(db)/dt = bias random walk
+ * where R rotates body (FLU) rates into the NED error frame. With
+ * F = I + A dt the blocks of F P F^T reduce to (A=Ppp, B=Ppv, C=Ppt,
+ * D=Pvv, E=Pvt, G=Ptt, H=Ppb, J=Pvb, K=Ptb, W=Pbb, M = -[f_n]x dt,
+ * L = -R dt). F factors exactly into the position / velocity / attitude
+ * step followed by the bias coupling, so the first pass is
+ *   A' = A + dt (B + B^T) + dt^2 D
+ *   B' = B + dt D + (C + dt E) M^T
+ *   C' = C + dt E
+ *   D' = D + M E^T + E M^T + M G M^T
+ *   E' = E + M G
+ *   H' = H + dt J
+ *   J' = J + M K
+ * and the second adds L times the bias row to the attitude row:
+ *   C'' = C' + H' L^T
+ *   E'' = E' + J' L^T
+ *   G'' = G + L K^T + K L^T + L W L^T
+ *   K'' = K + L W
+ */
+
+#include "nav_ekf.h"
+#include <math.h>
+#include <string.h>
+
+#define GRAVITY             9.80665f
+#define DEG2RAD_F           0.0174532925f
+
+#define IDX_POS 0
+#define IDX_VEL 3
+#define IDX_ATT 6
+#define IDX_BIAS 9
+
+static void reset_covariance(NavEkf_t *ekf);
+static bool fuse_scalar(NavEkf_t *ekf, int index, float innovation, float variance, float dx[NAV_EKF_STATES]);
+static void inject_error(NavEkf_t *ekf, const float dx[NAV_EKF_STATES]);
+static const float *displacement_at(const NavEkf_t *ekf, uint64_t time_us);
+
+NavEkf_Config_t NavEkf_DefaultConfig(void) {
+    NavEkf_Config_t config;
+    config.accel_noise = 0.35f;
+    config.gyro_noise = 0.005f;
+    config.gyro_bias_noise = 0.01f;
+    config.gps_pos_noise_h = 2.5f;
+    config.gps_pos_noise_v = 5.0f;
+    config.baro_noise = 1.0f;
+    config.innovation_gate = 5.0f;
+    return config;
+}
+
+void NavEkf_Init(NavEkf_t *ekf, const NavEkf_Config_t *config, Quaternion_t q) {
+    memset(ekf, 0, sizeof(NavEkf_t));
+    ekf->config = (config != NULL) ? *config : NavEkf_DefaultConfig();
+    ekf->q = q;
+    reset_covariance(ekf);
+}
+
+void NavEkf_Predict(NavEkf_t *ekf, const IMU_Data_t *imu, float dt, uint64_t time_us) {
+    float q0 = ekf->q.w, q1 = ekf->q.x, q2 = ekf->q.y, q3 = ekf->q.z;
+    float fx = imu->accel_x, fy = imu->accel_y, fz = imu->accel_z;
+
+    // Specific force into north-west-up, then to NED
+    float f_n = (1.0f - 2.0f * (q2 * q2 + q3 * q3)) * fx + 2.0f * (q1 * q2 - q0 * q3) * fy + 2.0f * (q1 * q3 + q0 * q2) * fz;
+    float f_w = 2.0f * (q1 * q2 + q0 * q3) * fx + (1.0f - 2.0f * (q1 * q1 + q3 * q3)) * fy + 2.0f * (q2 * q3 - q0 * q1) * fz;
+    float f_u = 2.0f * (q1 * q3 - q0 * q2) * fx + 2.0f * (q2 * q3 + q0 * q1) * fy + (1.0f - 2.0f * (q1 * q1 + q2 * q2)) * fz;
+    float f_ned[3] = { f_n, -f_w, -f_u };
+    float accel[3] = { f_ned[0], f_ned[1], f_ned[2] + GRAVITY };
+
+    // Nominal position / velocity
+    for (int i = 0; i < 3; i++) {
+        float step = ekf->vel[i] * dt + 0.5f * accel[i] * dt * dt;
+        ekf->pos[i] += step;
+        ekf->displacement[i] += step;
+        ekf->vel[i] += accel[i] * dt;
+    }
+
+    // Nominal attitude: q <- q (x) [1, (w - b) dt / 2]
+    float hx = (imu->gyro_x * DEG2RAD_F - ekf->gyro_bias[0]) * 0.5f * dt;
+    float hy = (imu->gyro_y * DEG2RAD_F - ekf->gyro_bias[1]) * 0.5f * dt;
+    float hz = (imu->gyro_z * DEG2RAD_F - ekf->gyro_bias[2]) * 0.5f * dt;
+    float nq0 = q0 - q1 * hx - q2 * hy - q3 * hz;
+    float nq1 = q1 + q0 * hx + q2 * hz - q3 * hy;
+    float nq2 = q2 + q0 * hy - q1 * hz + q3 * hx;
+    float nq3 = q3 + q0 * hz + q1 * hy - q2 * hx;
+    float inv = 1.0f / sqrtf(nq0 * nq0 + nq1 * nq1 + nq2 * nq2 + nq3 * nq3);
+    ekf->q.w = nq0 * inv;
+    ekf->q.x = nq1 * inv;
+    ekf->q.y = nq2 * inv;
+    ekf->q.z = nq3 * inv;
+
+    // Covariance, block-wise (see file header)
+    SymMatrix<NAV_EKF_STATES> &P = ekf->P;
+    Matrix<3, 3> A = P.Block<3>(IDX_POS, IDX_POS);
+    Matrix<3, 3> B = P.Block<3>(IDX_POS, IDX_VEL);
+    Matrix<3, 3> C = P.Block<3>(IDX_POS, IDX_ATT);
+    Matrix<3, 3> D = P.Block<3>(IDX_VEL, IDX_VEL);
+    Matrix<3, 3> E = P.Block<3>(IDX_VEL, IDX_ATT);
+    Matrix<3, 3> G = P.Block<3>(IDX_ATT, IDX_ATT);
+    Matrix<3, 3> H = P.Block<3>(IDX_POS, IDX_BIAS);
+    Matrix<3, 3> J = P.Block<3>(IDX_VEL, IDX_BIAS);
+    Matrix<3, 3> K = P.Block<3>(IDX_ATT, IDX_BIAS);
+    Matrix<3, 3> W = P.Block<3>(IDX_BIAS, IDX_BIAS);
+    Matrix<3, 3> M = Skew(f_ned[0], f_ned[1], f_ned[2]) * (-dt);
+
+    // Body to NED rotation of the (pre-step) attitude, scaled by -dt
+    Matrix<3, 3> L;
+    L(0, 0) = -(1.0f - 2.0f * (q2 * q2 + q3 * q3)) * dt;
+    L(0, 1) = -2.0f * (q1 * q2 - q0 * q3) * dt;
+    L(0, 2) = -2.0f * (q1 * q3 + q0 * q2) * dt;
+    L(1, 0) = 2.0f * (q1 * q2 + q0 * q3) * dt;
+    L(1, 1) = (1.0f - 2.0f * (q1 * q1 + q3 * q3)) * dt;
+    L(1, 2) = 2.0f * (q2 * q3 - q0 * q1) * dt;
+    L(2, 0) = 2.0f * (q1 * q3 - q0 * q2) * dt;
+    L(2, 1) = 2.0f * (q2 * q3 + q0 * q1) * dt;
+    L(2, 2) = (1.0f - 2.0f * (q1 * q1 + q2 * q2)) * dt;
+
+    Matrix<3, 3> C_next = C + E * dt;
+    Matrix<3, 3> MG = M * G;
+    Matrix<3, 3> ME_t = MultiplyTransposed(M, E);
+
+    Matrix<3, 3> A_next = A + (B + B.Transposed()) * dt + D * (dt * dt);
+    Matrix<3, 3> B_next = B + D * dt + MultiplyTransposed(C_next, M);
+    Matrix<3, 3> D_next = D + ME_t + ME_t.Transposed() + MultiplyTransposed(MG, M);
+    Matrix<3, 3> E_next = E + MG;
+    Matrix<3, 3> H_next = H + J * dt;
+    Matrix<3, 3> J_next = J + M * K;
+
+    Matrix<3, 3> LK_t = MultiplyTransposed(L, K);
+    Matrix<3, 3> LW = L * W;
+    C_next = C_next + MultiplyTransposed(H_next, L);
+    E_next = E_next + MultiplyTransposed(J_next, L);
+    Matrix<3, 3> G_next = G + LK_t + LK_t.Transposed() + MultiplyTransposed(LW, L);
+    Matrix<3, 3> K_next = K + LW;
+
+    float q_vel = ekf->config.accel_noise * dt;
+    float q_att = ekf->config.gyro_noise * dt;
+    float q_bias = ekf->config.gyro_bias_noise * dt;
+    for (int i = 0; i < 3; i++) {
+        D_next(i, i) += q_vel * q_vel;
+        G_next(i, i) += q_att * q_att;
+        W(i, i) += q_bias * q_bias;
+    }
+
+    P.SetDiagonalBlock<3>(IDX_POS, A_next);
+    P.SetBlock<3>(IDX_POS, IDX_VEL, B_next);
+    P.SetBlock<3>(IDX_POS, IDX_ATT, C_next);
+    P.SetBlock<3>(IDX_POS, IDX_BIAS, H_next);
+    P.SetDiagonalBlock<3>(IDX_VEL, D_next);
+    P.SetBlock<3>(IDX_VEL, IDX_ATT, E_next);
+    P.SetBlock<3>(IDX_VEL, IDX_BIAS, J_next);
+    P.SetDiagonalBlock<3>(IDX_ATT, G_next);
+    P.SetBlock<3>(IDX_ATT, IDX_BIAS, K_next);
+    P.SetDiagonalBlock<3>(IDX_BIAS, W);
+
+    // Displacement history for delayed measurements
+    NavEkf_History_t *slot = &ekf->history[ekf->history_head];
+    slot->time_us = time_us;
+    memcpy(slot->displacement, ekf->displacement, sizeof(slot->displacement));
+    ekf->history_head = (ekf->history_head + 1) % NAV_EKF_HISTORY_LEN;
+    if (ekf->history_count < NAV_EKF_HISTORY_LEN) ekf->history_count++;
+    ekf->time_us = time_us;
+}
+
+bool NavEkf_FuseBaro(NavEkf_t *ekf, float altitude) {
+    if (!ekf->baro_referenced) {
+        // Baro datum differs from GPS; anchor it to the current estimate
+        ekf->baro_offset = altitude + ekf->pos[2];
+        ekf->baro_referenced = true;
+        return true;
+    }
+
+    float dx[NAV_EKF_STATES] = { 0 };
+    float measured_down = ekf->baro_offset - altitude;
+    float noise = ekf->config.baro_noise;
+
+    if (!fuse_scalar(ekf, IDX_POS + 2, measured_down - ekf->pos[2], noise * noise, dx)) {
+        ekf->baro_rejects++;
+        return false;
+    }
+    inject_error(ekf, dx);
+    return true;
+}
+
+bool NavEkf_FuseGps(NavEkf_t *ekf, double latitude, double longitude, float altitude,
+                    uint64_t measured_us) {
+    // Motion flown since the fix was taken
+    const float *then = displacement_at(ekf, measured_us);
+    float motion[3] = { 0.0f, 0.0f, 0.0f };
+    if (then != NULL) {
+        for (int i = 0; i < 3; i++) motion[i] = ekf->displacement[i] - then[i];
+    }
+
+    if (!ekf->origin_set) {
+        LocalFrame_Init(&ekf->origin, latitude, longitude, altitude);
+        ekf->origin_set = true;
+        ekf->baro_referenced = false;
+        memcpy(ekf->pos, motion, sizeof(ekf->pos));
+        reset_covariance(ekf);
+        return true;
+    }
+
+    float measured[3];
+    LocalFrame_ToNED(&ekf->origin, latitude, longitude, altitude, measured);
+
+    if (ekf->gps_reject_streak >= NAV_EKF_GPS_RESET) {
+        // Estimate has diverged from a consistent receiver; trust the receiver
+        for (int i = 0; i < 3; i++) ekf->pos[i] = measured[i] + motion[i];
+        ekf->gps_reject_streak = 0;
+        ekf->baro_referenced = false;
+        reset_covariance(ekf);
+        return true;
+    }
+
+    float noise_h = ekf->config.gps_pos_noise_h * ekf->config.gps_pos_noise_h;
+    float noise_v = ekf->config.gps_pos_noise_v * ekf->config.gps_pos_noise_v;
+    float dx[NAV_EKF_STATES] = { 0 };
+    bool accepted = true;
+
+    for (int i = 0; i < 3; i++) {
+        float predicted = ekf->pos[i] - motion[i] + dx[IDX_POS + i];
+        float variance = (i < 2) ? noise_h : noise_v;
+        if (!fuse_scalar(ekf, IDX_POS + i, measured[i] - predicted, variance, dx)) {
+            accepted = false;
+        }
+    }
+
+    if (accepted) {
+        ekf->gps_reject_streak = 0;
+    } else {
+        ekf->gps_rejects++;
+        ekf->gps_reject_streak++;
+    }
+    inject_error(ekf, dx);
+    return accepted;
+}
+
+void NavEkf_GetPosition(const NavEkf_t *ekf, double *latitude, double *longitude, float *altitude) {
+    if (!ekf->origin_set) {
+        *latitude = 0.0;
+        *longitude = 0.0;
+        *altitude = 0.0f;
+        return;
+    }
+    LocalFrame_FromNED(&ekf->origin, ekf->pos, latitude, longitude, altitude);
+}
+
+/* --- Internal helpers --- */
+
+static void reset_covariance(NavEkf_t *ekf) {
+    ekf->P.SetZero();
+    for (int i = 0; i < 3; i++) {
+        ekf->P(IDX_POS + i, IDX_POS + i) = 25.0f;     // 5 m
+        ekf->P(IDX_VEL + i, IDX_VEL + i) = 1.0f;      // 1 m/s
+        ekf->P(IDX_ATT + i, IDX_ATT + i) = 0.01f;     // ~6 deg
+        ekf->P(IDX_BIAS + i, IDX_BIAS + i) = 1.0e-5f;    // ~0.2 deg/s
+    }
+}
+
+// Scalar update for a measurement of a single state. Accumulates the
+// correction in dx; the caller injects it once all axes are fused.
+static bool fuse_scalar(NavEkf_t *ekf, int index, float innovation, float variance,
+                        float dx[NAV_EKF_STATES]) {
+    SymMatrix<NAV_EKF_STATES> &P = ekf->P;
+    float s = P(index, index) + variance;
+    float gate = ekf->config.innovation_gate;
+
+    if (innovation * innovation > gate * gate * s) return false;
+
+    float column[NAV_EKF_STATES];
+    for (int j = 0; j < NAV_EKF_STATES; j++) column[j] = P(j, index);
+
+    float inv_s = 1.0f / s;
+    for (int j = 0; j < NAV_EKF_STATES; j++) {
+        dx[j] += column[j] * inv_s * innovation;
+    }
+
+    // P -= K H P  ==  P - col col^T / s  (upper triangle only)
+    for (int j = 0; j < NAV_EKF_STATES; j++) {
+        float kj = column[j] * inv_s;
+        for (int k = j; k < NAV_EKF_STATES; k++) {
+            P(j, k) -= kj * column[k];
+        }
+    }
+    return true;
+}
+
+static void inject_error(NavEkf_t *ekf, const float dx[NAV_EKF_STATES]) {
+    for (int i = 0; i < 3; i++) {
+        ekf->pos[i] += dx[IDX_POS + i];
+        ekf->vel[i] += dx[IDX_VEL + i];
+        ekf->gyro_bias[i] += dx[IDX_BIAS + i];
+    }
+
+    // Earth-frame attitude error (NED) -> north-west-up, q <- dq (x) q
+    float hx = 0.5f * dx[IDX_ATT + 0];
+    float hy = -0.5f * dx[IDX_ATT + 1];
+    float hz = -0.5f * dx[IDX_ATT + 2];
+    float q0 = ekf->q.w, q1 = ekf->q.x, q2 = ekf->q.y, q3 = ekf->q.z;
+
+    float nq0 = q0 - hx * q1 - hy * q2 - hz * q3;
+    float nq1 = q1 + hx * q0 + hy * q3 - hz * q2;
+    float nq2 = q2 - hx * q3 + hy * q0 + hz * q1;
+    float nq3 = q3 + hx * q2 - hy * q1 + hz * q0;
+    float inv = 1.0f / sqrtf(nq0 * nq0 + nq1 * nq1 + nq2 * nq2 + nq3 * nq3);
+    ekf->q.w = nq0 * inv;
+    ekf->q.x = nq1 * inv;
+    ekf->q.y = nq2 * inv;
+    ekf->q.z = nq3 * inv;
+}
+
+// Displacement recorded at or just before time_us, NULL if no history
+static const float *displacement_at(const NavEkf_t *ekf, uint64_t time_us) {
+    if (ekf->history_count == 0) return NULL;
+
+    uint32_t index = (ekf->history_head + NAV_EKF_HISTORY_LEN - 1) % NAV_EKF_HISTORY_LEN;
+    for (uint32_t n = 0; n < ekf->history_count; n++) {
+        const NavEkf_History_t *entry = &ekf->history[index];
+        if (entry->time_us <= time_us || n + 1 == ekf->history_count) {
+            return entry->displacement;
+        }
+        index = (index + NAV_EKF_HISTORY_LEN - 1) % NAV_EKF_HISTORY_LEN;
+    }
+    return NULL;
+}
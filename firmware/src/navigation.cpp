@@ -6,9 +6,30 @@
  *
  * Implements waypoint navigation, sensor fusion update, velocity & attitude commands,
  * and mission control logic.
+ *
+ * The trajectory planner runs inside the navigation task: each tick plans
+ * at most one segment (a few legs ahead of the vehicle) and samples the
+ * active one. The mission starts from the fused position, so it waits for
+ * the first GPS fix.
+ *
+ * Terrain-relative missions are planned in height above the ground: the
+ * planner is given the vehicle's height above the follower's ground
+ * rather than its altitude, so its vertical reference, error and
+ * feed-forward are all relative to the ground, and the ground's own
+ * rate is added to the command. The mission waits for terrain under the
+ * vehicle before it starts; while tiles are missing the ground is held.
+ *
+ * The geofence limits the command last, after the trajectory and the
+ * speed limits, so it has the final say on where the vehicle goes.
  */
 
 #include "navigation.h"
+#include "geofence.h"
+#include "local_frame.h"
+#include "mission.h"
+#include "nav_ekf.h"
+#include "terrain.h"
+#include "trajectory.h"
 #include <math.h>
 #include <string.h>
 
@@ -16,112 +37,201 @@
 #define RAD2DEG (180.0f / 3.14159265359f)
 #define EARTH_RADIUS_METERS 6371000.0f
 
-static Waypoint_t waypoints[MAX_WAYPOINTS];
-static uint8_t waypoint_count = 0;
-static uint8_t current_wp_index = 0;
-static bool mission_complete = false;
-
-static Position_t current_position = {0};
-static Velocity_t velocity_command = {0};
-static Attitude_t attitude_command = {0};
-
-static float distance_between(Position_t *a, Position_t *b);
-static float bearing_between(Position_t *a, Position_t *b);
-static void update_velocity_command(Position_t *target_pos);
-static void update_attitude_command(Position_t *target_pos);
-
-bool Navigation_Init(void) {
-    memset(waypoints, 0, sizeof(waypoints));
-    waypoint_count = 0;
-    current_wp_index = 0;
-    mission_complete = false;
-
-    // Additional sensor fusion initialization here if needed
+// Trajectory tracking: feed-forward plus this much velocity per metre of
+// position error, limited to a little over the planner's cruise speed
+#define NAV_POSITION_GAIN  1.0f
+#define NAV_MAX_SPEED      18.0f
+#define NAV_MAX_CLIMB      3.0f
+
+// Geofence: look this far ahead along the command, and brake at this
+// rate to stop this far short of a predicted breach
+#define NAV_FENCE_HORIZON_S    3.0f
+#define NAV_FENCE_BRAKE_ACCEL  3.0f    // m/s^2
+#define NAV_FENCE_BUFFER       3.0f    // m
+
+// Vector from the current position to the active waypoint
+typedef struct {
+    float north;      // m
+    float east;       // m
+    float distance;   // m
+    float bearing;    // degrees, 0 - 360 clockwise from north
+} Leg_Geometry_t;
+
+static void activate_leg(Navigation_t *nav, const Position_t *target);
+static void compute_leg_geometry(const Navigation_t *nav, const Position_t *target_pos, Leg_Geometry_t *leg);
+static void update_velocity_command(Navigation_t *nav, const Trajectory_Setpoint_t *setpoint);
+static void update_attitude_command(Navigation_t *nav, const Leg_Geometry_t *leg);
+static void apply_geofence(Navigation_t *nav);
+static bool update_ground(Navigation_t *nav, float dt);
+static Position_t planner_position(const Navigation_t *nav);
+static void clear_commands(Navigation_t *nav);
+
+bool Navigation_Init(Navigation_t *nav, const Sensors_t *sensors) {
+    memset(nav, 0, sizeof(Navigation_t));
+    nav->sensors = sensors;
+    nav->geometry_mode = NAV_GEOMETRY_LOCAL_TANGENT;
 
     return true;
 }
 
-void Navigation_Update(IMU_Data_t *imu, Barometer_Data_t *baro, Position_t *gps_pos) {
-    if (mission_complete || waypoint_count == 0) {
-        velocity_command.north = 0;
-        velocity_command.east = 0;
-        velocity_command.down = 0;
-        attitude_command.roll = 0;
-        attitude_command.pitch = 0;
-        attitude_command.yaw = 0;
-        return;
+void Navigation_Update(Navigation_t *nav, IMU_Data_t *imu, Barometer_Data_t *baro, const GPS_Data_t *gps,
+                       uint64_t now_us) {
+    // Sensor fusion: seed attitude from the AHRS, then let the EKF carry it.
+    // The first call only starts the clock; there is no interval to predict
+    // over (last_update_us is not a sample time yet).
+    float dt = 0.0f;
+    if (!nav->ekf_started) {
+        NavEkf_Config_t config = NavEkf_DefaultConfig();
+        NavEkf_Init(&nav->ekf, &config, Sensors_GetAttitude(nav->sensors));
+        nav->ekf_started = true;
+    } else {
+        dt = (float)(now_us - nav->last_update_us) * 1e-6f;
+        if (imu != NULL) NavEkf_Predict(&nav->ekf, imu, dt, now_us);
+    }
+    nav->last_update_us = now_us;
+
+    if (baro != NULL) {
+        NavEkf_FuseBaro(&nav->ekf, baro->altitude);
+    }
+
+    // The fix is fused at its own timestamp, so the EKF rewinds by
+    // however long it actually took to arrive
+    if (gps != NULL) {
+        NavEkf_FuseGps(&nav->ekf, gps->latitude, gps->longitude, gps->altitude, gps->timestamp_us);
     }
 
     // Update current position
-    if (gps_pos != NULL) {
-        current_position = *gps_pos;
+    if (nav->ekf.origin_set) {
+        NavEkf_GetPosition(&nav->ekf, &nav->current_position.latitude, &nav->current_position.longitude,
+                           &nav->current_position.altitude);
+        if (nav->geofence != NULL) {
+            Geofence_Check(nav->geofence, &nav->current_position, &nav->fence_status);
+            nav->fence_valid = true;
+        }
     }
 
-    // Check distance to current waypoint
-    Position_t *target = &waypoints[current_wp_index].position;
-    float dist = distance_between(&current_position, target);
+    if (nav->terrain != NULL) Terrain_Service(nav->terrain);
+
+    if (nav->mission_complete || !nav->mission_loaded) {
+        clear_commands(nav);
+        return;
+    }
+    bool ground_known = nav->terrain_relative && nav->ekf.origin_set && update_ground(nav, dt);
 
-    // Threshold to consider waypoint reached (10 meters)
-    if (dist < 10.0f) {
-        // Hover for hold_time, then advance waypoint
-        // For brevity, hold_time logic omitted (implement timer externally)
-        if (++current_wp_index >= waypoint_count) {
-            mission_complete = true;
+    // The trajectory starts from where the vehicle is
+    if (!nav->mission_started) {
+        if (!nav->ekf.origin_set || (nav->terrain_relative && !ground_known)) {
+            clear_commands(nav);
+            return;
         }
+        Position_t start = planner_position(nav);
+        TrajectoryPlanner_Start(&nav->planner, &nav->mission, &start, nav->ekf.vel, now_us);
+        nav->mission_started = true;
     }
 
-    if (!mission_complete) {
-        update_velocity_command(target);
-        update_attitude_command(target);
-    } else {
-        velocity_command.north = 0;
-        velocity_command.east = 0;
-        velocity_command.down = 0;
-        attitude_command.roll = 0;
-        attitude_command.pitch = 0;
-        attitude_command.yaw = 0;
+    TrajectoryPlanner_Service(&nav->planner);
+    Trajectory_Setpoint_t setpoint;
+    Position_t tracked = planner_position(nav);
+    TrajectoryPlanner_Sample(&nav->planner, now_us, &tracked, &setpoint);
+    if (setpoint.complete) {
+        nav->mission_complete = true;
+        clear_commands(nav);
+        return;
+    }
+    if (setpoint.target == NULL) {
+        clear_commands(nav);
+        return;
+    }
+
+    if (!nav->leg_active || setpoint.target_index != nav->current_wp_index) {
+        nav->current_wp_index = setpoint.target_index;
+        activate_leg(nav, &setpoint.target->position);
     }
+    Leg_Geometry_t leg;
+    compute_leg_geometry(nav, &nav->leg_target, &leg);
+    update_velocity_command(nav, &setpoint);
+    update_attitude_command(nav, &leg);
+    apply_geofence(nav);
 }
 
-bool Navigation_SetWaypoints(Waypoint_t *wps, uint8_t count) {
-    if (count == 0 || count > MAX_WAYPOINTS) return false;
+bool Navigation_SetWaypoints(Navigation_t *nav, const Waypoint_t *wps, uint32_t count) {
+    if (count == 0) return false;
 
-    memcpy(waypoints, wps, sizeof(Waypoint_t) * count);
-    waypoint_count = count;
-    current_wp_index = 0;
-    mission_complete = false;
+    Mission_Source_t source;
+    Mission_ArraySource(&source, wps, count);
+    return Navigation_SetMission(nav, &source);
+}
+
+bool Navigation_SetMission(Navigation_t *nav, const Mission_Source_t *source) {
+    if (source->count == 0) return false;
+    bool relative = (source->flags & MISSION_FLAG_TERRAIN) != 0;
+    if (relative && nav->terrain == NULL) return false;
+
+    nav->mission = *source;
+    nav->terrain_relative = relative;
+    TerrainFollower_Reset(&nav->follower);
+    nav->mission_loaded = true;
+    nav->mission_started = false;
+    nav->leg_active = false;
+    nav->current_wp_index = 0;
+    nav->mission_complete = false;
     return true;
 }
 
-Velocity_t Navigation_GetVelocityCommand(void) {
-    return velocity_command;
+void Navigation_SetTerrain(Navigation_t *nav, Terrain_t *dem) {
+    nav->terrain = dem;
+    if (nav->terrain == NULL && nav->terrain_relative && !nav->mission_complete) Navigation_AbortMission(nav);
+}
+
+void Navigation_SetGeofence(Navigation_t *nav, const Geofence_t *fence) {
+    nav->geofence = fence;
+    nav->fence_valid = false;
+}
+
+bool Navigation_GetGeofenceStatus(const Navigation_t *nav, Geofence_Status_t *status) {
+    if (nav->geofence == NULL || !nav->fence_valid) return false;
+    *status = nav->fence_status;
+    return true;
 }
 
-Attitude_t Navigation_GetAttitudeCommand(void) {
-    return attitude_command;
+void Navigation_SetGeometryMode(Navigation_t *nav, Navigation_GeometryMode_t mode) {
+    nav->geometry_mode = mode;
+    if (nav->leg_active && !nav->mission_complete) activate_leg(nav, &nav->leg_target);
 }
 
-uint8_t Navigation_GetCurrentWaypoint(void) {
-    return current_wp_index;
+Position_t Navigation_GetPosition(const Navigation_t *nav) {
+    return nav->current_position;
 }
 
-bool Navigation_IsMissionComplete(void) {
-    return mission_complete;
+Velocity_t Navigation_GetVelocity(const Navigation_t *nav) {
+    Velocity_t velocity = { nav->ekf.vel[0], nav->ekf.vel[1], nav->ekf.vel[2] };
+    return velocity;
 }
 
-void Navigation_AbortMission(void) {
-    mission_complete = true;
-    velocity_command.north = 0;
-    velocity_command.east = 0;
-    velocity_command.down = 0;
-    attitude_command.roll = 0;
-    attitude_command.pitch = 0;
-    attitude_command.yaw = 0;
+Velocity_t Navigation_GetVelocityCommand(const Navigation_t *nav) {
+    return nav->velocity_command;
+}
+
+Attitude_t Navigation_GetAttitudeCommand(const Navigation_t *nav) {
+    return nav->attitude_command;
+}
+
+uint32_t Navigation_GetCurrentWaypoint(const Navigation_t *nav) {
+    return nav->current_wp_index;
+}
+
+bool Navigation_IsMissionComplete(const Navigation_t *nav) {
+    return nav->mission_complete;
+}
+
+void Navigation_AbortMission(Navigation_t *nav) {
+    nav->mission_complete = true;
+    clear_commands(nav);
 }
 
 // --- Helper functions ---
 
-static float distance_between(Position_t *a, Position_t *b) {
+float Navigation_DistanceBetween(const Position_t *a, const Position_t *b) {
     // Haversine formula
     float lat1 = (float)(a->latitude * DEG2RAD);
     float lon1 = (float)(a->longitude * DEG2RAD);
@@ -137,7 +247,7 @@ static float distance_between(Position_t *a, Position_t *b) {
     return EARTH_RADIUS_METERS * c;
 }
 
-static float bearing_between(Position_t *a, Position_t *b) {
+float Navigation_BearingBetween(const Position_t *a, const Position_t *b) {
     float lat1 = (float)(a->latitude * DEG2RAD);
     float lon1 = (float)(a->longitude * DEG2RAD);
     float lat2 = (float)(b->latitude * DEG2RAD);
@@ -153,26 +263,127 @@ static float bearing_between(Position_t *a, Position_t *b) {
     return brng;
 }
 
-static void update_velocity_command(Position_t *target_pos) {
-    float dist = distance_between(&current_position, target_pos);
-    float brng = bearing_between(&current_position, target_pos);
+// Called whenever a new waypoint becomes active: all trig for the leg
+// happens here, once
+static void activate_leg(Navigation_t *nav, const Position_t *target) {
+    nav->leg_target = *target;
+    nav->leg_active = true;
+    LocalFrame_Init(&nav->leg_frame, target->latitude, target->longitude, target->altitude);
+    if (nav->terrain_relative) Terrain_Prefetch(nav->terrain, &nav->current_position, target);
+}
 
-    // Simple proportional controller on distance for velocity command (max 15 m/s)
-    float speed = (dist > 15.0f) ? 15.0f : dist; // Cap speed
-    float rad = brng * DEG2RAD;
+// Ground under and ahead of the vehicle, looking along the horizontal
+// command it is flying
+static bool update_ground(Navigation_t *nav, float dt) {
+    const float velocity_ne[2] = { nav->velocity_command.north, nav->velocity_command.east };
+    TerrainFollower_Update(&nav->follower, nav->terrain, &nav->current_position, velocity_ne, dt);
+    return nav->follower.valid;
+}
 
-    velocity_command.north = speed * cosf(rad);
-    velocity_command.east = speed * sinf(rad);
-    velocity_command.down = 0; // Assume flat terrain for now
+// Position as the planner sees it: altitude becomes height above the
+// ground for terrain-relative missions
+static Position_t planner_position(const Navigation_t *nav) {
+    Position_t position = nav->current_position;
+    if (nav->terrain_relative) position.altitude -= nav->follower.ground_alt;
+    return position;
 }
 
-static void update_attitude_command(Position_t *target_pos) {
-    float brng = bearing_between(&current_position, target_pos);
+static void compute_leg_geometry(const Navigation_t *nav, const Position_t *target_pos, Leg_Geometry_t *leg) {
+    if (nav->geometry_mode == NAV_GEOMETRY_GREAT_CIRCLE) {
+        leg->distance = Navigation_DistanceBetween(&nav->current_position, target_pos);
+        leg->bearing = Navigation_BearingBetween(&nav->current_position, target_pos);
+        float rad = leg->bearing * DEG2RAD;
+        leg->north = leg->distance * cosf(rad);
+        leg->east = leg->distance * sinf(rad);
+        return;
+    }
 
-    // Set yaw toward waypoint bearing
-    attitude_command.yaw = brng;
+    // Leg frame is anchored at the target, so the offset of the current
+    // position is exactly the negated vector we need
+    float ned[3];
+    LocalFrame_ToNED(&nav->leg_frame, nav->current_position.latitude, nav->current_position.longitude,
+                     nav->current_position.altitude, ned);
+    leg->north = -ned[0];
+    leg->east = -ned[1];
+    leg->distance = sqrtf(leg->north * leg->north + leg->east * leg->east);
+
+    float brng = atan2f(leg->east, leg->north) * RAD2DEG;
+    if (brng < 0) brng += 360.0f;
+    leg->bearing = brng;
+}
+
+static void update_velocity_command(Navigation_t *nav, const Trajectory_Setpoint_t *setpoint) {
+    // Trajectory feed-forward plus a proportional pull onto the reference
+    float north = setpoint->velocity[0] + NAV_POSITION_GAIN * setpoint->position_error[0];
+    float east = setpoint->velocity[1] + NAV_POSITION_GAIN * setpoint->position_error[1];
+    float down = setpoint->velocity[2] + NAV_POSITION_GAIN * setpoint->position_error[2];
+    if (nav->terrain_relative) down -= nav->follower.ground_rate;
+
+    float speed = sqrtf(north * north + east * east);
+    if (speed > NAV_MAX_SPEED) {
+        north *= NAV_MAX_SPEED / speed;
+        east *= NAV_MAX_SPEED / speed;
+    }
+    if (down > NAV_MAX_CLIMB) down = NAV_MAX_CLIMB;
+    if (down < -NAV_MAX_CLIMB) down = -NAV_MAX_CLIMB;
+
+    nav->velocity_command.north = north;
+    nav->velocity_command.east = east;
+    nav->velocity_command.down = down;
+}
+
+static void update_attitude_command(Navigation_t *nav, const Leg_Geometry_t *leg) {
+    // Set yaw toward waypoint bearing; keep it while on top of the waypoint,
+    // where the bearing is noise
+    if (leg->distance > 1.0f) nav->attitude_command.yaw = leg->bearing;
 
     // Simple level flight assumptions
-    attitude_command.roll = 0.0f;
-    attitude_command.pitch = 0.0f;
+    nav->attitude_command.roll = 0.0f;
+    nav->attitude_command.pitch = 0.0f;
+}
+
+static void apply_geofence(Navigation_t *nav) {
+    if (nav->geofence == NULL) return;
+    Geofence_Predict(nav->geofence, &nav->current_position, &nav->velocity_command, NAV_FENCE_HORIZON_S, &nav->fence_status);
+
+    float speed = sqrtf(nav->velocity_command.north * nav->velocity_command.north +
+                        nav->velocity_command.east * nav->velocity_command.east +
+                        nav->velocity_command.down * nav->velocity_command.down);
+    float allowed;
+    if (nav->fence_status.breached) {
+        // Keep the command only if a second of it gains clearance
+        float ned[3];
+        Position_t probe;
+        LocalFrame_ToNED(&nav->geofence->frame, nav->current_position.latitude, nav->current_position.longitude,
+                         nav->current_position.altitude, ned);
+        ned[0] += nav->velocity_command.north;
+        ned[1] += nav->velocity_command.east;
+        ned[2] += nav->velocity_command.down;
+        LocalFrame_FromNED(&nav->geofence->frame, ned, &probe.latitude, &probe.longitude, &probe.altitude);
+        Geofence_Status_t ahead;
+        Geofence_Check(nav->geofence, &probe, &ahead);
+        allowed = (ahead.clearance > nav->fence_status.clearance) ? speed : 0.0f;
+    } else if (nav->fence_status.breach_in_s >= 0.0f) {
+        // Slow enough to stop short of the predicted breach
+        float room = nav->fence_status.breach_in_s * speed - NAV_FENCE_BUFFER;
+        allowed = (room > 0.0f) ? sqrtf(2.0f * NAV_FENCE_BRAKE_ACCEL * room) : 0.0f;
+    } else {
+        return;
+    }
+
+    if (speed > allowed) {
+        float scale = allowed / speed;
+        nav->velocity_command.north *= scale;
+        nav->velocity_command.east *= scale;
+        nav->velocity_command.down *= scale;
+    }
+}
+
+static void clear_commands(Navigation_t *nav) {
+    nav->velocity_command.north = 0;
+    nav->velocity_command.east = 0;
+    nav->velocity_command.down = 0;
+    nav->attitude_command.roll = 0;
+    nav->attitude_command.pitch = 0;
+    nav->attitude_command.yaw = 0;
 }
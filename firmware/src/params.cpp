@@ -0,0 +1,352 @@
+/*
+ * params.cpp - Runtime parameter store for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * The start-up scan reads every slot header with blocking reads (64 KiB
+ * at most, before the scheduler starts). After that the store only
+ * touches the flash from Params_Service, one page program or sector erase
+ * per call, and only while the flash is idle, so it interleaves with the
+ * blackbox the same way the mission and terrain readers do.
+ */
+
+#include "params.h"
+#include "telemetry.h"
+#include <string.h>
+
+#define PARAMS_HASH_BITS    5                        // 32 slots
+#define PARAMS_HASH_SLOTS   (1U << PARAMS_HASH_BITS)
+#define SLOTS_PER_SECTOR    (FLASH_SECTOR_SIZE / PARAMS_SLOT_BYTES)
+
+static_assert(2 * PARAM_COUNT <= PARAMS_HASH_SLOTS, "grow PARAMS_HASH_BITS with the table");
+static_assert(FLASH_PARAMS_SIZE / FLASH_SECTOR_SIZE >= 2, "the image ring needs two sectors");
+
+#define PARAM_INFO_ENTRY(name, type, def, lo, hi) { #name, Params_Hash(#name), type, def, lo, hi },
+static constexpr Params_Info_t param_info[PARAM_COUNT] = { PARAMS_TABLE(PARAM_INFO_ENTRY) };
+#undef PARAM_INFO_ENTRY
+
+// Multiplicative perfect hash of the name hashes, found at compile time:
+// slot = (hash * multiplier) >> (32 - PARAMS_HASH_BITS) is distinct for
+// every parameter. Two names with the same FNV hash fail the build.
+struct ParamsPerfectHash {
+    uint32_t multiplier;
+    uint8_t id[PARAMS_HASH_SLOTS];   // PARAM_COUNT where no parameter lands
+
+    constexpr ParamsPerfectHash() : multiplier(0), id() {
+        uint32_t candidate = 0x9E3779B1U;
+        for (int attempt = 0; attempt < 100000 && multiplier == 0; attempt++) {
+            for (uint32_t slot = 0; slot < PARAMS_HASH_SLOTS; slot++) id[slot] = PARAM_COUNT;
+            bool distinct = true;
+            for (int p = 0; p < PARAM_COUNT && distinct; p++) {
+                uint32_t slot = (param_info[p].hash * candidate) >> (32 - PARAMS_HASH_BITS);
+                if (id[slot] != PARAM_COUNT) distinct = false;
+                else id[slot] = (uint8_t)p;
+            }
+            if (distinct) multiplier = candidate;
+            else candidate = (candidate * 1664525U + 1013904223U) | 1U;
+        }
+    }
+};
+
+static constexpr ParamsPerfectHash perfect_hash;
+static_assert(perfect_hash.multiplier != 0, "no collision-free multiplier for the parameter names");
+
+static const uint8_t params_magic[4] = { 'T', 'M', 'F', 'P' };
+
+static Params_Bank_t default_bank;
+static bool default_bank_ready = false;
+
+static void load_defaults(Params_Bank_t *bank);
+static uint32_t scan_slots(Params_t *params, uint32_t *newest_slot);
+static void apply_image(Params_t *params, const uint8_t *image, uint32_t count);
+static bool read_image(uint32_t slot, uint8_t *image, uint32_t *count, uint32_t *sequence);
+static bool in_range(Param_Id_t id, float value);
+static bool stage(Params_t *params);
+static bool choose_slot(Params_t *params);
+static uint32_t slot_address(uint32_t slot);
+static void put_u16(uint8_t *p, uint16_t v);
+static void put_u32(uint8_t *p, uint32_t v);
+static uint16_t get_u16(const uint8_t *p);
+static uint32_t get_u32(const uint8_t *p);
+
+bool Params_Init(Params_t *params) {
+    load_defaults(&params->bank[0]);
+    params->bank[1] = params->bank[0];
+    params->active.store(0, std::memory_order_relaxed);
+    params->pending.store(false, std::memory_order_relaxed);
+    params->staging_open = false;
+    params->save_queued.store(false, std::memory_order_relaxed);
+    params->image_length = 0;
+    params->next_sequence = 1;
+    params->next_slot = 0;
+    params->writing = false;
+    params->erase_pending = false;
+    params->inflight = 0;
+    params->write_offset = 0;
+    memset(&params->stats, 0, sizeof(params->stats));
+
+    params->flash_ok = Flash_Init();
+    if (!params->flash_ok) return false;
+
+    uint32_t newest_slot = 0;
+    uint32_t last_used = scan_slots(params, &newest_slot);
+    if (last_used < PARAMS_SLOTS) params->next_slot = (last_used + 1) % PARAMS_SLOTS;
+
+    uint32_t count, sequence;
+    if (params->stats.sequence != 0 && read_image(newest_slot, params->image, &count, &sequence)) {
+        apply_image(params, params->image, count);
+        params->bank[1] = params->bank[0];
+    }
+    return true;
+}
+
+const Params_Bank_t *Params_Defaults(void) {
+    if (!default_bank_ready) {
+        load_defaults(&default_bank);
+        default_bank_ready = true;
+    }
+    return &default_bank;
+}
+
+Param_Id_t Params_Find(uint32_t hash) {
+    uint8_t id = perfect_hash.id[(hash * perfect_hash.multiplier) >> (32 - PARAMS_HASH_BITS)];
+    if (id >= PARAM_COUNT || param_info[id].hash != hash) return PARAM_COUNT;
+    return (Param_Id_t)id;
+}
+
+const Params_Info_t *Params_GetInfo(Param_Id_t id) {
+    return (id < PARAM_COUNT) ? &param_info[id] : NULL;
+}
+
+bool Params_BeginFrame(Params_t *params) {
+    if (!params->pending.load(std::memory_order_acquire)) return false;
+    params->active.store(params->active.load(std::memory_order_relaxed) ^ 1U, std::memory_order_relaxed);
+    params->stats.commits++;
+    params->pending.store(false, std::memory_order_release);
+    return true;
+}
+
+bool Params_SetFloat(Params_t *params, Param_Id_t id, float value) {
+    if (id >= PARAM_COUNT || param_info[id].type != PARAM_FLOAT || !in_range(id, value)) return false;
+    if (!stage(params)) return false;
+    params->bank[params->active.load(std::memory_order_relaxed) ^ 1U].value[id].f = value;
+    return true;
+}
+
+bool Params_SetInt(Params_t *params, Param_Id_t id, int32_t value) {
+    if (id >= PARAM_COUNT || param_info[id].type != PARAM_INT32 || !in_range(id, (float)value)) return false;
+    if (!stage(params)) return false;
+    params->bank[params->active.load(std::memory_order_relaxed) ^ 1U].value[id].i = value;
+    return true;
+}
+
+bool Params_Commit(Params_t *params) {
+    if (!params->staging_open) return false;
+    params->staging_open = false;
+    params->pending.store(true, std::memory_order_release);
+    return true;
+}
+
+bool Params_Save(Params_t *params) {
+    if (!params->flash_ok || params->save_queued.load(std::memory_order_acquire)) return false;
+
+    // The newest committed values: the staged bank until it is adopted,
+    // the active one after. Neither changes under us.
+    uint32_t active = params->active.load(std::memory_order_relaxed);
+    const Params_Bank_t *bank = &params->bank[params->pending.load(std::memory_order_acquire) ? active ^ 1U : active];
+
+    uint8_t *image = params->image;
+    memset(image, 0xFF, sizeof(params->image));
+    memcpy(image, params_magic, sizeof(params_magic));
+    put_u16(image + 4, PARAMS_VERSION);
+    put_u16(image + 6, PARAM_COUNT);
+    put_u32(image + 8, params->next_sequence);
+    put_u16(image + 12, 0);
+    uint8_t *record = image + PARAMS_HEADER_BYTES;
+    for (int id = 0; id < PARAM_COUNT; id++, record += PARAMS_RECORD_BYTES) {
+        put_u32(record, param_info[id].hash);
+        put_u32(record + 4, (uint32_t)bank->value[id].i);
+    }
+    uint16_t crc = Telemetry_Crc16(0xFFFF, image, 14);
+    crc = Telemetry_Crc16(crc, image + PARAMS_HEADER_BYTES, PARAM_COUNT * PARAMS_RECORD_BYTES);
+    put_u16(image + 14, crc);
+    params->image_length = PARAMS_HEADER_BYTES + PARAM_COUNT * PARAMS_RECORD_BYTES;
+
+    params->save_queued.store(true, std::memory_order_release);
+    return true;
+}
+
+bool Params_IsSaving(const Params_t *params) {
+    return params->save_queued.load(std::memory_order_acquire);
+}
+
+void Params_Service(Params_t *params) {
+    if (!params->save_queued.load(std::memory_order_acquire) || Flash_IsBusy()) return;
+
+    if (params->inflight > 0) {
+        params->write_offset += params->inflight;
+        params->inflight = 0;
+    }
+
+    if (!params->writing) {
+        if (!choose_slot(params)) return;
+        params->writing = true;
+        params->write_offset = 0;
+    }
+
+    if (params->erase_pending) {
+        if (Flash_StartSectorErase(slot_address(params->write_slot))) {
+            params->erase_pending = false;
+            params->stats.sectors_erased++;
+        }
+        return;
+    }
+
+    // Header page first: a slot is in use as soon as its first word is
+    if (params->write_offset < params->image_length) {
+        uint32_t chunk = params->image_length - params->write_offset;
+        uint32_t address = slot_address(params->write_slot) + params->write_offset;
+        uint32_t page_room = FLASH_PAGE_SIZE - address % FLASH_PAGE_SIZE;
+        if (chunk > page_room) chunk = page_room;
+        if (Flash_StartProgram(address, &params->image[params->write_offset], chunk)) params->inflight = chunk;
+        return;
+    }
+
+    params->stats.saves++;
+    params->stats.sequence = params->next_sequence;
+    params->stats.slot = params->write_slot;
+    params->next_sequence++;
+    params->next_slot = (params->write_slot + 1) % PARAMS_SLOTS;
+    params->writing = false;
+    params->save_queued.store(false, std::memory_order_release);
+}
+
+void Params_GetStats(const Params_t *params, Params_Stats_t *stats) {
+    *stats = params->stats;
+}
+
+/* --- Internals --- */
+
+static void load_defaults(Params_Bank_t *bank) {
+    for (int id = 0; id < PARAM_COUNT; id++) {
+        if (param_info[id].type == PARAM_INT32) bank->value[id].i = (int32_t)param_info[id].default_value;
+        else bank->value[id].f = param_info[id].default_value;
+    }
+}
+
+// Header pass over the ring: the newest valid image (stats.sequence and
+// newest_slot) and the slot of the highest sequence written at all, torn
+// or not, which the next image follows. Returns PARAMS_SLOTS if none.
+static uint32_t scan_slots(Params_t *params, uint32_t *newest_slot) {
+    uint32_t last_used = PARAMS_SLOTS;
+    uint32_t last_sequence = 0;
+    for (uint32_t slot = 0; slot < PARAMS_SLOTS; slot++) {
+        uint8_t header[PARAMS_HEADER_BYTES];
+        if (!Flash_Read(slot_address(slot), header, sizeof(header))) continue;
+        if (memcmp(header, params_magic, sizeof(params_magic)) != 0) continue;
+
+        uint32_t sequence = get_u32(header + 8);
+        if (last_used == PARAMS_SLOTS || sequence > last_sequence) {
+            last_used = slot;
+            last_sequence = sequence;
+        }
+
+        uint32_t count;
+        if (sequence > params->stats.sequence && read_image(slot, params->image, &count, &sequence)) {
+            params->stats.sequence = sequence;
+            params->stats.slot = slot;
+            *newest_slot = slot;
+        }
+    }
+    if (last_used < PARAMS_SLOTS) params->next_sequence = last_sequence + 1;
+    return last_used;
+}
+
+static bool read_image(uint32_t slot, uint8_t *image, uint32_t *count, uint32_t *sequence) {
+    if (!Flash_Read(slot_address(slot), image, PARAMS_HEADER_BYTES)) return false;
+    if (memcmp(image, params_magic, sizeof(params_magic)) != 0 || get_u16(image + 4) != PARAMS_VERSION) return false;
+    *count = get_u16(image + 6);
+    *sequence = get_u32(image + 8);
+    if (PARAMS_HEADER_BYTES + *count * PARAMS_RECORD_BYTES > PARAMS_SLOT_BYTES) return false;
+    if (!Flash_Read(slot_address(slot) + PARAMS_HEADER_BYTES, image + PARAMS_HEADER_BYTES,
+                    *count * PARAMS_RECORD_BYTES)) {
+        return false;
+    }
+
+    uint16_t crc = Telemetry_Crc16(0xFFFF, image, 14);
+    crc = Telemetry_Crc16(crc, image + PARAMS_HEADER_BYTES, *count * PARAMS_RECORD_BYTES);
+    return crc == get_u16(image + 14);
+}
+
+static void apply_image(Params_t *params, const uint8_t *image, uint32_t count) {
+    const uint8_t *record = image + PARAMS_HEADER_BYTES;
+    for (uint32_t r = 0; r < count; r++, record += PARAMS_RECORD_BYTES) {
+        Param_Id_t id = Params_Find(get_u32(record));
+        Param_Value_t value;
+        value.i = (int32_t)get_u32(record + 4);
+        float as_float = (id < PARAM_COUNT && param_info[id].type == PARAM_INT32) ? (float)value.i : value.f;
+        if (id == PARAM_COUNT || !in_range(id, as_float)) {
+            params->stats.skipped++;
+            continue;
+        }
+        params->bank[0].value[id] = value;
+        params->stats.loaded++;
+    }
+}
+
+// NaN fails both comparisons
+static bool in_range(Param_Id_t id, float value) {
+    return value >= param_info[id].min && value <= param_info[id].max;
+}
+
+// Open the staging bank for edits: a copy of the active one, unless a
+// commit is still waiting for the control loop
+static bool stage(Params_t *params) {
+    if (params->staging_open) return true;
+    if (params->pending.load(std::memory_order_acquire)) return false;
+    uint32_t active = params->active.load(std::memory_order_relaxed);
+    params->bank[active ^ 1U] = params->bank[active];
+    params->staging_open = true;
+    return true;
+}
+
+// The slot after the last one written. Entering a sector erases it: it
+// holds the oldest images, never the newest. A slot left half-written by
+// a reset is skipped.
+static bool choose_slot(Params_t *params) {
+    uint32_t slot = params->next_slot;
+    for (uint32_t tries = 0; tries < SLOTS_PER_SECTOR; tries++) {
+        if (slot % SLOTS_PER_SECTOR == 0) {
+            params->erase_pending = true;
+            break;
+        }
+        uint8_t first[4];
+        if (!Flash_Read(slot_address(slot), first, sizeof(first))) return false;
+        if (get_u32(first) == 0xFFFFFFFFU) break;
+        slot = (slot + 1) % PARAMS_SLOTS;
+    }
+    params->write_slot = slot;
+    return true;
+}
+
+static uint32_t slot_address(uint32_t slot) {
+    return FLASH_PARAMS_BASE + slot * PARAMS_SLOT_BYTES;
+}
+
+static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
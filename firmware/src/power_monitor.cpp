@@ -0,0 +1,332 @@
+/*
+ * power_monitor.cpp - Power rail and thermal health monitor for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Two producers (the ADC and SPI DMA callbacks, possibly at different
+ * interrupt priorities) each own one half of the measurements. Each folds
+ * its block into a private working copy, then publishes it with a short
+ * copy under its own sequence counter, so a reader only ever retries over
+ * a few hundred bytes and never over the block processing.
+ *
+ * Energy and charge are summed per block in float and carried in 64-bit
+ * integers (mJ, uC), with each block's fraction of a unit carried into
+ * the next, so an hour of flight loses no resolution.
+ */
+
+#include "power_monitor.h"
+#include "hardware_drivers.h"
+#include "system_clock.h"
+#include <atomic>
+#include <string.h>
+
+#define SNAPSHOT_RETRIES 4
+
+// Board calibration: value = counts * gain + offset (12-bit ADC, 3.3 V ref)
+#define ADC_VOLTS_PER_COUNT (3.3f / 4095.0f)
+
+static const struct {
+    float gain;
+    float offset;
+} channel_cal[POWER_CHANNEL_COUNT] = {
+    { ADC_VOLTS_PER_COUNT * 11.0f, 0.0f },              // 100k/10k divider
+    { ADC_VOLTS_PER_COUNT / 0.020f, -1.65f / 0.020f },  // Hall sensor, 20 mV/A about 1.65 V
+    { ADC_VOLTS_PER_COUNT * 20.0f, 0.0f },              // 190k/10k divider
+    { ADC_VOLTS_PER_COUNT / 0.025f, -1.65f / 0.025f },  // Hall sensor, 25 mV/A about 1.65 V
+    { ADC_VOLTS_PER_COUNT * 2.0f, 0.0f },               // 10k/10k divider
+};
+
+// EMA weights per sample: 50 ms on the rails, 1 s on the thermocouples
+#define RAIL_ALPHA     0.0020f    // 1 - exp(-(1 / 10 kHz) / 50 ms)
+#define THERMAL_ALPHA  0.0952f    // 1 - exp(-100 ms / 1 s)
+#define SCAN_SECONDS   (1.0f / (float)POWER_ADC_SCAN_HZ)
+
+typedef struct {
+    uint64_t rails_us;
+    uint32_t scans;
+    Power_Stat_t channels[POWER_CHANNEL_COUNT];
+    float battery_power_w;
+    float coil_power_w;
+    int64_t battery_energy_mj;
+    int64_t battery_charge_uc;
+    int64_t coil_energy_mj;
+    float battery_energy_carry;   // Fractions of a unit not yet in the totals
+    float battery_charge_carry;
+    float coil_energy_carry;
+} Rails_t;
+
+typedef struct {
+    uint64_t thermal_us;
+    float coil_temp_c[POWER_THERMOCOUPLES];
+    float coil_temp_max_c;
+    uint8_t sensor_faults;    // Also set until a thermocouple first reads good
+    uint8_t seen;             // Bit per thermocouple that has read good once
+} Thermal_t;
+
+typedef struct {
+    Power_Thermal_t thermal;
+    float output_limit;
+    uint8_t shed_level;
+    bool healthy;
+} Decision_t;
+
+// Producer-private working state
+static Rails_t rails_work;
+static Thermal_t thermal_work;
+
+// Published copies
+static Rails_t rails_published;
+static std::atomic<uint32_t> rails_sequence{0};
+static Thermal_t thermal_published;
+static std::atomic<uint32_t> thermal_sequence{0};
+static Decision_t decision;
+static std::atomic<uint32_t> decision_sequence{0};
+
+static uint32_t loads_on = 0;   // Bit per Power_Load_t as last switched
+
+template <typename T>
+static void publish(std::atomic<uint32_t> *sequence, T *published, const T *work);
+template <typename T>
+static void read_published(std::atomic<uint32_t> *sequence, const T *published, T *out);
+static void apply_loads(uint8_t shed_level);
+static void accumulate(int64_t *total, float *carry, float amount);
+
+bool PowerMonitor_Init(void) {
+    memset(&rails_work, 0, sizeof(rails_work));
+    memset(&thermal_work, 0, sizeof(thermal_work));
+    rails_sequence.store(0, std::memory_order_relaxed);
+    thermal_sequence.store(0, std::memory_order_relaxed);
+    decision_sequence.store(0, std::memory_order_relaxed);
+    rails_published = rails_work;
+    decision.thermal = POWER_THERMAL_NORMAL;
+    decision.output_limit = 1.0f;
+    decision.shed_level = 0;
+    decision.healthy = true;
+
+    thermal_work.sensor_faults = (1U << POWER_THERMOCOUPLES) - 1U;   // Unknown until read
+    thermal_published = thermal_work;
+
+    loads_on = 0;
+    apply_loads(0);
+    return PowerSense_Init();
+}
+
+void PowerMonitor_OnAdcBlock(const uint16_t *scans, uint32_t count, uint64_t timestamp_us) {
+    Rails_t *r = &rails_work;
+    float battery_wj = 0.0f, battery_c = 0.0f, coil_wj = 0.0f;
+
+    for (uint32_t s = 0; s < count; s++) {
+        const uint16_t *scan = &scans[s * POWER_CHANNEL_COUNT];
+        float values[POWER_CHANNEL_COUNT];
+        for (int ch = 0; ch < POWER_CHANNEL_COUNT; ch++) {
+            float x = (float)scan[ch] * channel_cal[ch].gain + channel_cal[ch].offset;
+            Power_Stat_t *stat = &r->channels[ch];
+            if (r->scans == 0) {
+                stat->mean = stat->min = stat->max = x;
+            } else {
+                stat->mean += RAIL_ALPHA * (x - stat->mean);
+                if (x < stat->min) stat->min = x;
+                if (x > stat->max) stat->max = x;
+            }
+            stat->value = x;
+            values[ch] = x;
+        }
+
+        float battery_w = values[POWER_CH_BATTERY_V] * values[POWER_CH_BATTERY_I];
+        float coil_w = values[POWER_CH_COIL_V] * values[POWER_CH_COIL_I];
+        if (r->scans == 0) {
+            r->battery_power_w = battery_w;
+            r->coil_power_w = coil_w;
+        } else {
+            r->battery_power_w += RAIL_ALPHA * (battery_w - r->battery_power_w);
+            r->coil_power_w += RAIL_ALPHA * (coil_w - r->coil_power_w);
+        }
+        battery_wj += battery_w;
+        battery_c += values[POWER_CH_BATTERY_I];
+        coil_wj += coil_w;
+        r->scans++;
+    }
+
+    // Block sums to integer accumulators: W * s = J
+    accumulate(&r->battery_energy_mj, &r->battery_energy_carry, battery_wj * SCAN_SECONDS * 1000.0f);
+    accumulate(&r->battery_charge_uc, &r->battery_charge_carry, battery_c * SCAN_SECONDS * 1000000.0f);
+    accumulate(&r->coil_energy_mj, &r->coil_energy_carry, coil_wj * SCAN_SECONDS * 1000.0f);
+    r->rails_us = timestamp_us;
+
+    publish(&rails_sequence, &rails_published, r);
+}
+
+void PowerMonitor_OnThermocouples(const uint32_t *frames, uint32_t count, uint64_t timestamp_us) {
+    Thermal_t *t = &thermal_work;
+    if (count > POWER_THERMOCOUPLES) count = POWER_THERMOCOUPLES;
+
+    for (uint32_t i = 0; i < count; i++) {
+        float celsius;
+        uint8_t bit = (uint8_t)(1U << i);
+        if (!PowerMonitor_DecodeMax31855(frames[i], &celsius)) {
+            t->sensor_faults |= bit;
+            continue;
+        }
+        t->sensor_faults &= (uint8_t)~bit;
+
+        if (!(t->seen & bit)) {
+            t->coil_temp_c[i] = celsius;
+            if (t->seen == 0 || celsius > t->coil_temp_max_c) t->coil_temp_max_c = celsius;
+            t->seen |= bit;
+        } else {
+            t->coil_temp_c[i] += THERMAL_ALPHA * (celsius - t->coil_temp_c[i]);
+            if (celsius > t->coil_temp_max_c) t->coil_temp_max_c = celsius;
+        }
+    }
+    t->thermal_us = timestamp_us;
+
+    publish(&thermal_sequence, &thermal_published, t);
+}
+
+bool PowerMonitor_DecodeMax31855(uint32_t frame, float *celsius) {
+    // D16 is the fault summary, D2..D0 say which (SCV, SCG, OC)
+    if (frame & ((1UL << 16) | 0x7UL)) return false;
+    int32_t quarter_degrees = (int32_t)frame >> 18;   // 14-bit signed, 0.25 C
+    *celsius = (float)quarter_degrees * 0.25f;
+    return true;
+}
+
+bool PowerMonitor_CheckHealth(void) {
+    PowerMonitor_Snapshot_t snap;
+    PowerMonitor_GetSnapshot(&snap);
+    uint64_t now_us = SystemClock_Micros();
+
+    bool rails_fresh = snap.scans > 0 && now_us - snap.rails_us <= POWER_STALE_US;
+    bool thermal_fresh = snap.thermal_us != 0 && now_us - snap.thermal_us <= POWER_STALE_US;
+
+    // A coil we cannot see is assumed to be at least at the throttle limit
+    float hottest = -273.15f;
+    for (int i = 0; i < POWER_THERMOCOUPLES; i++) {
+        bool known = thermal_fresh && !(snap.sensor_faults & (1U << i));
+        float temp = snap.coil_temp_c[i];
+        if (!known && temp < POWER_THROTTLE_C) temp = POWER_THROTTLE_C;
+        if (temp > hottest) hottest = temp;
+    }
+
+    Decision_t next = decision;
+    switch (next.thermal) {
+    case POWER_THERMAL_NORMAL:
+        if (hottest >= POWER_SHUTDOWN_C) next.thermal = POWER_THERMAL_SHUTDOWN;
+        else if (hottest >= POWER_THROTTLE_C) next.thermal = POWER_THERMAL_THROTTLE;
+        break;
+    case POWER_THERMAL_THROTTLE:
+        if (hottest >= POWER_SHUTDOWN_C) next.thermal = POWER_THERMAL_SHUTDOWN;
+        else if (hottest < POWER_THROTTLE_CLEAR_C) next.thermal = POWER_THERMAL_NORMAL;
+        break;
+    case POWER_THERMAL_SHUTDOWN:
+        if (hottest < POWER_SHUTDOWN_CLEAR_C) next.thermal = POWER_THERMAL_NORMAL;
+        break;
+    }
+
+    // Derate linearly across the throttle band
+    if (next.thermal == POWER_THERMAL_SHUTDOWN) {
+        next.output_limit = 0.0f;
+    } else if (next.thermal == POWER_THERMAL_THROTTLE) {
+        float x = (hottest - POWER_THROTTLE_C) / (POWER_SHUTDOWN_C - POWER_THROTTLE_C);
+        if (x < 0.0f) x = 0.0f;
+        if (x > 1.0f) x = 1.0f;
+        next.output_limit = 1.0f - (1.0f - POWER_THROTTLE_FLOOR) * x;
+    } else {
+        next.output_limit = 1.0f;
+    }
+
+    // Staged shedding on the filtered cell voltage, with hysteresis
+    if (rails_fresh) {
+        float cell_v = snap.channels[POWER_CH_BATTERY_V].mean / (float)POWER_BATTERY_CELLS;
+        if (next.shed_level < 1 && cell_v < POWER_SHED1_CELL_V) next.shed_level = 1;
+        if (next.shed_level < 2 && cell_v < POWER_SHED2_CELL_V) next.shed_level = 2;
+        if (next.shed_level == 2 && cell_v > POWER_SHED2_CELL_V + POWER_SHED_HYSTERESIS_V) next.shed_level = 1;
+        if (next.shed_level == 1 && cell_v > POWER_SHED1_CELL_V + POWER_SHED_HYSTERESIS_V) next.shed_level = 0;
+    }
+    apply_loads(next.shed_level);
+
+    float avionics_v = snap.channels[POWER_CH_AVIONICS_V].mean;
+    next.healthy = rails_fresh && thermal_fresh && snap.sensor_faults == 0 &&
+                   next.thermal != POWER_THERMAL_SHUTDOWN &&
+                   avionics_v >= POWER_AVIONICS_MIN_V && avionics_v <= POWER_AVIONICS_MAX_V &&
+                   snap.channels[POWER_CH_COIL_I].mean <= POWER_COIL_MAX_A;
+
+    publish(&decision_sequence, &decision, &next);
+    return next.healthy;
+}
+
+void PowerMonitor_GetSnapshot(PowerMonitor_Snapshot_t *snapshot) {
+    Rails_t r;
+    Thermal_t t;
+    Decision_t d;
+    read_published(&rails_sequence, &rails_published, &r);
+    read_published(&thermal_sequence, &thermal_published, &t);
+    read_published(&decision_sequence, &decision, &d);
+
+    snapshot->rails_us = r.rails_us;
+    snapshot->scans = r.scans;
+    memcpy(snapshot->channels, r.channels, sizeof(r.channels));
+    snapshot->battery_power_w = r.battery_power_w;
+    snapshot->battery_energy_wh = (float)r.battery_energy_mj / 3600000.0f;
+    snapshot->battery_charge_mah = (float)r.battery_charge_uc / 3600000.0f;
+    snapshot->coil_power_w = r.coil_power_w;
+    snapshot->coil_energy_wh = (float)r.coil_energy_mj / 3600000.0f;
+
+    snapshot->thermal_us = t.thermal_us;
+    memcpy(snapshot->coil_temp_c, t.coil_temp_c, sizeof(t.coil_temp_c));
+    snapshot->coil_temp_max_c = t.coil_temp_max_c;
+    snapshot->sensor_faults = t.sensor_faults;
+
+    snapshot->thermal = d.thermal;
+    snapshot->output_limit = d.output_limit;
+    snapshot->shed_level = d.shed_level;
+    snapshot->healthy = d.healthy;
+}
+
+/* --- Internals --- */
+
+template <typename T>
+static void publish(std::atomic<uint32_t> *sequence, T *published, const T *work) {
+    uint32_t seq = sequence->load(std::memory_order_relaxed);
+    sequence->store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(published, work, sizeof(T));
+    sequence->store(seq + 2, std::memory_order_release);
+}
+
+// The writer holds the counter odd only for one short copy, so a retry
+// practically always succeeds; after SNAPSHOT_RETRIES the copy is best effort
+template <typename T>
+static void read_published(std::atomic<uint32_t> *sequence, const T *published, T *out) {
+    for (int attempt = 0; attempt < SNAPSHOT_RETRIES; attempt++) {
+        uint32_t before = sequence->load(std::memory_order_acquire);
+        if (before & 1U) continue;
+        memcpy(out, published, sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence->load(std::memory_order_relaxed) == before) return;
+    }
+    memcpy(out, published, sizeof(T));
+}
+
+// Add the whole units of amount plus the carried fraction to total and
+// keep the new fraction (same sign as the sum, under one unit)
+static void accumulate(int64_t *total, float *carry, float amount) {
+    float sum = amount + *carry;
+    int64_t whole = (int64_t)sum;
+    *total += whole;
+    *carry = sum - (float)whole;
+}
+
+// Payload and lights go at level 1, the radio boost at level 2
+static void apply_loads(uint8_t shed_level) {
+    static const uint8_t shed_at[POWER_LOAD_COUNT] = { 1, 1, 2 };
+    for (uint32_t load = 0; load < POWER_LOAD_COUNT; load++) {
+        bool on = shed_level < shed_at[load];
+        bool was_on = (loads_on >> load) & 1U;
+        if (on == was_on) continue;
+        PowerSense_SetLoad(load, on);
+        if (on) loads_on |= 1U << load;
+        else loads_on &= ~(1U << load);
+    }
+}
@@ -0,0 +1,256 @@
+/*
+ * propulsion_driver.cpp - DShot ESC driver for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * CubeMX configuration this relies on: TIM3 CH1-CH4 on the ESC pins with
+ * PSC 0 (108 MHz timer clock), its update DMA stream memory-to-peripheral,
+ * word, normal mode, and one DMA stream per capture channel, peripheral-
+ * to-memory, halfword, normal mode. The driver owns all TIM3 registers
+ * and switches them between PWM output and input capture itself.
+ *
+ * Frame buffer: DSHOT_FRAME_SLOTS rows of CCR1-CCR4. Each row sets the
+ * high time of one bit period for all four ESCs; the trailing zero rows
+ * return the lines to idle before the stream completes.
+ */
+
+#include "propulsion_driver.h"
+#include "stm32f7xx_hal.h"
+#include "system_clock.h"
+#include <string.h>
+
+#define ESC_TIMER              htim3
+extern TIM_HandleTypeDef ESC_TIMER;
+
+#define DSHOT_FRAME_SLOTS      (DSHOT_FRAME_BITS + 2)
+#define DSHOT_MIN_BIT_COUNTS   40        // Below this the pulse widths lose resolution
+#define DSHOT_TURNAROUND_US    30        // ESC reply starts this long after the frame
+#define DSHOT_REPLY_MARGIN_US  10
+
+// Per-channel CCMR fields, written for channel 1 and shifted for the others
+#define CCMR_PWM1_PRELOAD      (TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1PE)
+#define CCMR_CAPTURE_TI        TIM_CCMR1_CC1S_0
+
+// Reply nibbles are sent as 5-bit GCR codes; 0xFF marks an invalid code
+static const uint8_t gcr_decode[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x9,  0xA,  0xB,  0xFF, 0xD,  0xE,  0xF,
+    0xFF, 0xFF, 0x2,  0x3,  0xFF, 0x5,  0x6,  0x7,  0xFF, 0x0,  0x8,  0x1,  0xFF, 0x4,  0xC,  0xFF,
+};
+
+static const uint32_t esc_channels[PROPULSION_MOTORS] = {
+    TIM_CHANNEL_1, TIM_CHANNEL_2, TIM_CHANNEL_3, TIM_CHANNEL_4
+};
+
+static uint32_t frame_burst[DSHOT_FRAME_SLOTS][PROPULSION_MOTORS];
+static uint16_t reply_edges[PROPULSION_MOTORS][DSHOT_CAPTURE_EDGES];
+
+static bool initialized = false;
+static uint32_t bit_counts = 0;        // Timer counts per frame bit
+static uint32_t one_high = 0;          // High time of a 1 (75%)
+static uint32_t zero_high = 0;         // High time of a 0 (37.5%)
+static uint32_t reply_bit_counts = 0;  // Reply runs at 5/4 of the frame bit rate
+static uint32_t frame_window_us = 0;   // Frame plus the reply, if any
+static uint64_t frame_start_us = 0;
+static bool frame_pending = false;
+static bool capturing = false;
+static PropulsionDriver_Telemetry_t telemetry;
+
+static uint16_t throttle_value(float output);
+static void configure_output(void);
+static void configure_capture(void);
+static void collect_replies(void);
+
+bool PropulsionDriver_Init(void) {
+    memset(&telemetry, 0, sizeof(telemetry));
+    memset(frame_burst, 0, sizeof(frame_burst));
+
+    // TIM3 is on APB1, so its clock is 2 x PCLK1
+    uint32_t timer_clock_hz = 2U * HAL_RCC_GetPCLK1Freq();
+    bit_counts = timer_clock_hz / PROPULSION_DSHOT_RATE;
+    if (bit_counts < DSHOT_MIN_BIT_COUNTS || bit_counts > 0xFFFFU) return false;
+    one_high = (3U * bit_counts + 2U) / 4U;
+    zero_high = (3U * bit_counts + 4U) / 8U;
+    reply_bit_counts = bit_counts * 4U / 5U;
+
+    uint32_t frame_us = (DSHOT_FRAME_SLOTS * 1000000U + PROPULSION_DSHOT_RATE - 1U) / PROPULSION_DSHOT_RATE;
+    frame_window_us = frame_us;
+    if (PROPULSION_BIDIRECTIONAL) {
+        uint32_t reply_us = (DSHOT_REPLY_BITS * 1000000U * 4U / 5U + PROPULSION_DSHOT_RATE - 1U) /
+                            PROPULSION_DSHOT_RATE;
+        frame_window_us += DSHOT_TURNAROUND_US + reply_us + DSHOT_REPLY_MARGIN_US;
+    }
+
+    capturing = false;
+    frame_pending = false;
+    configure_output();
+    for (int m = 0; m < PROPULSION_MOTORS; m++) {
+        if (HAL_TIM_PWM_Start(&ESC_TIMER, esc_channels[m]) != HAL_OK) return false;
+    }
+    initialized = true;
+    return true;
+}
+
+void PropulsionDriver_SetOutputs(const Motor_Output_t *motors) {
+    if (!motors || !initialized) return;
+
+    // One frame and its reply at a time; a faster caller just loses updates
+    uint64_t now_us = SystemClock_Micros();
+    if (frame_pending && now_us - frame_start_us < frame_window_us) {
+        telemetry.frames_skipped++;
+        return;
+    }
+    if (capturing) collect_replies();
+
+    const float outputs[PROPULSION_MOTORS] = { motors->motor1, motors->motor2, motors->motor3, motors->motor4 };
+    for (int m = 0; m < PROPULSION_MOTORS; m++) {
+        uint16_t frame = PropulsionDriver_EncodeFrame(throttle_value(outputs[m]), false,
+                                                      PROPULSION_BIDIRECTIONAL);
+        for (int bit = 0; bit < DSHOT_FRAME_BITS; bit++) {
+            frame_burst[bit][m] = (frame & (0x8000U >> bit)) ? one_high : zero_high;
+        }
+    }
+
+    if (capturing) {
+        configure_output();
+        capturing = false;
+    }
+    frame_start_us = now_us;
+    frame_pending = true;
+    telemetry.frames_sent++;
+    HAL_TIM_DMABurst_MultiWriteStart(&ESC_TIMER, TIM_DMABASE_CCR1, TIM_DMA_UPDATE, &frame_burst[0][0],
+                                     TIM_DMABURSTLENGTH_4TRANSFERS, DSHOT_FRAME_SLOTS * PROPULSION_MOTORS);
+}
+
+void PropulsionDriver_GetTelemetry(PropulsionDriver_Telemetry_t *out) {
+    *out = telemetry;
+}
+
+void PropulsionDriver_OnFrameSent(void) {
+    HAL_TIM_DMABurst_WriteStop(&ESC_TIMER, TIM_DMA_UPDATE);
+    if (!PROPULSION_BIDIRECTIONAL) return;
+
+    configure_capture();
+    for (int m = 0; m < PROPULSION_MOTORS; m++) {
+        HAL_TIM_IC_Start_DMA(&ESC_TIMER, esc_channels[m], (uint32_t *)reply_edges[m], DSHOT_CAPTURE_EDGES);
+    }
+    capturing = true;
+}
+
+// The ESC timer is the only user of the period-elapsed callback
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
+    if (htim == &ESC_TIMER) PropulsionDriver_OnFrameSent();
+}
+
+uint16_t PropulsionDriver_EncodeFrame(uint16_t value, bool telemetry_request, bool bidirectional) {
+    uint16_t packet = (uint16_t)(((value & 0x7FFU) << 1) | (telemetry_request ? 1U : 0U));
+    uint16_t crc = (packet ^ (packet >> 4) ^ (packet >> 8)) & 0xFU;
+    if (bidirectional) crc = ~crc & 0xFU;
+    return (uint16_t)((packet << 4) | crc);
+}
+
+bool PropulsionDriver_DecodeReply(const uint16_t *edges, uint32_t count, uint32_t bit_counts_in,
+                                  uint32_t *erpm) {
+    if (count < 2 || bit_counts_in == 0) return false;
+
+    // Rebuild the line levels: start bit low, one level per run between edges
+    uint32_t levels = 0, bits = 0, level = 0;
+    for (uint32_t k = 1; k < count; k++) {
+        uint16_t width = (uint16_t)(edges[k] - edges[k - 1]);
+        uint32_t run = (width + bit_counts_in / 2U) / bit_counts_in;
+        if (run == 0 || bits + run > DSHOT_REPLY_BITS) return false;
+        levels = (levels << run) | (level ? (1U << run) - 1U : 0U);
+        bits += run;
+        level ^= 1U;
+    }
+    // Whatever is left is the final level (idle high after the last edge)
+    uint32_t rest = DSHOT_REPLY_BITS - bits;
+    levels = (levels << rest) | (level ? (1U << rest) - 1U : 0U);
+
+    // A transition is a 1: undo the NRZI coding, then the 5b/4b GCR code
+    uint32_t gcr = (levels ^ (levels >> 1)) & 0xFFFFFU;
+    uint32_t value = 0;
+    for (int quintet = 3; quintet >= 0; quintet--) {
+        uint8_t nibble = gcr_decode[(gcr >> (quintet * 5)) & 0x1FU];
+        if (nibble == 0xFF) return false;
+        value = (value << 4) | nibble;
+    }
+
+    // The four nibbles of a good reply XOR to 0xF
+    uint32_t check = value ^ (value >> 8);
+    check ^= check >> 4;
+    if ((check & 0xFU) != 0xFU) return false;
+
+    // 12-bit period in us as eee mmmmmmmmm; all ones means stopped
+    uint32_t period = value >> 4;
+    if (period == 0xFFFU) {
+        *erpm = 0;
+        return true;
+    }
+    period = (period & 0x1FFU) << (period >> 9);
+    if (period == 0) return false;
+    *erpm = (60000000U + period / 2U) / period;
+    return true;
+}
+
+/* --- Internals --- */
+
+static uint16_t throttle_value(float output) {
+    if (!(output > 0.0f)) return 0;
+    if (output >= 1.0f) return DSHOT_THROTTLE_MAX;
+    return (uint16_t)(DSHOT_THROTTLE_MIN + output * (DSHOT_THROTTLE_MAX - DSHOT_THROTTLE_MIN) + 0.5f);
+}
+
+static void configure_output(void) {
+    TIM_TypeDef *tim = ESC_TIMER.Instance;
+    uint32_t ccer = 0;
+    for (int m = 0; m < PROPULSION_MOTORS; m++) {
+        ccer |= TIM_CCER_CC1E << esc_channels[m];
+        // Bidirectional DShot idles high: pulses are active low
+        if (PROPULSION_BIDIRECTIONAL) ccer |= TIM_CCER_CC1P << esc_channels[m];
+    }
+
+    tim->CCER = 0;                     // CCxS is only writable with the channel off
+    tim->PSC = 0;
+    tim->ARR = bit_counts - 1U;
+    tim->CCMR1 = CCMR_PWM1_PRELOAD | (CCMR_PWM1_PRELOAD << 8);
+    tim->CCMR2 = CCMR_PWM1_PRELOAD | (CCMR_PWM1_PRELOAD << 8);
+    tim->CCR1 = tim->CCR2 = tim->CCR3 = tim->CCR4 = 0;
+    tim->CR1 |= TIM_CR1_ARPE;
+    tim->EGR = TIM_EGR_UG;
+    tim->CCER = ccer;
+}
+
+static void configure_capture(void) {
+    TIM_TypeDef *tim = ESC_TIMER.Instance;
+    uint32_t ccer = 0;
+    for (int m = 0; m < PROPULSION_MOTORS; m++) {
+        // Both edges
+        ccer |= (TIM_CCER_CC1E | TIM_CCER_CC1P | TIM_CCER_CC1NP) << esc_channels[m];
+    }
+
+    tim->CCER = 0;
+    tim->ARR = 0xFFFFU;                // Free-running; edge widths wrap cleanly in 16 bits
+    tim->CCMR1 = CCMR_CAPTURE_TI | (CCMR_CAPTURE_TI << 8);
+    tim->CCMR2 = CCMR_CAPTURE_TI | (CCMR_CAPTURE_TI << 8);
+    tim->EGR = TIM_EGR_UG;
+    tim->CCER = ccer;
+}
+
+static void collect_replies(void) {
+    for (int m = 0; m < PROPULSION_MOTORS; m++) {
+        uint32_t remaining = ESC_TIMER.hdma[TIM_DMA_ID_CC1 + m]->Instance->NDTR;
+        HAL_TIM_IC_Stop_DMA(&ESC_TIMER, esc_channels[m]);
+
+        uint32_t erpm;
+        uint32_t count = DSHOT_CAPTURE_EDGES - remaining;
+        if (PropulsionDriver_DecodeReply(reply_edges[m], count, reply_bit_counts, &erpm)) {
+            telemetry.rpm[m] = (float)erpm / (float)PROPULSION_POLE_PAIRS;
+            telemetry.valid[m] = true;
+            telemetry.replies_ok++;
+        } else {
+            telemetry.valid[m] = false;
+            telemetry.replies_bad++;
+        }
+    }
+}
@@ -0,0 +1,143 @@
+/*
+ * resonance_tracker.cpp - Closed-loop coil resonance tracking for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Runs in the coil ADC DMA callback once per RESONANCE_BLOCK_CYCLES drive
+ * cycles: integer sums over the block, one divide for the detector, a
+ * handful of float operations for the loop filter and one table lookup
+ * to retune the timer.
+ */
+
+#include "resonance_tracker.h"
+#include "coil_control.h"
+#include <math.h>
+#include <string.h>
+
+static ResonanceTracker_Config_t config;
+static float trim_cos = 1.0f;
+static float trim_sin = 0.0f;
+
+static float frequency_hz = 0.0f;
+static float integrator_hz = 0.0f;
+static float last_tangent = 0.0f;
+static float last_amplitude = 0.0f;
+static uint32_t in_band_blocks = 0;
+static ResonanceTracker_Status_t status;
+
+static float clamp_band(float hz);
+static void drop_lock(void);
+
+void ResonanceTracker_DefaultConfig(ResonanceTracker_Config_t *out) {
+    out->quality = 50.0f;
+    out->kp = 0.1f;
+    out->ki = 0.35f;
+    out->max_step_hz = 20000.0f;
+    out->max_tangent = 4.0f;          // About 76 degrees
+    out->lock_tangent = 0.0875f;      // 5 degrees
+    out->lock_blocks = 8;
+    out->min_amplitude = 40.0f;
+    out->phase_trim_rad = 0.0f;
+}
+
+void ResonanceTracker_Init(const ResonanceTracker_Config_t *cfg, uint32_t start_hz) {
+    config = *cfg;
+    trim_cos = cosf(config.phase_trim_rad);
+    trim_sin = sinf(config.phase_trim_rad);
+
+    frequency_hz = clamp_band((float)start_hz);
+    integrator_hz = frequency_hz;
+    last_tangent = 0.0f;
+    last_amplitude = 0.0f;
+    in_band_blocks = 0;
+    memset(&status, 0, sizeof(status));
+    CoilControl_SetFrequency((uint32_t)(frequency_hz + 0.5f));
+}
+
+float ResonanceTracker_Detect(const uint16_t *in_phase, const uint16_t *quadrature, uint32_t cycles,
+                              float *amplitude) {
+    int32_t sum_i = 0;
+    int32_t sum_q = 0;
+    for (uint32_t n = 0; n < cycles; n++) {
+        sum_i += (int32_t)in_phase[n];
+        sum_q += (int32_t)quadrature[n];
+    }
+    int32_t offset = (int32_t)(cycles * RESONANCE_ADC_MIDSCALE);
+    float i = (float)(sum_i - offset);
+    float q = (float)(sum_q - offset);
+
+    // Rotate out the fixed sampling delay
+    float i_trim = i * trim_cos + q * trim_sin;
+    float q_trim = q * trim_cos - i * trim_sin;
+
+    float scale = 1.0f / (float)cycles;
+    *amplitude = sqrtf(i_trim * i_trim + q_trim * q_trim) * scale;
+
+    // A series tank never passes +/-90 degrees; only noise gets here
+    float limit = config.max_tangent;
+    if (i_trim <= 0.0f) return (q_trim >= 0.0f) ? limit : -limit;
+    float tangent = q_trim / i_trim;
+    if (tangent > limit) return limit;
+    if (tangent < -limit) return -limit;
+    return tangent;
+}
+
+void ResonanceTracker_ProcessBlock(const uint16_t *in_phase, const uint16_t *quadrature, uint32_t cycles) {
+    if (cycles == 0) return;
+    status.blocks++;
+
+    float amplitude;
+    float tangent = ResonanceTracker_Detect(in_phase, quadrature, cycles, &amplitude);
+    last_tangent = tangent;
+    last_amplitude = amplitude;
+
+    if (amplitude < config.min_amplitude) {
+        // No plasma or coil current to lock to: hold the frequency
+        status.low_signal++;
+        drop_lock();
+        return;
+    }
+
+    // tan(phase) = 2Q (f0 - f) / f0, so this estimates f0 - f directly
+    float error_hz = tangent * frequency_hz / (2.0f * config.quality);
+    integrator_hz = clamp_band(integrator_hz + config.ki * error_hz);
+
+    float step = integrator_hz + config.kp * error_hz - frequency_hz;
+    if (step > config.max_step_hz || step < -config.max_step_hz) {
+        step = (step > 0.0f) ? config.max_step_hz : -config.max_step_hz;
+        status.slew_limited++;
+        integrator_hz = frequency_hz + step;   // No windup while slewing
+    }
+    frequency_hz = clamp_band(frequency_hz + step);
+    CoilControl_SetFrequency((uint32_t)(frequency_hz + 0.5f));
+
+    if (fabsf(tangent) < config.lock_tangent) {
+        if (++in_band_blocks >= config.lock_blocks) status.locked = true;
+    } else {
+        drop_lock();
+    }
+}
+
+void ResonanceTracker_GetStatus(ResonanceTracker_Status_t *out) {
+    *out = status;
+    out->frequency_hz = frequency_hz;
+    out->phase_rad = atanf(last_tangent);
+    out->amplitude = last_amplitude;
+}
+
+/* --- Internals --- */
+
+static float clamp_band(float hz) {
+    if (hz < (float)RESONANCE_MIN_HZ) return (float)RESONANCE_MIN_HZ;
+    if (hz > (float)RESONANCE_MAX_HZ) return (float)RESONANCE_MAX_HZ;
+    return hz;
+}
+
+static void drop_lock(void) {
+    in_band_blocks = 0;
+    if (status.locked) {
+        status.locked = false;
+        status.lock_losses++;
+    }
+}
@@ -0,0 +1,129 @@
+/*
+ * scheduler.cpp - Multi-rate cooperative task scheduler for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * The task table is kept sorted by period so priority order is simply
+ * table order. After any task runs, dispatch restarts from the top, which
+ * lets a faster task that became ready in the meantime go next.
+ */
+
+#include "scheduler.h"
+#include "system_clock.h"
+#include <stddef.h>
+#include <string.h>
+
+typedef struct {
+    Scheduler_TaskFn_t fn;
+    void *context;
+    uint64_t next_release_us;
+    uint64_t last_start_us;
+    Scheduler_TaskStats_t stats;
+} Scheduler_Task_t;
+
+static Scheduler_Task_t tasks[SCHEDULER_MAX_TASKS];
+static int task_count = 0;
+static int task_ids[SCHEDULER_MAX_TASKS];   // id -> table slot
+static bool started = false;
+
+void Scheduler_Init(void) {
+    memset(tasks, 0, sizeof(tasks));
+    task_count = 0;
+    started = false;
+}
+
+int Scheduler_AddTask(const char *name, Scheduler_TaskFn_t fn, void *context,
+                      uint32_t period_us, uint32_t phase_us) {
+    if (started || fn == NULL || period_us == 0 || task_count >= SCHEDULER_MAX_TASKS) {
+        return -1;
+    }
+
+    // Insert after every task with a period <= this one (stable RM order)
+    int slot = task_count;
+    while (slot > 0 && tasks[slot - 1].stats.period_us > period_us) {
+        tasks[slot] = tasks[slot - 1];
+        slot--;
+    }
+    for (int id = 0; id < task_count; id++) {
+        if (task_ids[id] >= slot) task_ids[id]++;
+    }
+
+    Scheduler_Task_t *task = &tasks[slot];
+    memset(task, 0, sizeof(Scheduler_Task_t));
+    task->fn = fn;
+    task->context = context;
+    task->stats.name = name;
+    task->stats.period_us = period_us;
+    task->stats.phase_us = phase_us;
+
+    int id = task_count++;
+    task_ids[id] = slot;
+    return id;
+}
+
+void Scheduler_Start(void) {
+    uint64_t now = SystemClock_Micros();
+    for (int i = 0; i < task_count; i++) {
+        tasks[i].next_release_us = now + tasks[i].stats.phase_us;
+        tasks[i].last_start_us = 0;
+    }
+    started = true;
+}
+
+void Scheduler_RunOnce(void) {
+    if (!started) Scheduler_Start();
+
+    uint64_t now = SystemClock_Micros();
+
+    for (int i = 0; i < task_count; i++) {
+        Scheduler_Task_t *task = &tasks[i];
+        uint32_t period = task->stats.period_us;
+
+        if (now < task->next_release_us) continue;
+
+        // Drop whole periods we could not serve, keeping the phase grid
+        uint64_t late = now - task->next_release_us;
+        if (late >= period) {
+            uint32_t lost = (uint32_t)(late / period);
+            task->stats.skipped_releases += lost;
+            task->stats.deadline_misses += lost;
+            task->next_release_us += (uint64_t)lost * period;
+        }
+
+        uint64_t start = SystemClock_Micros();
+        uint32_t dt_us = (task->stats.run_count == 0) ? period
+                                                       : (uint32_t)(start - task->last_start_us);
+        task->last_start_us = start;
+        task->stats.last_dt_us = dt_us;
+
+        task->fn((float)dt_us * 1e-6f, task->context);
+
+        now = SystemClock_Micros();
+        uint32_t exec_us = (uint32_t)(now - start);
+        if (exec_us > task->stats.max_exec_us) task->stats.max_exec_us = exec_us;
+        if (now > task->next_release_us + period) task->stats.deadline_misses++;
+
+        task->stats.run_count++;
+        task->next_release_us += period;
+
+        // Restart from the highest priority task
+        i = -1;
+    }
+
+    uint64_t next = UINT64_MAX;
+    for (int i = 0; i < task_count; i++) {
+        if (tasks[i].next_release_us < next) next = tasks[i].next_release_us;
+    }
+    if (next != UINT64_MAX) SystemClock_SleepUntil(next);
+}
+
+bool Scheduler_GetStats(int task_id, Scheduler_TaskStats_t *stats) {
+    if (task_id < 0 || task_id >= task_count || stats == NULL) return false;
+    *stats = tasks[task_ids[task_id]].stats;
+    return true;
+}
+
+int Scheduler_TaskCount(void) {
+    return task_count;
+}
@@ -10,111 +10,344 @@
 
 #include "sensors.h"
 #include <string.h>
-#include <math.h>
 #include "hardware_drivers.h" // Abstracts low-level SPI/I2C/UART
 
-static IMU_Data_t imu_cache;
-static GPS_Data_t gps_cache;
-static Barometer_Data_t baro_cache;
+#define DEG2RAD 0.0174532925f
+#define GRAVITY 9.80665f
+#define IMU_DRAIN_BATCH 16   // Samples copied out of the ring per pass
+
+// Standard atmosphere (troposphere)
+#define ISA_PRESSURE_HPA    1013.25f
+#define ISA_TEMPERATURE_C   15.0f
+#define ISA_LAPSE_RATE      0.0065f     // K/m
+#define ISA_EXPONENT        0.190263f   // R * lapse rate / g
+#define CELSIUS_TO_KELVIN   273.15f
+
+static const Sensors_BaroReference_t isa_reference = {
+    ISA_PRESSURE_HPA, ISA_TEMPERATURE_C, 0.0f, 1.0f / ISA_PRESSURE_HPA,
+    (ISA_TEMPERATURE_C + CELSIUS_TO_KELVIN) / ISA_LAPSE_RATE,
+};
+
+// Default IMU filter cascades
+static const Sensors_FilterStage_t default_gyro_cascade[] = {
+    { SENSORS_STAGE_LOWPASS, SENSORS_GYRO_LPF_HZ, BIQUAD_Q_BUTTERWORTH },
+};
+static const Sensors_FilterStage_t default_accel_cascade[] = {
+    { SENSORS_STAGE_LOWPASS, SENSORS_ACCEL_LPF_HZ, BIQUAD_Q_BUTTERWORTH },
+};
+
+// Barometric power table: x^k = 2^(k e) * m^k. Each mantissa segment
+// holds the cubic Hermite interpolant of m^k (value and slope exact at
+// both ends), evaluated in double at compile time.
+#define POW_SEGMENT_BITS    4
+#define POW_SEGMENTS        (1 << POW_SEGMENT_BITS)
+#define POW_EXPONENT_MIN    (-4)
+#define POW_EXPONENTS       5           // 2^-4 to 2^0
+#define POW_RATIO_MIN       0.0625f
+#define POW_RATIO_MAX       1.9999f
+
+static constexpr double const_ln(double x) {
+    int exponent = 0;
+    while (x > 1.4142135623730951) {
+        x *= 0.5;
+        exponent++;
+    }
+    while (x < 0.7071067811865476) {
+        x *= 2.0;
+        exponent--;
+    }
+    double s = (x - 1.0) / (x + 1.0), s2 = s * s, term = s, sum = 0.0;
+    for (int n = 1; n < 40; n += 2) {
+        sum += term / n;
+        term *= s2;
+    }
+    return 2.0 * sum + exponent * 0.6931471805599453;
+}
+
+static constexpr double const_exp(double x) {
+    int halvings = 0;
+    while (x > 0.5 || x < -0.5) {
+        x *= 0.5;
+        halvings++;
+    }
+    double sum = 1.0, term = 1.0;
+    for (int n = 1; n < 30; n++) {
+        term *= x / n;
+        sum += term;
+    }
+    while (halvings-- > 0) sum *= sum;
+    return sum;
+}
+
+struct BaroPowTable {
+    float cubic[POW_SEGMENTS][4];   // In u = m - segment start
+    float scale[POW_EXPONENTS];
+
+    constexpr BaroPowTable() : cubic(), scale() {
+        const double k = (double)ISA_EXPONENT, h = 1.0 / POW_SEGMENTS;
+        for (int i = 0; i < POW_SEGMENTS; i++) {
+            double a = 1.0 + i * h, b = a + h;
+            double fa = const_exp(k * const_ln(a)), fb = const_exp(k * const_ln(b));
+            double da = k * fa / a, db = k * fb / b;
+            double slope = (fb - fa) / h;
+            cubic[i][0] = (float)fa;
+            cubic[i][1] = (float)da;
+            cubic[i][2] = (float)((3.0 * slope - 2.0 * da - db) / h);
+            cubic[i][3] = (float)((da + db - 2.0 * slope) / (h * h));
+        }
+        for (int e = 0; e < POW_EXPONENTS; e++) {
+            scale[e] = (float)const_exp(k * (e + POW_EXPONENT_MIN) * 0.6931471805599453);
+        }
+    }
+};
+
+static constexpr BaroPowTable pow_table;
+
+// The board has one IMU stream and it has one consumer: the context that
+// last ran Sensors_Init
+static const Sensors_t *imu_stream_owner = NULL;
 
 // Internal helper prototypes
-static bool IMU_ReadRaw(float *accel, float *gyro, float *mag);
-static void IMU_ComputeEulerAngles(IMU_Data_t *imu);
-static bool GPS_ParseData(char *nmea_sentence);
-static bool Baro_ReadPressureTemp(float *pressure, float *temperature);
+static void process_imu_sample(Sensors_t *sensors, const IMU_Sample_t *sample);
+static void finish_imu_batch(Sensors_t *sensors, IMU_Data_t *imu_data);
+static float pow_isa_exponent(float x);
 
-bool Sensors_Init(void) {
-    bool imu_ok = IMU_Init();
+bool Sensors_Init(Sensors_t *sensors) {
+    Sensors_Reset(sensors);
+    ImuStream_Reset();
+    imu_stream_owner = sensors;
+
+    bool imu_ok = IMU_Init() && IMU_StartStream(SENSORS_IMU_ODR_HZ, SENSORS_IMU_WATERMARK);
     bool gps_ok = GPS_Init();
     bool baro_ok = Baro_Init();
 
     return imu_ok && gps_ok && baro_ok;
 }
 
-bool Sensors_UpdateIMU(IMU_Data_t *imu_data) {
-    float accel[3], gyro[3], mag[3];
+void Sensors_Reset(Sensors_t *sensors) {
+    memset(sensors, 0, sizeof(Sensors_t));
+    AHRS_Init(&sensors->ahrs, AHRS_DEFAULT_KP, AHRS_DEFAULT_KI);
 
-    if (!IMU_ReadRaw(accel, gyro, mag)) return false;
+    DynNotch_Init(&sensors->gyro_notch, (float)SENSORS_IMU_ODR_HZ, SENSORS_DYN_NOTCH_MIN_HZ,
+                  SENSORS_DYN_NOTCH_MAX_HZ, SENSORS_DYN_NOTCH_Q);
+    Sensors_SetFilterCascade(sensors, SENSORS_FILTER_GYRO, default_gyro_cascade,
+                             (int)(sizeof(default_gyro_cascade) / sizeof(default_gyro_cascade[0])));
+    Sensors_SetFilterCascade(sensors, SENSORS_FILTER_ACCEL, default_accel_cascade,
+                             (int)(sizeof(default_accel_cascade) / sizeof(default_accel_cascade[0])));
+    GpsParser_Init(&sensors->gps_parser);
+    sensors->gps_read_index = 0;
 
-    imu_cache.accel_x = accel[0];
-    imu_cache.accel_y = accel[1];
-    imu_cache.accel_z = accel[2];
-    imu_cache.gyro_x = gyro[0];
-    imu_cache.gyro_y = gyro[1];
-    imu_cache.gyro_z = gyro[2];
-    imu_cache.mag_x = mag[0];
-    imu_cache.mag_y = mag[1];
-    imu_cache.mag_z = mag[2];
+    sensors->baro_reference = isa_reference;
+    VertEst_Init(&sensors->vertical, SENSORS_VERTICAL_TAU_S);
+}
 
-    IMU_ComputeEulerAngles(&imu_cache);
+bool Sensors_SetFilterCascade(Sensors_t *sensors, Sensors_FilterChannel_t channel,
+                              const Sensors_FilterStage_t *stages, int count) {
+    const float sample_hz = (float)SENSORS_IMU_ODR_HZ;
+    if (count < 0 || count > SENSORS_FILTER_MAX_STAGES) return false;
+    for (int i = 0; i < count; i++) {
+        if (!(stages[i].hz > 0.0f && stages[i].hz < 0.5f * sample_hz) || !(stages[i].q > 0.0f)) return false;
+    }
 
-    if (imu_data) memcpy(imu_data, &imu_cache, sizeof(IMU_Data_t));
+    Biquad_t (*sections)[SENSORS_FILTER_MAX_STAGES] =
+        (channel == SENSORS_FILTER_GYRO) ? sensors->gyro_filter : sensors->accel_filter;
+    for (int axis = 0; axis < 3; axis++) {
+        for (int i = 0; i < count; i++) {
+            if (stages[i].type == SENSORS_STAGE_NOTCH) {
+                Biquad_SetNotch(&sections[axis][i], stages[i].hz, sample_hz, stages[i].q);
+            } else {
+                Biquad_SetLowpass(&sections[axis][i], stages[i].hz, sample_hz, stages[i].q);
+            }
+            Biquad_Reset(&sections[axis][i]);
+        }
+    }
+    if (channel == SENSORS_FILTER_GYRO) sensors->gyro_filter_stages = count;
+    else sensors->accel_filter_stages = count;
     return true;
 }
 
-bool Sensors_UpdateGPS(GPS_Data_t *gps_data) {
-    char nmea_sentence[128];
+bool Sensors_UpdateIMU(Sensors_t *sensors, IMU_Data_t *imu_data) {
+    IMU_Sample_t batch[IMU_DRAIN_BATCH];
+    uint32_t total = 0;
+    size_t count;
+
+    if (sensors != imu_stream_owner) return false;
 
-    if (!GPS_ReadLine(nmea_sentence, sizeof(nmea_sentence))) return false;
-    if (!GPS_ParseData(nmea_sentence)) return false;
+    // Bounded to one ring's worth so a stuck producer cannot stall the loop
+    while (total < IMU_STREAM_CAPACITY &&
+           (count = ImuStream_Drain(batch, IMU_DRAIN_BATCH)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            process_imu_sample(sensors, &batch[i]);
+        }
+        total += (uint32_t)count;
+    }
 
-    if (gps_data) memcpy(gps_data, &gps_cache, sizeof(GPS_Data_t));
+    if (total == 0) return false;
+    finish_imu_batch(sensors, imu_data);
     return true;
 }
 
-bool Sensors_UpdateBarometer(Barometer_Data_t *baro_data) {
-    float pressure, temperature;
+bool Sensors_FeedIMU(Sensors_t *sensors, const IMU_Sample_t *samples, size_t count, IMU_Data_t *imu_data) {
+    if (count == 0) return false;
+    for (size_t i = 0; i < count; i++) {
+        process_imu_sample(sensors, &samples[i]);
+    }
+    finish_imu_batch(sensors, imu_data);
+    return true;
+}
 
-    if (!Baro_ReadPressureTemp(&pressure, &temperature)) return false;
+bool Sensors_UpdateGPS(Sensors_t *sensors, GPS_Data_t *gps_data) {
+    uint64_t last_byte_us = 0;
+    size_t write_index = GPS_RxWriteIndex(&last_byte_us);
 
-    baro_cache.pressure = pressure;
-    baro_cache.temperature = temperature;
-    // Simplistic altitude calc assuming standard atmosphere
-    baro_cache.altitude = 44330.0f * (1.0f - powf(pressure / 1013.25f, 0.1903f));
+    uint32_t fixes = GpsParser_Consume(&sensors->gps_parser, GPS_RxBuffer(), GPS_RX_BUFFER_SIZE,
+                                       &sensors->gps_read_index, write_index, last_byte_us,
+                                       GPS_BYTE_TIME_NS);
+    if (fixes == 0) return false;
 
-    if (baro_data) memcpy(baro_data, &baro_cache, sizeof(Barometer_Data_t));
+    sensors->gps_cache = sensors->gps_parser.fix;
+    if (gps_data) memcpy(gps_data, &sensors->gps_cache, sizeof(GPS_Data_t));
     return true;
 }
 
-/* --- Internal hardware interface stubs --- */
+bool Sensors_UpdateBarometer(Sensors_t *sensors, Barometer_Data_t *baro_data) {
+    float pressure, temperature;
 
-static bool IMU_ReadRaw(float *accel, float *gyro, float *mag) {
-    // Replace with actual hardware SPI/I2C reads for your IMU (e.g., BMI270 or similar)
-    // Stub: return dummy stabilized values for development
-    accel[0] = 0.0f; accel[1] = 0.0f; accel[2] = 9.81f; // gravity
-    gyro[0] = 0.0f; gyro[1] = 0.0f; gyro[2] = 0.0f;
-    mag[0] = 0.3f; mag[1] = 0.0f; mag[2] = 0.5f;
+    if (!Baro_ReadPressureTemp(&pressure, &temperature)) return false;
+    Sensors_FeedBarometer(sensors, pressure, temperature, baro_data);
     return true;
 }
 
-static void IMU_ComputeEulerAngles(IMU_Data_t *imu) {
-    // Simple complementary filter or Madgwick/Mahony could be implemented here
-    // For demo, we'll calculate pitch and roll from accel only (radians)
-    float ax = imu->accel_x;
-    float ay = imu->accel_y;
-    float az = imu->accel_z;
-
-    imu->roll = atan2f(ay, az) * 57.2958f;  // degrees
-    imu->pitch = atan2f(-ax, sqrtf(ay * ay + az * az)) * 57.2958f;
-    // Yaw requires magnetometer + fusion; stub as zero
-    imu->yaw = 0.0f;
-}
-
-static bool GPS_ParseData(char *nmea_sentence) {
-    // Parse NMEA sentences to update gps_cache; simplified example:
-    // Real implementation requires full NMEA parser
-    // Here, we stub fixed coordinates for testing
-    gps_cache.latitude = 37.7749;   // San Francisco approx
-    gps_cache.longitude = -122.4194;
-    gps_cache.altitude = 15.0f;
-    gps_cache.speed = 0.0f;
-    gps_cache.fix_type = 2;          // 3D fix assumed
-    return true;
+void Sensors_FeedBarometer(Sensors_t *sensors, float pressure, float temperature, Barometer_Data_t *baro_data) {
+    sensors->baro_cache.pressure = pressure;
+    sensors->baro_cache.temperature = temperature;
+    sensors->baro_cache.altitude = Sensors_BaroAltitude(&sensors->baro_reference, pressure);
+    VertEst_FuseBaro(&sensors->vertical, sensors->baro_cache.altitude);
+
+    if (baro_data) memcpy(baro_data, &sensors->baro_cache, sizeof(Barometer_Data_t));
+}
+
+void Sensors_ComputeEulerAngles(Sensors_t *sensors, IMU_Data_t *imu) {
+    AHRS_GetEuler(&sensors->ahrs, &imu->roll, &imu->pitch, &imu->yaw);
+
+    // Later Sensors_UpdateIMU copies carry the most recent angles
+    sensors->imu_cache.roll = imu->roll;
+    sensors->imu_cache.pitch = imu->pitch;
+    sensors->imu_cache.yaw = imu->yaw;
+}
+
+Quaternion_t Sensors_GetAttitude(const Sensors_t *sensors) {
+    return sensors->ahrs.q;
 }
 
-static bool Baro_ReadPressureTemp(float *pressure, float *temperature) {
-    // Stub with fixed sea level pressure and room temp
-    *pressure = 1013.25f;  // hPa
-    *temperature = 25.0f;  // Celsius
+bool Sensors_GetVertical(const Sensors_t *sensors, float *altitude, float *climb_rate) {
+    if (!sensors->vertical.initialized) return false;
+    if (altitude) *altitude = sensors->vertical.altitude;
+    if (climb_rate) *climb_rate = sensors->vertical.climb_rate;
     return true;
 }
+
+Sensors_BaroReference_t Sensors_MakeBaroReference(float pressure, float temperature, float altitude) {
+    Sensors_BaroReference_t reference;
+    reference.pressure = pressure;
+    reference.temperature = temperature;
+    reference.altitude = altitude;
+    reference.inv_pressure = 1.0f / pressure;
+    reference.scale = (temperature + CELSIUS_TO_KELVIN) / ISA_LAPSE_RATE;
+    return reference;
+}
+
+void Sensors_SetBaroReference(Sensors_t *sensors, const Sensors_BaroReference_t *reference) {
+    if (sensors->vertical.baro_samples > 0) {
+        float pressure = sensors->baro_cache.pressure;
+        float shift = Sensors_BaroAltitude(reference, pressure) -
+                      Sensors_BaroAltitude(&sensors->baro_reference, pressure);
+        VertEst_Shift(&sensors->vertical, shift);
+        sensors->baro_cache.altitude += shift;
+    }
+    sensors->baro_reference = *reference;
+}
+
+float Sensors_BaroAltitude(const Sensors_BaroReference_t *reference, float pressure) {
+    float ratio = pressure * reference->inv_pressure;
+    return reference->altitude + reference->scale * (1.0f - pow_isa_exponent(ratio));
+}
+
+float Sensors_PressureToAltitude(float pressure) {
+    return Sensors_BaroAltitude(&isa_reference, pressure);
+}
+
+/* --- Internal helpers --- */
+
+// Filters and attitude run every sample; Euler angles only on request
+static void process_imu_sample(Sensors_t *sensors, const IMU_Sample_t *sample) {
+    float gyro[3] = { sample->gyro[0], sample->gyro[1], sample->gyro[2] };
+    float accel[3];
+    const float *mag = sample->mag;
+
+    // Analysis sees the raw gyro; the control path sees it notched
+    DynNotch_AddSample(&sensors->gyro_notch, gyro);
+    DynNotch_Apply(&sensors->gyro_notch, gyro);
+    for (int axis = 0; axis < 3; axis++) {
+        gyro[axis] = Biquad_ApplyCascade(sensors->gyro_filter[axis], sensors->gyro_filter_stages, gyro[axis]);
+        accel[axis] = Biquad_ApplyCascade(sensors->accel_filter[axis], sensors->accel_filter_stages,
+                                          sample->accel[axis]);
+    }
+
+    IMU_Data_t *imu_cache = &sensors->imu_cache;
+    imu_cache->accel_x = accel[0];
+    imu_cache->accel_y = accel[1];
+    imu_cache->accel_z = accel[2];
+    imu_cache->gyro_x = gyro[0];
+    imu_cache->gyro_y = gyro[1];
+    imu_cache->gyro_z = gyro[2];
+    imu_cache->mag_x = mag[0];
+    imu_cache->mag_y = mag[1];
+    imu_cache->mag_z = mag[2];
+
+    AHRS_State_t *ahrs = &sensors->ahrs;
+    if (!ahrs->aligned) {
+        // From the raw accel: the filters start from zero, and the AHRS
+        // learns 1 g from this reading's magnitude
+        AHRS_Align(ahrs, sample->accel[0], sample->accel[1], sample->accel[2], mag[0], mag[1], mag[2]);
+    } else {
+        float dt = (float)(sample->timestamp_us - sensors->last_imu_us) * 1e-6f;
+        AHRS_Update(ahrs, gyro[0] * DEG2RAD, gyro[1] * DEG2RAD, gyro[2] * DEG2RAD,
+                    accel[0], accel[1], accel[2], mag[0], mag[1], mag[2], dt);
+
+        // Vertical specific force: the third row of the body-to-earth
+        // rotation (earth z is up) applied to the accel
+        const Quaternion_t *q = &ahrs->q;
+        float up = 2.0f * (q->x * q->z - q->w * q->y) * accel[0] +
+                   2.0f * (q->y * q->z + q->w * q->x) * accel[1] +
+                   (1.0f - 2.0f * (q->x * q->x + q->y * q->y)) * accel[2];
+        VertEst_Predict(&sensors->vertical, up - GRAVITY, dt);
+    }
+    sensors->last_imu_us = sample->timestamp_us;
+}
+
+// x^0.190263 for x = 2^e * m, m in [1, 2): a table of 2^(k e) times a
+// cubic in m on one of 16 segments, read straight from the float's bits.
+// Within 2e-7 of the exact power, i.e. within 1 cm of altitude, for
+// ratios from 1/16 to 2 (about 65-2000 hPa around a sea-level reference).
+static float pow_isa_exponent(float x) {
+    if (!(x >= POW_RATIO_MIN)) x = POW_RATIO_MIN;   // Also catches NaN
+    if (x > POW_RATIO_MAX) x = POW_RATIO_MAX;
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    int32_t exponent = (int32_t)(bits >> 23) - 127;
+    uint32_t segment = (bits >> (23 - POW_SEGMENT_BITS)) & (POW_SEGMENTS - 1);
+    uint32_t mantissa_bits = (bits & 0x007FFFFFU) | 0x3F800000U;
+    float m;
+    memcpy(&m, &mantissa_bits, sizeof(m));
+
+    float u = m - (1.0f + (float)segment * (1.0f / POW_SEGMENTS));
+    const float *c = pow_table.cubic[segment];
+    return pow_table.scale[exponent - POW_EXPONENT_MIN] * (c[0] + u * (c[1] + u * (c[2] + u * c[3])));
+}
+
+// Once per batch: advance the notch tracker and publish the newest sample
+static void finish_imu_batch(Sensors_t *sensors, IMU_Data_t *imu_data) {
+    DynNotch_Step(&sensors->gyro_notch);
+    if (imu_data) memcpy(imu_data, &sensors->imu_cache, sizeof(IMU_Data_t));
+}
@@ -0,0 +1,79 @@
+/*
+ * system_clock.cpp - Monotonic time base implementation for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Default source extends the 32-bit DWT cycle counter to a 64-bit
+ * microsecond clock. The counter wraps every ~19.9 s at 216 MHz, so
+ * SystemClock_Micros() must be called at least that often (the control
+ * loop does so every frame).
+ */
+
+#include "system_clock.h"
+#include "stm32f7xx_hal.h"
+#include <stddef.h>
+
+static uint64_t dwt_now_us(void);
+static void dwt_sleep_until_us(uint64_t deadline);
+
+static const SystemClock_Source_t dwt_source = {
+    dwt_now_us,
+    dwt_sleep_until_us,
+};
+
+static const SystemClock_Source_t *active_source = &dwt_source;
+static uint64_t run_limit_us = 0;
+
+// Cycle counter extension state
+static uint32_t last_cyccnt = 0;
+static uint64_t cycle_high = 0;
+
+void SystemClock_Init(void) {
+    // Enable trace block and the DWT cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    last_cyccnt = 0;
+    cycle_high = 0;
+}
+
+void SystemClock_SetSource(const SystemClock_Source_t *source) {
+    active_source = (source != NULL) ? source : &dwt_source;
+}
+
+uint64_t SystemClock_Micros(void) {
+    return active_source->now_us();
+}
+
+void SystemClock_SleepUntil(uint64_t deadline_us) {
+    active_source->sleep_until_us(deadline_us);
+}
+
+void SystemClock_SetRunLimit(uint64_t limit_us) {
+    run_limit_us = limit_us;
+}
+
+bool SystemClock_ShouldRun(void) {
+    return run_limit_us == 0 || SystemClock_Micros() < run_limit_us;
+}
+
+/* --- DWT-backed default source --- */
+
+static uint64_t dwt_now_us(void) {
+    uint32_t now = DWT->CYCCNT;
+    if (now < last_cyccnt) {
+        cycle_high += (1ULL << 32);
+    }
+    last_cyccnt = now;
+
+    uint64_t cycles = cycle_high | now;
+    return cycles / (SystemCoreClock / 1000000U);
+}
+
+static void dwt_sleep_until_us(uint64_t deadline) {
+    // Busy-wait; the RTOS port replaces this with a tick-based delay
+    while (dwt_now_us() < deadline) {
+    }
+}
@@ -0,0 +1,323 @@
+/*
+ * telemetry.cpp - Prioritized, rate-limited binary telemetry for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * The TX ring is written only by Telemetry_Service and read only by the
+ * UART DMA, which Telemetry_Service also starts: head and tail are plain
+ * counters. A transfer covers the contiguous bytes from tail to head or
+ * to the end of the ring; the budget keeps each pass's output shorter
+ * than the time to the next pass, so polling keeps the link busy.
+ *
+ * The uplink is polled from the same task: received bytes are copied out
+ * of the radio a chunk at a time and fed to a parser the caller owns.
+ */
+
+#include "telemetry.h"
+#include "flight_control.h"
+#include "hardware_drivers.h"
+#include "navigation.h"
+#include "sensors.h"
+#include "system_clock.h"
+#include <string.h>
+
+#define TX_RING_MASK (TELEMETRY_TX_RING_SIZE - 1)
+
+// The payload is the struct layout; pin the sizes the ground side expects
+static_assert(sizeof(IMU_Data_t) == 48, "IMU_Data_t wire size changed");
+static_assert(sizeof(Velocity_t) == 12, "Velocity_t wire size changed");
+static_assert(sizeof(Position_t) == 24, "Position_t wire size changed");
+static_assert(sizeof(Motor_Output_t) == 16, "Motor_Output_t wire size changed");
+static_assert(sizeof(Telemetry_Diagnostics_t) == 24, "Telemetry_Diagnostics_t wire size changed");
+static_assert(sizeof(Telemetry_ParamSet_t) == 8, "Telemetry_ParamSet_t wire size changed");
+static_assert((TELEMETRY_TX_RING_SIZE & TX_RING_MASK) == 0, "TX ring size must be a power of two");
+static_assert(TELEMETRY_BURST_BYTES + TELEMETRY_MAX_PAYLOAD + TELEMETRY_OVERHEAD <= TELEMETRY_TX_RING_SIZE,
+              "TX ring must hold a full burst");
+
+typedef struct {
+    uint8_t id;
+    uint8_t size;
+    uint8_t priority;
+    const uint8_t *source;
+    uint32_t interval_us;
+    uint64_t next_due_us;
+    Telemetry_StreamStats_t stats;
+} Telemetry_Stream_t;
+
+// CRC-16/CCITT-FALSE lookup table, built at compile time
+struct Crc16Table {
+    uint16_t entry[256];
+    constexpr Crc16Table() : entry() {
+        for (int i = 0; i < 256; i++) {
+            uint16_t crc = (uint16_t)(i << 8);
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+            }
+            entry[i] = crc;
+        }
+    }
+};
+static constexpr Crc16Table crc_table;
+
+static Telemetry_Stream_t streams[TELEMETRY_MAX_STREAMS];   // Sorted by priority
+static int stream_count = 0;
+
+static uint8_t tx_ring[TELEMETRY_TX_RING_SIZE];
+static uint32_t tx_head = 0;        // Next byte to write
+static uint32_t tx_tail = 0;        // Next byte to transmit
+static uint32_t tx_inflight = 0;    // Bytes handed to the DMA
+
+static uint32_t tokens = 0;         // Budget in bytes
+static uint64_t last_refill_us = 0;
+static uint64_t refill_remainder = 0;   // Sub-byte budget carried between passes
+static uint8_t sequence = 0;
+static bool link_up = false;
+static Telemetry_Stats_t stats;
+
+static uint8_t rx_chunk[TELEMETRY_MAX_PAYLOAD + TELEMETRY_OVERHEAD];
+static uint32_t rx_length = 0;      // Bytes in rx_chunk
+static uint32_t rx_index = 0;       // Next byte to parse
+
+static void enqueue(Telemetry_Stream_t *stream);
+static void refill(uint64_t now_us);
+static void kick_tx(void);
+
+bool Telemetry_Init(void) {
+    stream_count = 0;
+    tx_head = tx_tail = tx_inflight = 0;
+    tokens = TELEMETRY_BURST_BYTES;
+    last_refill_us = SystemClock_Micros();
+    refill_remainder = 0;
+    sequence = 0;
+    rx_length = rx_index = 0;
+    memset(&stats, 0, sizeof(stats));
+    link_up = TelemetryLink_Init();
+    return link_up;
+}
+
+bool Telemetry_AddStream(Telemetry_MessageId_t id, const void *source, uint8_t size,
+                         float rate_hz, uint8_t priority) {
+    if (stream_count >= TELEMETRY_MAX_STREAMS || source == NULL) return false;
+    if (size > TELEMETRY_MAX_PAYLOAD || !(rate_hz > 0.0f)) return false;
+
+    // Insertion keeps the table in priority order (stable for equal priority)
+    int slot = stream_count;
+    while (slot > 0 && streams[slot - 1].priority > priority) {
+        streams[slot] = streams[slot - 1];
+        slot--;
+    }
+
+    Telemetry_Stream_t *stream = &streams[slot];
+    memset(stream, 0, sizeof(*stream));
+    stream->id = (uint8_t)id;
+    stream->size = size;
+    stream->priority = priority;
+    stream->source = (const uint8_t *)source;
+    stream->interval_us = (uint32_t)(1000000.0f / rate_hz);
+    stream->next_due_us = SystemClock_Micros();
+    stream_count++;
+
+    stats.demand_bytes_per_s += (uint32_t)((float)(size + TELEMETRY_OVERHEAD) * rate_hz);
+    return true;
+}
+
+void Telemetry_Service(void) {
+    if (!link_up) return;
+
+    uint64_t now_us = SystemClock_Micros();
+    refill(now_us);
+
+    // Retire the finished transfer before measuring free space
+    if (tx_inflight > 0 && !TelemetryLink_TxBusy()) {
+        tx_tail += tx_inflight;
+        tx_inflight = 0;
+    }
+
+    bool blocked = false;
+    for (int i = 0; i < stream_count; i++) {
+        Telemetry_Stream_t *stream = &streams[i];
+        if (now_us < stream->next_due_us) continue;
+
+        uint32_t frame = (uint32_t)stream->size + TELEMETRY_OVERHEAD;
+        uint32_t free_bytes = TELEMETRY_TX_RING_SIZE - (tx_head - tx_tail);
+        if (blocked || frame > tokens || frame > free_bytes) {
+            // Strict priority: nothing below a waiting stream may use the budget
+            blocked = true;
+            stream->stats.deferred++;
+            stats.deferred++;
+            continue;
+        }
+
+        enqueue(stream);
+        tokens -= frame;
+
+        // Skip missed slots rather than bursting to catch up
+        stream->next_due_us += stream->interval_us;
+        if (stream->next_due_us <= now_us) stream->next_due_us = now_us + stream->interval_us;
+    }
+
+    uint32_t depth = tx_head - tx_tail;
+    if (depth > stats.max_ring_depth) stats.max_ring_depth = depth;
+
+    kick_tx();
+}
+
+void Telemetry_GetStats(Telemetry_Stats_t *out) {
+    *out = stats;
+}
+
+bool Telemetry_GetStreamStats(Telemetry_MessageId_t id, Telemetry_StreamStats_t *out) {
+    for (int i = 0; i < stream_count; i++) {
+        if (streams[i].id == (uint8_t)id) {
+            *out = streams[i].stats;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Telemetry_Receive(Telemetry_Parser_t *parser) {
+    if (!link_up) return false;
+
+    for (;;) {
+        if (rx_index == rx_length) {
+            rx_length = (uint32_t)TelemetryLink_Receive(rx_chunk, sizeof(rx_chunk));
+            rx_index = 0;
+            if (rx_length == 0) return false;
+        }
+        if (Telemetry_ParseByte(parser, rx_chunk[rx_index++])) return true;
+    }
+}
+
+uint16_t Telemetry_Crc16(uint16_t crc, const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        crc = (uint16_t)((crc << 8) ^ crc_table.entry[(uint8_t)((crc >> 8) ^ data[i])]);
+    }
+    return crc;
+}
+
+/* --- TX path --- */
+
+static inline void ring_put(const uint8_t *data, uint32_t length, uint16_t *crc) {
+    uint32_t offset = tx_head & TX_RING_MASK;
+    uint32_t first = TELEMETRY_TX_RING_SIZE - offset;
+    if (first > length) first = length;
+    memcpy(&tx_ring[offset], data, first);
+    memcpy(&tx_ring[0], data + first, length - first);
+    *crc = Telemetry_Crc16(*crc, data, length);
+    tx_head += length;
+}
+
+static void enqueue(Telemetry_Stream_t *stream) {
+    uint8_t header[4] = { TELEMETRY_SYNC, stream->size, stream->id, sequence++ };
+    uint16_t crc = 0xFFFF;
+    uint16_t unused = 0xFFFF;
+
+    ring_put(header, 1, &unused);
+    ring_put(header + 1, 3, &crc);
+    ring_put(stream->source, stream->size, &crc);   // Straight from the live struct
+    uint8_t trailer[2] = { (uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8) };
+    ring_put(trailer, 2, &unused);
+
+    uint32_t frame = (uint32_t)stream->size + TELEMETRY_OVERHEAD;
+    stream->stats.frames_sent++;
+    stream->stats.bytes_sent += frame;
+    stats.frames_sent++;
+    stats.bytes_queued += frame;
+}
+
+static void refill(uint64_t now_us) {
+    uint64_t elapsed = now_us - last_refill_us;
+    last_refill_us = now_us;
+
+    uint64_t scaled = elapsed * TELEMETRY_BUDGET_BYTES_PER_S + refill_remainder;
+    uint64_t added = scaled / 1000000U;
+    refill_remainder = scaled % 1000000U;
+
+    uint64_t total = tokens + added;
+    if (total >= TELEMETRY_BURST_BYTES) {
+        total = TELEMETRY_BURST_BYTES;
+        refill_remainder = 0;
+    }
+    tokens = (uint32_t)total;
+}
+
+static void kick_tx(void) {
+    if (tx_inflight > 0 || tx_head == tx_tail) return;
+
+    uint32_t offset = tx_tail & TX_RING_MASK;
+    uint32_t length = tx_head - tx_tail;
+    if (length > TELEMETRY_TX_RING_SIZE - offset) length = TELEMETRY_TX_RING_SIZE - offset;
+    if (TelemetryLink_StartTx(&tx_ring[offset], length)) tx_inflight = length;
+}
+
+/* --- Frame parser and encoder --- */
+
+enum { PARSE_SYNC = 0, PARSE_BODY, PARSE_CRC_LO, PARSE_CRC_HI };
+
+void Telemetry_ParserInit(Telemetry_Parser_t *parser) {
+    memset(parser, 0, sizeof(*parser));
+}
+
+bool Telemetry_ParseByte(Telemetry_Parser_t *parser, uint8_t byte) {
+    switch (parser->state) {
+    case PARSE_SYNC:
+        if (byte == TELEMETRY_SYNC) {
+            parser->index = 0;
+            parser->state = PARSE_BODY;
+        }
+        return false;
+
+    case PARSE_BODY:
+        if (parser->index == 0) {
+            if (byte > TELEMETRY_MAX_PAYLOAD) {
+                parser->state = PARSE_SYNC;   // Not a frame we could have sent
+                return false;
+            }
+            parser->length = byte;
+        }
+        parser->buffer[parser->index++] = byte;
+        if (parser->index == (uint32_t)parser->length + 3) parser->state = PARSE_CRC_LO;
+        return false;
+
+    case PARSE_CRC_LO:
+        parser->buffer[parser->index++] = byte;
+        parser->state = PARSE_CRC_HI;
+        return false;
+
+    default: {
+        parser->state = PARSE_SYNC;
+        uint32_t body = (uint32_t)parser->length + 3;
+        uint16_t received = (uint16_t)(parser->buffer[body] | (byte << 8));
+        if (Telemetry_Crc16(0xFFFF, parser->buffer, body) != received) {
+            parser->crc_errors++;
+            return false;
+        }
+
+        uint8_t seq = parser->buffer[2];
+        if (parser->have_sequence) parser->lost += (uint8_t)(seq - parser->sequence - 1);
+        parser->sequence = seq;
+        parser->have_sequence = true;
+        parser->message_id = parser->buffer[1];
+        parser->payload = &parser->buffer[3];
+        parser->frames++;
+        return true;
+    }
+    }
+}
+
+size_t Telemetry_EncodeFrame(uint8_t id, uint8_t seq, const void *payload, uint8_t length,
+                             uint8_t *out) {
+    if (length > TELEMETRY_MAX_PAYLOAD) return 0;
+
+    out[0] = TELEMETRY_SYNC;
+    out[1] = length;
+    out[2] = id;
+    out[3] = seq;
+    if (length > 0) memcpy(&out[4], payload, length);
+    uint16_t crc = Telemetry_Crc16(0xFFFF, &out[1], (size_t)length + 3);
+    out[length + 4] = (uint8_t)(crc & 0xFF);
+    out[length + 5] = (uint8_t)(crc >> 8);
+    return (size_t)length + TELEMETRY_OVERHEAD;
+}
@@ -0,0 +1,412 @@
+/*
+ * terrain.cpp - Digital elevation model and terrain following for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * The queue holds tile keys in load order. A lookup miss under the
+ * vehicle goes to the front (it is needed now); prefetches and lookahead
+ * misses go to the back. Loading a tile costs two short flash reads (its
+ * index entry and its data) and one decode, so a 500 Hz caller fills the
+ * whole cache in a few tens of milliseconds once the flash is idle.
+ */
+
+#include "terrain.h"
+#include "hardware_drivers.h"
+#include "telemetry.h"
+#include <math.h>
+#include <string.h>
+
+static const uint8_t terrain_magic[4] = { 'T', 'M', 'F', 'T' };
+
+static bool height_at(Terrain_t *terrain, double latitude, double longitude, bool urgent, float *height);
+static Terrain_Tile_t *find_tile(Terrain_t *terrain, int32_t key);
+static int32_t tile_key(const Terrain_t *terrain, double post_north, double post_east);
+static void request_tile(Terrain_t *terrain, int32_t key, bool urgent);
+static bool decode_tile(const uint8_t *data, uint32_t length, Terrain_Tile_t *tile);
+static int32_t predict(const uint16_t *posts, uint32_t row, uint32_t col);
+static void put_u16(uint8_t *p, uint16_t v);
+static void put_u32(uint8_t *p, uint32_t v);
+static uint16_t get_u16(const uint8_t *p);
+static uint32_t get_u32(const uint8_t *p);
+
+void Terrain_Init(Terrain_t *terrain, const Terrain_Grid_t *grid) {
+    terrain->grid = *grid;
+    terrain->address = 0;
+    terrain->posts_per_deg_lat = 1.0 / grid->spacing_latitude;
+    terrain->posts_per_deg_lon = 1.0 / grid->spacing_longitude;
+    LocalFrame_Init(&terrain->frame,
+                    grid->origin_latitude + 0.5 * grid->spacing_latitude * grid->tiles_north * TERRAIN_TILE_CELLS,
+                    grid->origin_longitude + 0.5 * grid->spacing_longitude * grid->tiles_east * TERRAIN_TILE_CELLS,
+                    0.0f);
+
+    for (uint32_t slot = 0; slot < TERRAIN_CACHE_TILES; slot++) {
+        terrain->cache[slot].key = -1;
+        terrain->cache[slot].last_used = 0;
+    }
+    terrain->clock = 0;
+    terrain->last_slot = 0;
+    terrain->queue_count = 0;
+    memset(&terrain->stats, 0, sizeof(terrain->stats));
+    terrain->from_flash = false;
+}
+
+bool Terrain_Open(Terrain_t *terrain, uint32_t address) {
+    uint8_t header[TERRAIN_HEADER_BYTES];
+    Terrain_Grid_t grid;
+    if (!Flash_Read(address, header, sizeof(header))) return false;
+    if (!Terrain_DecodeHeader(header, &grid)) return false;
+    uint64_t index_end = (uint64_t)address + TERRAIN_HEADER_BYTES +
+                         (uint64_t)grid.tiles_north * grid.tiles_east * TERRAIN_INDEX_BYTES;
+    if (index_end > FLASH_CAPACITY) return false;
+
+    Terrain_Init(terrain, &grid);
+    terrain->address = address;
+    terrain->from_flash = true;
+    return true;
+}
+
+bool Terrain_Height(Terrain_t *terrain, double latitude, double longitude, float *height) {
+    return height_at(terrain, latitude, longitude, true, height);
+}
+
+void Terrain_Prefetch(Terrain_t *terrain, const Position_t *from, const Position_t *to) {
+    double n0 = (from->latitude - terrain->grid.origin_latitude) * terrain->posts_per_deg_lat;
+    double e0 = (from->longitude - terrain->grid.origin_longitude) * terrain->posts_per_deg_lon;
+    double dn = (to->latitude - from->latitude) * terrain->posts_per_deg_lat;
+    double de = (to->longitude - from->longitude) * terrain->posts_per_deg_lon;
+
+    // Half-tile steps cannot skip a tile corner by more than a few posts
+    uint32_t steps = (uint32_t)ceil(sqrt(dn * dn + de * de) / (0.5 * TERRAIN_TILE_CELLS));
+    int32_t previous = -1;
+    uint32_t distinct = 0;
+    for (uint32_t i = 0; i <= steps && distinct < TERRAIN_PREFETCH_TILES; i++) {
+        double f = (steps > 0) ? (double)i / steps : 0.0;
+        int32_t key = tile_key(terrain, n0 + dn * f, e0 + de * f);
+        if (key < 0 || key == previous) continue;
+        previous = key;
+        distinct++;
+
+        Terrain_Tile_t *tile = find_tile(terrain, key);
+        if (tile != NULL) {
+            tile->last_used = ++terrain->clock;
+        } else {
+            request_tile(terrain, key, false);
+        }
+    }
+}
+
+bool Terrain_Service(Terrain_t *terrain) {
+    if (!terrain->from_flash || terrain->queue_count == 0) return false;
+    if (Flash_IsBusy()) {
+        terrain->stats.deferred++;
+        return false;
+    }
+
+    int32_t key = terrain->queue[0];
+    terrain->queue_count--;
+    memmove(&terrain->queue[0], &terrain->queue[1], terrain->queue_count * sizeof(terrain->queue[0]));
+    if (find_tile(terrain, key) != NULL) return false;
+
+    uint8_t entry[TERRAIN_INDEX_BYTES];
+    uint32_t entry_address = terrain->address + TERRAIN_HEADER_BYTES + (uint32_t)key * TERRAIN_INDEX_BYTES;
+    if (!Flash_Read(entry_address, entry, sizeof(entry))) {
+        terrain->stats.load_errors++;
+        return false;
+    }
+    uint32_t offset = get_u32(entry), length = get_u16(entry + 4);
+    if (length > TERRAIN_MAX_TILE_BYTES || !Flash_Read(terrain->address + offset, terrain->scratch, length)) {
+        terrain->stats.load_errors++;
+        return false;
+    }
+    return Terrain_LoadTile(terrain, (uint32_t)key, terrain->scratch, length);
+}
+
+bool Terrain_LoadTile(Terrain_t *terrain, uint32_t key, const uint8_t *data, uint32_t length) {
+    // An empty slot, else the least recently used one
+    Terrain_Tile_t *victim = &terrain->cache[0];
+    for (uint32_t slot = 0; slot < TERRAIN_CACHE_TILES && victim->key >= 0; slot++) {
+        Terrain_Tile_t *tile = &terrain->cache[slot];
+        if (tile->key < 0 || tile->last_used < victim->last_used) victim = tile;
+    }
+    if (victim->key >= 0) terrain->stats.evictions++;
+
+    if (!decode_tile(data, length, victim)) {
+        victim->key = -1;
+        terrain->stats.load_errors++;
+        return false;
+    }
+    victim->key = (int32_t)key;
+    victim->last_used = ++terrain->clock;
+    terrain->stats.loads++;
+    return true;
+}
+
+void Terrain_EncodeHeader(const Terrain_Grid_t *grid, uint8_t header[TERRAIN_HEADER_BYTES]) {
+    memset(header, 0, TERRAIN_HEADER_BYTES);
+    memcpy(header, terrain_magic, sizeof(terrain_magic));
+    put_u16(header + 4, TERRAIN_VERSION);
+    put_u16(header + 6, TERRAIN_TILE_POSTS);
+    put_u32(header + 8, (uint32_t)(int32_t)llround(grid->origin_latitude * 1e7));
+    put_u32(header + 12, (uint32_t)(int32_t)llround(grid->origin_longitude * 1e7));
+    put_u32(header + 16, (uint32_t)llround(grid->spacing_latitude * 1e9));
+    put_u32(header + 20, (uint32_t)llround(grid->spacing_longitude * 1e9));
+    put_u16(header + 24, (uint16_t)grid->tiles_north);
+    put_u16(header + 26, (uint16_t)grid->tiles_east);
+    put_u16(header + 30, Telemetry_Crc16(0xFFFF, header, 30));
+}
+
+void Terrain_EncodeIndex(uint32_t offset, uint32_t length, uint8_t entry[TERRAIN_INDEX_BYTES]) {
+    put_u32(entry, offset);
+    put_u16(entry + 4, (uint16_t)length);
+    put_u16(entry + 6, 0);
+}
+
+uint32_t Terrain_EncodeTile(const float heights[TERRAIN_TILE_POSTS * TERRAIN_TILE_POSTS],
+                            uint8_t out[TERRAIN_MAX_TILE_BYTES]) {
+    const uint32_t count = TERRAIN_TILE_POSTS * TERRAIN_TILE_POSTS;
+    int32_t lowest = INT32_MAX, highest = INT32_MIN;
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t dm = (int32_t)lroundf(heights[i] * 10.0f);
+        if (dm < lowest) lowest = dm;
+        if (dm > highest) highest = dm;
+    }
+    if ((int64_t)highest - lowest > UINT16_MAX) return 0;
+
+    uint16_t posts[TERRAIN_TILE_POSTS * TERRAIN_TILE_POSTS];
+    uint32_t residuals[TERRAIN_TILE_POSTS * TERRAIN_TILE_POSTS];
+    uint32_t largest = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        posts[i] = (uint16_t)(lroundf(heights[i] * 10.0f) - lowest);
+        int32_t residual = (int32_t)posts[i] - predict(posts, i / TERRAIN_TILE_POSTS, i % TERRAIN_TILE_POSTS);
+        residuals[i] = ((uint32_t)residual << 1) ^ (uint32_t)(residual >> 31);
+        if (residuals[i] > largest) largest = residuals[i];
+    }
+    uint32_t width = 0;
+    while (width < 32 && (largest >> width) != 0) width++;
+
+    // Residuals packed LSB first
+    uint8_t *payload = out + TERRAIN_TILE_HEADER_BYTES;
+    uint32_t bytes = (count * width + 7) / 8;
+    memset(payload, 0, bytes);
+    uint64_t bit = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t b = 0; b < width; b++, bit++) {
+            if (residuals[i] & (1u << b)) payload[bit >> 3] |= (uint8_t)(1u << (bit & 7));
+        }
+    }
+
+    put_u32(out, (uint32_t)lowest);
+    out[4] = (uint8_t)width;
+    out[5] = 0;
+    put_u16(out + 6, Telemetry_Crc16(0xFFFF, payload, bytes));
+    return TERRAIN_TILE_HEADER_BYTES + bytes;
+}
+
+bool Terrain_DecodeHeader(const uint8_t header[TERRAIN_HEADER_BYTES], Terrain_Grid_t *grid) {
+    if (memcmp(header, terrain_magic, sizeof(terrain_magic)) != 0) return false;
+    if (get_u16(header + 30) != Telemetry_Crc16(0xFFFF, header, 30)) return false;
+    if (get_u16(header + 4) != TERRAIN_VERSION || get_u16(header + 6) != TERRAIN_TILE_POSTS) return false;
+
+    grid->origin_latitude = (double)(int32_t)get_u32(header + 8) * 1e-7;
+    grid->origin_longitude = (double)(int32_t)get_u32(header + 12) * 1e-7;
+    grid->spacing_latitude = (double)get_u32(header + 16) * 1e-9;
+    grid->spacing_longitude = (double)get_u32(header + 20) * 1e-9;
+    grid->tiles_north = get_u16(header + 24);
+    grid->tiles_east = get_u16(header + 26);
+    return grid->spacing_latitude > 0.0 && grid->spacing_longitude > 0.0 &&
+           grid->tiles_north > 0 && grid->tiles_east > 0;
+}
+
+void TerrainFollower_Reset(TerrainFollower_t *follower) {
+    follower->ground_alt = 0.0f;
+    follower->ground_rate = 0.0f;
+    follower->stale = 0;
+    follower->valid = false;
+}
+
+bool TerrainFollower_Update(TerrainFollower_t *follower, Terrain_t *terrain, const Position_t *position,
+                            const float velocity_ne[2], float dt) {
+    float ground;
+    if (!height_at(terrain, position->latitude, position->longitude, true, &ground)) {
+        follower->stale++;
+        follower->ground_rate = 0.0f;
+        return false;
+    }
+    follower->stale = 0;
+
+    // Highest terrain ahead, less the climb allowance until it is reached
+    double deg_per_m_n = 1.0 / terrain->frame.meters_per_deg_n;
+    double deg_per_m_e = 1.0 / terrain->frame.meters_per_deg_e;
+    float effective = ground;
+    for (int i = 1; i <= TERRAIN_LOOKAHEAD_SAMPLES; i++) {
+        float t = TERRAIN_LOOKAHEAD_S * (float)i / TERRAIN_LOOKAHEAD_SAMPLES;
+        float ahead;
+        if (!height_at(terrain, position->latitude + velocity_ne[0] * t * deg_per_m_n,
+                       position->longitude + velocity_ne[1] * t * deg_per_m_e, false, &ahead)) {
+            continue;
+        }
+        ahead -= TERRAIN_CLIMB_ALLOWANCE * t;
+        if (ahead > effective) effective = ahead;
+    }
+
+    Position_t horizon = *position;
+    horizon.latitude += velocity_ne[0] * TERRAIN_LOOKAHEAD_S * deg_per_m_n;
+    horizon.longitude += velocity_ne[1] * TERRAIN_LOOKAHEAD_S * deg_per_m_e;
+    Terrain_Prefetch(terrain, position, &horizon);
+
+    if (!follower->valid) {
+        follower->ground_alt = effective;
+        follower->ground_rate = 0.0f;
+        follower->valid = true;
+        return true;
+    }
+    if (dt > 0.0f) {
+        float rate = (effective - follower->ground_alt) / dt;
+        follower->ground_rate += (rate - follower->ground_rate) * dt / (TERRAIN_RATE_TAU_S + dt);
+    }
+    follower->ground_alt = effective;
+    return true;
+}
+
+/* --- Internals --- */
+
+static bool height_at(Terrain_t *terrain, double latitude, double longitude, bool urgent, float *height) {
+    terrain->stats.lookups++;
+    double north = (latitude - terrain->grid.origin_latitude) * terrain->posts_per_deg_lat;
+    double east = (longitude - terrain->grid.origin_longitude) * terrain->posts_per_deg_lon;
+    int32_t key = tile_key(terrain, north, east);
+    if (key < 0) {
+        terrain->stats.outside++;
+        return false;
+    }
+    Terrain_Tile_t *tile = find_tile(terrain, key);
+    if (tile == NULL) {
+        terrain->stats.misses++;
+        request_tile(terrain, key, urgent);
+        return false;
+    }
+    tile->last_used = ++terrain->clock;
+
+    uint32_t post_n = (uint32_t)north, post_e = (uint32_t)east;
+    float wn = (float)(north - post_n), we = (float)(east - post_e);
+    const uint16_t *p = &tile->posts[(post_n % TERRAIN_TILE_CELLS) * TERRAIN_TILE_POSTS + post_e % TERRAIN_TILE_CELLS];
+    float south = (float)p[0] + ((float)p[1] - (float)p[0]) * we;
+    float north_row = (float)p[TERRAIN_TILE_POSTS] + ((float)p[TERRAIN_TILE_POSTS + 1] - (float)p[TERRAIN_TILE_POSTS]) * we;
+    *height = tile->base_m + 0.1f * (south + (north_row - south) * wn);
+    return true;
+}
+
+static Terrain_Tile_t *find_tile(Terrain_t *terrain, int32_t key) {
+    if (terrain->cache[terrain->last_slot].key == key) return &terrain->cache[terrain->last_slot];
+    for (uint32_t slot = 0; slot < TERRAIN_CACHE_TILES; slot++) {
+        if (terrain->cache[slot].key == key) {
+            terrain->last_slot = slot;
+            return &terrain->cache[slot];
+        }
+    }
+    return NULL;
+}
+
+static int32_t tile_key(const Terrain_t *terrain, double post_north, double post_east) {
+    if (!(post_north >= 0.0 && post_east >= 0.0)) return -1;
+    uint32_t row = (uint32_t)(post_north * (1.0 / TERRAIN_TILE_CELLS));
+    uint32_t col = (uint32_t)(post_east * (1.0 / TERRAIN_TILE_CELLS));
+    if (row >= terrain->grid.tiles_north || col >= terrain->grid.tiles_east) return -1;
+    return (int32_t)(row * terrain->grid.tiles_east + col);
+}
+
+static void request_tile(Terrain_t *terrain, int32_t key, bool urgent) {
+    uint32_t at = terrain->queue_count;
+    for (uint32_t i = 0; i < terrain->queue_count; i++) {
+        if (terrain->queue[i] == key) at = i;
+    }
+    if (at < terrain->queue_count) {
+        if (!urgent || at == 0) return;
+        // Already queued: move it to the front
+        memmove(&terrain->queue[1], &terrain->queue[0], at * sizeof(terrain->queue[0]));
+        terrain->queue[0] = key;
+        return;
+    }
+
+    if (terrain->queue_count == TERRAIN_QUEUE) {
+        terrain->stats.queue_full++;
+        if (!urgent) return;
+        terrain->queue_count--;   // The newest prefetch gives way
+    }
+    if (urgent) {
+        memmove(&terrain->queue[1], &terrain->queue[0], terrain->queue_count * sizeof(terrain->queue[0]));
+        terrain->queue[0] = key;
+    } else {
+        terrain->queue[terrain->queue_count] = key;
+    }
+    terrain->queue_count++;
+}
+
+static bool decode_tile(const uint8_t *data, uint32_t length, Terrain_Tile_t *tile) {
+    const uint32_t count = TERRAIN_TILE_POSTS * TERRAIN_TILE_POSTS;
+    if (length < TERRAIN_TILE_HEADER_BYTES) return false;
+    uint32_t width = data[4];
+    uint32_t bytes = (count * width + 7) / 8;
+    if (width > TERRAIN_MAX_RESIDUAL_BITS || length < TERRAIN_TILE_HEADER_BYTES + bytes) return false;
+    const uint8_t *payload = data + TERRAIN_TILE_HEADER_BYTES;
+    if (get_u16(data + 6) != Telemetry_Crc16(0xFFFF, payload, bytes)) return false;
+
+    // Bit reader: refill whole bytes below the 32 bits a residual can need
+    uint64_t bits = 0;
+    uint32_t available = 0, next = 0;
+    uint32_t mask = (width == 32) ? 0xFFFFFFFFu : (1u << width) - 1u;
+    for (uint32_t i = 0; i < count; i++) {
+        while (available < width) {
+            bits |= (uint64_t)((next < bytes) ? payload[next] : 0) << available;
+            next++;
+            available += 8;
+        }
+        uint32_t zigzag = (uint32_t)bits & mask;
+        bits >>= width;
+        available -= width;
+
+        int32_t residual = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+        int32_t value = predict(tile->posts, i / TERRAIN_TILE_POSTS, i % TERRAIN_TILE_POSTS) + residual;
+        if (value < 0 || value > UINT16_MAX) return false;
+        tile->posts[i] = (uint16_t)value;
+    }
+    tile->base_m = (float)(int32_t)get_u32(data) * 0.1f;
+    return true;
+}
+
+// JPEG-LS median edge detector over the west, south and south-west posts
+static int32_t predict(const uint16_t *posts, uint32_t row, uint32_t col) {
+    if (row == 0 && col == 0) return 0;
+    if (row == 0) return posts[col - 1];
+    if (col == 0) return posts[(row - 1) * TERRAIN_TILE_POSTS];
+
+    int32_t west = posts[row * TERRAIN_TILE_POSTS + col - 1];
+    int32_t south = posts[(row - 1) * TERRAIN_TILE_POSTS + col];
+    int32_t south_west = posts[(row - 1) * TERRAIN_TILE_POSTS + col - 1];
+    int32_t low = (west < south) ? west : south;
+    int32_t high = (west < south) ? south : west;
+    if (south_west >= high) return low;
+    if (south_west <= low) return high;
+    return west + south - south_west;
+}
+
+/* --- Byte order --- */
+
+static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
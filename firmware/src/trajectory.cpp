@@ -0,0 +1,510 @@
+/*
+ * trajectory.cpp - Minimum-snap trajectory planner for TMF drone
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Each segment is p(tau) = sum c_k tau^k on tau in [0, 1]. Its eight
+ * coefficients follow from the position and first three derivatives at
+ * both ends (c = A^-1 d), so the snap cost of a segment is a quadratic
+ * form in its knot derivatives, H = A^-T Q A^-1 with
+ *   Q_ij = i!/(i-4)! j!/(j-4)! / (i+j-7)        (i, j >= 4)
+ * For a segment of duration T the tau-derivatives are d_k T^k and the
+ * cost scales by 1/T^7. Summing the segment blocks over the window gives
+ * the Hessian over all knot derivatives; with the fixed ones (start
+ * state, waypoint positions, zero derivatives at a stop) moved to the
+ * right-hand side, the free ones solve H_FF x_F = -H_FP x_P.
+ *
+ * Times are normalized to the first segment's duration so the matrix
+ * stays well scaled in single precision. The solve only sets the free
+ * derivatives, and knots share them between segments, so rounding never
+ * breaks continuity; it can only make a segment slightly less smooth.
+ */
+
+#include "trajectory.h"
+#include <math.h>
+#include <string.h>
+
+#define KNOT_VARS       4                                          // Position, velocity, acceleration, jerk
+#define MAX_VARS        (KNOT_VARS * (TRAJECTORY_WINDOW_LEGS + 1))
+#define MAX_FREE        (3 * TRAJECTORY_WINDOW_LEGS)
+#define RETIME_TRIES    4
+#define RETIME_MAX_STEP 3.0f      // Largest change of a segment time per retry
+#define LIMIT_SAMPLES   16
+#define LIMIT_TOLERANCE 0.05f
+#define MERGE_DISTANCE  0.5f      // Waypoints this close to the previous knot are skipped (m)
+#define REST_SPEED      0.5f      // Start speeds below this count as starting from rest (m/s)
+
+typedef struct {
+    int legs;
+    bool stop_end;
+    bool first_reaches_waypoint;   // Else the first segment ends part way along a split leg
+    float duration[TRAJECTORY_WINDOW_LEGS];
+    float knot[TRAJECTORY_WINDOW_LEGS + 1][3];   // NED from the planning knot
+} Window_t;
+
+static float a_inverse[TRAJECTORY_COEFFS][TRAJECTORY_COEFFS];   // Knot tau-derivatives to coefficients
+static float snap_cost[TRAJECTORY_COEFFS][TRAJECTORY_COEFFS];   // Unit-segment cost over knot tau-derivatives
+
+static bool build_tables(void);
+static void fill_cache(TrajectoryPlanner_t *planner);
+static bool plan_segment(TrajectoryPlanner_t *planner);
+static float leg_duration(float distance, int rest_ends);
+static bool is_stop(const TrajectoryPlanner_t *planner, uint32_t index, const Waypoint_t *waypoint);
+static void drop_cached(TrajectoryPlanner_t *planner);
+static bool solve_window(const Window_t *window, const float start[3][3],
+                         float coeff[][3][TRAJECTORY_COEFFS], float end[3][3]);
+static float limit_ratio(const float coeff[3][TRAJECTORY_COEFFS], float duration);
+static const Trajectory_Segment_t *active_segment(const TrajectoryPlanner_t *planner);
+static void pop_segment(TrajectoryPlanner_t *planner);
+static float distance3(const float a[3], const float b[3]);
+
+// Filled during static initialization, before any planner (or thread) can
+// use them, so concurrent planners only ever read them
+static const bool tables_built = build_tables();
+
+void TrajectoryPlanner_Start(TrajectoryPlanner_t *planner, const Mission_Source_t *source,
+                             const Position_t *start, const float velocity[3], uint64_t now_us) {
+    memset(planner, 0, sizeof(TrajectoryPlanner_t));
+    planner->source = *source;
+    planner->mission_count = source->count;
+    planner->plan_position = *start;
+    for (int axis = 0; axis < 3; axis++) planner->plan_derivatives[axis][0] = velocity[axis];
+    planner->last_sample_us = now_us;
+    planner->complete = (source->count == 0);
+}
+
+bool TrajectoryPlanner_Service(TrajectoryPlanner_t *planner) {
+    fill_cache(planner);
+    return plan_segment(planner);
+}
+
+void TrajectoryPlanner_Sample(TrajectoryPlanner_t *planner, uint64_t now_us, const Position_t *position,
+                              Trajectory_Setpoint_t *setpoint) {
+    memset(setpoint, 0, sizeof(Trajectory_Setpoint_t));
+    float dt = (now_us > planner->last_sample_us) ? (float)(now_us - planner->last_sample_us) * 1e-6f : 0.0f;
+    planner->last_sample_us = now_us;
+
+    if (planner->complete) {
+        setpoint->complete = true;
+        return;
+    }
+    const Trajectory_Segment_t *segment = active_segment(planner);
+    if (segment == NULL) return;   // Nothing planned yet: hold where we are
+
+    // Slow the reference down while the vehicle lags it
+    float vehicle[3], reference[3];
+    LocalFrame_ToNED(&segment->frame, position->latitude, position->longitude, position->altitude, vehicle);
+    Trajectory_Evaluate(segment, planner->segment_time, reference, NULL, NULL);
+    float rate = (TRAJECTORY_STOP_ERROR - distance3(reference, vehicle)) /
+                 (TRAJECTORY_STOP_ERROR - TRAJECTORY_SLOW_ERROR);
+    if (rate > 1.0f) rate = 1.0f;
+    if (rate < 0.0f) rate = 0.0f;
+    planner->segment_time += dt * rate;
+
+    while (planner->segment_time >= segment->duration_s) {
+        if (segment->stop) {
+            // Hold only counts once the vehicle is actually there
+            planner->segment_time = segment->duration_s;
+            Trajectory_Evaluate(segment, segment->duration_s, reference, NULL, NULL);
+            bool inside = distance3(reference, vehicle) < TRAJECTORY_HOLD_RADIUS;
+            if (inside) planner->hold_elapsed += dt;
+            setpoint->holding = true;
+            if (!inside || planner->hold_elapsed < segment->target.hold_time) break;
+        }
+        bool planned_out = (planner->queue_count == 1 && planner->plan_next >= planner->mission_count);
+        if (segment->target_index + 1 >= planner->mission_count && (segment->stop || planned_out)) {
+            planner->complete = true;
+            setpoint->complete = true;
+            return;
+        }
+        if (planner->queue_count == 1) {
+            // Planning fell behind: wait at the end of the segment
+            if (!planner->starving) planner->stats.starved++;
+            planner->starving = true;
+            planner->segment_time = segment->duration_s;
+            break;
+        }
+
+        planner->segment_time = segment->stop ? 0.0f : planner->segment_time - segment->duration_s;
+        setpoint->holding = false;
+        pop_segment(planner);
+        segment = active_segment(planner);
+        LocalFrame_ToNED(&segment->frame, position->latitude, position->longitude, position->altitude, vehicle);
+    }
+    if (planner->queue_count > 1) planner->starving = false;
+
+    float velocity[3], acceleration[3];
+    Trajectory_Evaluate(segment, planner->segment_time, reference, velocity, acceleration);
+    for (int axis = 0; axis < 3; axis++) {
+        setpoint->position_error[axis] = reference[axis] - vehicle[axis];
+        setpoint->velocity[axis] = velocity[axis] * rate;
+        setpoint->acceleration[axis] = acceleration[axis] * rate * rate;
+    }
+    setpoint->target = &segment->target;
+    setpoint->target_index = segment->target_index;
+}
+
+void Trajectory_Evaluate(const Trajectory_Segment_t *segment, float t, float position[3],
+                         float velocity[3], float acceleration[3]) {
+    float inv_t = 1.0f / segment->duration_s;
+    float tau = t * inv_t;
+    if (tau < 0.0f) tau = 0.0f;
+    if (tau > 1.0f) tau = 1.0f;
+
+    for (int axis = 0; axis < 3; axis++) {
+        const float *c = segment->coeff[axis];
+        if (position != NULL) {
+            float p = c[7];
+            for (int k = 6; k >= 0; k--) p = p * tau + c[k];
+            position[axis] = p;
+        }
+        if (velocity != NULL) {
+            float v = 7.0f * c[7];
+            for (int k = 6; k >= 1; k--) v = v * tau + (float)k * c[k];
+            velocity[axis] = v * inv_t;
+        }
+        if (acceleration != NULL) {
+            float a = 42.0f * c[7];
+            for (int k = 6; k >= 2; k--) a = a * tau + (float)(k * (k - 1)) * c[k];
+            acceleration[axis] = a * inv_t * inv_t;
+        }
+    }
+}
+
+/* --- Internals --- */
+
+// A and Q in double, once; only the products are kept
+static bool build_tables(void) {
+    const int n = TRAJECTORY_COEFFS;
+    double a[TRAJECTORY_COEFFS][2 * TRAJECTORY_COEFFS];
+    memset(a, 0, sizeof(a));
+
+    // Rows 0-3: derivatives at tau = 0; rows 4-7: at tau = 1
+    for (int d = 0; d < KNOT_VARS; d++) {
+        for (int k = d; k < n; k++) {
+            double falling = 1.0;
+            for (int m = 0; m < d; m++) falling *= (double)(k - m);
+            if (k == d) a[d][k] = falling;
+            a[KNOT_VARS + d][k] = falling;
+        }
+    }
+    for (int i = 0; i < n; i++) a[i][n + i] = 1.0;
+
+    // Gauss-Jordan with partial pivoting
+    for (int col = 0; col < n; col++) {
+        int pivot = col;
+        for (int r = col + 1; r < n; r++) {
+            if (fabs(a[r][col]) > fabs(a[pivot][col])) pivot = r;
+        }
+        for (int c = 0; c < 2 * n; c++) {
+            double t = a[col][c];
+            a[col][c] = a[pivot][c];
+            a[pivot][c] = t;
+        }
+        double scale = 1.0 / a[col][col];
+        for (int c = 0; c < 2 * n; c++) a[col][c] *= scale;
+        for (int r = 0; r < n; r++) {
+            if (r == col || a[r][col] == 0.0) continue;
+            double f = a[r][col];
+            for (int c = 0; c < 2 * n; c++) a[r][c] -= f * a[col][c];
+        }
+    }
+
+    double q[TRAJECTORY_COEFFS][TRAJECTORY_COEFFS];
+    memset(q, 0, sizeof(q));
+    for (int i = 4; i < n; i++) {
+        for (int j = 4; j < n; j++) {
+            double fi = (double)(i * (i - 1) * (i - 2) * (i - 3));
+            double fj = (double)(j * (j - 1) * (j - 2) * (j - 3));
+            q[i][j] = fi * fj / (double)(i + j - 7);
+        }
+    }
+
+    for (int r = 0; r < n; r++) {
+        for (int c = 0; c < n; c++) {
+            a_inverse[r][c] = (float)a[r][n + c];
+            double h = 0.0;
+            for (int i = 0; i < n; i++) {
+                for (int j = 0; j < n; j++) h += a[i][n + r] * q[i][j] * a[j][n + c];
+            }
+            snap_cost[r][c] = (float)h;
+        }
+    }
+    return true;
+}
+
+// Top up the read-ahead; a corrupt record ends the mission before it
+static void fill_cache(TrajectoryPlanner_t *planner) {
+    uint32_t next = planner->cache_first + planner->cache_count;
+    if (planner->cache_count >= TRAJECTORY_CACHE || next >= planner->mission_count) return;
+
+    uint32_t want = TRAJECTORY_CACHE - planner->cache_count;
+    if (want > planner->mission_count - next) want = planner->mission_count - next;
+    uint32_t got = planner->source.read(&planner->source, next, &planner->cache[planner->cache_count], want);
+    planner->cache_count += got;
+    planner->stats.waypoints_read += got;
+    if (planner->source.failed) {
+        planner->mission_count = next + got;
+        planner->stats.source_failed = true;
+    }
+}
+
+static bool plan_segment(TrajectoryPlanner_t *planner) {
+    if (planner->queue_count >= TRAJECTORY_QUEUE) return false;
+
+    LocalFrame_t frame;
+    LocalFrame_Init(&frame, planner->plan_position.latitude, planner->plan_position.longitude,
+                    planner->plan_position.altitude);
+
+    // Waypoints on top of the planning knot would be zero-length legs
+    while (planner->plan_next < planner->mission_count && planner->cache_count > 0) {
+        const Waypoint_t *waypoint = &planner->cache[0];
+        float ned[3], here[3] = { 0.0f, 0.0f, 0.0f };
+        LocalFrame_ToNED(&frame, waypoint->position.latitude, waypoint->position.longitude,
+                         waypoint->position.altitude, ned);
+        if (distance3(ned, here) >= MERGE_DISTANCE || is_stop(planner, planner->plan_next, waypoint)) break;
+        planner->plan_next++;
+        drop_cached(planner);
+    }
+    if (planner->plan_next >= planner->mission_count) return false;
+
+    // Window: up to TRAJECTORY_WINDOW_LEGS segments, ending early at a stop
+    Window_t window;
+    memset(&window, 0, sizeof(window));
+    float start_speed = sqrtf(planner->plan_derivatives[0][0] * planner->plan_derivatives[0][0] +
+                              planner->plan_derivatives[1][0] * planner->plan_derivatives[1][0] +
+                              planner->plan_derivatives[2][0] * planner->plan_derivatives[2][0]);
+    float previous[3] = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t index = planner->plan_next; window.legs < TRAJECTORY_WINDOW_LEGS; index++) {
+        if (index >= planner->mission_count) break;
+        if (index - planner->cache_first >= planner->cache_count) return false;   // Read-ahead still pending
+
+        const Waypoint_t *waypoint = &planner->cache[index - planner->cache_first];
+        bool stop = is_stop(planner, index, waypoint);
+        float ned[3];
+        LocalFrame_ToNED(&frame, waypoint->position.latitude, waypoint->position.longitude,
+                         waypoint->position.altitude, ned);
+        float distance = distance3(previous, ned);
+        if (distance < MERGE_DISTANCE && !stop) continue;
+
+        // Long legs are split into evenly spaced pieces
+        int pieces = (int)ceilf(distance / TRAJECTORY_SPLIT_DISTANCE - 0.01f);
+        if (pieces < 1) pieces = 1;
+        int piece = 1;
+        for (; piece <= pieces && window.legs < TRAJECTORY_WINDOW_LEGS; piece++) {
+            float *knot = window.knot[window.legs + 1];
+            for (int axis = 0; axis < 3; axis++) {
+                knot[axis] = previous[axis] + (ned[axis] - previous[axis]) * (float)piece / (float)pieces;
+            }
+            int rest_ends = 0;
+            if (window.legs == 0 && start_speed < REST_SPEED) rest_ends++;
+            if (stop && piece == pieces) rest_ends++;
+            window.duration[window.legs] = leg_duration(distance / (float)pieces, rest_ends);
+            if (window.legs == 0) window.first_reaches_waypoint = (pieces == 1);
+            window.legs++;
+        }
+        if (piece <= pieces) break;   // Window full part way along the leg
+        memcpy(previous, ned, sizeof(previous));
+        if (stop) {
+            window.stop_end = true;
+            break;
+        }
+    }
+
+    // Solve, retiming each segment until it just meets the limits
+    float coeff[TRAJECTORY_WINDOW_LEGS][3][TRAJECTORY_COEFFS], end[3][3];
+    for (int attempt = 0; attempt < RETIME_TRIES; attempt++) {
+        planner->stats.solves++;
+        if (!solve_window(&window, planner->plan_derivatives, coeff, end)) return false;
+        if (attempt == RETIME_TRIES - 1) break;
+
+        bool retimed = false;
+        for (int leg = 0; leg < window.legs; leg++) {
+            float ratio = limit_ratio(coeff[leg], window.duration[leg]);
+            if (fabsf(ratio - 1.0f) <= LIMIT_TOLERANCE) continue;
+            if (!(ratio < RETIME_MAX_STEP)) ratio = RETIME_MAX_STEP;   // Also catches NaN
+            if (ratio < 1.0f / RETIME_MAX_STEP) ratio = 1.0f / RETIME_MAX_STEP;
+            if (attempt == 0 && leg == 0 && ratio > 1.0f) planner->stats.stretched++;
+            window.duration[leg] = fmaxf(window.duration[leg] * ratio, TRAJECTORY_MIN_SEGMENT_S);
+            retimed = true;
+        }
+        if (!retimed) break;
+    }
+
+    uint32_t slot = (planner->queue_head + planner->queue_count) % TRAJECTORY_QUEUE;
+    Trajectory_Segment_t *segment = &planner->queue[slot];
+    const Waypoint_t *target = &planner->cache[planner->plan_next - planner->cache_first];
+    segment->frame = frame;
+    memcpy(segment->coeff, coeff[0], sizeof(coeff[0]));
+    segment->duration_s = window.duration[0];
+    segment->target = *target;
+    segment->target_index = planner->plan_next;
+    segment->stop = (window.legs == 1 && window.stop_end);
+    planner->queue_count++;
+    planner->stats.segments++;
+
+    // The segment end is the next planning knot
+    if (window.first_reaches_waypoint) {
+        planner->plan_position = target->position;
+        planner->plan_next++;
+        drop_cached(planner);
+    } else {
+        LocalFrame_FromNED(&frame, window.knot[1], &planner->plan_position.latitude,
+                           &planner->plan_position.longitude, &planner->plan_position.altitude);
+    }
+    memcpy(planner->plan_derivatives, end, sizeof(end));
+    return true;
+}
+
+static bool is_stop(const TrajectoryPlanner_t *planner, uint32_t index, const Waypoint_t *waypoint) {
+    return waypoint->hold_time > 0.0f || index + 1 >= planner->mission_count;
+}
+
+// Forget cached waypoints the planner has passed
+static void drop_cached(TrajectoryPlanner_t *planner) {
+    uint32_t drop = planner->plan_next - planner->cache_first;
+    if (drop > planner->cache_count) drop = planner->cache_count;
+    memmove(&planner->cache[0], &planner->cache[drop], (planner->cache_count - drop) * sizeof(Waypoint_t));
+    planner->cache_first += drop;
+    planner->cache_count -= drop;
+}
+
+// Trapezoidal speed profile, ramping at each end that is at rest
+static float leg_duration(float distance, int rest_ends) {
+    const float v = TRAJECTORY_CRUISE_SPEED;
+    const float a = TRAJECTORY_MAX_ACCEL;
+    float duration;
+    if (rest_ends == 0) {
+        duration = distance / v;
+    } else if (distance >= (float)rest_ends * v * v / (2.0f * a)) {
+        duration = distance / v + (float)rest_ends * v / (2.0f * a);
+    } else {
+        duration = (float)rest_ends * sqrtf(2.0f * a * distance / (float)rest_ends) / a;
+    }
+    return (duration > TRAJECTORY_MIN_SEGMENT_S) ? duration : TRAJECTORY_MIN_SEGMENT_S;
+}
+
+static bool solve_window(const Window_t *window, const float start[3][3],
+                         float coeff[][3][TRAJECTORY_COEFFS], float end[3][3]) {
+    const int legs = window->legs;
+    const int n = KNOT_VARS * (legs + 1);
+    const float unit = window->duration[0];
+
+    // Hessian over all knot derivatives, time in units of the first segment
+    float h[MAX_VARS][MAX_VARS];
+    float s[TRAJECTORY_WINDOW_LEGS][TRAJECTORY_COEFFS];
+    memset(h, 0, sizeof(h));
+    for (int leg = 0; leg < legs; leg++) {
+        float t = window->duration[leg] / unit;
+        float *sl = s[leg];
+        sl[0] = sl[4] = 1.0f;
+        sl[1] = sl[5] = t;
+        sl[2] = sl[6] = t * t;
+        sl[3] = sl[7] = t * t * t;
+        float weight = 1.0f / (sl[3] * sl[3] * t);
+        int base = KNOT_VARS * leg;
+        for (int r = 0; r < TRAJECTORY_COEFFS; r++) {
+            for (int c = 0; c < TRAJECTORY_COEFFS; c++) {
+                h[base + r][base + c] += sl[r] * snap_cost[r][c] * sl[c] * weight;
+            }
+        }
+    }
+
+    // Free: interior velocity/acceleration/jerk, and the end's unless it stops
+    int free_vars[MAX_FREE], fixed_vars[MAX_VARS];
+    int n_free = 0, n_fixed = 0;
+    for (int v = 0; v < n; v++) {
+        int knot = v / KNOT_VARS, d = v % KNOT_VARS;
+        bool fixed = (knot == 0) || (d == 0) || (knot == legs && window->stop_end);
+        if (fixed) {
+            fixed_vars[n_fixed++] = v;
+        } else {
+            free_vars[n_free++] = v;
+        }
+    }
+
+    // Cholesky of H_FF, shared by the three axes
+    float l[MAX_FREE][MAX_FREE];
+    for (int i = 0; i < n_free; i++) {
+        for (int j = 0; j <= i; j++) {
+            float sum = h[free_vars[i]][free_vars[j]];
+            for (int k = 0; k < j; k++) sum -= l[i][k] * l[j][k];
+            if (i == j) {
+                if (sum <= 0.0f) return false;
+                l[i][i] = sqrtf(sum);
+            } else {
+                l[i][j] = sum / l[j][j];
+            }
+        }
+    }
+
+    float scale[KNOT_VARS] = { 1.0f, unit, unit * unit, unit * unit * unit };
+    for (int axis = 0; axis < 3; axis++) {
+        float x[MAX_VARS];
+        memset(x, 0, sizeof(x));
+        for (int d = 1; d < KNOT_VARS; d++) x[d] = start[axis][d - 1] * scale[d];
+        for (int knot = 1; knot <= legs; knot++) x[KNOT_VARS * knot] = window->knot[knot][axis];
+
+        float y[MAX_FREE];
+        for (int i = 0; i < n_free; i++) {
+            float rhs = 0.0f;
+            for (int p = 0; p < n_fixed; p++) rhs -= h[free_vars[i]][fixed_vars[p]] * x[fixed_vars[p]];
+            for (int k = 0; k < i; k++) rhs -= l[i][k] * y[k];
+            y[i] = rhs / l[i][i];
+        }
+        for (int i = n_free - 1; i >= 0; i--) {
+            float rhs = y[i];
+            for (int k = i + 1; k < n_free; k++) rhs -= l[k][i] * x[free_vars[k]];
+            x[free_vars[i]] = rhs / l[i][i];
+        }
+
+        // Segment coefficients from its knots' tau-derivatives
+        for (int leg = 0; leg < legs; leg++) {
+            const float *xl = &x[KNOT_VARS * leg];
+            for (int r = 0; r < TRAJECTORY_COEFFS; r++) {
+                float c = 0.0f;
+                for (int k = 0; k < TRAJECTORY_COEFFS; k++) c += a_inverse[r][k] * xl[k] * s[leg][k];
+                coeff[leg][axis][r] = c;
+            }
+        }
+        for (int d = 1; d < KNOT_VARS; d++) end[axis][d - 1] = x[KNOT_VARS + d] / scale[d];
+    }
+    return true;
+}
+
+// Worst of peak speed and acceleration over their limits, as the factor
+// the segment's duration should be scaled by
+static float limit_ratio(const float coeff[3][TRAJECTORY_COEFFS], float duration) {
+    Trajectory_Segment_t probe;
+    memcpy(probe.coeff, coeff, sizeof(probe.coeff));
+    probe.duration_s = duration;
+
+    float peak_speed = 0.0f, peak_accel = 0.0f;
+    for (int i = 0; i <= LIMIT_SAMPLES; i++) {
+        float v[3], a[3];
+        Trajectory_Evaluate(&probe, duration * (float)i / LIMIT_SAMPLES, NULL, v, a);
+        float speed = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        float accel = sqrtf(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+        if (speed > peak_speed) peak_speed = speed;
+        if (accel > peak_accel) peak_accel = accel;
+    }
+    float speed_ratio = peak_speed / TRAJECTORY_CRUISE_SPEED;
+    float accel_ratio = sqrtf(peak_accel / TRAJECTORY_MAX_ACCEL);
+    return (speed_ratio > accel_ratio) ? speed_ratio : accel_ratio;
+}
+
+static const Trajectory_Segment_t *active_segment(const TrajectoryPlanner_t *planner) {
+    return (planner->queue_count > 0) ? &planner->queue[planner->queue_head] : NULL;
+}
+
+static void pop_segment(TrajectoryPlanner_t *planner) {
+    planner->queue_head = (planner->queue_head + 1) % TRAJECTORY_QUEUE;
+    planner->queue_count--;
+    planner->hold_elapsed = 0.0f;
+}
+
+static float distance3(const float a[3], const float b[3]) {
+    float dn = a[0] - b[0], de = a[1] - b[1], dd = a[2] - b[2];
+    return sqrtf(dn * dn + de * de + dd * dd);
+}
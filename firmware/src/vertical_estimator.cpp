@@ -0,0 +1,44 @@
+/*
+ * vertical_estimator.cpp - Altitude and climb rate from accel and baro
+ * MCU: STM32F746ZG
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ */
+
+#include "vertical_estimator.h"
+#include <string.h>
+
+#define VERT_EST_MAX_DT  0.1f   // Longer gaps are skipped, not integrated
+
+void VertEst_Init(VertEst_t *est, float tau_s) {
+    memset(est, 0, sizeof(VertEst_t));
+    est->k1 = 3.0f / tau_s;
+    est->k2 = 3.0f / (tau_s * tau_s);
+    est->k3 = 1.0f / (tau_s * tau_s * tau_s);
+}
+
+void VertEst_Predict(VertEst_t *est, float accel_up, float dt) {
+    if (!est->initialized || dt <= 0.0f || dt > VERT_EST_MAX_DT) return;
+
+    float error = est->baro_altitude - est->altitude;
+    float accel = accel_up + est->accel_bias;
+    est->altitude += (est->climb_rate + 0.5f * accel * dt + est->k1 * error) * dt;
+    est->climb_rate += (accel + est->k2 * error) * dt;
+    est->accel_bias += est->k3 * error * dt;
+}
+
+void VertEst_FuseBaro(VertEst_t *est, float altitude) {
+    est->baro_altitude = altitude;
+    est->baro_samples++;
+    if (!est->initialized) {
+        est->altitude = altitude;
+        est->climb_rate = 0.0f;
+        est->accel_bias = 0.0f;
+        est->initialized = true;
+    }
+}
+
+void VertEst_Shift(VertEst_t *est, float delta) {
+    est->altitude += delta;
+    est->baro_altitude += delta;
+}
@@ -0,0 +1,176 @@
+/*
+ * propulsion_driver_test.cpp - DShot frame and eRPM reply vectors
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Checks PropulsionDriver_EncodeFrame and PropulsionDriver_DecodeReply
+ * against frames and replies worked by hand from the DShot protocol
+ * description, not against the SIL ESC model (which shares the driver's
+ * reading of the protocol):
+ *
+ *   frame  = 11-bit value, telemetry bit, 4-bit CRC of the 12-bit packet
+ *            (packet ^ packet >> 4 ^ packet >> 8), inverted when
+ *            bidirectional
+ *   reply  = 12-bit period (eee mmmmmmmmm, us) and an inverted CRC of the
+ *            same form, each nibble mapped to 5 GCR bits, sent NRZI (a 1
+ *            is a level change) after a low start bit
+ *
+ * Run through ctest; exits non-zero if any check fails.
+ */
+
+#include "propulsion_driver.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BIT_COUNTS  10   // Reply bit time in timer counts
+
+static int failures = 0;
+
+#define CHECK(cond)                                                      \
+    do {                                                                 \
+        if (!(cond)) {                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                  \
+        }                                                                \
+    } while (0)
+
+// GCR nibble codes from the protocol description
+static const uint8_t gcr_code[16] = {
+    0x19, 0x1B, 0x12, 0x13, 0x1D, 0x15, 0x16, 0x17,
+    0x1A, 0x09, 0x0A, 0x0B, 0x1E, 0x0D, 0x0E, 0x0F,
+};
+
+static uint32_t build_reply(uint16_t value, uint16_t start, uint16_t *edges);
+static void test_frames(void);
+static void test_replies_by_hand(void);
+static void test_replies_encoded(void);
+static void test_reply_rejection(void);
+
+int main(void) {
+    test_frames();
+    test_replies_by_hand();
+    test_replies_encoded();
+    test_reply_rejection();
+
+    if (failures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("propulsion driver: all checks passed\n");
+    return EXIT_SUCCESS;
+}
+
+/* --- Frames --- */
+
+static void test_frames(void) {
+    // 1046: packet 0x82C, CRC 0x82C ^ 0x82 ^ 0x8 -> 6
+    CHECK(PropulsionDriver_EncodeFrame(1046, false, false) == 0x82C6);
+    CHECK(PropulsionDriver_EncodeFrame(1046, false, true) == 0x82C9);
+
+    // Lowest throttle, without and with the telemetry request bit
+    CHECK(PropulsionDriver_EncodeFrame(DSHOT_THROTTLE_MIN, false, false) == 0x0606);
+    CHECK(PropulsionDriver_EncodeFrame(DSHOT_THROTTLE_MIN, true, false) == 0x0617);
+    CHECK(PropulsionDriver_EncodeFrame(DSHOT_THROTTLE_MIN, true, true) == 0x0618);
+
+    // Full throttle with telemetry: all ones, CRC inverted to zero
+    CHECK(PropulsionDriver_EncodeFrame(DSHOT_THROTTLE_MAX, true, false) == 0xFFFF);
+    CHECK(PropulsionDriver_EncodeFrame(DSHOT_THROTTLE_MAX, true, true) == 0xFFF0);
+
+    // Motor stop (command 0)
+    CHECK(PropulsionDriver_EncodeFrame(0, false, false) == 0x0000);
+    CHECK(PropulsionDriver_EncodeFrame(0, false, true) == 0x000F);
+}
+
+/* --- Replies --- */
+
+// Level runs of a reply written out bit by bit, as edge times
+static void test_replies_by_hand(void) {
+    uint32_t erpm = 12345;
+
+    // Stopped: period 0xFFF, CRC 0 -> nibbles F F F 0 -> GCR
+    // 01111 01111 01111 11001 -> levels 0 0 1 0 1 0 0 1 0 1 0 0 1 0 1 0 1 0 0 0 1
+    const uint16_t stopped[] = { 0, 20, 30, 40, 50, 70, 80, 90, 100, 120, 130, 140, 150, 160, 170, 200 };
+    CHECK(PropulsionDriver_DecodeReply(stopped, 16, BIT_COUNTS, &erpm));
+    CHECK(erpm == 0);
+
+    // 1000 us (e = 1, m = 500): 0x3F4, CRC 7 -> nibbles 3 F 4 7 -> GCR
+    // 10011 01111 11101 10111 -> levels 0 1 1 1 0 1 1 0 1 0 1 0 1 0 0 1 0 0 1 0 1
+    const uint16_t running[] = { 0, 10, 40, 50, 70, 80, 90, 100, 110, 120, 130, 150, 160, 180, 190, 200 };
+    CHECK(PropulsionDriver_DecodeReply(running, 16, BIT_COUNTS, &erpm));
+    CHECK(erpm == 60000);
+}
+
+static void test_replies_encoded(void) {
+    uint16_t edges[DSHOT_CAPTURE_EDGES];
+    uint32_t erpm;
+
+    // period_us -> exponent/mantissa; eRPM = 60e6 / period, rounded
+    const struct { uint16_t packet; uint32_t erpm; } cases[] = {
+        { 0x3F4, 60000 },                    // 500 << 1 = 1000 us
+        { 0x0C8, 300000 },                   // 200 us
+        { 0x1FF, 117417 },                   // 511 us, largest without exponent
+        { (7 << 9) | 0x1FE, 919 },           // 510 << 7 = 65280 us (0xFFF means stopped)
+        { 0x001, 60000000 },                 // 1 us
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        uint16_t packet = cases[i].packet;
+        uint16_t crc = (uint16_t)(~(packet ^ (packet >> 4) ^ (packet >> 8)) & 0xFU);
+        uint32_t count = build_reply((uint16_t)((packet << 4) | crc), 1000, edges);
+        erpm = 0;
+        CHECK(PropulsionDriver_DecodeReply(edges, count, BIT_COUNTS, &erpm));
+        CHECK(erpm == cases[i].erpm);
+    }
+
+    // Capture counter wrapping mid-reply
+    uint32_t count = build_reply(0x3F47, 65500, edges);
+    CHECK(PropulsionDriver_DecodeReply(edges, count, BIT_COUNTS, &erpm));
+    CHECK(erpm == 60000);
+
+    // Edges jittered by 20 % of a bit either way still land on the same bits
+    count = build_reply(0x3F47, 0, edges);
+    for (uint32_t k = 1; k < count; k++) edges[k] = (uint16_t)(edges[k] + ((k & 1U) ? 2 : -2));
+    CHECK(PropulsionDriver_DecodeReply(edges, count, BIT_COUNTS, &erpm));
+    CHECK(erpm == 60000);
+}
+
+static void test_reply_rejection(void) {
+    uint16_t edges[DSHOT_CAPTURE_EDGES];
+    uint32_t erpm;
+
+    // Every wrong CRC for 1000 us
+    for (uint16_t crc = 0; crc < 16; crc++) {
+        if (crc == 7) continue;
+        uint32_t count = build_reply((uint16_t)(0x3F40 | crc), 0, edges);
+        CHECK(!PropulsionDriver_DecodeReply(edges, count, BIT_COUNTS, &erpm));
+    }
+
+    // A start bit and no further edges: GCR 10000 00000 00000 00000
+    const uint16_t flat[] = { 0, 10 };
+    CHECK(!PropulsionDriver_DecodeReply(flat, 2, BIT_COUNTS, &erpm));
+
+    // 11111 (0x1F) is not a code either: GCR 11111 01111 01111 11001
+    // -> levels 0 1 0 1 0 1 1 0 1 0 1 1 0 1 0 1 0 1 1 1 0
+    const uint16_t bad_code[] = { 0, 10, 20, 30, 40, 50, 70, 80, 90, 100, 120, 130, 140, 150, 160, 170, 200 };
+    CHECK(!PropulsionDriver_DecodeReply(bad_code, 17, BIT_COUNTS, &erpm));
+
+    // Too many bits, no edges, no bit time
+    const uint16_t long_reply[] = { 0, 10, 20, 30, 40, 50, 60, 70, 80, 90, 100, 110, 120,
+                                    130, 140, 150, 160, 170, 180, 190, 200, 210, 220 };
+    CHECK(!PropulsionDriver_DecodeReply(long_reply, 23, BIT_COUNTS, &erpm));
+    CHECK(!PropulsionDriver_DecodeReply(edges, 0, BIT_COUNTS, &erpm));
+    CHECK(!PropulsionDriver_DecodeReply(flat, 2, 0, &erpm));
+}
+
+// Edge times of a 16-bit reply value starting at `start`; returns the count
+static uint32_t build_reply(uint16_t value, uint16_t start, uint16_t *edges) {
+    uint32_t gcr = 0;
+    for (int shift = 12; shift >= 0; shift -= 4) gcr = (gcr << 5) | gcr_code[(value >> shift) & 0xFU];
+
+    uint32_t count = 0;
+    edges[count++] = start;   // Falling edge of the start bit
+    for (int bit = 19; bit >= 0; bit--) {
+        if (gcr & (1U << bit)) edges[count++] = (uint16_t)(start + (20 - bit) * BIT_COUNTS);
+    }
+    return count;
+}
@@ -0,0 +1,118 @@
+/*
+ * blackbox_decode.cpp - Convert a blackbox flash image to CSV
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Usage: tmf_blackbox_decode <flash image> [output.csv]
+ *
+ * Reads a raw W25Q256JV dump (or the TMF_FLASH_FILE of a SIL run) and
+ * writes one CSV row per logged frame, with a leading log index. Logs
+ * start on sector boundaries; the scan stops at the first sector that
+ * starts erased. A per-log summary goes to stderr.
+ */
+
+#include "blackbox.h"
+#include "hardware_drivers.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void print_header(FILE *out) {
+    fprintf(out, "log,time_us");
+    for (int i = 0; i < BLACKBOX_FIELD_COUNT; i++) fprintf(out, ",%s", Blackbox_FieldName(i));
+    fprintf(out, "\n");
+}
+
+static void print_frame(FILE *out, uint32_t log, const Blackbox_Frame_t *frame) {
+    const float *groups[] = { frame->gyro, frame->accel, frame->attitude, frame->command,
+                              frame->pid_p, frame->pid_i, frame->pid_d, frame->motors };
+    const int sizes[] = { 3, 3, 3, 4, 3, 3, 3, 4 };
+
+    fprintf(out, "%lu,%llu", (unsigned long)log, (unsigned long long)frame->time_us);
+    for (size_t g = 0; g < sizeof(sizes) / sizeof(sizes[0]); g++) {
+        for (int i = 0; i < sizes[g]; i++) fprintf(out, ",%g", groups[g][i]);
+    }
+    fprintf(out, "\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s <flash image> [output.csv]\n", argv[0]);
+        return 2;
+    }
+
+    int fd = open(argv[1], O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+    size_t size = (size_t)st.st_size;
+    void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "cannot map %s\n", argv[1]);
+        return 1;
+    }
+    const uint8_t *image = (const uint8_t *)mapping;
+    if (size > FLASH_LOG_END) size = FLASH_LOG_END;   // The parameter, terrain and mission partitions are not logs
+
+    FILE *out = stdout;
+    if (argc == 3) {
+        out = fopen(argv[2], "w");
+        if (out == NULL) {
+            fprintf(stderr, "cannot create %s\n", argv[2]);
+            return 1;
+        }
+    }
+    print_header(out);
+
+    Blackbox_Codec_t codec;
+    Blackbox_CodecInit(&codec);
+    size_t sector = 0;
+    while (sector < size && image[sector] != 0xFF) {
+        size_t pos = sector;
+        uint32_t frames = 0;
+        uint32_t orphans = 0;
+        char type;
+        Blackbox_Frame_t frame;
+
+        size_t consumed = Blackbox_DecodeFrame(&codec, image + pos, size - pos, &type, &frame);
+        if (type != BLACKBOX_FRAME_HEADER) {
+            // Not a log start (tail of a damaged log): try the next sector
+            sector += FLASH_SECTOR_SIZE;
+            continue;
+        }
+        uint64_t first_us = 0, last_us = 0;
+        pos += consumed;
+        while (pos < size) {
+            consumed = Blackbox_DecodeFrame(&codec, image + pos, size - pos, &type, &frame);
+            if (consumed == 0) break;
+            if (type == BLACKBOX_FRAME_HEADER) break;   // Unreachable in a well-formed image
+            pos += consumed;
+            if (type == 0) {
+                orphans++;
+                continue;
+            }
+            if (frames == 0) first_us = frame.time_us;
+            last_us = frame.time_us;
+            frames++;
+            print_frame(out, codec.log_index, &frame);
+        }
+
+        fprintf(stderr, "log %lu at 0x%08lx: %lu frames, %lu bytes, %.3f s%s\n",
+                (unsigned long)codec.log_index, (unsigned long)sector, (unsigned long)frames,
+                (unsigned long)(pos - sector), (double)(last_us - first_us) * 1e-6,
+                orphans ? " (undecodable deltas skipped)" : "");
+
+        // Next log starts on the following sector boundary
+        sector = (pos + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE * FLASH_SECTOR_SIZE;
+    }
+
+    if (out != stdout) fclose(out);
+    munmap(mapping, size);
+    return 0;
+}
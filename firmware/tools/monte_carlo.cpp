@@ -0,0 +1,583 @@
+/*
+ * monte_carlo.cpp - Randomized closed-loop flights across all cores
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Usage: tmf_monte_carlo [--runs <n>] [--threads <n>] [--seed <n>]
+ *                        [--gain-spread <f>] [--wind <m/s>] [--faults <p>]
+ *                        [--csv <file>]
+ *
+ * Flies a 60 m square at 20 m, starting from a hover, many times over.
+ * The vehicle is held level for the first 2 s so the AHRS and EKF settle
+ * before the mission is loaded and it is released.
+ * Each flight draws its own airframe and environment:
+ *   gains       kp, ki and kd each scaled by 1 +- gain-spread (default 0.3)
+ *   airframe    mass +-10 %, motor lag 20 - 50 ms
+ *   sensors     gyro noise, residual bias after calibration (up to
+ *               0.1 deg/s) and rotor vibration, accel noise,
+ *               baro offset and noise, GPS noise and drift
+ *   wind        a mean up to --wind (default 8 m/s) from any direction,
+ *               plus gusts
+ *   faults      with probability --faults (default 0.3), one of: a GPS
+ *               outage, a stuck barometer, a baro step or a gyro bias step
+ *
+ * Every flight runs the real sensor processing (Sensors_FeedIMU, four
+ * samples per 2 ms frame), attitude control and navigation, each in its
+ * own context, against the 6-DOF plant of host/vehicle_plant.h stepped
+ * at the IMU rate, which also supplies the IMU, baro and GPS samples;
+ * the faults are applied to those samples here. Contexts are only ever
+ * Sensors_Reset and fed: the board's Sensors_Init / Sensors_Update*
+ * path belongs to a single context.
+ * The firmware has no velocity loop, so the harness closes one between
+ * navigation's velocity command and the attitude setpoint (P plus a
+ * wind-trimming integral and the command's low-passed derivative).
+ *
+ * Flights are spread over a work-stealing pool (see host/work_pool.h).
+ * Each flight seeds its own generator from --seed and its index, so the
+ * results do not depend on the thread count or on which worker ran it.
+ * Per-flight results go to --csv for gain and robustness sweeps; the
+ * summary gives the outcomes by fault, percentiles of the metrics, the
+ * worst flights by index (the same --seed draws them again) and the
+ * throughput.
+ */
+
+#include "flight_control.h"
+#include "local_frame.h"
+#include "navigation.h"
+#include "sensors.h"
+#include "vehicle_plant.h"
+#include "work_pool.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define PHYSICS_HZ        SENSORS_IMU_ODR_HZ   // One IMU sample per physics step
+#define PHYSICS_DT        (1.0f / PHYSICS_HZ)
+#define FRAME_STEPS       4                    // 2 ms control and navigation frame
+#define FRAME_US          (FRAME_STEPS * 1000000 / PHYSICS_HZ)
+#define BARO_FRAMES       10                   // 50 Hz
+#define GPS_FRAMES        50                   // 10 Hz, reported 100 ms late
+#define HOLD_S            2.0f                 // Held level before release while the estimators settle
+#define FLIGHT_TIMEOUT_S  150.0f
+
+#define GRAVITY           9.80665f
+#define DEG2RAD_F         0.017453293f
+#define RAD2DEG_F         57.29578f
+#define BARO_PA_PER_M     11.5f                // Near the launch altitude
+
+// Harness velocity loop
+#define VEL_GAIN          1.2f                 // 1/s
+#define VEL_INTEGRAL      0.5f                 // Trims out the wind (1/s^2)
+#define VEL_FF_TAU_S      0.3f                 // Low-pass on the differentiated command
+#define VEL_MAX_ACCEL     6.0f                 // m/s^2
+#define VEL_MAX_TILT      35.0f                // deg
+#define CLIMB_GAIN        2.0f                 // 1/s
+#define CLIMB_INTEGRAL    0.5f                 // 1/s^2
+
+#define MISSION_SIDE_M    60.0f
+#define MISSION_HEIGHT_M  20.0f
+#define LAUNCH_LAT        47.3977
+#define LAUNCH_LON        8.5456
+#define LAUNCH_ALT        420.0f
+
+// Crash: below 1 m or tilted past 70 degrees
+#define CRASH_HEIGHT_M    1.0f
+#define CRASH_TILT_DEG    70.0f
+
+#define WORST_LISTED      5
+
+typedef enum {
+    FAULT_NONE = 0,
+    FAULT_GPS_OUTAGE,
+    FAULT_BARO_STUCK,
+    FAULT_BARO_STEP,
+    FAULT_GYRO_STEP,
+    FAULT_COUNT
+} Fault_t;
+
+static const char *const fault_names[FAULT_COUNT] = { "none", "gps_outage", "baro_stuck", "baro_step", "gyro_step" };
+
+typedef enum { OUTCOME_COMPLETE = 0, OUTCOME_TIMEOUT, OUTCOME_CRASH, OUTCOME_COUNT } Outcome_t;
+
+static const char *const outcome_names[OUTCOME_COUNT] = { "complete", "timeout", "crash" };
+
+typedef struct {
+    float gain_spread;
+    float wind_max;
+    float fault_rate;
+    uint64_t seed;
+} Config_t;
+
+typedef struct {
+    uint64_t seed;              // Sensor noise and gusts in flight
+    float gain_scale[3];        // kp, ki, kd
+    float mass, motor_tau;
+    float gyro_noise, gyro_bias[3], vibration, vibration_hz;
+    float accel_noise;
+    float baro_offset, baro_noise;
+    float gps_noise, gps_drift;
+    float wind[2], gust;
+    float yaw0;
+    Fault_t fault;
+    float fault_start_s, fault_length_s;
+    float fault_size;
+} Draw_t;
+
+typedef struct {
+    Outcome_t outcome;
+    Fault_t fault;
+    float time_s;
+    float track_rms;            // |true velocity - navigation's command| (m/s)
+    float nav_rms;              // |true - estimated| horizontal position (m)
+    float attitude_rms;         // AHRS roll/pitch against the truth (deg)
+    float climb_rms;            // Vertical estimator climb rate against the truth (m/s)
+    float tilt_max;             // deg
+    float wind;                 // Mean wind speed (m/s)
+    float gain_scale[3];
+} Result_t;
+
+// One per worker, reused flight after flight
+typedef struct {
+    Sensors_t sensors;
+    FlightControl_t control;
+    Navigation_t nav;
+    VehiclePlant_t plant;
+} Vehicle_t;
+
+typedef struct {
+    Config_t config;
+    std::vector<Vehicle_t *> vehicles;
+    std::vector<Result_t> results;
+    std::vector<Waypoint_t> mission;
+} Batch_t;
+
+static LocalFrame_t launch;
+
+/* --- Random numbers: splitmix64 (the plant draws its own noise) --- */
+
+typedef struct {
+    uint64_t state;
+} Rng_t;
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static float rng_uniform(Rng_t *rng, float lo, float hi) {
+    return lo + (hi - lo) * (float)((splitmix64(&rng->state) >> 40) * (1.0 / 16777216.0));
+}
+
+/* --- Flight set-up --- */
+
+static void draw_flight(const Config_t *config, uint32_t index, Draw_t *d) {
+    Rng_t rng = { config->seed ^ ((uint64_t)index * 0xD1B54A32D192ED03ULL) };
+
+    for (int i = 0; i < 3; i++) {
+        d->gain_scale[i] = rng_uniform(&rng, 1.0f - config->gain_spread, 1.0f + config->gain_spread);
+    }
+    d->mass = VehiclePlant_DefaultAirframe().mass_kg * rng_uniform(&rng, 0.9f, 1.1f);
+    d->motor_tau = rng_uniform(&rng, 0.02f, 0.05f);
+
+    d->gyro_noise = rng_uniform(&rng, 0.05f, 0.3f);
+    for (int i = 0; i < 3; i++) d->gyro_bias[i] = rng_uniform(&rng, -0.1f, 0.1f);   // Left after calibration
+    d->vibration = rng_uniform(&rng, 0.0f, 8.0f);
+    d->vibration_hz = rng_uniform(&rng, 120.0f, 300.0f);
+    d->accel_noise = rng_uniform(&rng, 0.05f, 0.4f);
+    d->baro_offset = rng_uniform(&rng, -2.0f, 2.0f);
+    d->baro_noise = rng_uniform(&rng, 0.1f, 0.6f);
+    d->gps_noise = rng_uniform(&rng, 0.2f, 1.0f);
+    d->gps_drift = rng_uniform(&rng, 0.2f, 1.5f);
+
+    float speed = rng_uniform(&rng, 0.0f, config->wind_max);
+    float from = rng_uniform(&rng, 0.0f, 6.2831853f);
+    d->wind[0] = -speed * cosf(from);
+    d->wind[1] = -speed * sinf(from);
+    d->gust = 0.5f + 0.2f * speed;
+    d->yaw0 = rng_uniform(&rng, -60.0f, 60.0f);
+
+    d->fault = FAULT_NONE;
+    if (rng_uniform(&rng, 0.0f, 1.0f) < config->fault_rate) {
+        d->fault = (Fault_t)(1 + (int)rng_uniform(&rng, 0.0f, (float)(FAULT_COUNT - 1) - 1e-3f));
+    }
+    d->fault_start_s = rng_uniform(&rng, 5.0f, 30.0f);
+    d->fault_length_s = rng_uniform(&rng, 3.0f, 10.0f);
+    d->fault_size = rng_uniform(&rng, 5.0f, 15.0f) * (rng_uniform(&rng, 0.0f, 1.0f) < 0.5f ? -1.0f : 1.0f);
+    d->seed = splitmix64(&rng.state);
+}
+
+static std::vector<Waypoint_t> build_mission(void) {
+    const float corners[][2] = { { MISSION_SIDE_M, 0 }, { MISSION_SIDE_M, MISSION_SIDE_M },
+                                 { 0, MISSION_SIDE_M }, { 0, 0 } };
+    std::vector<Waypoint_t> mission;
+    for (const auto &c : corners) {
+        Waypoint_t w;
+        float ned[3] = { c[0], c[1], -MISSION_HEIGHT_M };
+        LocalFrame_FromNED(&launch, ned, &w.position.latitude, &w.position.longitude, &w.position.altitude);
+        w.hold_time = 1.0f;
+        mission.push_back(w);
+    }
+    return mission;
+}
+
+// One vehicle hovering at the mission height over the launch point, with
+// the drawn airframe, sensors and wind
+static void reset_plant(VehiclePlant_t *p, const Draw_t *d, VehiclePlant_Sensors_t *sensors) {
+    VehiclePlant_Init(p, 1, LAUNCH_LAT, LAUNCH_LON, LAUNCH_ALT, d->seed);
+
+    VehiclePlant_Airframe_t airframe = VehiclePlant_DefaultAirframe();
+    airframe.mass_kg = d->mass;
+    airframe.motor_tau_s = d->motor_tau;
+    VehiclePlant_SetAirframe(p, 0, &airframe);
+
+    *sensors = VehiclePlant_DefaultSensors();
+    sensors->gyro_noise = d->gyro_noise;
+    for (int i = 0; i < 3; i++) sensors->gyro_bias[i] = d->gyro_bias[i];
+    sensors->accel_noise = d->accel_noise;
+    sensors->vibration_gyro = d->vibration;
+    sensors->vibration_accel = 0.1f * d->vibration;
+    sensors->vibration_hz = d->vibration_hz;
+    sensors->baro_offset_pa = d->baro_offset * BARO_PA_PER_M;
+    sensors->baro_noise_pa = d->baro_noise * BARO_PA_PER_M;
+    sensors->gps_noise = d->gps_noise;
+    sensors->gps_drift = d->gps_drift;
+    VehiclePlant_SetSensors(p, 0, sensors);
+
+    VehiclePlant_Wind_t wind = { { d->wind[0], d->wind[1], 0.0f }, d->gust, 2.0f };
+    VehiclePlant_SetWind(p, 0, &wind);
+
+    const float hover[3] = { 0.0f, 0.0f, -MISSION_HEIGHT_M };
+    VehiclePlant_Place(p, 0, hover, d->yaw0);
+}
+
+/* --- Flight --- */
+
+static bool fault_active(const Draw_t *d, Fault_t fault, float t) {
+    return d->fault == fault && t >= d->fault_start_s && t < d->fault_start_s + d->fault_length_s;
+}
+
+static void fly(Vehicle_t *v, const Batch_t *batch, const Draw_t *d, Result_t *r) {
+    VehiclePlant_t *p = &v->plant;
+    VehiclePlant_Sensors_t plant_sensors;
+    reset_plant(p, d, &plant_sensors);
+
+    FlightControl_Gains_t gains = FlightControl_DefaultGains();
+    for (int axis = 0; axis < 3; axis++) {
+        gains.kp[axis] *= d->gain_scale[0];
+        gains.ki[axis] *= d->gain_scale[1];
+        gains.kd[axis] *= d->gain_scale[2];
+    }
+    Sensors_Reset(&v->sensors);
+    FlightControl_Init(&v->control, &gains);
+    Navigation_Init(&v->nav, &v->sensors);
+
+    const VehiclePlant_Airframe_t reference = VehiclePlant_DefaultAirframe();
+    float climb_integral = 0.0f;
+    Velocity_t last_command = { 0.0f, 0.0f, 0.0f };
+    float feed_forward[2] = { 0.0f, 0.0f };
+    float vel_integral[2] = { 0.0f, 0.0f };
+    bool released = false;
+    bool gyro_stepped = false;
+    float baro_stuck = 0.0f;
+    GPS_Data_t gps_delayed;
+    bool gps_pending = false;
+
+    double track_sq = 0.0, nav_sq = 0.0, attitude_sq = 0.0, climb_sq = 0.0;
+    uint64_t frames = 0;
+    memset(r, 0, sizeof(*r));
+    r->outcome = OUTCOME_TIMEOUT;
+    r->time_s = FLIGHT_TIMEOUT_S;
+
+    // t counts from the release
+    uint64_t now_us = 0;
+    for (uint64_t frame = 1; (float)now_us * 1e-6f < HOLD_S + FLIGHT_TIMEOUT_S; frame++) {
+        bool held = (float)now_us * 1e-6f < HOLD_S;
+        VehiclePlant_Hold(p, 0, held);
+        IMU_Sample_t samples[FRAME_STEPS];
+        for (int k = 0; k < FRAME_STEPS; k++) {
+            VehiclePlant_Step(p, PHYSICS_DT);
+            now_us += 1000000 / PHYSICS_HZ;
+            VehiclePlant_SampleImu(p, now_us, &samples[k]);
+        }
+        float t = (float)now_us * 1e-6f - HOLD_S;
+        if (d->fault == FAULT_GYRO_STEP && t >= d->fault_start_s && !gyro_stepped) {
+            for (int i = 0; i < 3; i++) plant_sensors.gyro_bias[i] += 0.3f * d->fault_size;   // And stays
+            VehiclePlant_SetSensors(p, 0, &plant_sensors);
+            gyro_stepped = true;
+        }
+
+        IMU_Data_t imu;
+        Sensors_FeedIMU(&v->sensors, samples, FRAME_STEPS, &imu);
+        Sensors_ComputeEulerAngles(&v->sensors, &imu);
+
+        // Baro, through the firmware's pressure conversion referenced to
+        // the first reading at the known start height; a step of fault_size
+        // metres is the equivalent pressure change
+        Barometer_Data_t baro, *baro_in = NULL;
+        if (frame % BARO_FRAMES == 0) {
+            VehiclePlant_SampleBaro(p, 0, &baro.pressure, &baro.temperature);
+            if (frame == BARO_FRAMES) {
+                Sensors_BaroReference_t ground = Sensors_MakeBaroReference(baro.pressure, baro.temperature,
+                                                                           LAUNCH_ALT + MISSION_HEIGHT_M);
+                Sensors_SetBaroReference(&v->sensors, &ground);
+            }
+            if (fault_active(d, FAULT_BARO_STEP, t)) baro.pressure -= 0.01f * BARO_PA_PER_M * d->fault_size;
+            if (d->fault == FAULT_BARO_STUCK && t >= d->fault_start_s) {
+                if (baro_stuck == 0.0f) baro_stuck = baro.pressure;
+                if (t < d->fault_start_s + d->fault_length_s) baro.pressure = baro_stuck;
+            }
+            Sensors_FeedBarometer(&v->sensors, baro.pressure, baro.temperature, &baro);
+            baro_in = &baro;
+        }
+
+        // GPS fixes describe where the vehicle was one period ago, and
+        // carry the time they were taken
+        GPS_Data_t gps, *gps_in = NULL;
+        if (frame % GPS_FRAMES == 0) {
+            if (gps_pending && !fault_active(d, FAULT_GPS_OUTAGE, t)) {
+                gps = gps_delayed;
+                gps_in = &gps;
+            }
+            VehiclePlant_SampleGps(p, 0, now_us, &gps_delayed);
+            gps_pending = true;
+        }
+
+        Navigation_Update(&v->nav, &imu, baro_in, gps_in, now_us);
+        if (held) continue;
+
+        if (!released) {
+            Navigation_SetWaypoints(&v->nav, batch->mission.data(), (uint32_t)batch->mission.size());
+            released = true;
+        }
+
+        // Velocity loop: navigation's NED command to a tilt and throttle
+        Velocity_t command = Navigation_GetVelocityCommand(&v->nav);
+        Velocity_t estimate = Navigation_GetVelocity(&v->nav);
+        const float frame_s = FRAME_US * 1e-6f;
+        float ff_alpha = frame_s / (VEL_FF_TAU_S + frame_s);
+        feed_forward[0] += ff_alpha * ((command.north - last_command.north) / frame_s - feed_forward[0]);
+        feed_forward[1] += ff_alpha * ((command.east - last_command.east) / frame_s - feed_forward[1]);
+        last_command = command;
+        for (int i = 0; i < 2; i++) {
+            if (feed_forward[i] > TRAJECTORY_MAX_ACCEL) feed_forward[i] = TRAJECTORY_MAX_ACCEL;
+            if (feed_forward[i] < -TRAJECTORY_MAX_ACCEL) feed_forward[i] = -TRAJECTORY_MAX_ACCEL;
+        }
+        float vel_error[2] = { command.north - estimate.north, command.east - estimate.east };
+        for (int i = 0; i < 2; i++) {
+            vel_integral[i] += VEL_INTEGRAL * vel_error[i] * frame_s;
+            if (vel_integral[i] > 0.5f * VEL_MAX_ACCEL) vel_integral[i] = 0.5f * VEL_MAX_ACCEL;
+            if (vel_integral[i] < -0.5f * VEL_MAX_ACCEL) vel_integral[i] = -0.5f * VEL_MAX_ACCEL;
+        }
+        float accel_n = feed_forward[0] + VEL_GAIN * vel_error[0] + vel_integral[0];
+        float accel_e = feed_forward[1] + VEL_GAIN * vel_error[1] + vel_integral[1];
+        float accel_h = sqrtf(accel_n * accel_n + accel_e * accel_e);
+        if (accel_h > VEL_MAX_ACCEL) {
+            accel_n *= VEL_MAX_ACCEL / accel_h;
+            accel_e *= VEL_MAX_ACCEL / accel_h;
+        }
+
+        // Heading is clockwise from north: forward is (cos, sin) in N/E
+        float yaw = imu.yaw * DEG2RAD_F;
+        float accel_forward = accel_n * cosf(yaw) + accel_e * sinf(yaw);
+        float accel_left = accel_n * sinf(yaw) - accel_e * cosf(yaw);
+
+        // Attitude as the AHRS reports it: positive roll lifts the left side,
+        // positive pitch lowers the nose
+        Flight_Command_t cmd;
+        cmd.roll = -atanf(accel_left / GRAVITY) * RAD2DEG_F;
+        cmd.pitch = atanf(accel_forward / GRAVITY) * RAD2DEG_F;
+        if (cmd.roll > VEL_MAX_TILT) cmd.roll = VEL_MAX_TILT;
+        if (cmd.roll < -VEL_MAX_TILT) cmd.roll = -VEL_MAX_TILT;
+        if (cmd.pitch > VEL_MAX_TILT) cmd.pitch = VEL_MAX_TILT;
+        if (cmd.pitch < -VEL_MAX_TILT) cmd.pitch = -VEL_MAX_TILT;
+        cmd.yaw = Navigation_GetAttitudeCommand(&v->nav).yaw;   // Face along the leg
+
+        float climb_error = estimate.down - command.down;
+        climb_integral += CLIMB_INTEGRAL * climb_error * frame_s;
+        if (climb_integral > 0.3f * GRAVITY) climb_integral = 0.3f * GRAVITY;
+        if (climb_integral < -0.3f * GRAVITY) climb_integral = -0.3f * GRAVITY;
+        float tilt_cos = cosf(imu.roll * DEG2RAD_F) * cosf(imu.pitch * DEG2RAD_F);
+        if (tilt_cos < 0.5f) tilt_cos = 0.5f;
+        float nominal = reference.mass_kg * GRAVITY / (4.0f * reference.motor_max_n);
+        cmd.throttle = nominal * (1.0f + (CLIMB_GAIN * climb_error + climb_integral) / GRAVITY) / tilt_cos;
+
+        Motor_Output_t out;
+        FlightControl_Update(&v->control, &cmd, imu.roll, imu.pitch, imu.yaw, frame_s, &out);
+        VehiclePlant_SetMotors(p, 0, &out);
+
+        // Metrics against the truth
+        VehiclePlant_State_t truth;
+        VehiclePlant_GetState(p, 0, &truth);
+        float tilt = acosf(fminf(1.0f, fabsf(cosf(truth.roll * DEG2RAD_F) * cosf(truth.pitch * DEG2RAD_F)))) *
+                     RAD2DEG_F;
+        if (tilt > r->tilt_max) r->tilt_max = tilt;
+        float dr = imu.roll - truth.roll, dp = imu.pitch - truth.pitch;
+        attitude_sq += dr * dr + dp * dp;
+
+        float dv[3] = { truth.velocity[0] - command.north, truth.velocity[1] - command.east,
+                        truth.velocity[2] - command.down };
+        track_sq += dv[0] * dv[0] + dv[1] * dv[1] + dv[2] * dv[2];
+
+        Position_t estimated = Navigation_GetPosition(&v->nav);
+        float est_ned[3];
+        LocalFrame_ToNED(&launch, estimated.latitude, estimated.longitude, estimated.altitude, est_ned);
+        float dn = est_ned[0] - (float)truth.position[0], de = est_ned[1] - (float)truth.position[1];
+        nav_sq += dn * dn + de * de;
+        float climb = 0.0f;
+        Sensors_GetVertical(&v->sensors, NULL, &climb);
+        climb_sq += (climb + truth.velocity[2]) * (climb + truth.velocity[2]);
+        frames++;
+
+        if (-(float)truth.position[2] < CRASH_HEIGHT_M || tilt > CRASH_TILT_DEG) {
+            r->outcome = OUTCOME_CRASH;
+            r->time_s = t;
+            break;
+        }
+        if (Navigation_IsMissionComplete(&v->nav)) {
+            r->outcome = OUTCOME_COMPLETE;
+            r->time_s = t;
+            break;
+        }
+    }
+
+    VehiclePlant_Free(p);
+
+    r->fault = d->fault;
+    r->track_rms = (float)sqrt(track_sq / frames);
+    r->nav_rms = (float)sqrt(nav_sq / frames);
+    r->attitude_rms = (float)sqrt(attitude_sq / (2.0 * frames));
+    r->climb_rms = (float)sqrt(climb_sq / frames);
+    r->wind = sqrtf(d->wind[0] * d->wind[0] + d->wind[1] * d->wind[1]);
+    memcpy(r->gain_scale, d->gain_scale, sizeof(r->gain_scale));
+}
+
+static void flight_task(uint32_t index, uint32_t worker, void *context) {
+    Batch_t *batch = (Batch_t *)context;
+    Draw_t draw;
+    draw_flight(&batch->config, index, &draw);
+    fly(batch->vehicles[worker], batch, &draw, &batch->results[index]);
+}
+
+/* --- Report --- */
+
+static float percentile(std::vector<float> values, float fraction) {
+    if (values.empty()) return 0.0f;
+    size_t k = (size_t)(fraction * (float)(values.size() - 1) + 0.5f);
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+static void print_metric(const char *name, const std::vector<Result_t> &results, float Result_t::*field) {
+    std::vector<float> values;
+    for (const Result_t &r : results) values.push_back(r.*field);
+    printf("%-14s %8.2f %8.2f %8.2f %8.2f\n", name, percentile(values, 0.5f), percentile(values, 0.9f),
+           percentile(values, 0.99f), percentile(values, 1.0f));
+}
+
+static void write_csv(const char *path, const std::vector<Result_t> &results) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return;
+    }
+    fprintf(f, "run,kp_scale,ki_scale,kd_scale,wind,fault,outcome,time_s,track_rms,nav_rms,attitude_rms,climb_rms,"
+               "tilt_max\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result_t &r = results[i];
+        fprintf(f, "%zu,%.3f,%.3f,%.3f,%.2f,%s,%s,%.2f,%.3f,%.3f,%.3f,%.3f,%.2f\n", i, r.gain_scale[0],
+                r.gain_scale[1], r.gain_scale[2], r.wind, fault_names[r.fault], outcome_names[r.outcome], r.time_s, r.track_rms,
+                r.nav_rms, r.attitude_rms, r.climb_rms, r.tilt_max);
+    }
+    fclose(f);
+}
+
+int main(int argc, char **argv) {
+    uint32_t runs = 1000;
+    uint32_t threads = WorkPool_DefaultWorkers();
+    const char *csv = NULL;
+    Batch_t batch;
+    batch.config = { 0.3f, 8.0f, 0.3f, 1 };
+
+    for (int i = 1; i < argc; i++) {
+        bool more = i + 1 < argc;
+        if (strcmp(argv[i], "--runs") == 0 && more) runs = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--threads") == 0 && more) threads = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--seed") == 0 && more) batch.config.seed = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--gain-spread") == 0 && more) batch.config.gain_spread = strtof(argv[++i], NULL);
+        else if (strcmp(argv[i], "--wind") == 0 && more) batch.config.wind_max = strtof(argv[++i], NULL);
+        else if (strcmp(argv[i], "--faults") == 0 && more) batch.config.fault_rate = strtof(argv[++i], NULL);
+        else if (strcmp(argv[i], "--csv") == 0 && more) csv = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--runs n] [--threads n] [--seed n] [--gain-spread f] [--wind m/s] "
+                            "[--faults p] [--csv file]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (runs == 0) return 0;
+    if (threads < 1) threads = 1;
+
+    LocalFrame_Init(&launch, LAUNCH_LAT, LAUNCH_LON, LAUNCH_ALT);
+    batch.mission = build_mission();
+    batch.results.resize(runs);
+    for (uint32_t w = 0; w < threads && w < WORK_POOL_MAX_WORKERS; w++) batch.vehicles.push_back(new Vehicle_t);
+
+    WorkPool_Stats_t stats;
+    WorkPool_Run(threads, runs, flight_task, &batch, &stats);
+
+    // Outcomes by fault
+    uint32_t counts[FAULT_COUNT][OUTCOME_COUNT] = {};
+    double flown_s = 0.0;
+    for (const Result_t &r : batch.results) {
+        counts[r.fault][r.outcome]++;
+        flown_s += r.time_s;
+    }
+    printf("%-14s %8s %8s %8s\n", "fault", "complete", "timeout", "crash");
+    for (int f = 0; f < FAULT_COUNT; f++) {
+        printf("%-14s %8u %8u %8u\n", fault_names[f], counts[f][OUTCOME_COMPLETE], counts[f][OUTCOME_TIMEOUT],
+               counts[f][OUTCOME_CRASH]);
+    }
+
+    printf("\n%-14s %8s %8s %8s %8s\n", "metric", "p50", "p90", "p99", "max");
+    print_metric("time_s", batch.results, &Result_t::time_s);
+    print_metric("track_rms", batch.results, &Result_t::track_rms);
+    print_metric("nav_rms", batch.results, &Result_t::nav_rms);
+    print_metric("attitude_rms", batch.results, &Result_t::attitude_rms);
+    print_metric("climb_rms", batch.results, &Result_t::climb_rms);
+    print_metric("tilt_max", batch.results, &Result_t::tilt_max);
+
+    // Worst flights by tracking error, crashes first
+    std::vector<uint32_t> order(runs);
+    for (uint32_t i = 0; i < runs; i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        const Result_t &ra = batch.results[a], &rb = batch.results[b];
+        if ((ra.outcome == OUTCOME_CRASH) != (rb.outcome == OUTCOME_CRASH)) return ra.outcome == OUTCOME_CRASH;
+        return ra.track_rms > rb.track_rms;
+    });
+    printf("\nworst flights\n");
+    for (uint32_t i = 0; i < runs && i < WORST_LISTED; i++) {
+        const Result_t &r = batch.results[order[i]];
+        printf("  run %-6u %-8s fault=%-10s gains=%.2f/%.2f/%.2f wind=%.1f track_rms=%.2f tilt_max=%.1f\n",
+               order[i], outcome_names[r.outcome], fault_names[r.fault], r.gain_scale[0], r.gain_scale[1],
+               r.gain_scale[2], r.wind, r.track_rms, r.tilt_max);
+    }
+
+    uint32_t busiest = 0, idlest = runs;
+    for (uint32_t w = 0; w < stats.workers; w++) {
+        busiest = std::max(busiest, stats.executed[w]);
+        idlest = std::min(idlest, stats.executed[w]);
+    }
+    printf("\n%u flights (%.0f simulated s) in %.2f s on %u workers: %.1f flights/s, %.0fx real time\n", runs,
+           flown_s, stats.wall_s, stats.workers, runs / stats.wall_s, flown_s / stats.wall_s);
+    printf("pool: %u steals moved %u flights, flights per worker %u-%u\n", stats.steals, stats.stolen, idlest,
+           busiest);
+
+    if (csv) write_csv(csv, batch.results);
+    for (Vehicle_t *vehicle : batch.vehicles) delete vehicle;
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * params_tool.cpp - List and edit the parameters stored in a flash image
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Usage: tmf_params <flash image> [NAME=value ...]
+ *
+ * Opens the image as the SIL's TMF_FLASH_FILE (created erased if missing)
+ * and loads the store the way the firmware does at start-up. With
+ * assignments it stages them, commits them, lets a "frame" adopt them and
+ * saves an image through Params_Service, exactly as a ground-link tuning
+ * session would; a SIL run on the same image then flies the new values
+ * without a rebuild. It prints every parameter (a * marks values that
+ * differ from the default) and the image ring: the sequence held in each
+ * slot, '.' for an erased slot and '!' for one that fails its CRC.
+ */
+
+#include "hardware_drivers.h"
+#include "host_clock.h"
+#include "params.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static Params_t params;
+
+static bool apply_assignment(const char *assignment);
+static void print_params(void);
+static void print_ring(void);
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <flash image> [NAME=value ...]\n", argv[0]);
+        return 2;
+    }
+    setenv("TMF_FLASH_FILE", argv[1], 1);
+    HostClock_UseVirtual();
+    if (!Params_Init(&params)) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    Params_Stats_t stats;
+    Params_GetStats(&params, &stats);
+    if (stats.sequence != 0) {
+        printf("image %lu in slot %lu: %lu values loaded, %lu skipped\n", (unsigned long)stats.sequence,
+               (unsigned long)stats.slot, (unsigned long)stats.loaded, (unsigned long)stats.skipped);
+    } else {
+        printf("no stored image, defaults in place\n");
+    }
+
+    if (argc > 2) {
+        for (int i = 2; i < argc; i++) {
+            if (!apply_assignment(argv[i])) return 1;
+        }
+        Params_Commit(&params);
+        Params_BeginFrame(&params);
+        if (!Params_Save(&params)) {
+            fprintf(stderr, "cannot queue the image\n");
+            return 1;
+        }
+        while (Params_IsSaving(&params)) {
+            Params_Service(&params);
+            HostClock_Advance(100);
+        }
+        Params_GetStats(&params, &stats);
+        printf("saved image %lu in slot %lu (%lu sector erases)\n", (unsigned long)stats.sequence,
+               (unsigned long)stats.slot, (unsigned long)stats.sectors_erased);
+    }
+
+    print_params();
+    print_ring();
+    return 0;
+}
+
+// NAME=value, checked against the type and range
+static bool apply_assignment(const char *assignment) {
+    const char *equals = strchr(assignment, '=');
+    char name[64];
+    size_t length = equals ? (size_t)(equals - assignment) : 0;
+    if (length == 0 || length >= sizeof(name)) {
+        fprintf(stderr, "expected NAME=value, got %s\n", assignment);
+        return false;
+    }
+    memcpy(name, assignment, length);
+    name[length] = '\0';
+
+    Param_Id_t id = Params_Find(Params_Hash(name));
+    if (id == PARAM_COUNT) {
+        fprintf(stderr, "unknown parameter %s\n", name);
+        return false;
+    }
+    const Params_Info_t *info = Params_GetInfo(id);
+    char *end;
+    bool ok;
+    if (info->type == PARAM_INT32) {
+        long value = strtol(equals + 1, &end, 0);
+        ok = *end == '\0' && Params_SetInt(&params, id, (int32_t)value);
+    } else {
+        float value = strtof(equals + 1, &end);
+        ok = *end == '\0' && Params_SetFloat(&params, id, value);
+    }
+    if (!ok) {
+        fprintf(stderr, "%s: %s is not a valid value (range %g to %g)\n", name, equals + 1, info->min, info->max);
+    }
+    return ok;
+}
+
+static void print_params(void) {
+    const Params_Bank_t *bank = Params_Active(&params);
+    printf("%-18s %12s %12s %12s %12s\n", "name", "value", "default", "min", "max");
+    for (int id = 0; id < PARAM_COUNT; id++) {
+        const Params_Info_t *info = Params_GetInfo((Param_Id_t)id);
+        float value = (info->type == PARAM_INT32) ? (float)Params_Int(bank, (Param_Id_t)id)
+                                                  : Params_Float(bank, (Param_Id_t)id);
+        printf("%-18s %12g %12g %12g %12g%s\n", info->name, value, info->default_value, info->min, info->max,
+               value != info->default_value ? " *" : "");
+    }
+}
+
+// One line per sector of the partition
+static void print_ring(void) {
+    uint32_t slots_per_sector = FLASH_SECTOR_SIZE / PARAMS_SLOT_BYTES;
+    for (uint32_t sector = 0; sector < PARAMS_SLOTS / slots_per_sector; sector++) {
+        printf("sector %2lu:", (unsigned long)sector);
+        for (uint32_t s = 0; s < slots_per_sector; s++) {
+            uint32_t address = FLASH_PARAMS_BASE + (sector * slots_per_sector + s) * PARAMS_SLOT_BYTES;
+            uint8_t image[PARAMS_SLOT_BYTES];
+            Flash_Read(address, image, sizeof(image));
+            if (image[0] == 0xFF && image[1] == 0xFF && image[2] == 0xFF && image[3] == 0xFF) {
+                printf(" %8s", ".");
+                continue;
+            }
+            uint32_t sequence = (uint32_t)image[8] | ((uint32_t)image[9] << 8) | ((uint32_t)image[10] << 16) |
+                                ((uint32_t)image[11] << 24);
+            uint32_t count = (uint32_t)(image[6] | (image[7] << 8));
+            uint32_t records = count * PARAMS_RECORD_BYTES;
+            bool valid = memcmp(image, "TMFP", 4) == 0 && PARAMS_HEADER_BYTES + records <= PARAMS_SLOT_BYTES;
+            if (valid) {
+                uint16_t crc = Telemetry_Crc16(0xFFFF, image, 14);
+                crc = Telemetry_Crc16(crc, image + PARAMS_HEADER_BYTES, records);
+                valid = crc == (uint16_t)(image[14] | (image[15] << 8));
+            }
+            if (valid) printf(" %8lu", (unsigned long)sequence);
+            else printf(" %8s", "!");
+        }
+        printf("\n");
+    }
+}
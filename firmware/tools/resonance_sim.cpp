@@ -0,0 +1,147 @@
+/*
+ * resonance_sim.cpp - Lock-time and jitter runs of the coil resonance tracker
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Usage: tmf_resonance_sim [scenario substring] [--trace]
+ *
+ * Closes the loop through the real firmware path: the tracker retunes
+ * coil_control, the simulated tank (coil_plant.h) replays the timer's
+ * dither pattern cycle by cycle and feeds the ADC samples back in blocks.
+ * For each scenario it prints:
+ *   lock_us     time to the first declared lock
+ *   relock_us   time from the disturbance to lock again (- if never lost)
+ *   err_hz      mean drive - resonance over the last 5 ms
+ *   jitter_hz   RMS of drive - resonance about that mean
+ *   phase_deg   RMS phase from first lock to the end (tracking included)
+ *   power_pct   mean power relative to perfect tuning, from first lock
+ * --trace writes one CSV row per block to stdout instead.
+ */
+
+#include "coil_control.h"
+#include "coil_plant.h"
+#include "resonance_tracker.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define STEADY_WINDOW_S 0.005
+
+typedef struct {
+    const char *name;
+    uint32_t start_hz;         // Tracker start frequency
+    double resonance_hz;       // Tank resonance at t = 0
+    double quality;            // Tank Q (the tracker always assumes its default)
+    float noise_counts;        // RMS ADC noise
+    double shift_hz;           // Resonance change...
+    double shift_at_ms;        // ...starting here...
+    double shift_ms;           // ...spread over this long (0 = step)
+    double run_ms;
+} Scenario_t;
+
+static const Scenario_t scenarios[] = {
+    { "acquire",       1050000, 1000000.0,  50.0,  4.0f,       0.0,  0.0,  0.0, 20.0 },
+    { "acquire_wide",   900000, 1180000.0,  50.0,  4.0f,       0.0,  0.0,  0.0, 30.0 },
+    { "step",          1100000, 1100000.0,  50.0,  4.0f,   15000.0, 10.0,  0.0, 25.0 },
+    { "drift",         1100000, 1100000.0,  50.0,  4.0f,  -60000.0,  5.0, 20.0, 35.0 },
+    { "noisy",         1050000, 1000000.0,  50.0, 40.0f,       0.0,  0.0,  0.0, 20.0 },
+    { "low_q",         1050000, 1000000.0,  20.0,  4.0f,       0.0,  0.0,  0.0, 20.0 },
+    { "high_q",        1080000, 1100000.0, 150.0,  4.0f,       0.0,  0.0,  0.0, 20.0 },
+};
+
+static double resonance_at(const Scenario_t *s, double t_ms) {
+    if (s->shift_hz == 0.0 || t_ms < s->shift_at_ms) return s->resonance_hz;
+    if (s->shift_ms <= 0.0 || t_ms >= s->shift_at_ms + s->shift_ms) return s->resonance_hz + s->shift_hz;
+    return s->resonance_hz + s->shift_hz * (t_ms - s->shift_at_ms) / s->shift_ms;
+}
+
+static void run(const Scenario_t *s, bool trace) {
+    ResonanceTracker_Config_t config;
+    ResonanceTracker_DefaultConfig(&config);
+    CoilControl_Init();
+    ResonanceTracker_Init(&config, s->start_hz);
+
+    CoilPlant_t plant;
+    CoilPlant_Init(&plant, s->resonance_hz, s->quality, s->noise_counts);
+
+    uint16_t in_phase[RESONANCE_BLOCK_CYCLES];
+    uint16_t quadrature[RESONANCE_BLOCK_CYCLES];
+    double lock_ms = -1.0, relock_ms = -1.0;
+    bool disturbed = false, lost = false;
+    double phase_sq = 0.0, power = 0.0;
+    uint32_t tracked = 0;
+    double err_sum = 0.0, err_sq = 0.0;
+    uint32_t steady = 0;
+
+    while (plant.time_s * 1000.0 < s->run_ms) {
+        double block_start = plant.time_s;
+        CoilControl_Cycle_t cycle;
+        for (uint32_t n = 0; n < RESONANCE_BLOCK_CYCLES; n++) {
+            CoilPlant_NextCycle(&plant, &cycle);
+            CoilPlant_RunCycle(&plant, &cycle, &in_phase[n], &quadrature[n]);
+        }
+        double drive_hz = RESONANCE_BLOCK_CYCLES / (plant.time_s - block_start);
+        double t_ms = plant.time_s * 1000.0;
+
+        ResonanceTracker_ProcessBlock(in_phase, quadrature, RESONANCE_BLOCK_CYCLES);
+        ResonanceTracker_Status_t status;
+        ResonanceTracker_GetStatus(&status);
+
+        double phase = CoilPlant_Phase(&plant, drive_hz);
+        if (trace) {
+            printf("%s,%.1f,%.0f,%.0f,%.3f,%.3f,%.1f,%d\n", s->name, t_ms * 1000.0, plant.resonance_hz,
+                   drive_hz, phase * 180.0 / M_PI, status.phase_rad * 180.0 / M_PI, status.amplitude,
+                   status.locked ? 1 : 0);
+        }
+
+        if (lock_ms < 0.0 && status.locked) lock_ms = t_ms;
+        if (lock_ms >= 0.0) {
+            phase_sq += phase * phase;
+            power += CoilPlant_RelativePower(&plant, drive_hz);
+            tracked++;
+        }
+        if (disturbed && !status.locked) lost = true;
+        if (lost && relock_ms < 0.0 && status.locked) relock_ms = t_ms - s->shift_at_ms;
+        if (t_ms >= s->run_ms - STEADY_WINDOW_S * 1000.0) {
+            double err = drive_hz - plant.resonance_hz;
+            err_sum += err;
+            err_sq += err * err;
+            steady++;
+        }
+
+        double next_hz = resonance_at(s, t_ms);
+        if (next_hz != plant.resonance_hz) {
+            disturbed = true;
+            CoilPlant_SetResonance(&plant, next_hz);
+        }
+    }
+    if (trace) return;
+
+    double mean = steady ? err_sum / steady : 0.0;
+    double jitter = steady ? sqrt(fmax(err_sq / steady - mean * mean, 0.0)) : 0.0;
+    char lock_text[16] = "-", relock_text[16] = "-";
+    if (lock_ms >= 0.0) snprintf(lock_text, sizeof(lock_text), "%.0f", lock_ms * 1000.0);
+    if (relock_ms >= 0.0) snprintf(relock_text, sizeof(relock_text), "%.0f", relock_ms * 1000.0);
+    printf("%-13s %8s %9s %8.0f %9.0f %9.2f %9.2f\n", s->name, lock_text, relock_text, mean, jitter,
+           tracked ? sqrt(phase_sq / tracked) * 180.0 / M_PI : 0.0,
+           tracked ? 100.0 * power / tracked : 0.0);
+}
+
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    bool trace = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0) trace = true;
+        else filter = argv[i];
+    }
+
+    if (trace) printf("scenario,time_us,resonance_hz,drive_hz,phase_deg,measured_deg,amplitude,locked\n");
+    else printf("%-13s %8s %9s %8s %9s %9s %9s\n", "scenario", "lock_us", "relock_us", "err_hz",
+                "jitter_hz", "phase_deg", "power_pct");
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        if (filter != NULL && strstr(scenarios[i].name, filter) == NULL) continue;
+        run(&scenarios[i], trace);
+    }
+    return 0;
+}
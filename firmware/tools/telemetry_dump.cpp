@@ -0,0 +1,223 @@
+/*
+ * telemetry_dump.cpp - Print the telemetry stream of a SIL run
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Usage: tmf_telemetry_dump <pty path | udp:port> [max frames] [NAME=value ...] [--save]
+ *
+ * Opens the pseudo-terminal printed by a TMF_TELEMETRY=pty run, or
+ * listens on 127.0.0.1:<port> for a TMF_TELEMETRY=udp:<port> run, checks
+ * every frame's CRC and sequence number and prints one line per frame.
+ * Stops after max frames (default: never) and prints the link counters.
+ *
+ * Parameter assignments are sent up the link once the first frame is in
+ * (for UDP, to the port it came from), followed by a commit and, with
+ * --save, a save. The vehicle flies the new values from its next control
+ * frame and reports the outcome as uplink= in the diagnostics stream.
+ */
+
+#include "flight_control.h"
+#include "navigation.h"
+#include "params.h"
+#include "sensors.h"
+#include "telemetry.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define MAX_ASSIGNMENTS 32
+
+// Where uplink frames go: the pty itself, or the sender of the telemetry
+static int link_fd = -1;
+static bool link_is_socket = false;
+static struct sockaddr_in link_peer;
+static uint8_t uplink_sequence = 0;
+
+static bool send_frame(uint8_t id, const void *payload, uint8_t length);
+static bool send_assignment(const char *assignment);
+
+template <typename T>
+static bool read_payload(const Telemetry_Parser_t *parser, T *out) {
+    if (parser->length != sizeof(T)) return false;
+    memcpy(out, parser->payload, sizeof(T));
+    return true;
+}
+
+static void print_frame(const Telemetry_Parser_t *parser) {
+    IMU_Data_t imu;
+    Velocity_t velocity;
+    Position_t position;
+    Motor_Output_t motors;
+    Telemetry_Diagnostics_t diag;
+
+    printf("#%-3u ", parser->sequence);
+    switch (parser->message_id) {
+    case TELEMETRY_MSG_ATTITUDE:
+        if (!read_payload(parser, &imu)) break;
+        printf("attitude rpy=%.2f,%.2f,%.2f gyro=%.1f,%.1f,%.1f accel=%.2f,%.2f,%.2f\n",
+               imu.roll, imu.pitch, imu.yaw, imu.gyro_x, imu.gyro_y, imu.gyro_z,
+               imu.accel_x, imu.accel_y, imu.accel_z);
+        return;
+    case TELEMETRY_MSG_VELOCITY:
+        if (!read_payload(parser, &velocity)) break;
+        printf("velocity ned=%.2f,%.2f,%.2f\n", velocity.north, velocity.east, velocity.down);
+        return;
+    case TELEMETRY_MSG_POSITION:
+        if (!read_payload(parser, &position)) break;
+        printf("position %.7f,%.7f alt=%.2f\n", position.latitude, position.longitude, position.altitude);
+        return;
+    case TELEMETRY_MSG_MOTORS:
+        if (!read_payload(parser, &motors)) break;
+        printf("motors %.3f %.3f %.3f %.3f\n", motors.motor1, motors.motor2, motors.motor3, motors.motor4);
+        return;
+    case TELEMETRY_MSG_DIAGNOSTICS:
+        if (!read_payload(parser, &diag)) break;
+        printf("diagnostics up=%lums misses=%lu imu_drop=%lu bb_drop=%lu tlm_deferred=%lu health=%u fence=%u "
+               "uplink=%u\n",
+               (unsigned long)diag.uptime_ms, (unsigned long)diag.deadline_misses,
+               (unsigned long)diag.imu_dropped, (unsigned long)diag.blackbox_dropped,
+               (unsigned long)diag.telemetry_deferred, diag.health_ok, diag.geofence, diag.uplink);
+        return;
+    default:
+        break;
+    }
+    printf("message %u, %u bytes\n", parser->message_id, parser->length);
+}
+
+static int open_source(const char *source) {
+    if (strncmp(source, "udp:", 4) == 0) {
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)atoi(source + 4));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) return -1;
+        return fd;
+    }
+
+    int fd = open(source, O_RDWR | O_NOCTTY);
+    if (fd < 0) return -1;
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+int main(int argc, char **argv) {
+    unsigned long max_frames = 0;
+    const char *assignments[MAX_ASSIGNMENTS];
+    int assignment_count = 0;
+    bool save = false;
+    bool usage = argc < 2;
+    for (int i = 2; i < argc && !usage; i++) {
+        if (strcmp(argv[i], "--save") == 0) {
+            save = true;
+        } else if (strchr(argv[i], '=') != NULL && assignment_count < MAX_ASSIGNMENTS) {
+            assignments[assignment_count++] = argv[i];
+        } else if (i == 2 && argv[i][0] >= '0' && argv[i][0] <= '9') {
+            max_frames = strtoul(argv[i], NULL, 10);
+        } else {
+            usage = true;
+        }
+    }
+    if (usage) {
+        fprintf(stderr, "usage: %s <pty path | udp:port> [max frames] [NAME=value ...] [--save]\n", argv[0]);
+        return 2;
+    }
+
+    int fd = open_source(argv[1]);
+    if (fd < 0) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+    link_fd = fd;
+    link_is_socket = strncmp(argv[1], "udp:", 4) == 0;
+    bool uplink_pending = assignment_count > 0 || save;
+
+    Telemetry_Parser_t parser;
+    Telemetry_ParserInit(&parser);
+    uint8_t chunk[2048];
+    bool done = false;
+    while (!done) {
+        socklen_t peer_length = sizeof(link_peer);
+        ssize_t received = link_is_socket ? recvfrom(fd, chunk, sizeof(chunk), 0, (struct sockaddr *)&link_peer,
+                                                     &peer_length)
+                                          : read(fd, chunk, sizeof(chunk));
+        if (received <= 0) break;   // Writer closed the pty
+        for (ssize_t i = 0; i < received && !done; i++) {
+            if (!Telemetry_ParseByte(&parser, chunk[i])) continue;
+            print_frame(&parser);
+            done = max_frames != 0 && parser.frames >= max_frames;
+        }
+
+        // The vehicle is up and, over UDP, its address is known
+        if (uplink_pending && parser.frames > 0) {
+            uplink_pending = false;
+            bool ok = true;
+            for (int i = 0; i < assignment_count && ok; i++) ok = send_assignment(assignments[i]);
+            if (ok) ok = send_frame(TELEMETRY_MSG_PARAM_COMMIT, NULL, 0);
+            if (ok && save) ok = send_frame(TELEMETRY_MSG_PARAM_SAVE, NULL, 0);
+            fprintf(stderr, ok ? "uplink: %d value(s) sent%s\n" : "uplink: failed after %d value(s)%s\n",
+                    assignment_count, save ? ", saving" : "");
+        }
+    }
+
+    fprintf(stderr, "frames=%lu crc_errors=%lu lost=%lu\n", (unsigned long)parser.frames,
+            (unsigned long)parser.crc_errors, (unsigned long)parser.lost);
+    close(fd);
+    return 0;
+}
+
+static bool send_frame(uint8_t id, const void *payload, uint8_t length) {
+    uint8_t frame[TELEMETRY_MAX_PAYLOAD + TELEMETRY_OVERHEAD];
+    size_t size = Telemetry_EncodeFrame(id, uplink_sequence++, payload, length, frame);
+    ssize_t written = link_is_socket ? sendto(link_fd, frame, size, 0, (const struct sockaddr *)&link_peer,
+                                              sizeof(link_peer))
+                                     : write(link_fd, frame, size);
+    return written == (ssize_t)size;
+}
+
+// NAME=value, checked against the parameter table before it is sent
+static bool send_assignment(const char *assignment) {
+    const char *equals = strchr(assignment, '=');
+    char name[64];
+    size_t length = (size_t)(equals - assignment);
+    if (length == 0 || length >= sizeof(name)) {
+        fprintf(stderr, "expected NAME=value, got %s\n", assignment);
+        return false;
+    }
+    memcpy(name, assignment, length);
+    name[length] = '\0';
+
+    Telemetry_ParamSet_t set;
+    set.hash = Params_Hash(name);
+    Param_Id_t id = Params_Find(set.hash);
+    if (id == PARAM_COUNT) {
+        fprintf(stderr, "unknown parameter %s\n", name);
+        return false;
+    }
+    const Params_Info_t *info = Params_GetInfo(id);
+    Param_Value_t value;
+    char *end;
+    if (info->type == PARAM_INT32) {
+        value.i = (int32_t)strtol(equals + 1, &end, 0);
+    } else {
+        value.f = strtof(equals + 1, &end);
+    }
+    if (*end != '\0') {
+        fprintf(stderr, "%s: %s is not a number\n", name, equals + 1);
+        return false;
+    }
+    set.value = (uint32_t)value.i;
+    return send_frame(TELEMETRY_MSG_PARAM_SET, &set, sizeof(set));
+}
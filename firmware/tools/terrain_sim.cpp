@@ -0,0 +1,374 @@
+/*
+ * terrain_sim.cpp - Terrain following over a synthetic DEM in flash
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Usage: tmf_terrain_sim [--write <flash image>]
+ *
+ * Builds an 8 x 8 km DEM at one arc-second (rolling hills, a ridge across
+ * the survey and some roughness), packs it into the terrain partition
+ * through the flash driver and reports the compression against raw
+ * 16-bit posts. It then flies a 40 m survey over it twice with the same
+ * point-mass vehicle and navigation's tracking law: once terrain-relative
+ * (the mission flagged MISSION_FLAG_TERRAIN, tiles streamed from the
+ * flash through the LRU cache), once at a fixed altitude 40 m above the
+ * launch point as a flat-terrain mission would fly. Meanwhile a logger
+ * programs a page every 4 ms and erases a sector every second, so tile
+ * loads have to wait for the flash like they do in flight. For each run
+ * it prints:
+ *   agl_min     lowest height above the terrain (m)
+ *   agl_mean    mean height above the terrain (m)
+ *   agl_rms     RMS error from the planned 40 m (m)
+ *   low_s       time below half the planned height (s)
+ *   stale       ticks the follower held the ground for a missing tile
+ * and the cache counters. Last, the lookup cost over cached tiles.
+ * --write keeps the flash image (TMF_FLASH_FILE) with the DEM and the
+ * terrain-relative survey, so a SIL run loads both from it.
+ */
+
+#include "hardware_drivers.h"
+#include "host_clock.h"
+#include "local_frame.h"
+#include "mission.h"
+#include "system_clock.h"
+#include "terrain.h"
+#include "trajectory.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define SIM_STEP_S        0.002     // Navigation task period
+#define VEHICLE_TAU_S     0.3f      // Velocity loop time constant
+#define VEHICLE_MAX_ACCEL 8.0f
+
+// Navigation's tracking law (navigation.cpp)
+#define TRACK_GAIN        1.0f
+#define TRACK_MAX_SPEED   18.0f
+#define TRACK_MAX_CLIMB   3.0f
+
+// Logger flash traffic
+#define LOG_PAGE_PERIOD_US   4000
+#define LOG_ERASE_PERIOD_US  1000000
+
+#define DEM_LAT           47.3500
+#define DEM_LON           8.5000
+#define DEM_SPACING       (1.0 / 3600.0)
+#define DEM_TILES_NORTH   8
+#define DEM_TILES_EAST    12
+
+#define SURVEY_AGL        40.0f
+#define SURVEY_LANES      12
+#define SURVEY_LANE_M     3000.0f
+#define SURVEY_SPACING_M  100.0f
+#define SURVEY_SAMPLE_M   100.0f
+
+typedef struct {
+    double agl_min, agl_sum, err_sq, low_s;
+    uint64_t steps;
+    uint32_t stale;
+    double time_s;
+    bool finished;
+} Result_t;
+
+static Terrain_Grid_t grid;
+static LocalFrame_t origin;     // Survey start, on the ground
+static float launch_ground;
+static uint32_t log_address = 0;
+static uint64_t next_page_us = 0, next_erase_us = 0;
+
+// Smooth hills, a ridge running north-east and a little roughness (m)
+static float dem_height(double latitude, double longitude) {
+    double n = (latitude - DEM_LAT) * 111200.0;
+    double e = (longitude - DEM_LON) * 75300.0;
+    double h = 420.0 + 60.0 * sin(n * 0.0011) * cos(e * 0.0008) + 25.0 * sin(n * 0.0031 + e * 0.0023);
+    double across = (e - 0.8 * n - 2500.0) / 180.0;
+    h += 140.0 * exp(-across * across);
+    h += 1.5 * sin(n * 0.071 + 1.3) * sin(e * 0.093 + 0.4);
+    return (float)h;
+}
+
+// Pack the DEM into the terrain partition; returns the stored bytes
+static uint32_t write_dem(void) {
+    const uint32_t tiles = DEM_TILES_NORTH * DEM_TILES_EAST;
+    std::vector<uint8_t> image(TERRAIN_HEADER_BYTES + tiles * TERRAIN_INDEX_BYTES);
+    Terrain_EncodeHeader(&grid, image.data());
+
+    std::vector<float> heights(TERRAIN_TILE_POSTS * TERRAIN_TILE_POSTS);
+    uint8_t tile[TERRAIN_MAX_TILE_BYTES];
+    for (uint32_t key = 0; key < tiles; key++) {
+        uint32_t row = key / DEM_TILES_EAST, col = key % DEM_TILES_EAST;
+        for (uint32_t i = 0; i < heights.size(); i++) {
+            double post_n = row * TERRAIN_TILE_CELLS + i / TERRAIN_TILE_POSTS;
+            double post_e = col * TERRAIN_TILE_CELLS + i % TERRAIN_TILE_POSTS;
+            heights[i] = dem_height(DEM_LAT + post_n * DEM_SPACING, DEM_LON + post_e * DEM_SPACING);
+        }
+        uint32_t length = Terrain_EncodeTile(heights.data(), tile);
+        if (length == 0) return 0;
+        Terrain_EncodeIndex((uint32_t)image.size(), length,
+                            &image[TERRAIN_HEADER_BYTES + key * TERRAIN_INDEX_BYTES]);
+        image.insert(image.end(), tile, tile + length);
+    }
+    uint32_t bytes = (uint32_t)image.size();
+    if (bytes > FLASH_TERRAIN_SIZE) return 0;
+
+    for (uint32_t offset = 0; offset < bytes; offset += FLASH_SECTOR_SIZE) {
+        if (!Flash_StartSectorErase(FLASH_TERRAIN_BASE + offset)) return 0;
+        while (Flash_IsBusy()) HostClock_Advance(1000);
+    }
+    for (uint32_t offset = 0; offset < bytes; offset += FLASH_PAGE_SIZE) {
+        uint32_t length = (bytes - offset < FLASH_PAGE_SIZE) ? bytes - offset : FLASH_PAGE_SIZE;
+        if (!Flash_StartProgram(FLASH_TERRAIN_BASE + offset, &image[offset], length)) return 0;
+        while (Flash_IsBusy()) HostClock_Advance(100);
+    }
+    return bytes;
+}
+
+// Lawnmower across the ridge at the survey height above the terrain, or
+// at that height above the launch point
+static std::vector<Waypoint_t> build_survey(bool terrain_relative) {
+    std::vector<Waypoint_t> w;
+    const int per_lane = (int)(SURVEY_LANE_M / SURVEY_SAMPLE_M) + 1;
+    for (int lane = 0; lane < SURVEY_LANES; lane++) {
+        for (int k = 0; k < per_lane; k++) {
+            float along = SURVEY_SAMPLE_M * ((lane % 2) ? (per_lane - 1 - k) : k);
+            float ned[3] = { along, SURVEY_SPACING_M * lane, 0.0f };
+            Waypoint_t waypoint;
+            LocalFrame_FromNED(&origin, ned, &waypoint.position.latitude, &waypoint.position.longitude,
+                               &waypoint.position.altitude);
+            waypoint.position.altitude = terrain_relative ? SURVEY_AGL : launch_ground + SURVEY_AGL;
+            waypoint.hold_time = 0.0f;
+            w.push_back(waypoint);
+        }
+    }
+    return w;
+}
+
+static bool write_mission(const std::vector<Waypoint_t> &waypoints) {
+    uint32_t bytes = MISSION_HEADER_BYTES + (uint32_t)waypoints.size() * MISSION_RECORD_BYTES;
+    std::vector<uint8_t> image(bytes);
+    Mission_EncodeHeader((uint32_t)waypoints.size(), MISSION_FLAG_TERRAIN, image.data());
+    for (size_t i = 0; i < waypoints.size(); i++) {
+        Mission_EncodeRecord(&waypoints[i], &image[MISSION_HEADER_BYTES + i * MISSION_RECORD_BYTES]);
+    }
+    for (uint32_t offset = 0; offset < bytes; offset += FLASH_SECTOR_SIZE) {
+        if (!Flash_StartSectorErase(FLASH_MISSION_BASE + offset)) return false;
+        while (Flash_IsBusy()) HostClock_Advance(1000);
+    }
+    for (uint32_t offset = 0; offset < bytes; offset += FLASH_PAGE_SIZE) {
+        uint32_t length = (bytes - offset < FLASH_PAGE_SIZE) ? bytes - offset : FLASH_PAGE_SIZE;
+        if (!Flash_StartProgram(FLASH_MISSION_BASE + offset, &image[offset], length)) return false;
+        while (Flash_IsBusy()) HostClock_Advance(100);
+    }
+    return true;
+}
+
+// A page every few milliseconds and a sector erase every second, as the
+// blackbox writes its ring
+static void log_traffic(uint64_t now_us) {
+    static uint8_t page[FLASH_PAGE_SIZE];
+    if (Flash_IsBusy()) return;
+    if (now_us >= next_erase_us) {
+        log_address = (log_address + FLASH_SECTOR_SIZE) % FLASH_LOG_END;
+        Flash_StartSectorErase(log_address);
+        next_erase_us = now_us + LOG_ERASE_PERIOD_US;
+        return;
+    }
+    if (now_us >= next_page_us) {
+        memset(page, (int)(now_us & 0xFF), sizeof(page));
+        Flash_StartProgram(log_address + (uint32_t)((now_us / LOG_PAGE_PERIOD_US) % (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)) *
+                           FLASH_PAGE_SIZE, page, sizeof(page));
+        next_page_us = now_us + LOG_PAGE_PERIOD_US;
+    }
+}
+
+// Point mass with a first-order velocity loop
+static void step_vehicle(float pos[3], float vel[3], const float command[3], const float feed_forward[3]) {
+    float accel[3], norm = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        accel[axis] = (command[axis] - vel[axis]) / VEHICLE_TAU_S + feed_forward[axis];
+        norm += accel[axis] * accel[axis];
+    }
+    norm = sqrtf(norm);
+    if (norm > VEHICLE_MAX_ACCEL) {
+        for (int axis = 0; axis < 3; axis++) accel[axis] *= VEHICLE_MAX_ACCEL / norm;
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        vel[axis] += accel[axis] * (float)SIM_STEP_S;
+        pos[axis] += vel[axis] * (float)SIM_STEP_S;
+    }
+}
+
+static Result_t fly(Terrain_t *terrain, const std::vector<Waypoint_t> &waypoints, bool terrain_relative) {
+    Result_t r;
+    memset(&r, 0, sizeof(r));
+    r.agl_min = 1e9;
+
+    Mission_Source_t source;
+    Mission_ArraySource(&source, waypoints.data(), (uint32_t)waypoints.size());
+    static TrajectoryPlanner_t planner;
+    TerrainFollower_t follower;
+    TerrainFollower_Reset(&follower);
+
+    float pos[3] = { 0, 0, -SURVEY_AGL }, vel[3] = { 0, 0, 0 };
+    const float hover[3] = { 0, 0, 0 };
+    float command[3] = { 0, 0, 0 };
+    bool started = false;
+    uint64_t start_us = SystemClock_Micros();
+
+    while (r.time_s < 3600.0) {
+        uint64_t now_us = SystemClock_Micros();
+        Position_t position;
+        LocalFrame_FromNED(&origin, pos, &position.latitude, &position.longitude, &position.altitude);
+
+        // Navigation task: load a tile if the flash is free, then follow
+        Terrain_Service(terrain);
+        Position_t tracked = position;
+        if (terrain_relative) {
+            const float velocity_ne[2] = { command[0], command[1] };
+            if (!TerrainFollower_Update(&follower, terrain, &position, velocity_ne, (float)SIM_STEP_S)) r.stale++;
+            tracked.altitude -= follower.ground_alt;
+        }
+        if (!started && (!terrain_relative || follower.valid)) {
+            TrajectoryPlanner_Start(&planner, &source, &tracked, vel, now_us);
+            started = true;
+        }
+
+        const float *feed_forward = hover;
+        Trajectory_Setpoint_t setpoint;
+        if (started) {
+            TrajectoryPlanner_Service(&planner);
+            TrajectoryPlanner_Sample(&planner, now_us, &tracked, &setpoint);
+            if (setpoint.complete) {
+                r.finished = true;
+                break;
+            }
+            for (int axis = 0; axis < 3; axis++) {
+                command[axis] = setpoint.velocity[axis] + TRACK_GAIN * setpoint.position_error[axis];
+            }
+            if (terrain_relative) command[2] -= follower.ground_rate;
+            float speed = sqrtf(command[0] * command[0] + command[1] * command[1]);
+            if (speed > TRACK_MAX_SPEED) {
+                command[0] *= TRACK_MAX_SPEED / speed;
+                command[1] *= TRACK_MAX_SPEED / speed;
+            }
+            command[2] = fmaxf(-TRACK_MAX_CLIMB, fminf(TRACK_MAX_CLIMB, command[2]));
+            feed_forward = setpoint.acceleration;
+        }
+
+        // Blackbox task
+        log_traffic(now_us);
+
+        step_vehicle(pos, vel, command, feed_forward);
+        HostClock_Advance((uint64_t)(SIM_STEP_S * 1e6));
+        r.time_s = (SystemClock_Micros() - start_us) * 1e-6;
+
+        if (!started) continue;
+        double agl = -pos[2] + origin.ref_alt - dem_height(position.latitude, position.longitude);
+        if (agl < r.agl_min) r.agl_min = agl;
+        r.agl_sum += agl;
+        r.err_sq += (agl - SURVEY_AGL) * (agl - SURVEY_AGL);
+        if (agl < 0.5 * SURVEY_AGL) r.low_s += SIM_STEP_S;
+        r.steps++;
+    }
+    return r;
+}
+
+static void print_result(const char *mode, const Result_t *r) {
+    char time_text[16];
+    snprintf(time_text, sizeof(time_text), r->finished ? "%.1f" : ">%.0f", r->time_s);
+    printf("%-8s %9s %8.1f %8.1f %8.2f %7.1f %6lu\n", mode, time_text, r->agl_min,
+           r->steps ? r->agl_sum / r->steps : 0.0, r->steps ? sqrt(r->err_sq / r->steps) : 0.0, r->low_s,
+           (unsigned long)r->stale);
+}
+
+int main(int argc, char **argv) {
+    bool keep = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--write") == 0 && i + 1 < argc) {
+            setenv("TMF_FLASH_FILE", argv[++i], 1);
+            keep = true;
+        }
+    }
+
+    HostClock_UseVirtual();
+    if (!Flash_Init()) {
+        fprintf(stderr, "flash unavailable\n");
+        return 1;
+    }
+
+    grid.origin_latitude = DEM_LAT;
+    grid.origin_longitude = DEM_LON;
+    grid.spacing_latitude = DEM_SPACING;
+    grid.spacing_longitude = DEM_SPACING;
+    grid.tiles_north = DEM_TILES_NORTH;
+    grid.tiles_east = DEM_TILES_EAST;
+    uint32_t stored = write_dem();
+    if (stored == 0) {
+        fprintf(stderr, "cannot store the DEM in flash\n");
+        return 1;
+    }
+    uint32_t posts = (DEM_TILES_NORTH * TERRAIN_TILE_CELLS + 1) * (DEM_TILES_EAST * TERRAIN_TILE_CELLS + 1);
+    printf("dem %ux%u tiles, %lu posts: %lu bytes stored, %lu raw (%.2f bits/post, %.1fx)\n",
+           DEM_TILES_NORTH, DEM_TILES_EAST, (unsigned long)posts, (unsigned long)stored,
+           (unsigned long)(posts * 2), stored * 8.0 / posts, posts * 2.0 / stored);
+
+    static Terrain_t terrain;
+    if (!Terrain_Open(&terrain, FLASH_TERRAIN_BASE)) {
+        fprintf(stderr, "cannot open the stored DEM\n");
+        return 1;
+    }
+
+    // Survey from 1 km in from the south-west corner
+    double start_lat = DEM_LAT + 1000.0 / 111200.0, start_lon = DEM_LON + 1000.0 / 75300.0;
+    launch_ground = dem_height(start_lat, start_lon);
+    LocalFrame_Init(&origin, start_lat, start_lon, launch_ground);
+
+    std::vector<Waypoint_t> relative = build_survey(true);
+    std::vector<Waypoint_t> fixed = build_survey(false);
+    printf("%-8s %9s %8s %8s %8s %7s %6s\n", "mode", "time_s", "agl_min", "agl_mean", "agl_rms", "low_s",
+           "stale");
+    Result_t follow = fly(&terrain, relative, true);
+    print_result("terrain", &follow);
+    Terrain_Stats_t stats = terrain.stats;
+    Result_t flat = fly(&terrain, fixed, false);
+    print_result("flat", &flat);
+
+    printf("cache lookups=%lu misses=%lu outside=%lu loads=%lu errors=%lu evictions=%lu deferred=%lu "
+           "queue_full=%lu\n",
+           (unsigned long)stats.lookups, (unsigned long)stats.misses, (unsigned long)stats.outside,
+           (unsigned long)stats.loads, (unsigned long)stats.load_errors, (unsigned long)stats.evictions,
+           (unsigned long)stats.deferred, (unsigned long)stats.queue_full);
+
+    // Lookup cost over the tiles left in the cache, around the last lane
+    Position_t centre;
+    const float last[3] = { 0.5f * SURVEY_LANE_M, SURVEY_SPACING_M * (SURVEY_LANES - 1), 0.0f };
+    LocalFrame_FromNED(&origin, last, &centre.latitude, &centre.longitude, &centre.altitude);
+    const uint32_t lookups = 2000000;
+    uint32_t seed = 12345, hits = 0;
+    float sum = 0.0f;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < lookups; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        double dn = (((seed >> 8) & 0x3FF) / 1024.0 - 0.5) * 0.003;    // +-170 m
+        double de = (((seed >> 18) & 0x3FF) / 1024.0 - 0.5) * 0.003;   // +-110 m
+        float height;
+        if (Terrain_Height(&terrain, centre.latitude + dn, centre.longitude + de, &height)) {
+            sum += height;
+            hits++;
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    printf("lookup %.1f ns (%lu of %lu cached, mean %.1f m)\n",
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / lookups, (unsigned long)hits,
+           (unsigned long)lookups, hits ? sum / hits : 0.0f);
+
+    if (keep && !write_mission(relative)) {
+        fprintf(stderr, "cannot store the mission in flash\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,335 @@
+/*
+ * trajectory_sim.cpp - Minimum-snap missions against point-to-point steering
+ * Platform: Linux host
+ * Author: BryceWDesign
+ * License: Apache-2.0
+ *
+ * Usage: tmf_trajectory_sim [scenario substring] [--write <flash image>]
+ *
+ * Flies each scenario twice with the same point-mass vehicle (first-order
+ * velocity loop, acceleration limited): once on the trajectory planner
+ * with navigation's tracking law, once with the old point-to-point
+ * steering (15 m/s toward the waypoint, next one at 10 m, holds ignored).
+ * The survey is written to the mission partition through the flash driver
+ * and streamed back from it. For each run it prints:
+ *   time_s      mission time
+ *   v_max       peak speed (m/s)
+ *   a_max       peak acceleration (m/s^2)
+ *   a_rms       RMS acceleration, the control effort
+ *   jerk_rms    RMS jerk (m/s^3)
+ *   miss_m      worst closest approach to a waypoint
+ *   track_m     RMS distance from the trajectory reference
+ *   plan_us     mean / max host time per planned segment
+ * --write keeps the flash image (TMF_FLASH_FILE) so a SIL run flies the
+ * survey from it.
+ */
+
+#include "hardware_drivers.h"
+#include "host_clock.h"
+#include "local_frame.h"
+#include "mission.h"
+#include "trajectory.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define SIM_STEP_S        0.002     // Navigation task period
+#define VEHICLE_TAU_S     0.3f      // Velocity loop time constant
+#define VEHICLE_MAX_ACCEL 8.0f
+
+// Navigation's tracking law (navigation.cpp)
+#define TRACK_GAIN        1.0f
+#define TRACK_MAX_SPEED   18.0f
+#define TRACK_MAX_CLIMB   3.0f
+
+// Point-to-point steering it replaced
+#define P2P_MAX_SPEED     15.0f
+#define P2P_ACCEPT_M      10.0f
+
+#define ORIGIN_LAT        47.3769
+#define ORIGIN_LON        8.5417
+#define ORIGIN_ALT        450.0f
+
+typedef struct {
+    const char *name;
+    bool from_flash;
+    std::vector<Waypoint_t> (*build)(void);
+} Scenario_t;
+
+typedef struct {
+    double time_s;
+    double v_max, a_max;
+    double a_sq, jerk_sq, track_sq;
+    uint64_t steps, tracked;
+    double miss_max;
+    double plan_us_sum, plan_us_max;
+    uint32_t plans;
+    bool finished;
+} Result_t;
+
+static LocalFrame_t origin;
+
+static Waypoint_t waypoint_at(float north, float east, float up, float hold) {
+    Waypoint_t waypoint;
+    float ned[3] = { north, east, -up };
+    LocalFrame_FromNED(&origin, ned, &waypoint.position.latitude, &waypoint.position.longitude,
+                       &waypoint.position.altitude);
+    waypoint.hold_time = hold;
+    return waypoint;
+}
+
+static std::vector<Waypoint_t> build_square(void) {
+    std::vector<Waypoint_t> w;
+    const float corners[][2] = { { 200, 0 }, { 200, 200 }, { 0, 200 }, { 0, 0 } };
+    for (const auto &c : corners) w.push_back(waypoint_at(c[0], c[1], 50.0f, 3.0f));
+    return w;
+}
+
+static std::vector<Waypoint_t> build_zigzag(void) {
+    std::vector<Waypoint_t> w;
+    for (int i = 1; i <= 12; i++) w.push_back(waypoint_at(70.0f * i, (i % 2) ? 40.0f : -40.0f, 50.0f, 0.0f));
+    return w;
+}
+
+static std::vector<Waypoint_t> build_climb(void) {
+    std::vector<Waypoint_t> w;
+    const float legs[][2] = { { 150, 60 }, { 300, 90 }, { 450, 60 }, { 600, 30 } };
+    for (const auto &l : legs) w.push_back(waypoint_at(l[0], 0.0f, l[1], 0.0f));
+    return w;
+}
+
+// Lawnmower: 400 m lanes sampled every 40 m, 30 m apart, terrain-like
+// altitude, a 5 s photo hold every 400 waypoints
+static std::vector<Waypoint_t> build_survey(void) {
+    std::vector<Waypoint_t> w;
+    const int per_lane = 11;
+    for (int i = 0; i < 2000; i++) {
+        int lane = i / per_lane, k = i % per_lane;
+        float along = 40.0f * ((lane % 2) ? (per_lane - 1 - k) : k);
+        float up = 80.0f + 10.0f * sinf(along * 0.01f + lane * 0.3f);
+        w.push_back(waypoint_at(along, 30.0f * lane, up, (i % 400 == 399) ? 5.0f : 0.0f));
+    }
+    return w;
+}
+
+static const Scenario_t scenarios[] = {
+    { "square", false, build_square },
+    { "zigzag", false, build_zigzag },
+    { "climb",  false, build_climb },
+    { "survey", true,  build_survey },
+};
+
+// Store the mission in the flash partition the way an upload would
+static bool write_flash(const std::vector<Waypoint_t> &waypoints) {
+    uint32_t bytes = MISSION_HEADER_BYTES + (uint32_t)waypoints.size() * MISSION_RECORD_BYTES;
+    if (bytes > FLASH_MISSION_SIZE) return false;
+
+    std::vector<uint8_t> image(bytes);
+    Mission_EncodeHeader((uint32_t)waypoints.size(), 0, image.data());
+    for (size_t i = 0; i < waypoints.size(); i++) {
+        Mission_EncodeRecord(&waypoints[i], &image[MISSION_HEADER_BYTES + i * MISSION_RECORD_BYTES]);
+    }
+
+    for (uint32_t offset = 0; offset < bytes; offset += FLASH_SECTOR_SIZE) {
+        if (!Flash_StartSectorErase(FLASH_MISSION_BASE + offset)) return false;
+        while (Flash_IsBusy()) HostClock_Advance(1000);
+    }
+    for (uint32_t offset = 0; offset < bytes; offset += FLASH_PAGE_SIZE) {
+        uint32_t length = (bytes - offset < FLASH_PAGE_SIZE) ? bytes - offset : FLASH_PAGE_SIZE;
+        if (!Flash_StartProgram(FLASH_MISSION_BASE + offset, &image[offset], length)) return false;
+        while (Flash_IsBusy()) HostClock_Advance(100);
+    }
+    return true;
+}
+
+// Point mass with a first-order velocity loop; returns the acceleration
+static void step_vehicle(float pos[3], float vel[3], const float command[3], const float feed_forward[3],
+                         float accel[3]) {
+    float norm = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        accel[axis] = (command[axis] - vel[axis]) / VEHICLE_TAU_S + feed_forward[axis];
+        norm += accel[axis] * accel[axis];
+    }
+    norm = sqrtf(norm);
+    if (norm > VEHICLE_MAX_ACCEL) {
+        for (int axis = 0; axis < 3; axis++) accel[axis] *= VEHICLE_MAX_ACCEL / norm;
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        vel[axis] += accel[axis] * (float)SIM_STEP_S;
+        pos[axis] += vel[axis] * (float)SIM_STEP_S;
+    }
+}
+
+static void record(Result_t *r, const float vel[3], const float accel[3], float prev_accel[3]) {
+    double speed = sqrt(vel[0] * vel[0] + vel[1] * vel[1] + vel[2] * vel[2]);
+    double a_sq = accel[0] * accel[0] + accel[1] * accel[1] + accel[2] * accel[2];
+    double j_sq = 0.0;
+    for (int axis = 0; axis < 3; axis++) {
+        double jerk = (accel[axis] - prev_accel[axis]) / SIM_STEP_S;
+        j_sq += jerk * jerk;
+        prev_accel[axis] = accel[axis];
+    }
+    if (speed > r->v_max) r->v_max = speed;
+    if (sqrt(a_sq) > r->a_max) r->a_max = sqrt(a_sq);
+    r->a_sq += a_sq;
+    if (r->steps > 0) r->jerk_sq += j_sq;
+    r->steps++;
+}
+
+static void update_miss(std::vector<double> &miss, const std::vector<Waypoint_t> &w, uint32_t index,
+                        const float pos[3]) {
+    for (uint32_t i = (index > 0) ? index - 1 : 0; i <= index && i < w.size(); i++) {
+        float ned[3];
+        LocalFrame_ToNED(&origin, w[i].position.latitude, w[i].position.longitude, w[i].position.altitude, ned);
+        double d = sqrt((ned[0] - pos[0]) * (ned[0] - pos[0]) + (ned[1] - pos[1]) * (ned[1] - pos[1]) +
+                        (ned[2] - pos[2]) * (ned[2] - pos[2]));
+        if (d < miss[i]) miss[i] = d;
+    }
+}
+
+static Result_t fly_trajectory(const Mission_Source_t *source, const std::vector<Waypoint_t> &w,
+                               double time_limit) {
+    Result_t r;
+    memset(&r, 0, sizeof(r));
+    std::vector<double> miss(w.size(), 1e9);
+    float pos[3] = { 0, 0, -50.0f }, vel[3] = { 0, 0, 0 }, accel[3], prev_accel[3] = { 0, 0, 0 };
+
+    static TrajectoryPlanner_t planner;
+    Position_t position;
+    LocalFrame_FromNED(&origin, pos, &position.latitude, &position.longitude, &position.altitude);
+    TrajectoryPlanner_Start(&planner, source, &position, vel, 0);
+
+    for (uint64_t step = 0; r.time_s < time_limit; step++) {
+        auto t0 = std::chrono::steady_clock::now();
+        bool planned = TrajectoryPlanner_Service(&planner);
+        auto t1 = std::chrono::steady_clock::now();
+        if (planned) {
+            double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+            r.plan_us_sum += us;
+            if (us > r.plan_us_max) r.plan_us_max = us;
+            r.plans++;
+        }
+
+        LocalFrame_FromNED(&origin, pos, &position.latitude, &position.longitude, &position.altitude);
+        Trajectory_Setpoint_t setpoint;
+        TrajectoryPlanner_Sample(&planner, (uint64_t)(r.time_s * 1e6 + 0.5), &position, &setpoint);
+        if (setpoint.complete) {
+            r.finished = true;
+            break;
+        }
+
+        float command[3];
+        for (int axis = 0; axis < 3; axis++) {
+            command[axis] = setpoint.velocity[axis] + TRACK_GAIN * setpoint.position_error[axis];
+        }
+        float speed = sqrtf(command[0] * command[0] + command[1] * command[1]);
+        if (speed > TRACK_MAX_SPEED) {
+            command[0] *= TRACK_MAX_SPEED / speed;
+            command[1] *= TRACK_MAX_SPEED / speed;
+        }
+        command[2] = fmaxf(-TRACK_MAX_CLIMB, fminf(TRACK_MAX_CLIMB, command[2]));
+
+        if (setpoint.target != NULL) {
+            r.track_sq += setpoint.position_error[0] * setpoint.position_error[0] +
+                          setpoint.position_error[1] * setpoint.position_error[1] +
+                          setpoint.position_error[2] * setpoint.position_error[2];
+            r.tracked++;
+            update_miss(miss, w, setpoint.target_index, pos);
+        }
+        step_vehicle(pos, vel, command, setpoint.acceleration, accel);
+        record(&r, vel, accel, prev_accel);
+        r.time_s += SIM_STEP_S;
+    }
+    for (double m : miss) r.miss_max = fmax(r.miss_max, m);
+    return r;
+}
+
+static Result_t fly_point_to_point(const std::vector<Waypoint_t> &w, double time_limit) {
+    Result_t r;
+    memset(&r, 0, sizeof(r));
+    std::vector<double> miss(w.size(), 1e9);
+    float pos[3] = { 0, 0, -50.0f }, vel[3] = { 0, 0, 0 }, accel[3], prev_accel[3] = { 0, 0, 0 };
+    const float none[3] = { 0, 0, 0 };
+
+    uint32_t index = 0;
+    while (r.time_s < time_limit) {
+        float target[3];
+        LocalFrame_ToNED(&origin, w[index].position.latitude, w[index].position.longitude,
+                         w[index].position.altitude, target);
+        float dn = target[0] - pos[0], de = target[1] - pos[1];
+        float distance = sqrtf(dn * dn + de * de);
+        update_miss(miss, w, index, pos);
+        if (distance < P2P_ACCEPT_M) {
+            if (++index >= w.size()) {
+                r.finished = true;
+                break;
+            }
+            continue;
+        }
+
+        // Horizontal only, altitude held by a separate loop
+        float speed = (distance > P2P_MAX_SPEED) ? P2P_MAX_SPEED : distance;
+        float command[3] = { dn * speed / distance, de * speed / distance,
+                             fmaxf(-TRACK_MAX_CLIMB, fminf(TRACK_MAX_CLIMB, target[2] - pos[2])) };
+        step_vehicle(pos, vel, command, none, accel);
+        record(&r, vel, accel, prev_accel);
+        r.time_s += SIM_STEP_S;
+    }
+    for (double m : miss) r.miss_max = fmax(r.miss_max, m);
+    return r;
+}
+
+static void print_result(const char *name, const char *mode, const Result_t *r) {
+    char time_text[16], track_text[16] = "-", plan_text[24] = "-";
+    snprintf(time_text, sizeof(time_text), r->finished ? "%.1f" : ">%.0f", r->time_s);
+    if (r->tracked) snprintf(track_text, sizeof(track_text), "%.2f", sqrt(r->track_sq / r->tracked));
+    if (r->plans) snprintf(plan_text, sizeof(plan_text), "%.1f/%.1f", r->plan_us_sum / r->plans, r->plan_us_max);
+    printf("%-8s %-8s %9s %6.1f %6.2f %6.2f %9.1f %7.1f %8s %12s\n", name, mode, time_text, r->v_max, r->a_max,
+           r->steps ? sqrt(r->a_sq / r->steps) : 0.0, r->steps > 1 ? sqrt(r->jerk_sq / (r->steps - 1)) : 0.0,
+           r->miss_max, track_text, plan_text);
+}
+
+static void run(const Scenario_t *s) {
+    std::vector<Waypoint_t> waypoints = s->build();
+    Mission_Source_t source;
+    if (s->from_flash) {
+        if (!write_flash(waypoints) || !Mission_FlashSource(&source, FLASH_MISSION_BASE)) {
+            printf("%-8s cannot store the mission in flash\n", s->name);
+            return;
+        }
+    } else {
+        Mission_ArraySource(&source, waypoints.data(), (uint32_t)waypoints.size());
+    }
+
+    double limit = 4.0 * 60.0 * 60.0;
+    Result_t snap = fly_trajectory(&source, waypoints, limit);
+    Result_t p2p = fly_point_to_point(waypoints, limit);
+    print_result(s->name, "minsnap", &snap);
+    print_result(s->name, "p2p", &p2p);
+}
+
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--write") == 0 && i + 1 < argc) setenv("TMF_FLASH_FILE", argv[++i], 1);
+        else filter = argv[i];
+    }
+
+    HostClock_UseVirtual();
+    if (!Flash_Init()) {
+        fprintf(stderr, "flash unavailable\n");
+        return 1;
+    }
+    LocalFrame_Init(&origin, ORIGIN_LAT, ORIGIN_LON, ORIGIN_ALT);
+
+    printf("%-8s %-8s %9s %6s %6s %6s %9s %7s %8s %12s\n", "scenario", "mode", "time_s", "v_max", "a_max",
+           "a_rms", "jerk_rms", "miss_m", "track_m", "plan_us");
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        if (filter != NULL && strstr(scenarios[i].name, filter) == NULL) continue;
+        run(&scenarios[i]);
+    }
+    return 0;
+}